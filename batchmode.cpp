@@ -0,0 +1,514 @@
+#include "batchmode.h"
+#include "filemetadata.h"
+#include "logcompressor.h"
+#include "logrotation.h"
+#include "logscanner.h"
+#include "pacmandb.h"
+#include "privilegedhelper.h"
+
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QProcess>
+#include <QtCore/QSet>
+#include <QtCore/QVector>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <mntent.h>
+#include <sys/statvfs.h>
+
+namespace {
+
+const int Success = 0;
+const int Failure = 1;
+const int UsageError = 2;
+
+struct Command
+{
+    const char *name;
+    const char *description;
+};
+
+const Command Commands[] = {
+    { "cache-prune", "Remove cached package files of packages that are gone from every repository" },
+    { "orphans", "List orphaned packages, or remove them with --remove" },
+    { "logs-compress", "Compress uncompressed logs older than a number of days" },
+    { "logs-rotate", "Apply the log rotation policy" },
+    { "disk-report", "Report usage of mounted filesystems and, optionally, the largest files under a path" },
+};
+
+void writeLine(const QByteArray &line)
+{
+    fwrite(line.constData(), 1, size_t(line.size()), stdout);
+    fputc('\n', stdout);
+    fflush(stdout);
+}
+
+void printUsage(FILE *stream)
+{
+    fprintf(stream, "Usage: %s <command> [options]\n\nCommands:\n",
+            qPrintable(QCoreApplication::applicationFilePath().section('/', -1)));
+    for (const Command &command : Commands) {
+        fprintf(stream, "  %-15s %s\n", command.name, command.description);
+    }
+    fprintf(stream, "\nRun '<command> --help' for its options. Without a command the GUI starts.\n");
+}
+
+// The options every command takes; false (after printing why) on bad usage.
+// Read-only commands pass a null dryRun and don't accept --dry-run.
+bool parseArguments(QCommandLineParser &parser, const QStringList &arguments, BatchOutput::Format *format,
+                    bool *dryRun)
+{
+    const QCommandLineOption formatOption("format", "Output format: json (one document) or ndjson (one object per line).",
+                                          "format", "json");
+    const QCommandLineOption dryRunOption("dry-run", "Report what would be done without changing anything.");
+    const QCommandLineOption helpOption(QStringList() << "h" << "help", "Show this help.");
+    parser.addOption(formatOption);
+    if (dryRun) {
+        parser.addOption(dryRunOption);
+    }
+    parser.addOption(helpOption);
+
+    if (!parser.parse(arguments)) {
+        fprintf(stderr, "%s\n", qPrintable(parser.errorText()));
+        return false;
+    }
+    if (parser.isSet(helpOption)) {
+        fputs(qPrintable(parser.helpText()), stdout);
+        exit(Success);
+    }
+    if (!parser.positionalArguments().isEmpty()) {
+        fprintf(stderr, "Unexpected argument: %s\n", qPrintable(parser.positionalArguments().first()));
+        return false;
+    }
+
+    const QString name = parser.value(formatOption);
+    if (name != "json" && name != "ndjson") {
+        fprintf(stderr, "Unknown format: %s\n", qPrintable(name));
+        return false;
+    }
+    *format = name == "ndjson" ? BatchOutput::NdJson : BatchOutput::Json;
+    if (dryRun) {
+        *dryRun = parser.isSet(dryRunOption);
+    }
+    return true;
+}
+
+bool parseCount(const QString &value, const char *option, int *count)
+{
+    bool ok = false;
+    *count = value.toInt(&ok);
+    if (!ok || *count < 0) {
+        fprintf(stderr, "--%s expects a non-negative number, got %s\n", option, qPrintable(value));
+        return false;
+    }
+    return true;
+}
+
+QString statusKey(CachedPackage::Status status)
+{
+    switch (status) {
+    case CachedPackage::Installed:
+        return "installed";
+    case CachedPackage::InRepo:
+        return "in-repo";
+    case CachedPackage::Dead:
+        break;
+    }
+    return "dead";
+}
+
+QJsonObject compressionRecord(const CompressionResult &result)
+{
+    QJsonObject record {
+        { "path", result.sourcePath },
+        { "inputBytes", double(result.inputBytes) },
+    };
+    if (result.ok()) {
+        record.insert("output", result.outputPath);
+        record.insert("outputBytes", double(result.outputBytes));
+        record.insert("elapsedMs", double(result.elapsedMs));
+    } else {
+        record.insert("error", result.error);
+    }
+    return record;
+}
+
+} // namespace
+
+void BatchOutput::record(const QJsonObject &item)
+{
+    if (m_format == NdJson) {
+        writeLine(QJsonDocument(item).toJson(QJsonDocument::Compact));
+    } else {
+        m_items.append(item);
+    }
+}
+
+void BatchOutput::finish(const QJsonObject &summary, const QStringList &errors)
+{
+    QJsonObject result = summary;
+    result.insert("errors", QJsonArray::fromStringList(errors));
+    if (m_format == NdJson) {
+        // Tells the summary apart from the records before it.
+        result.insert("summary", true);
+        writeLine(QJsonDocument(result).toJson(QJsonDocument::Compact));
+        return;
+    }
+    const QJsonObject document {
+        { "command", m_command },
+        { "items", m_items },
+        { "summary", result },
+    };
+    writeLine(QJsonDocument(document).toJson(QJsonDocument::Indented).trimmed());
+}
+
+bool BatchMode::isCommand(const char *argument)
+{
+    for (const Command &command : Commands) {
+        if (qstrcmp(argument, command.name) == 0) {
+            return true;
+        }
+    }
+    return qstrcmp(argument, "help") == 0;
+}
+
+int BatchMode::run(int argc, char *argv[])
+{
+    // Only the core event dispatcher: no display connection, no widgets,
+    // nothing the GUI's constructor would load.
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("Pacman Cache Cleaner");
+
+    const QString command = QString::fromLocal8Bit(argv[1]);
+    // QCommandLineParser expects the program name first.
+    QStringList arguments = app.arguments();
+    arguments.removeAt(1);
+
+    if (command == "help") {
+        printUsage(stdout);
+        return Success;
+    }
+    if (command == "cache-prune") {
+        return cachePrune(arguments);
+    }
+    if (command == "orphans") {
+        return orphans(arguments);
+    }
+    if (command == "logs-compress") {
+        return logsCompress(arguments);
+    }
+    if (command == "logs-rotate") {
+        return logsRotate(arguments);
+    }
+    if (command == "disk-report") {
+        return diskReport(arguments);
+    }
+    printUsage(stderr);
+    return UsageError;
+}
+
+int BatchMode::cachePrune(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    const QCommandLineOption uninstalledOption("uninstalled",
+        "Also remove files of packages that are not installed but still in a sync repository.");
+    parser.addOption(uninstalledOption);
+    BatchOutput::Format format;
+    bool dryRun = false;
+    if (!parseArguments(parser, arguments, &format, &dryRun)) {
+        return UsageError;
+    }
+    const bool uninstalled = parser.isSet(uninstalledOption);
+
+    BatchOutput output("cache-prune", format);
+    QVector<CachedPackage> cached = PacmanCache::list();
+    PacmanCache::classify(cached, PacmanLocalDb::read(), PacmanSyncDb::readAll());
+
+    const QDir cache(PacmanCache::defaultPath());
+    QStringList paths;
+    int packages = 0;
+    qint64 bytes = 0;
+    for (const CachedPackage &package : qAsConst(cached)) {
+        if (package.status == CachedPackage::Installed || (package.status == CachedPackage::InRepo && !uninstalled)) {
+            continue;
+        }
+        const QString path = cache.filePath(package.fileName);
+        paths << path;
+        if (QFileInfo::exists(path + ".sig")) {
+            paths << path + ".sig";
+        }
+        ++packages;
+        bytes += package.size;
+        output.record(QJsonObject {
+            { "path", path },
+            { "name", package.name },
+            { "version", package.version },
+            { "status", statusKey(package.status) },
+            { "size", double(package.size) },
+        });
+    }
+
+    QStringList errors;
+    qint64 freed = 0;
+    if (!dryRun && !paths.isEmpty()) {
+        errors = PrivilegedHelper::instance().removeFiles(paths, &freed);
+    }
+    output.finish(QJsonObject {
+        { "dryRun", dryRun },
+        { "packages", packages },
+        { "bytes", double(bytes) },
+        { "freed", double(freed) },
+    }, errors);
+    return errors.isEmpty() ? Success : Failure;
+}
+
+int BatchMode::orphans(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    const QCommandLineOption removeOption("remove", "Remove the orphans (pacman -Rns) instead of only listing them.");
+    parser.addOption(removeOption);
+    BatchOutput::Format format;
+    bool dryRun = false;
+    if (!parseArguments(parser, arguments, &format, &dryRun)) {
+        return UsageError;
+    }
+    const bool remove = parser.isSet(removeOption) && !dryRun;
+
+    BatchOutput output("orphans", format);
+    QProcess pacman;
+    pacman.start("pacman", QStringList() << "-Qdtq");
+    pacman.waitForFinished(-1);
+    // pacman exits 1 when there is nothing to list.
+    const QStringList names = QString::fromLocal8Bit(pacman.readAllStandardOutput()).split('\n', Qt::SkipEmptyParts);
+    if (pacman.error() == QProcess::FailedToStart || pacman.exitStatus() != QProcess::NormalExit
+        || (pacman.exitCode() != 0 && !names.isEmpty())) {
+        const QString error = pacman.error() == QProcess::FailedToStart
+            ? pacman.errorString() : QString::fromLocal8Bit(pacman.readAllStandardError()).trimmed();
+        output.finish(QJsonObject { { "dryRun", dryRun }, { "packages", 0 } }, QStringList() << error);
+        return Failure;
+    }
+
+    for (const QString &name : names) {
+        output.record(QJsonObject { { "name", name.trimmed() } });
+    }
+
+    QStringList errors;
+    if (remove && !names.isEmpty()) {
+        QString error;
+        // pacman's own progress goes to stderr; stdout is for the JSON.
+        const bool ok = PrivilegedHelper::instance().removePackages(names, [](const QByteArray &chunk) {
+            fwrite(chunk.constData(), 1, size_t(chunk.size()), stderr);
+        }, &error);
+        if (!ok) {
+            errors << error;
+        }
+    }
+    output.finish(QJsonObject {
+        { "dryRun", dryRun },
+        { "removed", remove && !names.isEmpty() && errors.isEmpty() },
+        { "packages", names.size() },
+    }, errors);
+    return errors.isEmpty() ? Success : Failure;
+}
+
+int BatchMode::logsCompress(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    const QCommandLineOption olderThanOption("older-than", "Only logs last modified more than this many days ago.",
+                                             "days", "7");
+    const QCommandLineOption codecOption("codec", "gzip or zstd.", "codec", "gzip");
+    parser.addOption(olderThanOption);
+    parser.addOption(codecOption);
+    BatchOutput::Format format;
+    bool dryRun = false;
+    int days = 0;
+    if (!parseArguments(parser, arguments, &format, &dryRun)
+        || !parseCount(parser.value(olderThanOption), "older-than", &days)) {
+        return UsageError;
+    }
+    const QString codecName = parser.value(codecOption);
+    if (codecName != "gzip" && codecName != "zstd") {
+        fprintf(stderr, "Unknown codec: %s\n", qPrintable(codecName));
+        return UsageError;
+    }
+
+    BatchOutput output("logs-compress", format);
+    const qint64 cutoff = QDateTime::currentSecsSinceEpoch() - qint64(days) * 24 * 3600;
+    QStringList pending;
+    qint64 bytes = 0;
+    // The helper only compresses under /var/log, so that is all there is to scan.
+    for (const LogFileInfo &log : LogScanner::scan()) {
+        if (!log.compressed && log.mtime < cutoff) {
+            pending << log.path;
+            bytes += log.size;
+        }
+    }
+
+    PrivilegedCompressJob job;
+    job.codec = codecName == "zstd" ? CompressionCodec::Zstd : CompressionCodec::Gzip;
+    QStringList errors;
+    qint64 outputBytes = 0;
+    if (dryRun) {
+        for (const QString &path : qAsConst(pending)) {
+            output.record(QJsonObject { { "path", path } });
+        }
+    } else {
+        // Same fan-out as the Logs tab: one request per file, the helper
+        // spreads each file's blocks over its own pool.
+        const QVector<CompressionResult> results =
+            QtConcurrent::blockingMapped<QVector<CompressionResult>>(pending, job);
+        for (const CompressionResult &result : results) {
+            output.record(compressionRecord(result));
+            if (result.ok()) {
+                outputBytes += result.outputBytes;
+            } else {
+                errors << QString("%1: %2").arg(result.sourcePath, result.error);
+            }
+        }
+    }
+    output.finish(QJsonObject {
+        { "dryRun", dryRun },
+        { "files", pending.size() },
+        { "inputBytes", double(bytes) },
+        { "outputBytes", double(outputBytes) },
+    }, errors);
+    return errors.isEmpty() ? Success : Failure;
+}
+
+int BatchMode::logsRotate(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    const QCommandLineOption policyOption("policy", "Rotation policy file, as saved by the Rotation dialog.", "file",
+                                          RotationPolicy::defaultPath());
+    parser.addOption(policyOption);
+    BatchOutput::Format format;
+    bool dryRun = false;
+    if (!parseArguments(parser, arguments, &format, &dryRun)) {
+        return UsageError;
+    }
+
+    const QString policyPath = parser.value(policyOption);
+    QFile file(policyPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        fprintf(stderr, "%s: %s\n", qPrintable(policyPath), qPrintable(file.errorString()));
+        return UsageError;
+    }
+    const RotationPolicy policy = RotationPolicy::fromJson(file.readAll());
+
+    BatchOutput output("logs-rotate", format);
+    const QVector<RotationTask> tasks = LogRotator::plan(policy, LogScanner::scan(), LogRotator::openFiles(),
+                                                         QDateTime::currentSecsSinceEpoch());
+    for (const RotationTask &task : tasks) {
+        output.record(QJsonObject {
+            { "path", task.path },
+            { "size", double(task.size) },
+            { "reason", task.reason },
+            { "method", LogRotator::methodName(task.method) },
+            { "compress", task.compress },
+            { "deletions", QJsonArray::fromStringList(task.deletions) },
+        });
+    }
+
+    if (dryRun) {
+        output.finish(QJsonObject { { "dryRun", true }, { "planned", tasks.size() } });
+        return Success;
+    }
+    // The helper plans again with root's view of /var/log and /proc.
+    const RotationReport report = PrivilegedHelper::instance().rotateLogs(policy);
+    output.finish(QJsonObject {
+        { "dryRun", false },
+        { "planned", tasks.size() },
+        { "rotated", report.rotated },
+        { "compressed", report.compressed },
+        { "deleted", report.deleted },
+        { "bytesRotated", double(report.bytesRotated) },
+        { "elapsedMs", double(report.elapsedMs) },
+    }, report.errors);
+    return report.errors.isEmpty() ? Success : Failure;
+}
+
+int BatchMode::diskReport(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    const QCommandLineOption pathOption("path", "Also list the largest files below this directory.", "path");
+    const QCommandLineOption topOption("top", "How many of the largest files to list.", "count", "20");
+    parser.addOption(pathOption);
+    parser.addOption(topOption);
+    BatchOutput::Format format;
+    int top = 0;
+    if (!parseArguments(parser, arguments, &format, nullptr) || !parseCount(parser.value(topOption), "top", &top)) {
+        return UsageError;
+    }
+
+    BatchOutput output("disk-report", format);
+    QStringList errors;
+    int filesystems = 0;
+    // What the Disk Usage tab lists: block-device mounts, each device once.
+    if (FILE *mounts = setmntent("/proc/self/mounts", "r")) {
+        QSet<QString> seen;
+        while (struct mntent *entry = getmntent(mounts)) {
+            const QString device = QString::fromLocal8Bit(entry->mnt_fsname);
+            if (!device.startsWith("/dev/") || seen.contains(device)) {
+                continue;
+            }
+            seen.insert(device);
+            struct statvfs st;
+            if (::statvfs(entry->mnt_dir, &st) != 0) {
+                continue;
+            }
+            const qint64 size = qint64(st.f_blocks) * qint64(st.f_frsize);
+            const qint64 available = qint64(st.f_bavail) * qint64(st.f_frsize);
+            const qint64 used = size - qint64(st.f_bfree) * qint64(st.f_frsize);
+            output.record(QJsonObject {
+                { "type", "filesystem" },
+                { "device", device },
+                { "mountpoint", QString::fromLocal8Bit(entry->mnt_dir) },
+                { "fstype", QString::fromLocal8Bit(entry->mnt_type) },
+                { "size", double(size) },
+                { "used", double(used) },
+                { "available", double(available) },
+            });
+            ++filesystems;
+        }
+        endmntent(mounts);
+    } else {
+        errors << "Cannot read /proc/self/mounts";
+    }
+
+    int files = 0;
+    if (parser.isSet(pathOption)) {
+        const QString root = QDir::cleanPath(QDir(parser.value(pathOption)).absolutePath());
+        if (!QFileInfo(root).isDir()) {
+            errors << QString("%1: not a directory").arg(root);
+        } else {
+            FileMetadataCache &metadata = FileMetadataCache::instance();
+            metadata.scanTree(root);
+            QVector<FileMetadata> entries = metadata.entriesUnder(root);
+            const int count = qMin(top, entries.size());
+            std::partial_sort(entries.begin(), entries.begin() + count, entries.end(),
+                              [](const FileMetadata &a, const FileMetadata &b) {
+                                  return a.allocated > b.allocated;
+                              });
+            for (int i = 0; i < count; ++i) {
+                output.record(QJsonObject {
+                    { "type", "file" },
+                    { "path", entries.at(i).path },
+                    { "size", double(entries.at(i).size) },
+                    { "allocated", double(entries.at(i).allocated) },
+                    { "mtime", double(entries.at(i).mtime) },
+                });
+            }
+            files = count;
+        }
+    }
+    output.finish(QJsonObject { { "filesystems", filesystems }, { "files", files } }, errors);
+    return errors.isEmpty() ? Success : Failure;
+}
@@ -0,0 +1,52 @@
+#ifndef BATCHMODE_H
+#define BATCHMODE_H
+
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonObject>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+// Writes a command's records to stdout: as they are produced, one compact
+// object per line (NDJSON), or collected into one document at the end.
+class BatchOutput
+{
+public:
+    enum Format
+    {
+        Json,
+        NdJson
+    };
+
+    BatchOutput(const QString &command, Format format) : m_command(command), m_format(format) {}
+
+    void record(const QJsonObject &item);
+    // Ends the output; errors, if any, are reported alongside the summary.
+    void finish(const QJsonObject &summary, const QStringList &errors = QStringList());
+
+private:
+    QString m_command;
+    Format m_format;
+    QJsonArray m_items;
+};
+
+// `PacmanCacheCleaner <command> [options]`, for cron and fleet automation:
+// no QApplication, no display, no widgets, just the engines the tabs use
+// and JSON on stdout. Anything needing root goes through the privileged
+// helper, or runs directly when invoked as root.
+//
+// Exit status: 0 on success, 1 when any operation failed, 2 on bad usage.
+class BatchMode
+{
+public:
+    static bool isCommand(const char *argument);
+    static int run(int argc, char *argv[]);
+
+private:
+    static int cachePrune(const QStringList &arguments);
+    static int orphans(const QStringList &arguments);
+    static int logsCompress(const QStringList &arguments);
+    static int logsRotate(const QStringList &arguments);
+    static int diskReport(const QStringList &arguments);
+};
+
+#endif // BATCHMODE_H
@@ -0,0 +1,161 @@
+#include "bootanalysis.h"
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QSet>
+#include <QtDBus/QDBusArgument>
+#include <QtDBus/QDBusError>
+#include <QtDBus/QDBusMessage>
+#include <QtDBus/QDBusMetaType>
+#include <QtDBus/QDBusObjectPath>
+#include <QtDBus/QDBusPendingCall>
+
+#include <algorithm>
+
+namespace {
+
+const char ManagerPath[] = "/org/freedesktop/systemd1";
+const char ManagerInterface[] = "org.freedesktop.systemd1.Manager";
+const char UnitInterface[] = "org.freedesktop.systemd1.Unit";
+const char PropertiesInterface[] = "org.freedesktop.DBus.Properties";
+
+QDBusMessage getAll(const QString &service, const QString &path, const QString &interface)
+{
+    QDBusMessage call = QDBusMessage::createMethodCall(service, path, PropertiesInterface, "GetAll");
+    call << interface;
+    return call;
+}
+
+QVariantMap replyProperties(const QDBusPendingCall &call)
+{
+    const QDBusMessage reply = call.reply();
+    if (reply.type() != QDBusMessage::ReplyMessage || reply.arguments().isEmpty()) {
+        return QVariantMap();
+    }
+    return qdbus_cast<QVariantMap>(reply.arguments().first());
+}
+
+} // namespace
+
+BootAnalyzer::BootAnalyzer(const QDBusConnection &bus, const QString &service)
+    : m_bus(bus), m_service(service)
+{
+}
+
+BootAnalysis BootAnalyzer::analyze(const QString &target) const
+{
+    BootAnalysis analysis;
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!m_bus.isConnected()) {
+        analysis.error = "D-Bus connection unavailable";
+        return analysis;
+    }
+
+    QDBusPendingCall managerCall = m_bus.asyncCall(getAll(m_service, ManagerPath, ManagerInterface));
+    QDBusPendingCall listCall = m_bus.asyncCall(
+        QDBusMessage::createMethodCall(m_service, ManagerPath, ManagerInterface, "ListUnits"));
+    QDBusPendingCall targetCall = m_bus.asyncCall(
+        QDBusMessage::createMethodCall(m_service, ManagerPath, ManagerInterface, "GetDefaultTarget"));
+    listCall.waitForFinished();
+    if (listCall.isError()) {
+        analysis.error = QString("ListUnits: %1").arg(listCall.error().message());
+        return analysis;
+    }
+
+    // ListUnits: a(ssssssouso); only the name and object path matter here.
+    QStringList names;
+    QStringList paths;
+    const QDBusArgument units = listCall.reply().arguments().value(0).value<QDBusArgument>();
+    units.beginArray();
+    while (!units.atEnd()) {
+        QString name, description, load, active, sub, following, jobType;
+        QDBusObjectPath path, jobPath;
+        uint jobId = 0;
+        units.beginStructure();
+        units >> name >> description >> load >> active >> sub >> following >> path >> jobId >> jobType >> jobPath;
+        units.endStructure();
+        names << name;
+        paths << path.path();
+    }
+    units.endArray();
+
+    QList<QDBusPendingCall> calls;
+    calls.reserve(paths.size());
+    for (const QString &path : qAsConst(paths)) {
+        calls.append(m_bus.asyncCall(getAll(m_service, path, UnitInterface)));
+    }
+
+    managerCall.waitForFinished();
+    const QVariantMap manager = replyProperties(managerCall);
+    analysis.userspaceStart = manager.value("UserspaceTimestampMonotonic").toULongLong();
+    analysis.finish = manager.value("FinishTimestampMonotonic").toULongLong();
+
+    targetCall.waitForFinished();
+    analysis.target = target;
+    if (analysis.target.isEmpty()) {
+        analysis.target = targetCall.isError() ? QString("default.target")
+                                               : targetCall.reply().arguments().value(0).toString();
+    }
+
+    QHash<QString, int> byName;
+    analysis.units.reserve(calls.size());
+    for (int i = 0; i < calls.size(); ++i) {
+        calls[i].waitForFinished();
+        const QVariantMap properties = replyProperties(calls[i]);
+        BootUnitTiming unit;
+        unit.name = names[i];
+        unit.activating = properties.value("InactiveExitTimestampMonotonic").toULongLong();
+        unit.activated = properties.value("ActiveEnterTimestampMonotonic").toULongLong();
+        unit.after = properties.value("After").toStringList();
+        byName.insert(unit.name, analysis.units.size());
+        analysis.units.append(unit);
+    }
+
+    const int targetIndex = byName.value(analysis.target, -1);
+    if (targetIndex < 0) {
+        analysis.error = QString("%1 is not loaded").arg(analysis.target);
+    } else {
+        analysis.criticalChain = criticalChain(analysis.units, byName, targetIndex, analysis.finish);
+    }
+
+    analysis.ranking.reserve(analysis.units.size());
+    for (int i = 0; i < analysis.units.size(); ++i) {
+        if (analysis.units[i].activationUsec() > 0) {
+            analysis.ranking.append(i);
+        }
+    }
+    const QVector<BootUnitTiming> &timings = analysis.units;
+    std::sort(analysis.ranking.begin(), analysis.ranking.end(), [&timings](int a, int b) {
+        return timings[a].activationUsec() > timings[b].activationUsec();
+    });
+
+    analysis.elapsedMs = timer.elapsed();
+    return analysis;
+}
+
+QVector<int> BootAnalyzer::criticalChain(const QVector<BootUnitTiming> &units, const QHash<QString, int> &byName,
+                                         int target, quint64 finish)
+{
+    // Units activated after the boot finished did not hold it up.
+    auto inRange = [&units, finish](int index) {
+        return units[index].activated > 0 && (finish == 0 || units[index].activated <= finish);
+    };
+
+    QVector<int> chain;
+    QSet<int> visited;
+    for (int current = target; current >= 0 && !visited.contains(current);) {
+        chain.append(current);
+        visited.insert(current);
+
+        int next = -1;
+        for (const QString &dependency : units[current].after) {
+            const int index = byName.value(dependency, -1);
+            if (index >= 0 && inRange(index) && (next < 0 || units[index].activated > units[next].activated)) {
+                next = index;
+            }
+        }
+        current = next;
+    }
+    return chain;
+}
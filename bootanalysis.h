@@ -0,0 +1,66 @@
+#ifndef BOOTANALYSIS_H
+#define BOOTANALYSIS_H
+
+#include "systemdunits.h"
+
+#include <QtCore/QHash>
+#include <QtCore/QMetaType>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+// CLOCK_MONOTONIC microseconds, as systemd records them; 0 when the unit
+// never went through that state this boot.
+struct BootUnitTiming
+{
+    QString name;
+    quint64 activating = 0;
+    quint64 activated = 0;
+    QStringList after;
+
+    // Time spent activating, which is what systemd-analyze blame ranks by.
+    qint64 activationUsec() const
+    {
+        return activating > 0 && activated > activating ? qint64(activated - activating) : 0;
+    }
+};
+
+struct BootAnalysis
+{
+    QString target;
+    quint64 userspaceStart = 0;
+    quint64 finish = 0;
+    QVector<BootUnitTiming> units;
+    // Indexes into units, from the target down to the first unit it waited on.
+    QVector<int> criticalChain;
+    // Indexes into units, slowest activation first.
+    QVector<int> ranking;
+    qint64 elapsedMs = 0;
+    QString error;
+};
+
+Q_DECLARE_METATYPE(BootAnalysis)
+
+class BootAnalyzer
+{
+public:
+    explicit BootAnalyzer(const QDBusConnection &bus = QDBusConnection::systemBus(),
+                          const QString &service = SystemdManager::defaultService());
+
+    // Lists the loaded units, then fetches every unit's properties with one
+    // pipelined GetAll per unit (all sent before any reply is awaited).
+    // An empty target means the default target.
+    BootAnalysis analyze(const QString &target = QString()) const;
+
+    // The systemd-analyze critical-chain walk: from the target, repeatedly
+    // follow the After= dependency that became active last before the boot
+    // finished.
+    static QVector<int> criticalChain(const QVector<BootUnitTiming> &units, const QHash<QString, int> &byName,
+                                      int target, quint64 finish);
+
+private:
+    QDBusConnection m_bus;
+    QString m_service;
+};
+
+#endif // BOOTANALYSIS_H
@@ -0,0 +1,131 @@
+#include "cacheverifier.h"
+#include "compressedstream.h"
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QFile>
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zstd.h>
+
+VerifyResult PackageVerifier::verify(const VerifyJob &job)
+{
+    VerifyResult result;
+    result.path = job.path;
+
+    int fd = ::open(QFile::encodeName(job.path).constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        result.status = VerifyResult::ReadFailed;
+        result.detail = qt_error_string(errno);
+        return result;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && job.expectedSize >= 0 && st.st_size != job.expectedSize) {
+        result.status = VerifyResult::SizeMismatch;
+        result.detail = QString("expected %1 bytes, found %2").arg(job.expectedSize).arg(qint64(st.st_size));
+        result.bytes = st.st_size;
+        ::close(fd);
+        return result;
+    }
+
+    // Let the kernel read ahead the whole file while we hash.
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    QByteArray buffer(int(ReadSize), Qt::Uninitialized);
+
+    ZSTD_DCtx *context = nullptr;
+    QByteArray scratch;
+    size_t frameState = 0;
+    if (job.testDecompress) {
+        context = ZSTD_createDCtx();
+        scratch.resize(int(ZSTD_DStreamOutSize()));
+    }
+
+    bool failed = false;
+    for (;;) {
+        ssize_t n = ::read(fd, buffer.data(), size_t(buffer.size()));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            result.status = VerifyResult::ReadFailed;
+            result.detail = qt_error_string(errno);
+            failed = true;
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+
+        if (context && result.bytes == 0
+            && CompressedStreamReader::detect(buffer.constData(), n) != CompressedStreamReader::Format::Zstd) {
+            // Older .pkg.tar.xz files are only checksummed.
+            ZSTD_freeDCtx(context);
+            context = nullptr;
+        }
+        result.bytes += n;
+
+        hash.addData(buffer.constData(), int(n));
+
+        if (context) {
+            ZSTD_inBuffer in = { buffer.constData(), size_t(n), 0 };
+            while (in.pos < in.size) {
+                ZSTD_outBuffer out = { scratch.data(), size_t(scratch.size()), 0 };
+                frameState = ZSTD_decompressStream(context, &out, &in);
+                if (ZSTD_isError(frameState)) {
+                    result.status = VerifyResult::DecompressFailed;
+                    result.detail = ZSTD_getErrorName(frameState);
+                    ZSTD_freeDCtx(context);
+                    context = nullptr;
+                    break;
+                }
+            }
+        }
+    }
+    ::close(fd);
+
+    if (context) {
+        if (!failed && frameState != 0) {
+            result.status = VerifyResult::DecompressFailed;
+            result.detail = "truncated zstd stream";
+        }
+        ZSTD_freeDCtx(context);
+    }
+
+    if (failed || result.status != VerifyResult::Ok) {
+        return result;
+    }
+
+    if (job.expectedSha256.isEmpty()) {
+        result.status = VerifyResult::NoChecksum;
+        result.detail = "not in any sync database";
+    } else if (hash.result() != job.expectedSha256) {
+        result.status = VerifyResult::ChecksumMismatch;
+        result.detail = "sha256 " + QString::fromLatin1(hash.result().toHex());
+    }
+    return result;
+}
+
+QString PackageVerifier::statusName(VerifyResult::Status status)
+{
+    switch (status) {
+    case VerifyResult::Ok:
+        return "OK";
+    case VerifyResult::NoChecksum:
+        return "No checksum";
+    case VerifyResult::SizeMismatch:
+        return "Truncated";
+    case VerifyResult::ChecksumMismatch:
+        return "Checksum mismatch";
+    case VerifyResult::DecompressFailed:
+        return "Corrupt archive";
+    case VerifyResult::ReadFailed:
+        break;
+    }
+    return "Read error";
+}
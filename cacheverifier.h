@@ -0,0 +1,47 @@
+#ifndef CACHEVERIFIER_H
+#define CACHEVERIFIER_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QMetaType>
+#include <QtCore/QString>
+
+struct VerifyJob
+{
+    QString path;
+    QByteArray expectedSha256;
+    qint64 expectedSize = -1;
+    bool testDecompress = false;
+};
+
+struct VerifyResult
+{
+    enum Status
+    {
+        Ok,
+        NoChecksum,
+        SizeMismatch,
+        ChecksumMismatch,
+        DecompressFailed,
+        ReadFailed
+    };
+
+    QString path;
+    Status status = Ok;
+    QString detail;
+    qint64 bytes = 0;
+};
+
+Q_DECLARE_METATYPE(VerifyResult)
+
+class PackageVerifier
+{
+public:
+    // Each call holds one read buffer and at most one zstd context, so memory
+    // stays bounded by the number of pool threads.
+    static VerifyResult verify(const VerifyJob &job);
+    static QString statusName(VerifyResult::Status status);
+
+    static const qint64 ReadSize = 4 * 1024 * 1024;
+};
+
+#endif // CACHEVERIFIER_H
@@ -0,0 +1,188 @@
+#include "cgroupsampler.h"
+
+#include <QtCore/QFile>
+
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+// Service cgroups nest at most one slice deep under system.slice
+// (system-getty.slice/getty@tty1.service), but allow a little more.
+const int MaxSliceDepth = 3;
+
+qint64 monotonicUsec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+// cgroup files are regenerated on every read from offset 0.
+qint64 readAt0(int fd, char *buffer, qint64 size)
+{
+    if (fd < 0) {
+        return -1;
+    }
+    const qint64 n = preadFully(fd, buffer, size - 1, 0);
+    if (n >= 0) {
+        buffer[n] = '\0';
+    }
+    return n;
+}
+
+qint64 readFileAt(int directoryFd, const QByteArray &path, char *buffer, qint64 size)
+{
+    UniqueFd fd(::openat(directoryFd, path.constData(), O_RDONLY | O_CLOEXEC));
+    return readAt0(fd.get(), buffer, size);
+}
+
+bool hasSuffix(const char *name, const char *suffix)
+{
+    const size_t length = strlen(name);
+    const size_t suffixLength = strlen(suffix);
+    return length > suffixLength && memcmp(name + length - suffixLength, suffix, suffixLength) == 0;
+}
+
+} // namespace
+
+CgroupSampler::CgroupSampler(const QString &root)
+    : m_root(QFile::encodeName(root))
+{
+    m_rootFd.reset(::open(m_root.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+}
+
+quint64 CgroupSampler::parseCpuUsage(const char *data, qint64 size)
+{
+    static const char key[] = "usage_usec ";
+    const char *end = data + size;
+    for (const char *line = data; line < end;) {
+        if (end - line > qint64(sizeof(key) - 1) && memcmp(line, key, sizeof(key) - 1) == 0) {
+            return strtoull(line + sizeof(key) - 1, nullptr, 10);
+        }
+        const char *newline = static_cast<const char *>(memchr(line, '\n', size_t(end - line)));
+        line = newline ? newline + 1 : end;
+    }
+    return 0;
+}
+
+quint64 CgroupSampler::parseIoBytes(const char *data, qint64 size)
+{
+    // "8:0 rbytes=1 wbytes=2 rios=3 wios=4 dbytes=0 dios=0" per device.
+    quint64 total = 0;
+    const char *end = data + size;
+    for (const char *p = data; p < end; ++p) {
+        if ((*p == 'r' || *p == 'w') && end - p > 7 && memcmp(p + 1, "bytes=", 6) == 0
+            && (p == data || p[-1] == ' ')) {
+            total += strtoull(p + 7, nullptr, 10);
+            p += 7;
+        }
+    }
+    return total;
+}
+
+void CgroupSampler::discover(const QByteArray &relative, int depth)
+{
+    int fd = relative.isEmpty() ? ::dup(m_rootFd.get())
+                                : ::openat(m_rootFd.get(), relative.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    DIR *dir = ::fdopendir(fd);
+    if (!dir) {
+        ::close(fd);
+        return;
+    }
+
+    while (struct dirent *entry = ::readdir(dir)) {
+        if (entry->d_type != DT_DIR || entry->d_name[0] == '.') {
+            continue;
+        }
+        const QByteArray path = relative.isEmpty() ? QByteArray(entry->d_name) : relative + '/' + entry->d_name;
+
+        if (hasSuffix(entry->d_name, ".slice")) {
+            if (depth < MaxSliceDepth) {
+                discover(path, depth + 1);
+            }
+            continue;
+        }
+        if (!hasSuffix(entry->d_name, ".service")) {
+            continue;
+        }
+
+        QSharedPointer<Unit> &unit = m_units[QFile::decodeName(entry->d_name)];
+        if (!unit) {
+            unit.reset(new Unit);
+            unit->path = path;
+            unit->cpu.reset(::openat(m_rootFd.get(), (path + "/cpu.stat").constData(), O_RDONLY | O_CLOEXEC));
+        }
+        unit->seen = true;
+    }
+
+    ::closedir(dir);
+}
+
+ServiceUsageMap CgroupSampler::sample()
+{
+    ServiceUsageMap usage;
+    if (!m_rootFd.isValid()) {
+        return usage;
+    }
+
+    for (auto it = m_units.begin(); it != m_units.end(); ++it) {
+        it.value()->seen = false;
+    }
+    discover(QByteArray(), 0);
+
+    char buffer[16384];
+    usage.reserve(m_units.size());
+    for (auto it = m_units.begin(); it != m_units.end();) {
+        Unit &unit = *it.value();
+        if (!unit.seen) {
+            // Stopped services lose their cgroup; drop the stale descriptor.
+            it = m_units.erase(it);
+            continue;
+        }
+
+        const qint64 now = monotonicUsec();
+        qint64 n = readAt0(unit.cpu.get(), buffer, sizeof(buffer));
+        if (n < 0 && unit.cpu.isValid()) {
+            // The service was restarted into a new cgroup of the same name;
+            // this descriptor belongs to the removed one. Reopen next time.
+            it = m_units.erase(it);
+            continue;
+        }
+        const quint64 cpuUsec = n > 0 ? parseCpuUsage(buffer, n) : 0;
+
+        ServiceUsage &result = usage[it.key()];
+        n = readFileAt(m_rootFd.get(), unit.path + "/memory.current", buffer, sizeof(buffer));
+        if (n > 0) {
+            result.memoryBytes = qint64(strtoull(buffer, nullptr, 10));
+        }
+
+        n = readFileAt(m_rootFd.get(), unit.path + "/io.stat", buffer, sizeof(buffer));
+        const bool hasIo = n >= 0;
+        const quint64 ioBytes = n > 0 ? parseIoBytes(buffer, n) : 0;
+
+        const qint64 elapsed = now - unit.sampledUsec;
+        if (unit.primed && elapsed > 0) {
+            // Counters restart when a service is restarted in a new cgroup.
+            if (cpuUsec >= unit.cpuUsec) {
+                result.cpuPercent = double(cpuUsec - unit.cpuUsec) * 100.0 / double(elapsed);
+            }
+            if (hasIo && ioBytes >= unit.ioBytes) {
+                result.ioBytesPerSecond = double(ioBytes - unit.ioBytes) * 1e6 / double(elapsed);
+            }
+        }
+        unit.cpuUsec = cpuUsec;
+        unit.ioBytes = ioBytes;
+        unit.sampledUsec = now;
+        unit.primed = true;
+        ++it;
+    }
+    return usage;
+}
@@ -0,0 +1,67 @@
+#ifndef CGROUPSAMPLER_H
+#define CGROUPSAMPLER_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QMetaType>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QString>
+
+#include "fileutil.h"
+
+// Negative values mean "not known yet": rates need two samples, and a
+// controller may be disabled for the slice.
+struct ServiceUsage
+{
+    double cpuPercent = -1;
+    qint64 memoryBytes = -1;
+    double ioBytesPerSecond = -1;
+};
+
+typedef QHash<QString, ServiceUsage> ServiceUsageMap;
+
+Q_DECLARE_METATYPE(ServiceUsageMap)
+
+// Per-service resource usage from cgroup v2 accounting files. Each service
+// cgroup's cpu.stat stays open between samples and is re-read with pread()
+// from offset 0; memory.current and io.stat are opened for each sample, so
+// the sampler holds one descriptor per service and never needs a raised
+// open file limit. Not thread-safe; run one sample at a time.
+class CgroupSampler
+{
+public:
+    static QString defaultRoot()
+    {
+        return "/sys/fs/cgroup/system.slice";
+    }
+
+    explicit CgroupSampler(const QString &root = defaultRoot());
+
+    // Keyed by unit name (foo.service, getty@tty1.service). CPU percent is of
+    // one core, so a busy multi-threaded service can exceed 100.
+    ServiceUsageMap sample();
+
+    static quint64 parseCpuUsage(const char *data, qint64 size);
+    static quint64 parseIoBytes(const char *data, qint64 size);
+
+private:
+    struct Unit
+    {
+        // Relative to the root.
+        QByteArray path;
+        UniqueFd cpu;
+        quint64 cpuUsec = 0;
+        quint64 ioBytes = 0;
+        qint64 sampledUsec = 0;
+        bool primed = false;
+        bool seen = false;
+    };
+
+    void discover(const QByteArray &relative, int depth);
+
+    QByteArray m_root;
+    UniqueFd m_rootFd;
+    QHash<QString, QSharedPointer<Unit>> m_units;
+};
+
+#endif // CGROUPSAMPLER_H
@@ -0,0 +1,185 @@
+#include "compressedstream.h"
+#include "fileutil.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <zstd.h>
+
+namespace {
+
+void setError(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+}
+
+bool streamPlain(int fd, QByteArray &input, qint64 filled, const CompressedStreamReader::Sink &sink, QString *error)
+{
+    while (filled > 0) {
+        if (!sink(input.constData(), filled)) {
+            return true;
+        }
+        filled = readFully(fd, input.data(), input.size());
+    }
+    if (filled < 0) {
+        setError(error, QString("Read error: %1").arg(qt_error_string(errno)));
+        return false;
+    }
+    return true;
+}
+
+bool streamGzip(int fd, QByteArray &input, qint64 filled, const CompressedStreamReader::Sink &sink, QString *error)
+{
+    z_stream stream = {};
+    if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+        setError(error, "Failed to initialise zlib");
+        return false;
+    }
+
+    QByteArray output(int(CompressedStreamReader::ChunkSize), Qt::Uninitialized);
+    bool ok = true;
+    bool stopped = false;
+    bool streamEnded = false;
+
+    while (filled > 0 && ok && !stopped) {
+        stream.next_in = reinterpret_cast<Bytef *>(input.data());
+        stream.avail_in = uInt(filled);
+
+        while (stream.avail_in > 0 && !stopped) {
+            stream.next_out = reinterpret_cast<Bytef *>(output.data());
+            stream.avail_out = uInt(output.size());
+
+            int result = inflate(&stream, Z_NO_FLUSH);
+            if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+                setError(error, QString("Corrupt gzip stream: %1").arg(stream.msg ? stream.msg : "unknown error"));
+                ok = false;
+                break;
+            }
+
+            qint64 produced = output.size() - stream.avail_out;
+            if (produced > 0 && !sink(output.constData(), produced)) {
+                stopped = true;
+            }
+
+            if (result == Z_STREAM_END) {
+                // Concatenated gzip members (pigz, rotated logs) form one stream.
+                streamEnded = true;
+                inflateReset(&stream);
+            } else if (result == Z_OK) {
+                streamEnded = false;
+            } else if (result == Z_BUF_ERROR && produced == 0) {
+                break;
+            }
+        }
+
+        if (ok && !stopped) {
+            filled = readFully(fd, input.data(), input.size());
+            if (filled < 0) {
+                setError(error, QString("Read error: %1").arg(qt_error_string(errno)));
+                ok = false;
+            }
+        }
+    }
+
+    if (ok && !stopped && !streamEnded) {
+        setError(error, "Truncated gzip stream");
+        ok = false;
+    }
+
+    inflateEnd(&stream);
+    return ok;
+}
+
+bool streamZstd(int fd, QByteArray &input, qint64 filled, const CompressedStreamReader::Sink &sink, QString *error)
+{
+    ZSTD_DCtx *context = ZSTD_createDCtx();
+    if (!context) {
+        setError(error, "Failed to initialise zstd");
+        return false;
+    }
+
+    QByteArray output(int(ZSTD_DStreamOutSize()), Qt::Uninitialized);
+    bool ok = true;
+    bool stopped = false;
+    size_t lastResult = 0;
+
+    while (filled > 0 && ok && !stopped) {
+        ZSTD_inBuffer in = { input.constData(), size_t(filled), 0 };
+
+        while (in.pos < in.size && !stopped) {
+            ZSTD_outBuffer out = { output.data(), size_t(output.size()), 0 };
+            lastResult = ZSTD_decompressStream(context, &out, &in);
+            if (ZSTD_isError(lastResult)) {
+                setError(error, QString("Corrupt zstd stream: %1").arg(ZSTD_getErrorName(lastResult)));
+                ok = false;
+                break;
+            }
+            if (out.pos > 0 && !sink(output.constData(), qint64(out.pos))) {
+                stopped = true;
+            }
+        }
+
+        if (ok && !stopped) {
+            filled = readFully(fd, input.data(), input.size());
+            if (filled < 0) {
+                setError(error, QString("Read error: %1").arg(qt_error_string(errno)));
+                ok = false;
+            }
+        }
+    }
+
+    if (ok && !stopped && lastResult != 0) {
+        setError(error, "Truncated zstd stream");
+        ok = false;
+    }
+
+    ZSTD_freeDCtx(context);
+    return ok;
+}
+
+} // namespace
+
+CompressedStreamReader::Format CompressedStreamReader::detect(const char *data, qint64 size)
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data);
+    if (size >= 2 && bytes[0] == 0x1f && bytes[1] == 0x8b) {
+        return Format::Gzip;
+    }
+    if (size >= 4 && bytes[0] == 0x28 && bytes[1] == 0xb5 && bytes[2] == 0x2f && bytes[3] == 0xfd) {
+        return Format::Zstd;
+    }
+    return Format::Plain;
+}
+
+bool CompressedStreamReader::readFile(const QString &path, const Sink &sink, QString *error)
+{
+    UniqueFd fd(::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC));
+    if (fd.get() < 0) {
+        setError(error, QString("Cannot open %1: %2").arg(path, qt_error_string(errno)));
+        return false;
+    }
+    posix_fadvise(fd.get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    QByteArray input(int(ChunkSize), Qt::Uninitialized);
+    qint64 filled = readFully(fd.get(), input.data(), input.size());
+    if (filled < 0) {
+        setError(error, QString("Read error: %1").arg(qt_error_string(errno)));
+        return false;
+    }
+
+    switch (detect(input.constData(), filled)) {
+    case Format::Gzip:
+        return streamGzip(fd.get(), input, filled, sink, error);
+    case Format::Zstd:
+        return streamZstd(fd.get(), input, filled, sink, error);
+    case Format::Plain:
+        break;
+    }
+    return streamPlain(fd.get(), input, filled, sink, error);
+}
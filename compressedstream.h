@@ -0,0 +1,28 @@
+#ifndef COMPRESSEDSTREAM_H
+#define COMPRESSEDSTREAM_H
+
+#include <QtCore/QString>
+#include <functional>
+
+// Streams a possibly compressed file through a sink in fixed-size chunks,
+// without materialising the decompressed data.
+class CompressedStreamReader
+{
+public:
+    enum class Format
+    {
+        Plain,
+        Gzip,
+        Zstd
+    };
+
+    // Returning false from the sink stops reading early without an error.
+    using Sink = std::function<bool(const char *data, qint64 size)>;
+
+    static Format detect(const char *data, qint64 size);
+    static bool readFile(const QString &path, const Sink &sink, QString *error = nullptr);
+
+    static const qint64 ChunkSize = 256 * 1024;
+};
+
+#endif // COMPRESSEDSTREAM_H
@@ -0,0 +1,425 @@
+#include "dedup.h"
+#include "fileutil.h"
+
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtCore/QByteArray>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QSet>
+#include <QtCore/QVector>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+namespace {
+
+const qint64 ProbeSize = 64 * 1024;
+const qint64 CompareChunk = 1024 * 1024;
+
+struct FileEntry
+{
+    QString path;
+    dev_t device = 0;
+    ino_t inode = 0;
+    qint64 size = 0;
+    bool valid = false;
+    QByteArray probe;
+};
+
+struct Bucket
+{
+    QVector<int> members;
+};
+
+FileEntry statFile(const QString &path)
+{
+    FileEntry entry;
+    entry.path = path;
+
+    struct stat st;
+    if (::lstat(QFile::encodeName(path).constData(), &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        entry.device = st.st_dev;
+        entry.inode = st.st_ino;
+        entry.size = st.st_size;
+        entry.valid = true;
+    }
+    return entry;
+}
+
+// Hashes the head and tail of the file so that buckets only hold likely
+// duplicates before the full byte comparison.
+void probeFile(FileEntry &entry)
+{
+    UniqueFd fd(::open(QFile::encodeName(entry.path).constData(), O_RDONLY | O_CLOEXEC));
+    if (fd.get() < 0) {
+        entry.valid = false;
+        return;
+    }
+
+    QByteArray buffer(int(qMin(ProbeSize, entry.size)), Qt::Uninitialized);
+    QCryptographicHash hash(QCryptographicHash::Md5);
+
+    qint64 n = preadFully(fd.get(), buffer.data(), buffer.size(), 0);
+    if (n < 0) {
+        entry.valid = false;
+        return;
+    }
+    hash.addData(buffer.constData(), int(n));
+
+    if (entry.size > 2 * ProbeSize) {
+        n = preadFully(fd.get(), buffer.data(), buffer.size(), entry.size - ProbeSize);
+        if (n < 0) {
+            entry.valid = false;
+            return;
+        }
+        hash.addData(buffer.constData(), int(n));
+    }
+
+    entry.probe = hash.result();
+}
+
+enum class LinkResult
+{
+    Reflinked,
+    Hardlinked,
+    Different,
+    Failed
+};
+
+// FIDEDUPERANGE calls are split so one request never pins a huge range;
+// several filesystems cap a single call at 16 MiB anyway.
+const qint64 DedupeChunk = 16 * 1024 * 1024;
+
+enum class DedupeResult
+{
+    Same,
+    Different,
+    Unsupported,
+    Failed
+};
+
+// Asks the kernel to share the extents of the whole file. It locks both
+// inodes and compares the ranges itself, so a file rewritten after the
+// probe is never replaced with other contents.
+DedupeResult dedupeRange(int sourceFd, int duplicateFd, qint64 size, int *errorCode)
+{
+    QByteArray buffer(int(sizeof(struct file_dedupe_range) + sizeof(struct file_dedupe_range_info)), '\0');
+    struct file_dedupe_range *range = reinterpret_cast<struct file_dedupe_range *>(buffer.data());
+    range->dest_count = 1;
+
+    qint64 offset = 0;
+    while (offset < size) {
+        range->src_offset = quint64(offset);
+        range->src_length = quint64(qMin(DedupeChunk, size - offset));
+        range->info[0].dest_fd = duplicateFd;
+        range->info[0].dest_offset = quint64(offset);
+        range->info[0].bytes_deduped = 0;
+        range->info[0].status = 0;
+
+        if (::ioctl(sourceFd, FIDEDUPERANGE, range) != 0) {
+            *errorCode = errno;
+            return offset == 0 && (errno == EOPNOTSUPP || errno == ENOTTY || errno == EINVAL || errno == EXDEV)
+                ? DedupeResult::Unsupported : DedupeResult::Failed;
+        }
+        if (range->info[0].status == FILE_DEDUPE_RANGE_DIFFERS) {
+            return DedupeResult::Different;
+        }
+        if (range->info[0].status < 0) {
+            *errorCode = -range->info[0].status;
+            return offset == 0 && *errorCode == EINVAL ? DedupeResult::Unsupported : DedupeResult::Failed;
+        }
+        if (range->info[0].bytes_deduped == 0) {
+            *errorCode = EIO;
+            return DedupeResult::Failed;
+        }
+        offset += qint64(range->info[0].bytes_deduped);
+    }
+    return DedupeResult::Same;
+}
+
+bool descriptorsEqual(int a, int b, QString *error, const QString &path)
+{
+    posix_fadvise(a, 0, 0, POSIX_FADV_SEQUENTIAL);
+    posix_fadvise(b, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    QByteArray bufferA(int(CompareChunk), Qt::Uninitialized);
+    QByteArray bufferB(int(CompareChunk), Qt::Uninitialized);
+    qint64 offset = 0;
+
+    for (;;) {
+        qint64 n = preadFully(a, bufferA.data(), CompareChunk, offset);
+        qint64 m = preadFully(b, bufferB.data(), CompareChunk, offset);
+        if (n < 0 || m < 0) {
+            if (error) {
+                *error = errnoString(path);
+            }
+            return false;
+        }
+        if (n != m || memcmp(bufferA.constData(), bufferB.constData(), size_t(n)) != 0) {
+            return false;
+        }
+        if (n == 0) {
+            return true;
+        }
+        offset += n;
+    }
+}
+
+// Hardlinks the inode open as sourceFd over name in directoryFd. Used only
+// where extents cannot be shared: owner, group and mode must already match,
+// since the duplicate takes on the source's inode.
+LinkResult hardlinkOver(int directoryFd, const QByteArray &name, int sourceFd, const struct stat &sourceStat,
+                        const QString &duplicate, QString *error)
+{
+    // Link the open inode through /proc, not the source path, which may
+    // name another file by now.
+    const QByteArray sourceLink = "/proc/self/fd/" + QByteArray::number(sourceFd);
+    QByteArray tempName;
+    for (int attempt = 0;; ++attempt) {
+        tempName = ".ezdedup." + name + "." + QByteArray::number(::getpid()) + "." + QByteArray::number(attempt);
+        if (::linkat(AT_FDCWD, sourceLink.constData(), directoryFd, tempName.constData(), AT_SYMLINK_FOLLOW) == 0) {
+            break;
+        }
+        if (errno != EEXIST || attempt == 16) {
+            *error = errnoString(duplicate);
+            return LinkResult::Failed;
+        }
+    }
+
+    // The contents were compared before the link; if the source changed
+    // since, keep the duplicate as it is.
+    struct stat after;
+    if (::fstat(sourceFd, &after) != 0 || after.st_size != sourceStat.st_size
+        || after.st_mtim.tv_sec != sourceStat.st_mtim.tv_sec || after.st_mtim.tv_nsec != sourceStat.st_mtim.tv_nsec) {
+        ::unlinkat(directoryFd, tempName.constData(), 0);
+        *error = QString("%1: source changed while deduplicating").arg(duplicate);
+        return LinkResult::Failed;
+    }
+
+    // Renaming over the copy means the duplicate path never disappears.
+    if (::renameat(directoryFd, tempName.constData(), directoryFd, name.constData()) != 0) {
+        *error = errnoString(duplicate);
+        ::unlinkat(directoryFd, tempName.constData(), 0);
+        return LinkResult::Failed;
+    }
+    return LinkResult::Hardlinked;
+}
+
+// Everything after the first open goes through descriptors: the duplicate
+// is opened relative to its directory without following a final symlink,
+// and the checks and the dedupe apply to exactly the files that were opened.
+LinkResult replaceWithLink(const QString &duplicate, const QString &source, const DedupOptions &options,
+                           QString *error)
+{
+    const QFileInfo duplicateInfo(duplicate);
+    const QByteArray name = QFile::encodeName(duplicateInfo.fileName());
+
+    UniqueFd directoryFd(::open(QFile::encodeName(duplicateInfo.absolutePath()).constData(),
+                                O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if (directoryFd.get() < 0) {
+        *error = errnoString(duplicate);
+        return LinkResult::Failed;
+    }
+    // Read-only is enough for FIDEDUPERANGE on the owner's or root's files
+    // (Linux 4.19+), and unlike O_RDWR works on running executables.
+    UniqueFd duplicateFd(::openat(directoryFd.get(), name.constData(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC));
+    UniqueFd sourceFd(::open(QFile::encodeName(source).constData(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC));
+    if (duplicateFd.get() < 0 || sourceFd.get() < 0) {
+        *error = errnoString(duplicateFd.get() < 0 ? duplicate : source);
+        return LinkResult::Failed;
+    }
+
+    struct stat duplicateStat;
+    struct stat sourceStat;
+    if (::fstat(duplicateFd.get(), &duplicateStat) != 0 || ::fstat(sourceFd.get(), &sourceStat) != 0) {
+        *error = errnoString(duplicate);
+        return LinkResult::Failed;
+    }
+    if (options.owner >= 0) {
+        // Checked on the opened files: the paths the client named may have
+        // been swapped for symlinks since the helper looked at them.
+        struct stat directoryStat;
+        if (::fstat(directoryFd.get(), &directoryStat) != 0 || qint64(directoryStat.st_uid) != options.owner
+            || qint64(duplicateStat.st_uid) != options.owner || qint64(sourceStat.st_uid) != options.owner) {
+            *error = QString("%1: not your own file in your own directory").arg(duplicate);
+            return LinkResult::Failed;
+        }
+    }
+    if (!S_ISREG(duplicateStat.st_mode) || !S_ISREG(sourceStat.st_mode) || duplicateStat.st_dev != sourceStat.st_dev
+        || duplicateStat.st_size != sourceStat.st_size) {
+        return LinkResult::Different;
+    }
+    if (duplicateStat.st_ino == sourceStat.st_ino) {
+        *error = QString("%1: already the same file as %2").arg(duplicate, source);
+        return LinkResult::Failed;
+    }
+
+    int errorCode = 0;
+    switch (dedupeRange(sourceFd.get(), duplicateFd.get(), sourceStat.st_size, &errorCode)) {
+    case DedupeResult::Same:
+        return LinkResult::Reflinked;
+    case DedupeResult::Different:
+        return LinkResult::Different;
+    case DedupeResult::Failed:
+        *error = QString("%1: %2").arg(duplicate, qt_error_string(errorCode));
+        return LinkResult::Failed;
+    case DedupeResult::Unsupported:
+        break;
+    }
+
+    if (!options.allowHardlinks) {
+        *error = QString("%1: reflinks not supported (%2)").arg(duplicate, qt_error_string(errorCode));
+        return LinkResult::Failed;
+    }
+    if (duplicateStat.st_uid != sourceStat.st_uid || duplicateStat.st_gid != sourceStat.st_gid
+        || duplicateStat.st_mode != sourceStat.st_mode) {
+        *error = QString("%1: owner or mode differs from %2; not hardlinking").arg(duplicate, source);
+        return LinkResult::Failed;
+    }
+    if (!descriptorsEqual(sourceFd.get(), duplicateFd.get(), error, duplicate)) {
+        return error->isEmpty() ? LinkResult::Different : LinkResult::Failed;
+    }
+    return hardlinkOver(directoryFd.get(), name, sourceFd.get(), sourceStat, duplicate, error);
+}
+
+qint64 availableBytes(const QString &path)
+{
+    struct statvfs st;
+    if (::statvfs(QFile::encodeName(path).constData(), &st) != 0) {
+        return 0;
+    }
+    return qint64(st.f_bavail) * qint64(st.f_frsize);
+}
+
+} // namespace
+
+bool FileDeduplicator::contentsEqual(const QString &first, const QString &second, QString *error)
+{
+    UniqueFd a(::open(QFile::encodeName(first).constData(), O_RDONLY | O_CLOEXEC));
+    UniqueFd b(::open(QFile::encodeName(second).constData(), O_RDONLY | O_CLOEXEC));
+    if (a.get() < 0 || b.get() < 0) {
+        if (error) {
+            *error = errnoString(a.get() < 0 ? first : second);
+        }
+        return false;
+    }
+    return descriptorsEqual(a.get(), b.get(), error, first);
+}
+
+DedupReport FileDeduplicator::run(const QStringList &paths, const DedupOptions &options)
+{
+    DedupReport report;
+
+    // Stage 1: stat everything and drop paths that already share an inode.
+    QVector<FileEntry> entries = QtConcurrent::blockingMapped<QVector<FileEntry>>(paths, statFile);
+
+    QSet<QPair<quint64, quint64>> seenInodes;
+    QHash<QPair<quint64, qint64>, QVector<int>> bySize;
+    for (int i = 0; i < entries.size(); ++i) {
+        const FileEntry &entry = entries[i];
+        if (!entry.valid) {
+            continue;
+        }
+        QPair<quint64, quint64> inodeKey(quint64(entry.device), quint64(entry.inode));
+        if (seenInodes.contains(inodeKey)) {
+            continue;
+        }
+        seenInodes.insert(inodeKey);
+        bySize[qMakePair(quint64(entry.device), entry.size)].append(i);
+    }
+
+    QVector<int> candidates;
+    for (auto it = bySize.constBegin(); it != bySize.constEnd(); ++it) {
+        if (it.value().size() > 1) {
+            candidates += it.value();
+        }
+    }
+    report.candidates = candidates.size();
+
+    // Stage 2: cheap head/tail probe, in parallel.
+    QtConcurrent::blockingMap(candidates, [&entries](int index) {
+        probeFile(entries[index]);
+    });
+
+    QHash<QByteArray, Bucket> buckets;
+    for (int index : qAsConst(candidates)) {
+        const FileEntry &entry = entries[index];
+        if (!entry.valid) {
+            continue;
+        }
+        QByteArray key = entry.probe;
+        key.append(reinterpret_cast<const char *>(&entry.device), sizeof(entry.device));
+        key.append(reinterpret_cast<const char *>(&entry.size), sizeof(entry.size));
+        buckets[key].members.append(index);
+    }
+
+    QVector<Bucket> work;
+    QHash<quint64, QString> devicePaths;
+    for (auto it = buckets.constBegin(); it != buckets.constEnd(); ++it) {
+        if (it->members.size() > 1) {
+            work.append(it.value());
+            const FileEntry &first = entries[it->members.first()];
+            devicePaths.insert(quint64(first.device), QFileInfo(first.path).absolutePath());
+        }
+    }
+
+    QHash<quint64, qint64> availableBefore;
+    for (auto it = devicePaths.constBegin(); it != devicePaths.constEnd(); ++it) {
+        availableBefore.insert(it.key(), availableBytes(it.value()));
+    }
+
+    // Stage 3: share each file with the first representative the kernel
+    // finds identical; a file that matches none becomes a representative.
+    QMutex mutex;
+    QtConcurrent::blockingMap(work, [&](const Bucket &bucket) {
+        QVector<int> representatives;
+        for (int index : bucket.members) {
+            const FileEntry &entry = entries[index];
+            LinkResult result = LinkResult::Different;
+            for (int representative : qAsConst(representatives)) {
+                QString error;
+                result = replaceWithLink(entry.path, entries[representative].path, options, &error);
+                if (result == LinkResult::Different) {
+                    continue;
+                }
+                if (result == LinkResult::Failed) {
+                    QMutexLocker locker(&mutex);
+                    report.errors << error;
+                }
+                break;
+            }
+
+            if (result == LinkResult::Different) {
+                representatives.append(index);
+                continue;
+            }
+            if (result == LinkResult::Failed) {
+                continue;
+            }
+
+            QMutexLocker locker(&mutex);
+            report.duplicates++;
+            report.bytesDeduplicated += entry.size;
+            if (result == LinkResult::Reflinked) {
+                report.reflinked++;
+            } else {
+                report.hardlinked++;
+            }
+        }
+    });
+
+    for (auto it = devicePaths.constBegin(); it != devicePaths.constEnd(); ++it) {
+        report.bytesFreed += qMax<qint64>(0, availableBytes(it.value()) - availableBefore.value(it.key()));
+    }
+
+    return report;
+}
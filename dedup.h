@@ -0,0 +1,39 @@
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include <QtCore/QMetaType>
+#include <QtCore/QStringList>
+
+struct DedupOptions
+{
+    bool allowHardlinks = false;
+    // When not -1, only files owned by this uid, in directories owned by
+    // it, are touched; the helper sets it to its client's uid.
+    qint64 owner = -1;
+};
+
+struct DedupReport
+{
+    int candidates = 0;
+    int duplicates = 0;
+    int reflinked = 0;
+    int hardlinked = 0;
+    qint64 bytesDeduplicated = 0;
+    qint64 bytesFreed = 0;
+    QStringList errors;
+};
+
+Q_DECLARE_METATYPE(DedupReport)
+
+// Shares the extents of byte-identical copies with FIDEDUPERANGE, which
+// compares and shares atomically, or hardlinks copies with the same owner,
+// group and mode when the filesystem cannot share extents and the caller
+// opted in.
+class FileDeduplicator
+{
+public:
+    static DedupReport run(const QStringList &paths, const DedupOptions &options);
+    static bool contentsEqual(const QString &first, const QString &second, QString *error = nullptr);
+};
+
+#endif // DEDUP_H
@@ -0,0 +1,380 @@
+#include "filemetadata.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QThread>
+
+#include <condition_variable>
+#include <deque>
+#include <dirent.h>
+#include <fcntl.h>
+#include <mutex>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct TreeQueue
+{
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::deque<QByteArray> directories;
+    int active = 0;
+    QVector<FileMetadata> results;
+};
+
+void walkDirectory(const QByteArray &directory, QVector<FileMetadata> &found, std::vector<QByteArray> &subdirectories)
+{
+    int fd = ::open(directory.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    DIR *dir = ::fdopendir(fd);
+    if (!dir) {
+        ::close(fd);
+        return;
+    }
+
+    const QByteArray prefix = directory == "/" ? QByteArray() : directory;
+    while (struct dirent *entry = ::readdir(dir)) {
+        const char *name = entry->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+            continue;
+        }
+
+        unsigned char type = entry->d_type;
+        if (type == DT_DIR) {
+            subdirectories.push_back(prefix + '/' + name);
+            continue;
+        }
+        if (type != DT_REG && type != DT_UNKNOWN) {
+            continue;
+        }
+
+        struct statx stx;
+        if (::statx(fd, name, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC,
+                    STATX_TYPE | STATX_SIZE | STATX_BLOCKS | STATX_MTIME | STATX_INO, &stx) != 0) {
+            continue;
+        }
+
+        if (S_ISDIR(stx.stx_mode)) {
+            subdirectories.push_back(prefix + '/' + name);
+        } else if (S_ISREG(stx.stx_mode)) {
+            FileMetadata metadata;
+            metadata.path = QFile::decodeName(prefix + '/' + name);
+            metadata.device = (quint64(stx.stx_dev_major) << 32) | stx.stx_dev_minor;
+            metadata.inode = stx.stx_ino;
+            metadata.size = qint64(stx.stx_size);
+            metadata.allocated = qint64(stx.stx_blocks) * 512;
+            metadata.mtime = qint64(stx.stx_mtime.tv_sec);
+            found.append(metadata);
+        }
+    }
+
+    ::closedir(dir);
+}
+
+void treeWorker(TreeQueue &queue)
+{
+    QVector<FileMetadata> found;
+    std::vector<QByteArray> subdirectories;
+
+    std::unique_lock<std::mutex> lock(queue.mutex);
+    for (;;) {
+        queue.wakeup.wait(lock, [&queue]() {
+            return !queue.directories.empty() || queue.active == 0;
+        });
+        if (queue.directories.empty()) {
+            break;
+        }
+
+        QByteArray directory = std::move(queue.directories.front());
+        queue.directories.pop_front();
+        queue.active++;
+        lock.unlock();
+
+        walkDirectory(directory, found, subdirectories);
+
+        lock.lock();
+        for (QByteArray &subdirectory : subdirectories) {
+            queue.directories.push_back(std::move(subdirectory));
+        }
+        subdirectories.clear();
+        queue.active--;
+        queue.wakeup.notify_all();
+    }
+
+    queue.results += found;
+}
+
+QString normalized(const QString &path)
+{
+    return QDir::cleanPath(path);
+}
+
+// "/a/b" -> "/a" -> "/" -> "".
+QString parentOf(const QString &path)
+{
+    if (path == "/") {
+        return QString();
+    }
+    const int slash = path.lastIndexOf('/');
+    return slash > 0 ? path.left(slash) : slash == 0 ? QString("/") : QString();
+}
+
+bool isWithin(const QString &path, const QString &root)
+{
+    return root == "/" || path == root || (path.startsWith(root) && path.at(root.size()) == '/');
+}
+
+} // namespace
+
+FileMetadataCache &FileMetadataCache::instance()
+{
+    static FileMetadataCache cache;
+    return cache;
+}
+
+quint64 FileMetadataCache::generation() const
+{
+    QReadLocker locker(&m_lock);
+    return m_generation;
+}
+
+void FileMetadataCache::invalidate(const QString &path)
+{
+    invalidate(QStringList() << path);
+}
+
+void FileMetadataCache::invalidate(const QStringList &paths)
+{
+    QWriteLocker locker(&m_lock);
+    ++m_generation;
+    for (const QString &rawPath : paths) {
+        const QString path = normalized(rawPath);
+        if (path == "/") {
+            // Nothing survives, so drop it all at once.
+            m_entries.clear();
+            m_byInode.clear();
+            m_files.clear();
+            m_subdirectories.clear();
+            m_trees.clear();
+        } else {
+            evictLocked(path);
+            for (auto it = m_trees.begin(); it != m_trees.end();) {
+                if (isWithin(it.key(), path) || isWithin(path, it.key())) {
+                    it = m_trees.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        if (m_runningScans > 0) {
+            m_invalidated.insert(path, m_generation);
+        }
+    }
+}
+
+void FileMetadataCache::insert(const QVector<FileMetadata> &entries)
+{
+    QWriteLocker locker(&m_lock);
+    for (FileMetadata entry : entries) {
+        entry.generation = m_generation;
+        insertLocked(entry);
+    }
+}
+
+void FileMetadataCache::insert(const QVector<LogFileInfo> &logs)
+{
+    QWriteLocker locker(&m_lock);
+    for (const LogFileInfo &log : logs) {
+        FileMetadata entry;
+        entry.path = log.path;
+        entry.device = log.device;
+        entry.inode = log.inode;
+        entry.size = log.size;
+        entry.allocated = log.allocated;
+        entry.mtime = log.mtime;
+        entry.generation = m_generation;
+        insertLocked(entry);
+    }
+}
+
+void FileMetadataCache::insertLocked(const FileMetadata &entry)
+{
+    auto it = m_entries.find(entry.path);
+    if (it != m_entries.end()) {
+        if (it->device != entry.device || it->inode != entry.inode) {
+            m_byInode.remove(qMakePair(it->device, it->inode), entry.path);
+            m_byInode.insert(qMakePair(entry.device, entry.inode), entry.path);
+        }
+        *it = entry;
+        return;
+    }
+
+    m_entries.insert(entry.path, entry);
+    m_byInode.insert(qMakePair(entry.device, entry.inode), entry.path);
+    QString directory = parentOf(entry.path);
+    m_files[directory].insert(entry.path);
+    // Link the directory into its parents until one already knows it.
+    for (QString parent = parentOf(directory); !parent.isEmpty(); directory = parent, parent = parentOf(parent)) {
+        QSet<QString> &subdirectories = m_subdirectories[parent];
+        if (subdirectories.contains(directory)) {
+            break;
+        }
+        subdirectories.insert(directory);
+    }
+}
+
+void FileMetadataCache::removeLocked(const QString &path)
+{
+    auto it = m_entries.find(path);
+    if (it == m_entries.end()) {
+        return;
+    }
+    m_byInode.remove(qMakePair(it->device, it->inode), path);
+    m_entries.erase(it);
+
+    QString directory = parentOf(path);
+    auto files = m_files.find(directory);
+    if (files == m_files.end()) {
+        return;
+    }
+    files->remove(path);
+    // Unlink directories that no longer lead to anything.
+    while (!directory.isEmpty() && m_files.value(directory).isEmpty() && m_subdirectories.value(directory).isEmpty()) {
+        m_files.remove(directory);
+        m_subdirectories.remove(directory);
+        const QString parent = parentOf(directory);
+        auto siblings = m_subdirectories.find(parent);
+        if (siblings != m_subdirectories.end()) {
+            siblings->remove(directory);
+        }
+        directory = parent;
+    }
+}
+
+void FileMetadataCache::evictLocked(const QString &path)
+{
+    removeLocked(path);
+
+    QStringList files;
+    QStringList pending(path);
+    while (!pending.isEmpty()) {
+        const QString directory = pending.takeLast();
+        for (const QString &file : m_files.value(directory)) {
+            files << file;
+        }
+        for (const QString &subdirectory : m_subdirectories.value(directory)) {
+            pending << subdirectory;
+        }
+    }
+    for (const QString &file : qAsConst(files)) {
+        removeLocked(file);
+    }
+}
+
+bool FileMetadataCache::invalidatedSince(const QString &path, quint64 generation) const
+{
+    for (QString current = path; !current.isEmpty(); current = parentOf(current)) {
+        if (m_invalidated.value(current) > generation) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FileMetadataCache::find(const QString &path, FileMetadata *metadata) const
+{
+    QReadLocker locker(&m_lock);
+    auto it = m_entries.constFind(path);
+    if (it == m_entries.constEnd()) {
+        return false;
+    }
+    *metadata = *it;
+    return true;
+}
+
+QStringList FileMetadataCache::pathsFor(quint64 device, quint64 inode) const
+{
+    QReadLocker locker(&m_lock);
+    return m_byInode.values(qMakePair(device, inode));
+}
+
+void FileMetadataCache::scanTree(const QString &root, int threads)
+{
+    if (threads <= 0) {
+        threads = qBound(1, QThread::idealThreadCount(), 8);
+    }
+
+    const QString cleanRoot = normalized(root);
+    quint64 started = 0;
+    {
+        QWriteLocker locker(&m_lock);
+        started = m_generation;
+        ++m_runningScans;
+    }
+
+    TreeQueue queue;
+    queue.directories.push_back(QFile::encodeName(cleanRoot));
+
+    std::vector<std::thread> workers;
+    workers.reserve(size_t(threads - 1));
+    for (int i = 1; i < threads; ++i) {
+        workers.emplace_back(treeWorker, std::ref(queue));
+    }
+    treeWorker(queue);
+    for (std::thread &thread : workers) {
+        thread.join();
+    }
+
+    // An invalidation that raced with the walk still wins: entries below a
+    // path invalidated after the walk started are left out.
+    QWriteLocker locker(&m_lock);
+    const bool raced = m_generation != started;
+    for (FileMetadata &entry : queue.results) {
+        if (raced && invalidatedSince(entry.path, started)) {
+            continue;
+        }
+        entry.generation = started;
+        insertLocked(entry);
+    }
+    if (!raced) {
+        m_trees.insert(cleanRoot, started);
+    }
+    if (--m_runningScans == 0) {
+        m_invalidated.clear();
+    }
+}
+
+bool FileMetadataCache::hasTree(const QString &root) const
+{
+    QReadLocker locker(&m_lock);
+    for (QString path = normalized(root); !path.isEmpty(); path = parentOf(path)) {
+        if (m_trees.contains(path)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QVector<FileMetadata> FileMetadataCache::entriesUnder(const QString &root) const
+{
+    const QString cleanRoot = normalized(root);
+    QReadLocker locker(&m_lock);
+    QVector<FileMetadata> entries;
+    QStringList pending(cleanRoot);
+    while (!pending.isEmpty()) {
+        const QString directory = pending.takeLast();
+        for (const QString &file : m_files.value(directory)) {
+            entries.append(m_entries.value(file));
+        }
+        for (const QString &subdirectory : m_subdirectories.value(directory)) {
+            pending << subdirectory;
+        }
+    }
+    return entries;
+}
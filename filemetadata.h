@@ -0,0 +1,84 @@
+#ifndef FILEMETADATA_H
+#define FILEMETADATA_H
+
+#include "logscanner.h"
+
+#include <QtCore/QHash>
+#include <QtCore/QPair>
+#include <QtCore/QReadWriteLock>
+#include <QtCore/QSet>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+struct FileMetadata
+{
+    QString path;
+    quint64 device = 0;
+    quint64 inode = 0;
+    qint64 size = 0;
+    // st_blocks * 512, what du reports.
+    qint64 allocated = 0;
+    qint64 mtime = 0;
+    quint64 generation = 0;
+};
+
+// One stat cache shared by every tab. Entries are keyed by path and indexed
+// by (device, inode), so hardlinks and a log replaced by rotation are told
+// apart, and by directory, so listing a tree only touches what is in it.
+// invalidate() evicts everything at or below the path; a walk that was
+// already running when it happened does not put those entries back.
+class FileMetadataCache
+{
+public:
+    static FileMetadataCache &instance();
+
+    quint64 generation() const;
+
+    // Everything at or below path is dropped, and any complete tree that
+    // contains or lies inside it must be walked again.
+    void invalidate(const QString &path);
+    void invalidate(const QStringList &paths);
+
+    void insert(const QVector<FileMetadata> &entries);
+    void insert(const QVector<LogFileInfo> &logs);
+
+    // Hash lookups only; false when the path was never seen or was invalidated.
+    bool find(const QString &path, FileMetadata *metadata) const;
+    QStringList pathsFor(quint64 device, quint64 inode) const;
+
+    // Records every regular file below root (symlinks are not followed) on a
+    // small pool of threads, then remembers root as complete.
+    void scanTree(const QString &root, int threads = 0);
+    // True when root or one of its parents was walked since its last invalidation.
+    bool hasTree(const QString &root) const;
+    // Entries below root, in no particular order; visits only root's
+    // directories in the index, not the whole cache.
+    QVector<FileMetadata> entriesUnder(const QString &root) const;
+
+private:
+    FileMetadataCache() = default;
+    FileMetadataCache(const FileMetadataCache &) = delete;
+    FileMetadataCache &operator=(const FileMetadataCache &) = delete;
+
+    bool invalidatedSince(const QString &path, quint64 generation) const;
+    void insertLocked(const FileMetadata &entry);
+    void removeLocked(const QString &path);
+    void evictLocked(const QString &path);
+
+    mutable QReadWriteLock m_lock;
+    quint64 m_generation = 1;
+    QHash<QString, FileMetadata> m_entries;
+    QMultiHash<QPair<quint64, quint64>, QString> m_byInode;
+    // Directory -> files cached directly in it, and directory -> its
+    // subdirectories that lead to cached files.
+    QHash<QString, QSet<QString>> m_files;
+    QHash<QString, QSet<QString>> m_subdirectories;
+    // Invalidations while walks are running, so their results can be
+    // filtered; emptied once no walk is left.
+    QHash<QString, quint64> m_invalidated;
+    int m_runningScans = 0;
+    QHash<QString, quint64> m_trees;
+};
+
+#endif // FILEMETADATA_H
@@ -0,0 +1,284 @@
+#include "fileutil.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QRandomGenerator>
+
+#include <atomic>
+#include <cerrno>
+#include <fcntl.h>
+#include <mutex>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+// Mappings the SIGBUS handler may patch. The handler only reads the slots,
+// so they are plain atomics; open() and close() claim and release them.
+struct MappingSlot
+{
+    std::atomic<quintptr> begin { 0 };
+    std::atomic<quintptr> end { 0 };
+    std::atomic<bool> faulted { false };
+};
+
+const int MappingSlots = 64;
+MappingSlot mappingSlots[MappingSlots];
+std::mutex mappingSlotsMutex;
+struct sigaction previousBusAction;
+
+// A page past the end of a truncated file faults; map a zero page over it
+// and let the read carry on. Faults anywhere else go to the previous handler.
+void handleBus(int signal, siginfo_t *info, void *context)
+{
+    const quintptr address = quintptr(info->si_addr);
+    for (MappingSlot &slot : mappingSlots) {
+        if (address >= slot.begin.load() && address < slot.end.load()) {
+            const quintptr pageSize = quintptr(::sysconf(_SC_PAGESIZE));
+            void *page = reinterpret_cast<void *>(address & ~(pageSize - 1));
+            if (::mmap(page, pageSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) != MAP_FAILED) {
+                slot.faulted = true;
+                return;
+            }
+            break;
+        }
+    }
+
+    if (previousBusAction.sa_flags & SA_SIGINFO) {
+        previousBusAction.sa_sigaction(signal, info, context);
+    } else if (previousBusAction.sa_handler != SIG_DFL && previousBusAction.sa_handler != SIG_IGN) {
+        previousBusAction.sa_handler(signal);
+    } else {
+        // Returning re-runs the access, which now kills the process as usual.
+        ::signal(signal, SIG_DFL);
+    }
+}
+
+int claimMappingSlot(const char *data, qint64 size)
+{
+    static std::once_flag installed;
+    std::call_once(installed, []() {
+        struct sigaction action = {};
+        action.sa_sigaction = handleBus;
+        action.sa_flags = SA_SIGINFO | SA_NODEFER;
+        sigemptyset(&action.sa_mask);
+        ::sigaction(SIGBUS, &action, &previousBusAction);
+    });
+
+    std::lock_guard<std::mutex> lock(mappingSlotsMutex);
+    for (int i = 0; i < MappingSlots; ++i) {
+        MappingSlot &slot = mappingSlots[i];
+        if (slot.begin.load() == 0) {
+            // With end still 0 the handler can't match a half-set slot.
+            slot.faulted = false;
+            slot.begin = quintptr(data);
+            slot.end = quintptr(data) + quintptr(size);
+            return i;
+        }
+    }
+    return -1;
+}
+
+void releaseMappingSlot(int index)
+{
+    std::lock_guard<std::mutex> lock(mappingSlotsMutex);
+    mappingSlots[index].end = 0;
+    mappingSlots[index].begin = 0;
+}
+
+} // namespace
+
+void UniqueFd::reset(int fd)
+{
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+    m_fd = fd;
+}
+
+qint64 readFully(int fd, char *buffer, qint64 size)
+{
+    qint64 total = 0;
+    while (total < size) {
+        ssize_t n = ::read(fd, buffer + total, size_t(size - total));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        total += n;
+    }
+    return total;
+}
+
+qint64 preadFully(int fd, char *buffer, qint64 size, qint64 offset)
+{
+    qint64 total = 0;
+    while (total < size) {
+        ssize_t n = ::pread(fd, buffer + total, size_t(size - total), off_t(offset + total));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        total += n;
+    }
+    return total;
+}
+
+bool writeFully(int fd, const char *data, qint64 size)
+{
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size_t(size));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool copyFileAttributes(int fd, const struct stat &st)
+{
+    if (::fchown(fd, st.st_uid, st.st_gid) != 0 || ::fchmod(fd, st.st_mode & 07777) != 0) {
+        return false;
+    }
+    struct timespec times[2] = { st.st_atim, st.st_mtim };
+    return ::futimens(fd, times) == 0;
+}
+
+bool syncParentDirectory(const QByteArray &path)
+{
+    int slash = path.lastIndexOf('/');
+    QByteArray directory = slash > 0 ? path.left(slash) : QByteArray(slash == 0 ? "/" : ".");
+    UniqueFd fd(::open(directory.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    return fd.isValid() && ::fsync(fd.get()) == 0;
+}
+
+UniqueFd createTempAt(int directoryFd, const QByteArray &prefix, QByteArray *name)
+{
+    static const char letters[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        QByteArray candidate = prefix + '.';
+        for (int i = 0; i < 6; ++i) {
+            candidate += letters[QRandomGenerator::global()->bounded(int(sizeof(letters) - 1))];
+        }
+        UniqueFd fd(::openat(directoryFd, candidate.constData(),
+                             O_RDWR | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600));
+        if (fd.isValid() || errno != EEXIST) {
+            *name = candidate;
+            return fd;
+        }
+    }
+    errno = EEXIST;
+    return UniqueFd();
+}
+
+UniqueFd openParentBeneath(const QString &root, const QString &path, QByteArray *name, QString *error)
+{
+    if (!QDir::isAbsolutePath(path) || QDir::cleanPath(path) != path || !path.startsWith(root + '/')) {
+        *error = QString("%1: outside %2").arg(path, root);
+        return UniqueFd();
+    }
+    UniqueFd directory(::open(QFile::encodeName(root).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if (!directory.isValid()) {
+        *error = errnoString(root);
+        return UniqueFd();
+    }
+    const QList<QByteArray> components = QFile::encodeName(path.mid(root.size() + 1)).split('/');
+    for (int i = 0; i + 1 < components.size(); ++i) {
+        directory = UniqueFd(::openat(directory.get(), components.at(i).constData(),
+                                      O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC));
+        if (!directory.isValid()) {
+            *error = errno == ELOOP || errno == ENOTDIR
+                ? QString("%1: a directory on the way is a symlink or not a directory").arg(path)
+                : errnoString(path);
+            return UniqueFd();
+        }
+    }
+    *name = components.last();
+    return directory;
+}
+
+QString errnoString(const QString &context)
+{
+    int error = errno;
+    return QString("%1: %2").arg(context, qt_error_string(error));
+}
+
+QString systemRoot()
+{
+    static const QString root = []() {
+        const QString configured = qEnvironmentVariable("PACMAN_CACHE_CLEANER_SYSROOT");
+        return configured.isEmpty() ? QString() : QDir::cleanPath(configured);
+    }();
+    return root;
+}
+
+bool MappedFile::open(const QString &path, QString *error)
+{
+    close();
+
+    UniqueFd fd(::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC));
+    struct stat st;
+    if (!fd.isValid() || ::fstat(fd.get(), &st) != 0) {
+        if (error) {
+            *error = errnoString(path);
+        }
+        return false;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        if (error) {
+            *error = QString("%1: not a regular file").arg(path);
+        }
+        return false;
+    }
+    if (st.st_size == 0) {
+        return true;
+    }
+
+    void *mapping = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd.get(), 0);
+    if (mapping == MAP_FAILED) {
+        if (error) {
+            *error = errnoString(path);
+        }
+        return false;
+    }
+    m_data = static_cast<const char *>(mapping);
+    m_size = st.st_size;
+    // Without a free slot a truncation still raises SIGBUS, as it would
+    // for any other mapping.
+    m_slot = claimMappingSlot(m_data, m_size);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (m_slot >= 0) {
+        releaseMappingSlot(m_slot);
+        m_slot = -1;
+    }
+    if (m_data) {
+        ::munmap(const_cast<char *>(m_data), size_t(m_size));
+    }
+    m_data = nullptr;
+    m_size = 0;
+}
+
+bool MappedFile::truncated() const
+{
+    return m_slot >= 0 && mappingSlots[m_slot].faulted.load();
+}
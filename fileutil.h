@@ -0,0 +1,90 @@
+#ifndef FILEUTIL_H
+#define FILEUTIL_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
+
+#include <sys/stat.h>
+
+class UniqueFd
+{
+public:
+    explicit UniqueFd(int fd = -1) : m_fd(fd) {}
+    UniqueFd(UniqueFd &&other) noexcept : m_fd(other.release()) {}
+    UniqueFd &operator=(UniqueFd &&other) noexcept
+    {
+        reset(other.release());
+        return *this;
+    }
+    ~UniqueFd() { reset(); }
+
+    int get() const { return m_fd; }
+    bool isValid() const { return m_fd >= 0; }
+    int release()
+    {
+        int fd = m_fd;
+        m_fd = -1;
+        return fd;
+    }
+    void reset(int fd = -1);
+
+private:
+    UniqueFd(const UniqueFd &) = delete;
+    UniqueFd &operator=(const UniqueFd &) = delete;
+
+    int m_fd;
+};
+
+// Read-only private mapping of a whole file. The size is fixed at open, so
+// data appended later is not visible until the file is reopened. If the file
+// is truncated while mapped, reads past its new end see zeros instead of
+// raising SIGBUS, and truncated() turns true.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    bool open(const QString &path, QString *error = nullptr);
+    void close();
+
+    const char *data() const { return m_data; }
+    qint64 size() const { return m_size; }
+    bool truncated() const;
+
+private:
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *m_data = nullptr;
+    qint64 m_size = 0;
+    int m_slot = -1;
+};
+
+// Retry on EINTR and short transfers; return the byte count, or -1 with errno set.
+qint64 readFully(int fd, char *buffer, qint64 size);
+qint64 preadFully(int fd, char *buffer, qint64 size, qint64 offset);
+bool writeFully(int fd, const char *data, qint64 size);
+
+// Owner, mode and atime/mtime of st applied to fd.
+bool copyFileAttributes(int fd, const struct stat &st);
+bool syncParentDirectory(const QByteArray &path);
+
+// mkostemp() relative to a directory: creates prefix plus six random
+// characters with O_EXCL and O_NOFOLLOW, mode 0600; *name gets the name.
+UniqueFd createTempAt(int directoryFd, const QByteArray &prefix, QByteArray *name);
+
+// Opens the directory holding path by opening root and then every further
+// component with O_DIRECTORY | O_NOFOLLOW, so no symlink below root is
+// followed. path must be a clean absolute path below root; *name gets its
+// last component.
+UniqueFd openParentBeneath(const QString &root, const QString &path, QByteArray *name, QString *error);
+
+QString errnoString(const QString &context);
+
+// Prefix for the system directories the engines read (/var/cache/pacman,
+// /var/lib/pacman, /var/log): $PACMAN_CACHE_CLEANER_SYSROOT, read once, or
+// empty for the real system. Lets tests point every tab at fixtures.
+QString systemRoot();
+
+#endif // FILEUTIL_H
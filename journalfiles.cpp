@@ -0,0 +1,215 @@
+#include "journalfiles.h"
+#include "fileutil.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Offsets into the on-disk header; see systemd's journal-def.h.
+const char Signature[8] = { 'L', 'P', 'K', 'S', 'H', 'H', 'R', 'H' };
+const int StateOffset = 16;
+const int MachineIdOffset = 40;
+const int TailBootIdOffset = 56;
+const int HeaderSizeOffset = 88;
+const int ArenaSizeOffset = 96;
+const int EntryCountOffset = 152;
+const int HeadRealtimeOffset = 184;
+const int TailRealtimeOffset = 192;
+const int MinimumHeaderSize = 208;
+
+quint64 readLE64(const char *data)
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data);
+    quint64 value = 0;
+    for (int i = 7; i >= 0; --i) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+QString readId(const char *data)
+{
+    return QString::fromLatin1(QByteArray(data, 16).toHex());
+}
+
+bool isArchivedName(const QString &fileName)
+{
+    return fileName.contains('@') && (fileName.endsWith(".journal") || fileName.endsWith(".journal~"));
+}
+
+} // namespace
+
+bool JournalFiles::readHeader(const QString &path, JournalFileInfo *info)
+{
+    UniqueFd fd(::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW));
+    return readHeader(fd.get(), path, info);
+}
+
+bool JournalFiles::readHeader(int fd, const QString &path, JournalFileInfo *info)
+{
+    info->path = path;
+    info->archived = isArchivedName(QFileInfo(path).fileName());
+
+    struct stat st;
+    if (fd < 0 || ::fstat(fd, &st) != 0) {
+        info->error = errnoString(path);
+        return false;
+    }
+    info->diskUsage = qint64(st.st_blocks) * 512;
+
+    char header[MinimumHeaderSize];
+    if (preadFully(fd, header, sizeof(header), 0) != qint64(sizeof(header))
+        || memcmp(header, Signature, sizeof(Signature)) != 0) {
+        info->error = QString("%1: not a journal file").arg(path);
+        return false;
+    }
+
+    switch (quint8(header[StateOffset])) {
+    case 0:
+        info->state = JournalFileInfo::State::Offline;
+        break;
+    case 1:
+        info->state = JournalFileInfo::State::Online;
+        break;
+    case 2:
+        info->state = JournalFileInfo::State::Archived;
+        break;
+    default:
+        info->state = JournalFileInfo::State::Unknown;
+        break;
+    }
+
+    info->machineId = readId(header + MachineIdOffset);
+    info->bootId = readId(header + TailBootIdOffset);
+    info->arenaSize = qint64(readLE64(header + HeaderSizeOffset) + readLE64(header + ArenaSizeOffset));
+    info->entries = readLE64(header + EntryCountOffset);
+    info->headRealtime = readLE64(header + HeadRealtimeOffset);
+    info->tailRealtime = readLE64(header + TailRealtimeOffset);
+
+    // A cleanly rotated file is marked archived in its header; a "~" file was
+    // renamed after a crash and may still say online.
+    if (info->archived && path.endsWith(".journal") && info->state == JournalFileInfo::State::Online) {
+        info->archived = false;
+    }
+    return true;
+}
+
+QVector<JournalFileInfo> JournalFiles::scan(const QString &root)
+{
+    QVector<JournalFileInfo> files;
+
+    const QStringList filters { "*.journal", "*.journal~" };
+    const QFileInfoList machines = QDir(root).entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QFileInfo &machine : machines) {
+        const QFileInfoList journals = QDir(machine.filePath()).entryInfoList(filters, QDir::Files | QDir::System);
+        for (const QFileInfo &journal : journals) {
+            JournalFileInfo info;
+            readHeader(journal.filePath(), &info);
+            files.append(info);
+        }
+    }
+
+    std::sort(files.begin(), files.end(), [](const JournalFileInfo &a, const JournalFileInfo &b) {
+        return a.headRealtime < b.headRealtime;
+    });
+    return files;
+}
+
+QVector<JournalFileInfo> JournalFiles::planVacuum(const QVector<JournalFileInfo> &files, qint64 maxBytes,
+                                                  qint64 maxAgeSecs, qint64 now)
+{
+    QVector<int> candidates;
+    qint64 total = 0;
+    for (int i = 0; i < files.size(); ++i) {
+        total += files[i].diskUsage;
+        if (files[i].archived) {
+            candidates.append(i);
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [&files](int a, int b) {
+        return files[a].headRealtime < files[b].headRealtime;
+    });
+
+    QVector<JournalFileInfo> plan;
+    QVector<bool> taken(files.size(), false);
+
+    if (maxAgeSecs >= 0) {
+        const quint64 cutoff = quint64(qMax<qint64>(0, now - maxAgeSecs)) * 1000000;
+        for (int index : qAsConst(candidates)) {
+            if (files[index].tailRealtime < cutoff) {
+                taken[index] = true;
+                total -= files[index].diskUsage;
+            }
+        }
+    }
+
+    if (maxBytes >= 0) {
+        for (int index : qAsConst(candidates)) {
+            if (total <= maxBytes) {
+                break;
+            }
+            if (!taken[index]) {
+                taken[index] = true;
+                total -= files[index].diskUsage;
+            }
+        }
+    }
+
+    for (int index : qAsConst(candidates)) {
+        if (taken[index]) {
+            plan.append(files[index]);
+        }
+    }
+    return plan;
+}
+
+bool JournalFiles::removeAt(int directoryFd, const QString &path, qint64 *bytesFreed, QString *error)
+{
+    const QByteArray name = QFile::encodeName(QFileInfo(path).fileName());
+    UniqueFd fd(::openat(directoryFd, name.constData(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW));
+    JournalFileInfo current;
+    if (!readHeader(fd.get(), path, &current) || !current.archived) {
+        *error = current.error.isEmpty() ? QString("%1: no longer archived, skipped").arg(path) : current.error;
+        return false;
+    }
+    // Unlink the name only while it still refers to the file just checked.
+    struct stat opened;
+    struct stat named;
+    if (::fstat(fd.get(), &opened) != 0 || ::fstatat(directoryFd, name.constData(), &named, AT_SYMLINK_NOFOLLOW) != 0
+        || opened.st_dev != named.st_dev || opened.st_ino != named.st_ino) {
+        *error = QString("%1: replaced while being checked, skipped").arg(path);
+        return false;
+    }
+    if (::unlinkat(directoryFd, name.constData(), 0) != 0) {
+        *error = errnoString(path);
+        return false;
+    }
+    if (bytesFreed) {
+        *bytesFreed += current.diskUsage;
+    }
+    return true;
+}
+
+QString JournalFiles::stateName(JournalFileInfo::State state)
+{
+    switch (state) {
+    case JournalFileInfo::State::Offline:
+        return "Offline";
+    case JournalFileInfo::State::Online:
+        return "Online";
+    case JournalFileInfo::State::Archived:
+        return "Archived";
+    case JournalFileInfo::State::Unknown:
+        break;
+    }
+    return "Unknown";
+}
@@ -0,0 +1,68 @@
+#ifndef JOURNALFILES_H
+#define JOURNALFILES_H
+
+#include "fileutil.h"
+
+#include <QtCore/QMetaType>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+struct JournalFileInfo
+{
+    enum class State
+    {
+        Offline,
+        Online,
+        Archived,
+        Unknown
+    };
+
+    QString path;
+    qint64 diskUsage = 0;
+    qint64 arenaSize = 0;
+    State state = State::Unknown;
+    QString machineId;
+    QString bootId;
+    // Microseconds since the epoch; 0 for a file without entries.
+    quint64 headRealtime = 0;
+    quint64 tailRealtime = 0;
+    quint64 entries = 0;
+    // Rotated away by journald (name@...journal, or ...journal~ if it was
+    // not closed cleanly); only these are safe to delete.
+    bool archived = false;
+    QString error;
+};
+
+Q_DECLARE_METATYPE(QVector<JournalFileInfo>)
+
+// Reads systemd journal file headers directly instead of asking journalctl.
+class JournalFiles
+{
+public:
+    static QString defaultRoot()
+    {
+        return systemRoot() + "/var/log/journal";
+    }
+
+    static bool readHeader(const QString &path, JournalFileInfo *info);
+    // The same on an open file; path only names it.
+    static bool readHeader(int fd, const QString &path, JournalFileInfo *info);
+
+    // Every *.journal and *.journal~ file in the machine directories under root.
+    static QVector<JournalFileInfo> scan(const QString &root = defaultRoot());
+
+    // Archived files to delete, oldest first: those whose last entry is older
+    // than maxAgeSecs, then more until the total is at most maxBytes. A
+    // negative limit is ignored.
+    static QVector<JournalFileInfo> planVacuum(const QVector<JournalFileInfo> &files, qint64 maxBytes,
+                                               qint64 maxAgeSecs, qint64 now);
+
+    // Rechecks the header of path's last component in directoryFd before
+    // unlinking it there, so an active file is never removed.
+    static bool removeAt(int directoryFd, const QString &path, qint64 *bytesFreed, QString *error);
+
+    static QString stateName(JournalFileInfo::State state);
+};
+
+#endif // JOURNALFILES_H
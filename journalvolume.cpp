@@ -0,0 +1,293 @@
+#include "journalvolume.h"
+#include "fileutil.h"
+
+#include <QtCore/QVector>
+
+#include <cstring>
+#include <endian.h>
+#include <zstd.h>
+
+namespace {
+
+// Layout from systemd's journal-def.h.
+const int IncompatibleFlagsOffset = 12;
+const int HeaderSizeOffset = 88;
+const int EntryCountOffset = 152;
+const int EntryArrayOffsetOffset = 176;
+const int MinimumHeaderSize = 208;
+const quint32 IncompatibleCompact = 1 << 4;
+
+const int ObjectHeaderSize = 16;
+const quint8 ObjectData = 1;
+const quint8 ObjectEntry = 3;
+const quint8 ObjectEntryArray = 6;
+const quint8 CompressedXz = 1 << 0;
+const quint8 CompressedLz4 = 1 << 1;
+const quint8 CompressedZstd = 1 << 2;
+
+const int EntryRealtimeOffset = 24;
+const int EntryItemsOffset = 64;
+const int EntryArrayNextOffset = 16;
+const int EntryArrayItemsOffset = 24;
+const int DataPayloadOffset = 64;
+const int CompactDataPayloadOffset = 72;
+
+quint64 readLE64(const char *data)
+{
+    quint64 value;
+    memcpy(&value, data, sizeof(value));
+    return le64toh(value);
+}
+
+quint32 readLE32(const char *data)
+{
+    quint32 value;
+    memcpy(&value, data, sizeof(value));
+    return le32toh(value);
+}
+
+struct DataInfo
+{
+    enum Kind : quint8
+    {
+        Other,
+        Unit,
+        Priority,
+        Kernel
+    };
+
+    quint64 payloadSize = 0;
+    Kind kind = Other;
+    int value = 0;
+};
+
+class JournalReader
+{
+public:
+    JournalReader(const char *data, qint64 size, JournalVolumeReport &report)
+        : m_data(data), m_size(size), m_report(report)
+    {
+    }
+
+    bool run(QString *error)
+    {
+        if (m_size < MinimumHeaderSize || memcmp(m_data, "LPKSHHRH", 8) != 0) {
+            *error = "not a journal file";
+            return false;
+        }
+        m_compact = readLE32(m_data + IncompatibleFlagsOffset) & IncompatibleCompact;
+        m_headerSize = qint64(readLE64(m_data + HeaderSizeOffset));
+
+        quint64 remaining = readLE64(m_data + EntryCountOffset);
+        quint64 offset = readLE64(m_data + EntryArrayOffsetOffset);
+        const int itemSize = m_compact ? 4 : 8;
+
+        while (offset != 0 && remaining > 0) {
+            const char *array = object(offset, ObjectEntryArray);
+            if (!array) {
+                *error = QString("corrupt entry array at %1").arg(offset);
+                return false;
+            }
+            const quint64 count = (objectSize(array) - EntryArrayItemsOffset) / quint64(itemSize);
+            const char *items = array + EntryArrayItemsOffset;
+            for (quint64 i = 0; i < count && remaining > 0; ++i, --remaining) {
+                const quint64 entry = m_compact ? readLE32(items + i * 4) : readLE64(items + i * 8);
+                if (entry == 0) {
+                    remaining = 0;
+                    break;
+                }
+                addEntry(entry);
+            }
+
+            // Arrays are only ever appended, so the chain must move forward.
+            const quint64 next = readLE64(array + EntryArrayNextOffset);
+            if (next != 0 && next <= offset) {
+                *error = QString("entry array chain loops at %1").arg(offset);
+                return false;
+            }
+            offset = next;
+        }
+        return true;
+    }
+
+private:
+    static quint64 objectSize(const char *object)
+    {
+        return readLE64(object + 8);
+    }
+
+    // The object at offset if it is in bounds and of the expected type.
+    const char *object(quint64 offset, quint8 type) const
+    {
+        if (offset < quint64(m_headerSize) || offset % 8 != 0 || offset + ObjectHeaderSize > quint64(m_size)) {
+            return nullptr;
+        }
+        const char *object = m_data + offset;
+        const quint64 size = objectSize(object);
+        if (quint8(object[0]) != type || size < ObjectHeaderSize || size > quint64(m_size) - offset) {
+            return nullptr;
+        }
+        return object;
+    }
+
+    void addEntry(quint64 offset)
+    {
+        const char *entry = object(offset, ObjectEntry);
+        if (!entry || objectSize(entry) < quint64(EntryItemsOffset)) {
+            return;
+        }
+
+        const int itemSize = m_compact ? 4 : 16;
+        const quint64 count = (objectSize(entry) - EntryItemsOffset) / quint64(itemSize);
+        const char *items = entry + EntryItemsOffset;
+
+        LogVolume volume;
+        volume.entries = 1;
+        int unit = -1;
+        int priority = 6;
+        bool kernel = false;
+
+        for (quint64 i = 0; i < count; ++i) {
+            const quint64 dataOffset = m_compact ? readLE32(items + i * 4) : readLE64(items + i * 16);
+            const DataInfo &data = dataInfo(dataOffset);
+            volume.bytes += data.payloadSize;
+            switch (data.kind) {
+            case DataInfo::Unit:
+                unit = data.value;
+                break;
+            case DataInfo::Priority:
+                priority = data.value;
+                break;
+            case DataInfo::Kernel:
+                kernel = true;
+                break;
+            case DataInfo::Other:
+                break;
+            }
+        }
+        volume.priorities[priority] = 1;
+
+        const QString &name = unit >= 0 ? m_unitNames[unit] : kernel ? m_kernel : m_none;
+        m_report.units[name].add(volume);
+
+        const qint64 hour = qint64(readLE64(entry + EntryRealtimeOffset) / 3600000000ULL) * 3600;
+        m_report.hours[hour].add(volume);
+        m_report.total.add(volume);
+    }
+
+    const DataInfo &dataInfo(quint64 offset)
+    {
+        auto it = m_dataCache.find(offset);
+        if (it != m_dataCache.end()) {
+            return it.value();
+        }
+
+        DataInfo info;
+        const int payloadOffset = m_compact ? CompactDataPayloadOffset : DataPayloadOffset;
+        const char *data = object(offset, ObjectData);
+        if (data && objectSize(data) >= quint64(payloadOffset)) {
+            const char *payload = data + payloadOffset;
+            const quint64 length = objectSize(data) - quint64(payloadOffset);
+            const quint8 flags = quint8(data[1]);
+            info.payloadSize = length;
+
+            if (flags & CompressedZstd) {
+                unsigned long long size = ZSTD_getFrameContentSize(payload, size_t(length));
+                if (size != ZSTD_CONTENTSIZE_UNKNOWN && size != ZSTD_CONTENTSIZE_ERROR) {
+                    info.payloadSize = size;
+                }
+            } else if (flags & CompressedLz4) {
+                // systemd prefixes LZ4 blocks with the decompressed size.
+                if (length >= 8) {
+                    info.payloadSize = readLE64(payload);
+                }
+            } else if (!(flags & CompressedXz)) {
+                classify(payload, length, &info);
+            }
+        }
+        return *m_dataCache.insert(offset, info);
+    }
+
+    void classify(const char *payload, quint64 length, DataInfo *info)
+    {
+        static const char unitField[] = "_SYSTEMD_UNIT=";
+        static const char priorityField[] = "PRIORITY=";
+        static const char kernelField[] = "_TRANSPORT=kernel";
+        const quint64 unitLength = sizeof(unitField) - 1;
+        const quint64 priorityLength = sizeof(priorityField) - 1;
+        const quint64 kernelLength = sizeof(kernelField) - 1;
+
+        if (length > unitLength && memcmp(payload, unitField, unitLength) == 0) {
+            const QString name = QString::fromUtf8(payload + unitLength, int(length - unitLength));
+            info->kind = DataInfo::Unit;
+            info->value = m_unitIds.value(name, -1);
+            if (info->value < 0) {
+                info->value = m_unitNames.size();
+                m_unitIds.insert(name, info->value);
+                m_unitNames.append(name);
+            }
+        } else if (length == priorityLength + 1 && memcmp(payload, priorityField, priorityLength) == 0) {
+            const char digit = payload[priorityLength];
+            if (digit >= '0' && digit <= '7') {
+                info->kind = DataInfo::Priority;
+                info->value = digit - '0';
+            }
+        } else if (length == kernelLength && memcmp(payload, kernelField, kernelLength) == 0) {
+            info->kind = DataInfo::Kernel;
+        }
+    }
+
+    const char *m_data;
+    qint64 m_size;
+    qint64 m_headerSize = 0;
+    bool m_compact = false;
+    JournalVolumeReport &m_report;
+    QHash<quint64, DataInfo> m_dataCache;
+    QHash<QString, int> m_unitIds;
+    QVector<QString> m_unitNames;
+    const QString m_kernel = "kernel";
+    const QString m_none;
+};
+
+} // namespace
+
+void LogVolume::add(const LogVolume &other)
+{
+    entries += other.entries;
+    bytes += other.bytes;
+    for (int i = 0; i < 8; ++i) {
+        priorities[i] += other.priorities[i];
+    }
+}
+
+JournalVolumeReport JournalVolumeAnalyzer::analyzeFile(const QString &path)
+{
+    JournalVolumeReport report;
+    report.files = 1;
+
+    MappedFile file;
+    QString error;
+    if (!file.open(path, &error)) {
+        report.errors << error;
+        return report;
+    }
+
+    JournalReader reader(file.data(), file.size(), report);
+    if (!reader.run(&error)) {
+        report.errors << QString("%1: %2").arg(path, error);
+    }
+    return report;
+}
+
+void JournalVolumeAnalyzer::merge(JournalVolumeReport &result, const JournalVolumeReport &part)
+{
+    for (auto it = part.units.constBegin(); it != part.units.constEnd(); ++it) {
+        result.units[it.key()].add(it.value());
+    }
+    for (auto it = part.hours.constBegin(); it != part.hours.constEnd(); ++it) {
+        result.hours[it.key()].add(it.value());
+    }
+    result.total.add(part.total);
+    result.files += part.files;
+    result.errors += part.errors;
+}
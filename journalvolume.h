@@ -0,0 +1,49 @@
+#ifndef JOURNALVOLUME_H
+#define JOURNALVOLUME_H
+
+#include <QtCore/QHash>
+#include <QtCore/QMap>
+#include <QtCore/QMetaType>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+struct LogVolume
+{
+    quint64 entries = 0;
+    // Sum of the (uncompressed) field payloads referenced by each entry,
+    // roughly what journalctl -o export would print.
+    quint64 bytes = 0;
+    // Entries per syslog priority, 0 (emerg) to 7 (debug).
+    quint64 priorities[8] = {};
+
+    void add(const LogVolume &other);
+};
+
+struct JournalVolumeReport
+{
+    // Keyed by _SYSTEMD_UNIT; kernel messages under "kernel", anything else
+    // without a unit under an empty key.
+    QHash<QString, LogVolume> units;
+    // Keyed by the start of the hour, in seconds since the epoch.
+    QMap<qint64, LogVolume> hours;
+    LogVolume total;
+    int files = 0;
+    QStringList errors;
+};
+
+Q_DECLARE_METATYPE(JournalVolumeReport)
+
+// Attributes journal volume to units by walking each file's entry array
+// chain and the data objects its entries reference, straight from a
+// read-only mapping. Data objects are shared between entries, so each one
+// is classified once per file.
+class JournalVolumeAnalyzer
+{
+public:
+    static JournalVolumeReport analyzeFile(const QString &path);
+
+    // Reduce step for QtConcurrent::mappedReduced over analyzeFile.
+    static void merge(JournalVolumeReport &result, const JournalVolumeReport &part);
+};
+
+#endif // JOURNALVOLUME_H
@@ -4,4 +4,4 @@ SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" &> /dev/null && pwd )"
 
 cd "$SCRIPT_DIR"
 
-sudo -E ./build/PacmanCacheCleaner 
\ No newline at end of file
+./build/PacmanCacheCleaner 
\ No newline at end of file
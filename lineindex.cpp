@@ -0,0 +1,186 @@
+#include "lineindex.h"
+#include "fileutil.h"
+
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtCore/QFile>
+#include <QtCore/QPair>
+#include <QtCore/QThread>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+namespace {
+
+struct SegmentSearch
+{
+    typedef qint64 result_type;
+
+    const char *data;
+    QByteArray needle;
+
+    qint64 operator()(const QPair<qint64, qint64> &segment) const
+    {
+        const void *hit = memmem(data + segment.first, size_t(segment.second - segment.first),
+                                 needle.constData(), size_t(needle.size()));
+        return hit ? static_cast<const char *>(hit) - data : -1;
+    }
+};
+
+} // namespace
+
+int LineIndex::chunkCount(qint64 fileSize)
+{
+    return int((fileSize + ChunkSize - 1) / ChunkSize);
+}
+
+LineIndexChunk LineIndex::indexChunk(const char *data, qint64 size, int chunk)
+{
+    LineIndexChunk result;
+    result.begin = qint64(chunk) * ChunkSize;
+    result.end = qMin(size, result.begin + ChunkSize);
+
+    auto addStart = [&result](qint64 start) {
+        if (result.lineCount % CheckpointInterval == 0) {
+            result.checkpoints.append(start);
+        }
+        ++result.lineCount;
+    };
+
+    if (result.begin >= result.end) {
+        return result;
+    }
+    if (result.begin == 0 || data[result.begin - 1] == '\n') {
+        addStart(result.begin);
+    }
+
+    // glibc's memchr is vectorised; a newline at p starts a line at p + 1,
+    // which belongs to this chunk only if it is before end.
+    const char *p = data + result.begin;
+    const char *last = data + result.end - 1;
+    while (p < last) {
+        const char *newline = static_cast<const char *>(memchr(p, '\n', size_t(last - p)));
+        if (!newline) {
+            break;
+        }
+        addStart(newline + 1 - data);
+        p = newline + 1;
+    }
+    return result;
+}
+
+void LineIndex::reset(const char *data, qint64 size)
+{
+    m_data = data;
+    m_size = size;
+    m_indexedBytes = 0;
+    m_lineCount = 0;
+    m_chunks.clear();
+}
+
+void LineIndex::append(const LineIndexChunk &chunk)
+{
+    m_chunks.append(Chunk { chunk, m_lineCount });
+    m_lineCount += chunk.lineCount;
+    m_indexedBytes = chunk.end;
+}
+
+int LineIndex::chunkForLine(qint64 number) const
+{
+    auto it = std::upper_bound(m_chunks.constBegin(), m_chunks.constEnd(), number,
+                               [](qint64 line, const Chunk &chunk) { return line < chunk.firstLine; });
+    return int(it - m_chunks.constBegin()) - 1;
+}
+
+qint64 LineIndex::lineStart(qint64 number) const
+{
+    if (number < 0 || number >= m_lineCount) {
+        return -1;
+    }
+
+    const Chunk &chunk = m_chunks[chunkForLine(number)];
+    const qint64 local = number - chunk.firstLine;
+    qint64 start = chunk.index.checkpoints[int(local / CheckpointInterval)];
+    for (qint64 skip = local % CheckpointInterval; skip > 0; --skip) {
+        const char *newline = static_cast<const char *>(memchr(m_data + start, '\n', size_t(m_size - start)));
+        // Only when the file was truncated under the mapping, which then
+        // reads as zeros past its new end.
+        if (!newline || newline + 1 - m_data >= m_size) {
+            return -1;
+        }
+        start = newline + 1 - m_data;
+    }
+    return start;
+}
+
+QByteArray LineIndex::line(qint64 number) const
+{
+    const qint64 start = lineStart(number);
+    if (start < 0) {
+        return QByteArray();
+    }
+    const char *newline = static_cast<const char *>(memchr(m_data + start, '\n', size_t(m_size - start)));
+    qint64 end = newline ? newline - m_data : m_size;
+    if (end > start && m_data[end - 1] == '\r') {
+        --end;
+    }
+    return QByteArray::fromRawData(m_data + start, int(qMin<qint64>(end - start, INT_MAX)));
+}
+
+qint64 LineIndex::lineForOffset(qint64 offset) const
+{
+    if (offset < 0 || offset >= m_indexedBytes) {
+        return -1;
+    }
+
+    const Chunk &chunk = m_chunks[int(offset / ChunkSize)];
+    const QVector<qint64> &checkpoints = chunk.index.checkpoints;
+    auto it = std::upper_bound(checkpoints.constBegin(), checkpoints.constEnd(), offset);
+    if (it == checkpoints.constBegin()) {
+        // The offset is inside a line that started in an earlier chunk.
+        return chunk.firstLine - 1;
+    }
+
+    const int checkpoint = int(it - checkpoints.constBegin()) - 1;
+    qint64 line = chunk.firstLine + qint64(checkpoint) * CheckpointInterval;
+    qint64 start = checkpoints[checkpoint];
+    for (;;) {
+        const char *newline = static_cast<const char *>(memchr(m_data + start, '\n', size_t(offset - start)));
+        if (!newline) {
+            return line;
+        }
+        start = newline + 1 - m_data;
+        ++line;
+    }
+}
+
+qint64 SubstringSearch::findFirst(const char *data, qint64 size, qint64 from, const QByteArray &needle)
+{
+    if (needle.isEmpty() || from < 0 || from >= size) {
+        return -1;
+    }
+
+    const int batch = qMax(1, QThread::idealThreadCount());
+    const SegmentSearch search { data, needle };
+    qint64 position = from;
+
+    while (position < size) {
+        // Segments overlap by needle.size() - 1 so matches on a boundary count.
+        QVector<QPair<qint64, qint64>> segments;
+        for (int i = 0; i < batch && position < size; ++i) {
+            const qint64 segmentEnd = qMin(size, position + SegmentSize);
+            segments.append(qMakePair(position, qMin(size, segmentEnd + needle.size() - 1)));
+            position = segmentEnd;
+        }
+
+        const QVector<qint64> hits = segments.size() == 1
+            ? QVector<qint64>() << search(segments.first())
+            : QtConcurrent::blockingMapped<QVector<qint64>>(segments, search);
+        for (qint64 hit : hits) {
+            if (hit >= 0) {
+                return hit;
+            }
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,84 @@
+#ifndef LINEINDEX_H
+#define LINEINDEX_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+// Line starts found in [begin, end) of the mapping. Only every
+// CheckpointInterval-th start is kept; the rest are found again with memchr
+// on lookup, which keeps a 20 GB log's index in tens of megabytes.
+struct LineIndexChunk
+{
+    qint64 begin = 0;
+    qint64 end = 0;
+    qint64 lineCount = 0;
+    QVector<qint64> checkpoints;
+};
+
+class LineIndex
+{
+public:
+    static const qint64 ChunkSize = 16 * 1024 * 1024;
+    static const int CheckpointInterval = 64;
+
+    static int chunkCount(qint64 fileSize);
+    static LineIndexChunk indexChunk(const char *data, qint64 size, int chunk);
+
+    void reset(const char *data, qint64 size);
+
+    // Chunks must be appended in file order.
+    void append(const LineIndexChunk &chunk);
+    bool isComplete() const { return m_indexedBytes == m_size; }
+    qint64 indexedBytes() const { return m_indexedBytes; }
+    qint64 lineCount() const { return m_lineCount; }
+
+    // A view into the mapping without the trailing newline. Lines the index
+    // can no longer find, after the file was truncated, are empty, and their
+    // start is -1.
+    QByteArray line(qint64 number) const;
+    qint64 lineStart(qint64 number) const;
+    // -1 while the offset lies beyond the indexed part of the file.
+    qint64 lineForOffset(qint64 offset) const;
+
+private:
+    struct Chunk
+    {
+        LineIndexChunk index;
+        qint64 firstLine;
+    };
+
+    int chunkForLine(qint64 number) const;
+
+    const char *m_data = nullptr;
+    qint64 m_size = 0;
+    qint64 m_indexedBytes = 0;
+    qint64 m_lineCount = 0;
+    QVector<Chunk> m_chunks;
+};
+
+struct IndexChunkJob
+{
+    typedef LineIndexChunk result_type;
+
+    const char *data;
+    qint64 size;
+
+    LineIndexChunk operator()(int chunk) const
+    {
+        return LineIndex::indexChunk(data, size, chunk);
+    }
+};
+
+class SubstringSearch
+{
+public:
+    static const qint64 SegmentSize = 32 * 1024 * 1024;
+
+    // Offset of the first occurrence of needle at or after from, or -1. The
+    // range is split into segments scanned with memmem on the global thread
+    // pool, a batch at a time, so an early hit doesn't wait for the whole file.
+    static qint64 findFirst(const char *data, qint64 size, qint64 from, const QByteArray &needle);
+};
+
+#endif // LINEINDEX_H
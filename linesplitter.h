@@ -0,0 +1,74 @@
+#ifndef LINESPLITTER_H
+#define LINESPLITTER_H
+
+#include <QtCore/QByteArray>
+#include <cstring>
+
+// Accumulates process output chunks and hands out complete lines as
+// QByteArray::fromRawData views into the internal buffer. The views are only
+// valid for the duration of the callback.
+class LineSplitter
+{
+public:
+    void append(const QByteArray &chunk)
+    {
+        m_buffer.append(chunk);
+    }
+
+    template <typename Callback>
+    void consume(Callback callback)
+    {
+        const char *begin = m_buffer.constData();
+        const char *end = begin + m_buffer.size();
+        const char *lineStart = begin;
+
+        while (lineStart < end) {
+            const char *newline = static_cast<const char *>(memchr(lineStart, '\n', end - lineStart));
+            if (!newline) {
+                break;
+            }
+            emitLine(lineStart, newline, callback);
+            lineStart = newline + 1;
+        }
+
+        if (lineStart != begin) {
+            m_buffer.remove(0, int(lineStart - begin));
+        }
+    }
+
+    template <typename Callback>
+    void flush(Callback callback)
+    {
+        consume(callback);
+        if (!m_buffer.isEmpty()) {
+            emitLine(m_buffer.constData(), m_buffer.constData() + m_buffer.size(), callback);
+            m_buffer.clear();
+        }
+    }
+
+    void clear()
+    {
+        m_buffer.clear();
+    }
+
+private:
+    template <typename Callback>
+    static void emitLine(const char *lineStart, const char *lineEnd, Callback &callback)
+    {
+        // Progress bars redraw with '\r'; only the last redraw is meaningful.
+        while (lineEnd > lineStart && lineEnd[-1] == '\r') {
+            --lineEnd;
+        }
+        for (const char *p = lineEnd; p > lineStart; --p) {
+            if (p[-1] == '\r') {
+                lineStart = p;
+                break;
+            }
+        }
+        callback(QByteArray::fromRawData(lineStart, int(lineEnd - lineStart)));
+    }
+
+    QByteArray m_buffer;
+};
+
+#endif // LINESPLITTER_H
@@ -0,0 +1,648 @@
+#include "logarchive.h"
+#include "compressedstream.h"
+#include "fileutil.h"
+#include "logcompressor.h"
+
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtCore/QDateTime>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QThread>
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zstd.h>
+
+namespace {
+
+const quint32 SkippableMagic = 0x184D2A5E;
+const quint32 SeekableMagic = 0x8F92EAB1;
+const int SeekFooterSize = 9;
+
+void appendLE32(QByteArray &out, quint32 value)
+{
+    char bytes[4] = { char(value), char(value >> 8), char(value >> 16), char(value >> 24) };
+    out.append(bytes, 4);
+}
+
+quint32 readLE32(const char *data)
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data);
+    return quint32(bytes[0]) | quint32(bytes[1]) << 8 | quint32(bytes[2]) << 16 | quint32(bytes[3]) << 24;
+}
+
+qint64 daysFromCivil(int year, int month, int day)
+{
+    year -= month <= 2;
+    const int era = (year >= 0 ? year : year - 399) / 400;
+    const int yearOfEra = year - era * 400;
+    const int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return qint64(era) * 146097 + dayOfEra - 719468;
+}
+
+bool digits(const char *p, int count, int *value)
+{
+    int result = 0;
+    for (int i = 0; i < count; ++i) {
+        if (p[i] < '0' || p[i] > '9') {
+            return false;
+        }
+        result = result * 10 + (p[i] - '0');
+    }
+    *value = result;
+    return true;
+}
+
+qint64 firstTimestamp(const char *data, qint64 size, int defaultYear)
+{
+    const char *p = data;
+    const char *end = data + size;
+    for (int lines = 0; p < end && lines < 64; ++lines) {
+        const char *newline = static_cast<const char *>(memchr(p, '\n', size_t(end - p)));
+        const char *lineEnd = newline ? newline : end;
+        qint64 timestamp = LogArchive::parseLineTimestamp(p, lineEnd - p, defaultYear);
+        if (timestamp != 0) {
+            return timestamp;
+        }
+        p = lineEnd + 1;
+    }
+    return 0;
+}
+
+qint64 lastTimestamp(const char *data, qint64 size, int defaultYear)
+{
+    const char *lineEnd = data + size;
+    for (int lines = 0; lineEnd > data && lines < 64; ++lines) {
+        if (lineEnd[-1] == '\n') {
+            --lineEnd;
+        }
+        const char *lineStart = lineEnd;
+        while (lineStart > data && lineStart[-1] != '\n') {
+            --lineStart;
+        }
+        qint64 timestamp = LogArchive::parseLineTimestamp(lineStart, lineEnd - lineStart, defaultYear);
+        if (timestamp != 0) {
+            return timestamp;
+        }
+        lineEnd = lineStart;
+    }
+    return 0;
+}
+
+struct PendingBlock
+{
+    QByteArray data;
+    int defaultYear = 1970;
+};
+
+struct CompressedBlock
+{
+    QByteArray compressed;
+    qint64 size = 0;
+    qint64 firstTimestamp = 0;
+    qint64 lastTimestamp = 0;
+};
+
+struct ArchiveBlockCompressor
+{
+    typedef CompressedBlock result_type;
+
+    CompressionPolicy policy;
+
+    CompressedBlock operator()(const PendingBlock &block) const
+    {
+        CompressedBlock result;
+        result.compressed = LogCompressor::compressBlock(block.data.constData(), block.data.size(), policy);
+        result.size = block.data.size();
+        result.firstTimestamp = firstTimestamp(block.data.constData(), block.data.size(), block.defaultYear);
+        result.lastTimestamp = lastTimestamp(block.data.constData(), block.data.size(), block.defaultYear);
+        return result;
+    }
+};
+
+struct BlockReader
+{
+    typedef QByteArray result_type;
+
+    const LogArchive *archive;
+
+    QByteArray operator()(int index) const
+    {
+        return archive->readBlock(index);
+    }
+};
+
+class ArchiveWriter
+{
+public:
+    ArchiveWriter(int fd, const CompressionPolicy &policy)
+        : m_fd(fd), m_compressor { policy }, m_batchSize(qMax(1, QThread::idealThreadCount()))
+    {
+    }
+
+    bool add(const PendingBlock &block)
+    {
+        m_pending.append(block);
+        return m_pending.size() < m_batchSize || flush();
+    }
+
+    bool flush()
+    {
+        if (m_pending.isEmpty()) {
+            return true;
+        }
+
+        const QVector<CompressedBlock> compressed =
+            QtConcurrent::blockingMapped<QVector<CompressedBlock>>(m_pending, m_compressor);
+        m_pending.clear();
+
+        for (const CompressedBlock &block : compressed) {
+            if (block.compressed.isEmpty() || !writeFully(m_fd, block.compressed.constData(), block.compressed.size())) {
+                return false;
+            }
+            ArchiveBlock entry;
+            entry.compressedOffset = m_compressedOffset;
+            entry.compressedSize = block.compressed.size();
+            entry.decompressedOffset = m_decompressedOffset;
+            entry.decompressedSize = block.size;
+            entry.firstTimestamp = block.firstTimestamp;
+            entry.lastTimestamp = block.lastTimestamp;
+            blocks.append(entry);
+            m_compressedOffset += entry.compressedSize;
+            m_decompressedOffset += entry.decompressedSize;
+        }
+        return true;
+    }
+
+    bool writeSeekTable()
+    {
+        QByteArray table;
+        appendLE32(table, SkippableMagic);
+        appendLE32(table, quint32(blocks.size() * 8 + SeekFooterSize));
+        for (const ArchiveBlock &block : qAsConst(blocks)) {
+            appendLE32(table, quint32(block.compressedSize));
+            appendLE32(table, quint32(block.decompressedSize));
+        }
+        appendLE32(table, quint32(blocks.size()));
+        table.append(char(0));
+        appendLE32(table, SeekableMagic);
+        return writeFully(m_fd, table.constData(), table.size());
+    }
+
+    qint64 decompressedOffset() const { return m_decompressedOffset; }
+
+    QVector<ArchiveBlock> blocks;
+
+private:
+    int m_fd;
+    ArchiveBlockCompressor m_compressor;
+    int m_batchSize;
+    QVector<PendingBlock> m_pending;
+    qint64 m_compressedOffset = 0;
+    qint64 m_decompressedOffset = 0;
+};
+
+QJsonArray blockToJson(const ArchiveBlock &block)
+{
+    return QJsonArray { double(block.compressedOffset), double(block.compressedSize),
+                        double(block.decompressedOffset), double(block.decompressedSize),
+                        double(block.firstTimestamp), double(block.lastTimestamp) };
+}
+
+void setError(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+}
+
+} // namespace
+
+qint64 LogArchive::parseLineTimestamp(const char *line, qint64 length, int defaultYear)
+{
+    while (length > 0 && (*line == '[' || *line == ' ')) {
+        ++line;
+        --length;
+    }
+
+    int year, month, day, hour, minute, second;
+
+    if (length >= 19 && line[4] == '-' && line[7] == '-' && (line[10] == 'T' || line[10] == ' ')
+        && line[13] == ':' && line[16] == ':'
+        && digits(line, 4, &year) && digits(line + 5, 2, &month) && digits(line + 8, 2, &day)
+        && digits(line + 11, 2, &hour) && digits(line + 14, 2, &minute) && digits(line + 17, 2, &second)) {
+        // ISO 8601, local wall-clock time.
+    } else if (length >= 15 && line[3] == ' ' && line[6] == ' ' && line[9] == ':' && line[12] == ':'
+               && digits(line + 7, 2, &hour) && digits(line + 10, 2, &minute) && digits(line + 13, 2, &second)) {
+        static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+        const char *found = nullptr;
+        for (int i = 0; i < 12; ++i) {
+            if (memcmp(months + i * 3, line, 3) == 0) {
+                found = months + i * 3;
+                break;
+            }
+        }
+        if (!found) {
+            return 0;
+        }
+        month = int(found - months) / 3 + 1;
+        day = (line[4] == ' ' ? 0 : line[4] - '0') * 10 + (line[5] - '0');
+        year = defaultYear;
+    } else {
+        return 0;
+    }
+
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) {
+        return 0;
+    }
+    return daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+}
+
+bool LogArchive::create(const QString &archivePath, const QStringList &files, int level, QString *error,
+                        QVector<ArchiveSource> *sources)
+{
+    const QByteArray outputPath = QFile::encodeName(archivePath);
+    QByteArray tempPath = outputPath + ".XXXXXX";
+    UniqueFd output(::mkostemp(tempPath.data(), O_CLOEXEC));
+    if (!output.isValid()) {
+        setError(error, errnoString(archivePath));
+        return false;
+    }
+
+    auto fail = [&](const QString &message) {
+        setError(error, message);
+        output.reset();
+        ::unlink(tempPath.constData());
+        return false;
+    };
+
+    CompressionPolicy policy = CompressionPolicy::forFile(BlockSize, CompressionCodec::Zstd);
+    policy.level = level;
+    ArchiveWriter writer(output.get(), policy);
+    QVector<ArchiveMember> members;
+    // The archive and its index are no more readable than the strictest of
+    // the logs they hold.
+    mode_t mode = files.isEmpty() ? (S_IRUSR | S_IWUSR) : 0666;
+
+    for (const QString &file : files) {
+        ArchiveMember member;
+        member.name = file;
+        member.offset = writer.decompressedOffset();
+        member.firstBlock = writer.blocks.size();
+        member.mtime = QFileInfo(file).lastModified().toSecsSinceEpoch();
+        const int defaultYear = QFileInfo(file).lastModified().date().year();
+
+        // Blocks are cut at the last newline so every block holds whole lines
+        // and its timestamps describe exactly what it contains.
+        QByteArray current;
+        current.reserve(int(BlockSize) + int(CompressedStreamReader::ChunkSize));
+        bool writeFailed = false;
+
+        auto cut = [&](bool final) {
+            while (current.size() >= BlockSize || (final && !current.isEmpty())) {
+                int cutAt = current.size();
+                if (!final || current.size() > BlockSize) {
+                    int newline = current.lastIndexOf('\n', int(BlockSize) - 1);
+                    cutAt = newline >= 0 ? newline + 1 : int(qMin<qint64>(BlockSize, current.size()));
+                }
+                PendingBlock block;
+                block.data = current.left(cutAt);
+                block.defaultYear = defaultYear;
+                current.remove(0, cutAt);
+                if (!writer.add(block)) {
+                    writeFailed = true;
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        const QByteArray sourcePath = QFile::encodeName(file);
+        struct stat before;
+        if (::stat(sourcePath.constData(), &before) != 0) {
+            return fail(errnoString(file));
+        }
+        mode &= before.st_mode;
+
+        QString readError;
+        bool ok = CompressedStreamReader::readFile(file, [&](const char *data, qint64 size) {
+            current.append(data, int(size));
+            member.size += size;
+            return cut(false);
+        }, &readError);
+
+        if (!ok) {
+            return fail(writeFailed ? errnoString(archivePath) : readError);
+        }
+        if (sources) {
+            ArchiveSource source;
+            source.path = file;
+            source.device = quint64(before.st_dev);
+            source.inode = quint64(before.st_ino);
+            source.mtimeNs = qint64(before.st_mtim.tv_sec) * 1000000000 + before.st_mtim.tv_nsec;
+            struct stat after;
+            if (::stat(sourcePath.constData(), &after) == 0 && after.st_dev == before.st_dev
+                && after.st_ino == before.st_ino && after.st_size == before.st_size
+                && after.st_mtim.tv_sec == before.st_mtim.tv_sec && after.st_mtim.tv_nsec == before.st_mtim.tv_nsec) {
+                source.size = qint64(before.st_size);
+            }
+            sources->append(source);
+        }
+        if (!cut(true) || !writer.flush() || writeFailed) {
+            return fail(errnoString(archivePath));
+        }
+
+        member.blockCount = writer.blocks.size() - member.firstBlock;
+        members.append(member);
+    }
+
+    if (!writer.flush() || !writer.writeSeekTable() || ::fchmod(output.get(), mode) != 0
+        || ::fsync(output.get()) != 0) {
+        return fail(errnoString(archivePath));
+    }
+    output.reset();
+
+    QJsonArray memberArray;
+    for (const ArchiveMember &member : qAsConst(members)) {
+        memberArray.append(QJsonObject {
+            { "name", member.name },
+            { "offset", double(member.offset) },
+            { "size", double(member.size) },
+            { "mtime", double(member.mtime) },
+            { "firstBlock", member.firstBlock },
+            { "blockCount", member.blockCount },
+        });
+    }
+    QJsonArray blockArray;
+    for (const ArchiveBlock &block : qAsConst(writer.blocks)) {
+        blockArray.append(blockToJson(block));
+    }
+    QJsonObject index {
+        { "version", 1 },
+        { "members", memberArray },
+        { "blocks", blockArray },
+    };
+
+    QFile sidecar(indexPath(archivePath) + ".tmp");
+    if (!sidecar.open(QIODevice::WriteOnly | QIODevice::Truncate) || ::fchmod(sidecar.handle(), mode) != 0
+        || sidecar.write(QJsonDocument(index).toJson(QJsonDocument::Compact)) < 0 || !sidecar.flush()
+        || ::fsync(sidecar.handle()) != 0) {
+        sidecar.remove();
+        return fail(QString("%1: %2").arg(sidecar.fileName(), sidecar.errorString()));
+    }
+    sidecar.close();
+
+    if (::rename(tempPath.constData(), outputPath.constData()) != 0) {
+        sidecar.remove();
+        return fail(errnoString(archivePath));
+    }
+    if (!sidecar.rename(indexPath(archivePath))) {
+        QFile::remove(indexPath(archivePath));
+        if (!sidecar.rename(indexPath(archivePath))) {
+            setError(error, QString("%1: %2").arg(indexPath(archivePath), sidecar.errorString()));
+            return false;
+        }
+    }
+    syncParentDirectory(outputPath);
+    return true;
+}
+
+bool LogArchive::open(const QString &archivePath, QString *error)
+{
+    m_path = archivePath;
+    m_members.clear();
+    m_blocks.clear();
+
+    if (!readSeekTable(error)) {
+        return false;
+    }
+
+    QFile sidecar(indexPath(archivePath));
+    if (!sidecar.open(QIODevice::ReadOnly)) {
+        // Without the sidecar the seek table still allows random access.
+        ArchiveMember member;
+        member.name = archivePath;
+        member.blockCount = m_blocks.size();
+        for (const ArchiveBlock &block : qAsConst(m_blocks)) {
+            member.size += block.decompressedSize;
+        }
+        m_members.append(member);
+        return true;
+    }
+
+    const QJsonObject index = QJsonDocument::fromJson(sidecar.readAll()).object();
+    const QJsonArray blockArray = index.value("blocks").toArray();
+    if (blockArray.size() != m_blocks.size()) {
+        setError(error, QString("%1 does not match %2").arg(sidecar.fileName(), archivePath));
+        return false;
+    }
+
+    for (int i = 0; i < blockArray.size(); ++i) {
+        const QJsonArray entry = blockArray.at(i).toArray();
+        ArchiveBlock &block = m_blocks[i];
+        if (qint64(entry.at(0).toDouble()) != block.compressedOffset) {
+            setError(error, QString("%1 does not match %2").arg(sidecar.fileName(), archivePath));
+            return false;
+        }
+        block.firstTimestamp = qint64(entry.at(4).toDouble());
+        block.lastTimestamp = qint64(entry.at(5).toDouble());
+    }
+
+    const QJsonArray memberArray = index.value("members").toArray();
+    for (const QJsonValue &value : memberArray) {
+        const QJsonObject object = value.toObject();
+        ArchiveMember member;
+        member.name = object.value("name").toString();
+        member.offset = qint64(object.value("offset").toDouble());
+        member.size = qint64(object.value("size").toDouble());
+        member.mtime = qint64(object.value("mtime").toDouble());
+        member.firstBlock = object.value("firstBlock").toInt();
+        member.blockCount = object.value("blockCount").toInt();
+        if (member.firstBlock < 0 || member.firstBlock + member.blockCount > m_blocks.size()) {
+            setError(error, QString("%1 is corrupt").arg(sidecar.fileName()));
+            return false;
+        }
+        m_members.append(member);
+    }
+    return true;
+}
+
+bool LogArchive::readSeekTable(QString *error)
+{
+    UniqueFd fd(::open(QFile::encodeName(m_path).constData(), O_RDONLY | O_CLOEXEC));
+    struct stat st;
+    if (!fd.isValid() || ::fstat(fd.get(), &st) != 0) {
+        setError(error, errnoString(m_path));
+        return false;
+    }
+
+    char footer[SeekFooterSize];
+    if (st.st_size < 8 + SeekFooterSize
+        || preadFully(fd.get(), footer, SeekFooterSize, st.st_size - SeekFooterSize) != SeekFooterSize
+        || readLE32(footer + 5) != SeekableMagic) {
+        setError(error, QString("%1 is not a seekable zstd archive").arg(m_path));
+        return false;
+    }
+
+    const quint32 frameCount = readLE32(footer);
+    const int entrySize = (footer[4] & 0x80) ? 12 : 8;
+    const qint64 tableSize = qint64(frameCount) * entrySize;
+    const qint64 tableStart = st.st_size - SeekFooterSize - tableSize;
+    if (tableStart < 8) {
+        setError(error, QString("%1 has a corrupt seek table").arg(m_path));
+        return false;
+    }
+
+    QByteArray table(int(tableSize), Qt::Uninitialized);
+    if (preadFully(fd.get(), table.data(), tableSize, tableStart) != tableSize) {
+        setError(error, errnoString(m_path));
+        return false;
+    }
+
+    m_blocks.resize(int(frameCount));
+    qint64 compressedOffset = 0;
+    qint64 decompressedOffset = 0;
+    for (quint32 i = 0; i < frameCount; ++i) {
+        ArchiveBlock &block = m_blocks[int(i)];
+        block.compressedOffset = compressedOffset;
+        block.compressedSize = readLE32(table.constData() + i * entrySize);
+        block.decompressedOffset = decompressedOffset;
+        block.decompressedSize = readLE32(table.constData() + i * entrySize + 4);
+        compressedOffset += block.compressedSize;
+        decompressedOffset += block.decompressedSize;
+    }
+
+    if (compressedOffset != tableStart - 8) {
+        setError(error, QString("%1 has a corrupt seek table").arg(m_path));
+        return false;
+    }
+    return true;
+}
+
+QByteArray LogArchive::readBlock(int index, QString *error) const
+{
+    if (index < 0 || index >= m_blocks.size()) {
+        setError(error, "Block index out of range");
+        return QByteArray();
+    }
+    const ArchiveBlock &block = m_blocks[index];
+
+    UniqueFd fd(::open(QFile::encodeName(m_path).constData(), O_RDONLY | O_CLOEXEC));
+    if (!fd.isValid()) {
+        setError(error, errnoString(m_path));
+        return QByteArray();
+    }
+
+    QByteArray compressed(int(block.compressedSize), Qt::Uninitialized);
+    if (preadFully(fd.get(), compressed.data(), block.compressedSize, block.compressedOffset) != block.compressedSize) {
+        setError(error, errnoString(m_path));
+        return QByteArray();
+    }
+
+    QByteArray data(int(block.decompressedSize), Qt::Uninitialized);
+    size_t result = ZSTD_decompress(data.data(), size_t(data.size()), compressed.constData(), size_t(compressed.size()));
+    if (ZSTD_isError(result) || qint64(result) != block.decompressedSize) {
+        setError(error, QString("%1: corrupt block %2").arg(m_path).arg(index));
+        return QByteArray();
+    }
+    return data;
+}
+
+QByteArray LogArchive::readMember(const QString &name, QString *error) const
+{
+    for (const ArchiveMember &member : m_members) {
+        if (member.name != name) {
+            continue;
+        }
+        QByteArray data;
+        data.reserve(int(member.size));
+        for (int i = member.firstBlock; i < member.firstBlock + member.blockCount; ++i) {
+            QByteArray block = readBlock(i, error);
+            if (block.isNull()) {
+                return QByteArray();
+            }
+            data += block;
+        }
+        return data;
+    }
+    setError(error, QString("%1 is not in %2").arg(name, m_path));
+    return QByteArray();
+}
+
+ArchiveQueryResult LogArchive::queryTimeRange(qint64 from, qint64 to, const QString &memberName) const
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    ArchiveQueryResult result;
+    result.blocksTotal = m_blocks.size();
+
+    QVector<int> wanted;
+    QVector<const ArchiveMember *> owners;
+    for (const ArchiveMember &member : m_members) {
+        if (!memberName.isEmpty() && member.name != memberName) {
+            continue;
+        }
+        for (int i = member.firstBlock; i < member.firstBlock + member.blockCount; ++i) {
+            // Only the first and last 64 lines of a block are looked at for
+            // its bounds, so 0 on either side leaves that side open.
+            const ArchiveBlock &block = m_blocks[i];
+            if ((block.lastTimestamp == 0 || block.lastTimestamp >= from)
+                && (block.firstTimestamp == 0 || block.firstTimestamp <= to)) {
+                wanted.append(i);
+                owners.append(&member);
+            }
+        }
+    }
+
+    const QVector<QByteArray> data = QtConcurrent::blockingMapped<QVector<QByteArray>>(wanted, BlockReader { this });
+    result.blocksRead = wanted.size();
+
+    const ArchiveMember *currentMember = nullptr;
+    // Continuation lines at the start of a block follow the last stamped
+    // line of the block before, so the decision carries over between
+    // consecutive blocks of one member. A skipped block ended before from
+    // or started after to, so nothing after it is included until a line
+    // says otherwise.
+    bool include = false;
+    for (int i = 0; i < data.size(); ++i) {
+        const QByteArray &block = data[i];
+        if (block.isNull()) {
+            result.error = QString("%1: corrupt block %2").arg(m_path).arg(wanted[i]);
+            break;
+        }
+
+        const int defaultYear = QDateTime::fromSecsSinceEpoch(owners[i]->mtime).date().year();
+        if (i == 0 || wanted[i] != wanted[i - 1] + 1 || owners[i] != owners[i - 1]) {
+            include = false;
+        }
+        const char *p = block.constData();
+        const char *end = p + block.size();
+        while (p < end) {
+            const char *newline = static_cast<const char *>(memchr(p, '\n', size_t(end - p)));
+            const char *lineEnd = newline ? newline + 1 : end;
+            qint64 timestamp = parseLineTimestamp(p, lineEnd - p, defaultYear);
+            if (timestamp != 0) {
+                include = timestamp >= from && timestamp <= to;
+            }
+            if (include) {
+                if (owners[i] != currentMember && m_members.size() > 1) {
+                    currentMember = owners[i];
+                    result.text += "==> " + currentMember->name.toUtf8() + " <==\n";
+                }
+                result.text.append(p, int(lineEnd - p));
+            }
+            p = lineEnd;
+        }
+    }
+
+    result.elapsedMs = timer.elapsed();
+    return result;
+}
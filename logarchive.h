@@ -0,0 +1,107 @@
+#ifndef LOGARCHIVE_H
+#define LOGARCHIVE_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QMetaType>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+struct ArchiveBlock
+{
+    qint64 compressedOffset = 0;
+    qint64 compressedSize = 0;
+    qint64 decompressedOffset = 0;
+    qint64 decompressedSize = 0;
+    qint64 firstTimestamp = 0;
+    qint64 lastTimestamp = 0;
+};
+
+struct ArchiveMember
+{
+    QString name;
+    qint64 offset = 0;
+    qint64 size = 0;
+    qint64 mtime = 0;
+    int firstBlock = 0;
+    int blockCount = 0;
+};
+
+// How a member's file looked when create() read it; size is -1 when the file
+// changed while it was being read.
+struct ArchiveSource
+{
+    QString path;
+    quint64 device = 0;
+    quint64 inode = 0;
+    qint64 size = -1;
+    qint64 mtimeNs = 0;
+};
+
+struct ArchiveReport
+{
+    bool ok = false;
+    QString error;
+    int removed = 0;
+    qint64 bytesRemoved = 0;
+    QStringList removeErrors;
+};
+
+Q_DECLARE_METATYPE(ArchiveReport)
+
+struct ArchiveQueryResult
+{
+    QByteArray text;
+    int blocksRead = 0;
+    int blocksTotal = 0;
+    qint64 elapsedMs = 0;
+    QString error;
+};
+
+Q_DECLARE_METATYPE(ArchiveQueryResult)
+
+// Bundles logs into one file in the zstd seekable format: independent frames
+// cut on line boundaries, followed by a skippable seek-table frame. A JSON
+// sidecar (<archive>.idx) maps members to blocks and records the first and
+// last line timestamp of each block, so queries only decompress the frames
+// they touch.
+class LogArchive
+{
+public:
+    static const qint64 BlockSize = 4 * 1024 * 1024;
+
+    static bool create(const QString &archivePath, const QStringList &files, int level, QString *error = nullptr,
+                       QVector<ArchiveSource> *sources = nullptr);
+    static QString indexPath(const QString &archivePath)
+    {
+        return archivePath + ".idx";
+    }
+
+    bool open(const QString &archivePath, QString *error = nullptr);
+
+    const QVector<ArchiveMember> &members() const { return m_members; }
+    const QVector<ArchiveBlock> &blocks() const { return m_blocks; }
+
+    QByteArray readBlock(int index, QString *error = nullptr) const;
+    QByteArray readMember(const QString &name, QString *error = nullptr) const;
+
+    // Lines stamped within [from, to]; unstamped
+    // continuation lines follow the line before them. An empty member name
+    // searches every member.
+    ArchiveQueryResult queryTimeRange(qint64 from, qint64 to, const QString &member = QString()) const;
+
+    // Recognises "2024-01-02T15:04:05", "2024-01-02 15:04:05" and syslog's
+    // "Jan  2 15:04:05" as wall-clock seconds (the local time read as if it
+    // were UTC, so no time zone lookup per line); returns 0 when the line
+    // carries no timestamp.
+    static qint64 parseLineTimestamp(const char *line, qint64 length, int defaultYear);
+
+private:
+    bool readSeekTable(QString *error);
+
+    QString m_path;
+    QVector<ArchiveMember> m_members;
+    QVector<ArchiveBlock> m_blocks;
+};
+
+#endif // LOGARCHIVE_H
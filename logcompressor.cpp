@@ -0,0 +1,319 @@
+#include "logcompressor.h"
+#include "fileutil.h"
+
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThread>
+#include <QtCore/QVector>
+
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <zstd.h>
+
+namespace {
+
+// Every compressFile() call in the process draws the blocks it holds from
+// one budget, counted in MiB: two batches of 8 MiB zstd blocks. Per-file
+// jobs mapped over many logs share it instead of each holding a batch.
+const qint64 BudgetUnit = 1024 * 1024;
+
+int blockBudgetUnits()
+{
+    return 2 * qMax(1, QThread::idealThreadCount()) * 8;
+}
+
+QSemaphore &blockBudget()
+{
+    static QSemaphore budget(blockBudgetUnits());
+    return budget;
+}
+
+// Units taken from the budget, handed back on every way out of a batch.
+struct BudgetLease
+{
+    ~BudgetLease()
+    {
+        if (units > 0) {
+            blockBudget().release(units);
+        }
+    }
+
+    int units = 0;
+};
+
+class ZstdContext
+{
+public:
+    ZstdContext() : m_context(ZSTD_createCCtx()) {}
+    ~ZstdContext() { ZSTD_freeCCtx(m_context); }
+    ZSTD_CCtx *get() const { return m_context; }
+
+private:
+    ZSTD_CCtx *m_context;
+};
+
+QByteArray gzipBlock(const char *data, qint64 size, int level, QString *error)
+{
+    z_stream stream = {};
+    if (deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        if (error) {
+            *error = "Failed to initialise zlib";
+        }
+        return QByteArray();
+    }
+
+    QByteArray output(int(deflateBound(&stream, uLong(size))), Qt::Uninitialized);
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream.avail_in = uInt(size);
+    stream.next_out = reinterpret_cast<Bytef *>(output.data());
+    stream.avail_out = uInt(output.size());
+
+    int result = deflate(&stream, Z_FINISH);
+    output.resize(int(stream.total_out));
+    deflateEnd(&stream);
+
+    if (result != Z_STREAM_END) {
+        if (error) {
+            *error = "gzip compression failed";
+        }
+        return QByteArray();
+    }
+    return output;
+}
+
+QByteArray zstdBlock(const char *data, qint64 size, int level, QString *error)
+{
+    // One context per pool thread; creating them per block dominates small blocks.
+    thread_local ZstdContext context;
+
+    QByteArray output(int(ZSTD_compressBound(size_t(size))), Qt::Uninitialized);
+    ZSTD_CCtx_reset(context.get(), ZSTD_reset_session_and_parameters);
+    ZSTD_CCtx_setParameter(context.get(), ZSTD_c_compressionLevel, level);
+    ZSTD_CCtx_setParameter(context.get(), ZSTD_c_checksumFlag, 1);
+
+    size_t written = ZSTD_compress2(context.get(), output.data(), size_t(output.size()), data, size_t(size));
+    if (ZSTD_isError(written)) {
+        if (error) {
+            *error = QString("zstd compression failed: %1").arg(ZSTD_getErrorName(written));
+        }
+        return QByteArray();
+    }
+    output.resize(int(written));
+    return output;
+}
+
+struct BlockCompressor
+{
+    typedef QByteArray result_type;
+
+    CompressionPolicy policy;
+
+    QByteArray operator()(const QByteArray &block) const
+    {
+        return LogCompressor::compressBlock(block.constData(), block.size(), policy);
+    }
+};
+
+} // namespace
+
+CompressionPolicy CompressionPolicy::forFile(qint64 size, CompressionCodec codec)
+{
+    const qint64 MiB = 1024 * 1024;
+
+    CompressionPolicy policy;
+    policy.codec = codec;
+
+    if (codec == CompressionCodec::Gzip) {
+        policy.blockSize = MiB;
+        policy.level = size > 512 * MiB ? 4 : 6;
+    } else {
+        policy.blockSize = 8 * MiB;
+        if (size < 16 * MiB) {
+            policy.level = 19;
+        } else if (size < 256 * MiB) {
+            policy.level = 9;
+        } else {
+            policy.level = 3;
+        }
+    }
+    return policy;
+}
+
+QString CompressionPolicy::extension() const
+{
+    return codec == CompressionCodec::Gzip ? ".gz" : ".zst";
+}
+
+double CompressionResult::megabytesPerSecond() const
+{
+    return double(inputBytes) / (1024.0 * 1024.0) / (qMax<qint64>(1, elapsedMs) / 1000.0);
+}
+
+QByteArray LogCompressor::compressBlock(const char *data, qint64 size, const CompressionPolicy &policy, QString *error)
+{
+    if (policy.codec == CompressionCodec::Gzip) {
+        return gzipBlock(data, size, policy.level, error);
+    }
+    return zstdBlock(data, size, policy.level, error);
+}
+
+CompressionResult LogCompressor::compressFile(const QString &path, CompressionCodec codec)
+{
+    struct stat st;
+    qint64 size = ::stat(QFile::encodeName(path).constData(), &st) == 0 ? qint64(st.st_size) : 0;
+    return compressFile(path, CompressionPolicy::forFile(size, codec));
+}
+
+CompressionResult LogCompressor::compressFile(const QString &path, const CompressionPolicy &policy)
+{
+    const QString directory = QFileInfo(path).absolutePath();
+    UniqueFd directoryFd(::open(QFile::encodeName(directory).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if (!directoryFd.isValid()) {
+        CompressionResult result;
+        result.sourcePath = path;
+        result.error = errnoString(directory);
+        return result;
+    }
+    return compressFileAt(directoryFd.get(), path, policy);
+}
+
+CompressionResult LogCompressor::compressFileAt(int directoryFd, const QString &path, CompressionCodec codec)
+{
+    struct stat st;
+    const QByteArray name = QFile::encodeName(QFileInfo(path).fileName());
+    qint64 size = ::fstatat(directoryFd, name.constData(), &st, AT_SYMLINK_NOFOLLOW) == 0 ? qint64(st.st_size) : 0;
+    return compressFileAt(directoryFd, path, CompressionPolicy::forFile(size, codec));
+}
+
+CompressionResult LogCompressor::compressFileAt(int directoryFd, const QString &path, const CompressionPolicy &policy)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    CompressionResult result;
+    result.sourcePath = path;
+    result.outputPath = path + policy.extension();
+
+    const QByteArray sourceName = QFile::encodeName(QFileInfo(path).fileName());
+    const QByteArray outputName = sourceName + QFile::encodeName(policy.extension());
+
+    UniqueFd source(::openat(directoryFd, sourceName.constData(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW));
+    struct stat before;
+    if (!source.isValid() || ::fstat(source.get(), &before) != 0) {
+        result.error = errnoString(path);
+        return result;
+    }
+    if (!S_ISREG(before.st_mode)) {
+        result.error = QString("%1: not a regular file").arg(path);
+        return result;
+    }
+    posix_fadvise(source.get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    QByteArray tempName;
+    UniqueFd output(createTempAt(directoryFd, outputName, &tempName));
+    if (!output.isValid()) {
+        result.error = errnoString(result.outputPath);
+        return result;
+    }
+
+    auto fail = [&](const QString &message) {
+        result.error = message;
+        output.reset();
+        ::unlinkat(directoryFd, tempName.constData(), 0);
+        return result;
+    };
+
+    // Read up to one block per core, compress the batch in parallel, write it
+    // in order. The first block of a batch waits for the shared budget, the
+    // rest are only taken while it has room, so memory stays bounded however
+    // many files are compressed at once.
+    const int batchBlocks = qMax(1, QThread::idealThreadCount());
+    const int blockCost = int(qBound<qint64>(1, (policy.blockSize + BudgetUnit - 1) / BudgetUnit,
+                                             blockBudgetUnits()));
+    BlockCompressor compressor { policy };
+
+    for (;;) {
+        BudgetLease lease;
+        QVector<QByteArray> blocks;
+        for (int i = 0; i < batchBlocks; ++i) {
+            if (i == 0) {
+                blockBudget().acquire(blockCost);
+            } else if (!blockBudget().tryAcquire(blockCost)) {
+                break;
+            }
+            lease.units += blockCost;
+            QByteArray block(int(policy.blockSize), Qt::Uninitialized);
+            qint64 n = readFully(source.get(), block.data(), block.size());
+            if (n < 0) {
+                return fail(errnoString(path));
+            }
+            if (n == 0) {
+                break;
+            }
+            block.resize(int(n));
+            result.inputBytes += n;
+            blocks.append(block);
+            if (n < policy.blockSize) {
+                break;
+            }
+        }
+        if (blocks.isEmpty()) {
+            break;
+        }
+
+        const QVector<QByteArray> compressed = blocks.size() == 1
+            ? QVector<QByteArray>() << compressor(blocks.first())
+            : QtConcurrent::blockingMapped<QVector<QByteArray>>(blocks, compressor);
+
+        for (const QByteArray &chunk : compressed) {
+            if (chunk.isEmpty()) {
+                return fail(QString("%1: compression failed").arg(path));
+            }
+            if (!writeFully(output.get(), chunk.constData(), chunk.size())) {
+                return fail(errnoString(result.outputPath));
+            }
+            result.outputBytes += chunk.size();
+        }
+
+        if (blocks.last().size() < policy.blockSize) {
+            break;
+        }
+    }
+
+    if (result.inputBytes == 0) {
+        QByteArray empty = compressBlock("", 0, policy);
+        if (!writeFully(output.get(), empty.constData(), empty.size())) {
+            return fail(errnoString(result.outputPath));
+        }
+        result.outputBytes = empty.size();
+    }
+
+    // A log that grew while we read it would lose the new lines on unlink.
+    struct stat after;
+    if (::fstat(source.get(), &after) != 0 || after.st_size != before.st_size
+        || after.st_mtim.tv_sec != before.st_mtim.tv_sec || after.st_mtim.tv_nsec != before.st_mtim.tv_nsec) {
+        return fail(QString("%1: file changed while compressing").arg(path));
+    }
+
+    if (!copyFileAttributes(output.get(), before) || ::fsync(output.get()) != 0) {
+        return fail(errnoString(result.outputPath));
+    }
+    output.reset();
+
+    if (::renameat(directoryFd, tempName.constData(), directoryFd, outputName.constData()) != 0) {
+        return fail(errnoString(result.outputPath));
+    }
+    ::fsync(directoryFd);
+
+    if (::unlinkat(directoryFd, sourceName.constData(), 0) != 0) {
+        result.error = errnoString(path);
+    }
+
+    result.elapsedMs = timer.elapsed();
+    return result;
+}
@@ -0,0 +1,70 @@
+#ifndef LOGCOMPRESSOR_H
+#define LOGCOMPRESSOR_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QMetaType>
+#include <QtCore/QString>
+
+enum class CompressionCodec
+{
+    Gzip,
+    Zstd
+};
+
+struct CompressionPolicy
+{
+    CompressionCodec codec = CompressionCodec::Gzip;
+    int level = 6;
+    qint64 blockSize = 1024 * 1024;
+
+    // Large files trade ratio for speed; small ones get the stronger levels.
+    static CompressionPolicy forFile(qint64 size, CompressionCodec codec);
+    QString extension() const;
+};
+
+struct CompressionResult
+{
+    QString sourcePath;
+    QString outputPath;
+    qint64 inputBytes = 0;
+    qint64 outputBytes = 0;
+    qint64 elapsedMs = 0;
+    QString error;
+
+    bool ok() const { return error.isEmpty(); }
+    double megabytesPerSecond() const;
+};
+
+Q_DECLARE_METATYPE(CompressionResult)
+
+// Compresses a file as a sequence of independently compressed blocks (gzip
+// members or zstd frames) so one file can use every core. The output is
+// written to a temporary sibling, fsynced and renamed into place with the
+// source's owner, mode and timestamps before the source is removed.
+class LogCompressor
+{
+public:
+    static CompressionResult compressFile(const QString &path, const CompressionPolicy &policy);
+    static CompressionResult compressFile(const QString &path, CompressionCodec codec);
+    // The same on path's last component inside an already opened directory;
+    // every open, rename and unlink is relative to directoryFd.
+    static CompressionResult compressFileAt(int directoryFd, const QString &path, const CompressionPolicy &policy);
+    static CompressionResult compressFileAt(int directoryFd, const QString &path, CompressionCodec codec);
+
+    static QByteArray compressBlock(const char *data, qint64 size, const CompressionPolicy &policy, QString *error = nullptr);
+};
+
+// Functor form for QtConcurrent::mapped over a list of paths.
+struct CompressFileJob
+{
+    typedef CompressionResult result_type;
+
+    CompressionCodec codec;
+
+    CompressionResult operator()(const QString &path) const
+    {
+        return LogCompressor::compressFile(path, codec);
+    }
+};
+
+#endif // LOGCOMPRESSOR_H
@@ -0,0 +1,268 @@
+#include "loggrowth.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QStandardPaths>
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <limits>
+#include <sys/stat.h>
+#include <vector>
+
+namespace {
+
+const char Magic[8] = { 'E', 'Z', 'L', 'O', 'G', 'G', 'R', 'W' };
+const quint32 Version = 1;
+const int HeaderSize = 32;
+
+// Slot: u64 path hash (0 = free), u32 newest sample index, u32 sample count,
+// then the ring. Sample: u32 time, u64 size, packed into 12 bytes.
+const int SlotHeaderSize = 16;
+const int SampleSize = 12;
+const int SlotSize = SlotHeaderSize + LogGrowthTracker::SamplesPerFile * SampleSize;
+const qint64 FileSize = HeaderSize + qint64(LogGrowthTracker::MaxFiles) * SlotSize;
+
+// Keep the pairwise fit cheap enough to run for every log on each refresh.
+const int MaxFitSamples = 128;
+
+template<typename T>
+T load(const uchar *p)
+{
+    T value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+template<typename T>
+void store(uchar *p, T value)
+{
+    memcpy(p, &value, sizeof(value));
+}
+
+quint64 pathHash(const QByteArray &path)
+{
+    // FNV-1a; 0 marks a free slot.
+    quint64 hash = 14695981039346656037ULL;
+    for (char c : path) {
+        hash ^= quint8(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash ? hash : 1;
+}
+
+struct Sample
+{
+    qint64 time;
+    qint64 size;
+};
+
+Sample sampleAt(const uchar *slot, int index)
+{
+    const uchar *p = slot + SlotHeaderSize + index * SampleSize;
+    return Sample { qint64(load<quint32>(p)), qint64(load<quint64>(p + 4)) };
+}
+
+void setSample(uchar *slot, int index, qint64 time, qint64 size)
+{
+    uchar *p = slot + SlotHeaderSize + index * SampleSize;
+    store<quint32>(p, quint32(time));
+    store<quint64>(p + 4, quint64(size));
+}
+
+} // namespace
+
+QString LogGrowthTracker::defaultPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/log-growth.ring";
+}
+
+LogGrowthTracker::~LogGrowthTracker()
+{
+    if (m_map) {
+        m_file.unmap(m_map);
+    }
+}
+
+bool LogGrowthTracker::open(const QString &path, QString *error)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        if (error) {
+            *error = QString("%1: %2").arg(path, m_file.errorString());
+        }
+        return false;
+    }
+
+    char header[HeaderSize] = {};
+    const bool valid = m_file.size() == FileSize && m_file.read(header, HeaderSize) == HeaderSize
+        && memcmp(header, Magic, sizeof(Magic)) == 0 && load<quint32>(reinterpret_cast<uchar *>(header) + 8) == Version
+        && load<quint32>(reinterpret_cast<uchar *>(header) + 12) == quint32(MaxFiles)
+        && load<quint32>(reinterpret_cast<uchar *>(header) + 16) == quint32(SamplesPerFile);
+
+    if (!valid) {
+        // Unknown layout: start over rather than misread old samples.
+        memset(header, 0, sizeof(header));
+        memcpy(header, Magic, sizeof(Magic));
+        store<quint32>(reinterpret_cast<uchar *>(header) + 8, Version);
+        store<quint32>(reinterpret_cast<uchar *>(header) + 12, quint32(MaxFiles));
+        store<quint32>(reinterpret_cast<uchar *>(header) + 16, quint32(SamplesPerFile));
+        if (!m_file.resize(0) || !m_file.resize(FileSize) || !m_file.seek(0)
+            || m_file.write(header, HeaderSize) != HeaderSize || !m_file.flush()) {
+            if (error) {
+                *error = QString("%1: %2").arg(path, m_file.errorString());
+            }
+            m_file.close();
+            return false;
+        }
+    }
+
+    m_map = m_file.map(0, FileSize);
+    if (!m_map) {
+        if (error) {
+            *error = QString("%1: %2").arg(path, m_file.errorString());
+        }
+        m_file.close();
+        return false;
+    }
+    return true;
+}
+
+uchar *LogGrowthTracker::slot(quint64 hash, bool create) const
+{
+    uchar *slots = m_map + HeaderSize;
+    uchar *oldest = nullptr;
+    qint64 oldestTime = std::numeric_limits<qint64>::max();
+
+    for (int probe = 0; probe < MaxFiles; ++probe) {
+        uchar *slot = slots + qint64((hash + quint64(probe)) % MaxFiles) * SlotSize;
+        const quint64 slotHash = load<quint64>(slot);
+        if (slotHash == hash) {
+            return slot;
+        }
+        if (slotHash == 0) {
+            if (!create) {
+                return nullptr;
+            }
+            store<quint64>(slot, hash);
+            store<quint32>(slot + 8, 0);
+            store<quint32>(slot + 12, 0);
+            return slot;
+        }
+        const quint32 count = load<quint32>(slot + 12);
+        const qint64 newest = count ? sampleAt(slot, int(load<quint32>(slot + 8))).time : 0;
+        if (newest < oldestTime) {
+            oldestTime = newest;
+            oldest = slot;
+        }
+    }
+
+    // Full: reuse the log that has gone longest without a sample. Lookups
+    // for other hashes still terminate because no slot is ever freed.
+    if (create && oldest) {
+        store<quint64>(oldest, hash);
+        store<quint32>(oldest + 8, 0);
+        store<quint32>(oldest + 12, 0);
+    }
+    return create ? oldest : nullptr;
+}
+
+void LogGrowthTracker::record(const QStringList &paths, qint64 now)
+{
+    if (!m_map) {
+        return;
+    }
+
+    QVector<QPair<quint64, qint64>> sizes;
+    sizes.reserve(paths.size());
+    for (const QString &path : paths) {
+        const QByteArray encoded = QFile::encodeName(path);
+        struct statx stx;
+        if (::statx(AT_FDCWD, encoded.constData(), AT_STATX_DONT_SYNC, STATX_SIZE, &stx) == 0) {
+            sizes.append(qMakePair(pathHash(encoded), qint64(stx.stx_size)));
+        }
+    }
+
+    QMutexLocker locker(&m_mutex);
+    for (const auto &entry : qAsConst(sizes)) {
+        uchar *slot = this->slot(entry.first, true);
+        quint32 head = load<quint32>(slot + 8);
+        quint32 count = load<quint32>(slot + 12);
+
+        if (count >= 2) {
+            const qint64 previous = sampleAt(slot, int((head + SamplesPerFile - 1) % SamplesPerFile)).time;
+            if (now - previous < RecordInterval) {
+                setSample(slot, int(head), now, entry.second);
+                continue;
+            }
+        }
+        if (count > 0) {
+            head = (head + 1) % SamplesPerFile;
+        }
+        count = qMin<quint32>(count + 1, SamplesPerFile);
+        setSample(slot, int(head), now, entry.second);
+        store<quint32>(slot + 8, head);
+        store<quint32>(slot + 12, count);
+    }
+}
+
+GrowthEstimate LogGrowthTracker::estimate(const QString &path) const
+{
+    GrowthEstimate result;
+    if (!m_map) {
+        return result;
+    }
+
+    QVector<qint64> times;
+    QVector<qint64> sizes;
+    {
+        QMutexLocker locker(&m_mutex);
+        const uchar *slot = this->slot(pathHash(QFile::encodeName(path)), false);
+        if (!slot) {
+            return result;
+        }
+        const quint32 head = load<quint32>(slot + 8);
+        const quint32 count = load<quint32>(slot + 12);
+
+        // Walk back from the newest sample until a rotation or truncation.
+        qint64 laterSize = std::numeric_limits<qint64>::max();
+        for (quint32 i = 0; i < count && times.size() < MaxFitSamples; ++i) {
+            const Sample sample = sampleAt(slot, int((head + SamplesPerFile - i) % SamplesPerFile));
+            if (sample.size > laterSize) {
+                break;
+            }
+            laterSize = sample.size;
+            times.prepend(sample.time);
+            sizes.prepend(sample.size);
+        }
+    }
+
+    result.samples = times.size();
+    if (times.size() >= 2) {
+        result.spanSecs = times.last() - times.first();
+        result.bytesPerHour = theilSenSlope(times, sizes) * 3600.0;
+    }
+    return result;
+}
+
+double LogGrowthTracker::theilSenSlope(const QVector<qint64> &times, const QVector<qint64> &sizes)
+{
+    std::vector<double> slopes;
+    slopes.reserve(size_t(times.size()) * size_t(times.size()) / 2);
+    for (int i = 0; i < times.size(); ++i) {
+        for (int j = i + 1; j < times.size(); ++j) {
+            if (times[j] != times[i]) {
+                slopes.push_back(double(sizes[j] - sizes[i]) / double(times[j] - times[i]));
+            }
+        }
+    }
+    if (slopes.empty()) {
+        return 0;
+    }
+
+    auto middle = slopes.begin() + slopes.size() / 2;
+    std::nth_element(slopes.begin(), middle, slopes.end());
+    return *middle;
+}
@@ -0,0 +1,58 @@
+#ifndef LOGGROWTH_H
+#define LOGGROWTH_H
+
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+struct GrowthEstimate
+{
+    double bytesPerHour = 0;
+    int samples = 0;
+    qint64 spanSecs = 0;
+
+    bool isValid() const { return samples >= 3 && spanSecs >= 600; }
+};
+
+// Per-log size history in a fixed-size, memory-mapped file: an open-addressed
+// table of path hashes, each with a ring of (time, size) samples. Samples
+// closer together than RecordInterval replace the newest one instead of
+// advancing the ring, so sampling every minute still keeps days of history.
+class LogGrowthTracker
+{
+public:
+    static const int MaxFiles = 1024;
+    static const int SamplesPerFile = 512;
+    static const qint64 RecordInterval = 600;
+
+    static QString defaultPath();
+
+    LogGrowthTracker() = default;
+    ~LogGrowthTracker();
+
+    bool open(const QString &path = defaultPath(), QString *error = nullptr);
+    bool isOpen() const { return m_map != nullptr; }
+
+    // One statx() per path; thread-safe against estimate().
+    void record(const QStringList &paths, qint64 now);
+
+    // Growth since the last rotation or truncation, from a Theil-Sen fit
+    // (median of pairwise slopes), which ignores the odd burst.
+    GrowthEstimate estimate(const QString &path) const;
+
+    static double theilSenSlope(const QVector<qint64> &times, const QVector<qint64> &sizes);
+
+private:
+    LogGrowthTracker(const LogGrowthTracker &) = delete;
+    LogGrowthTracker &operator=(const LogGrowthTracker &) = delete;
+
+    uchar *slot(quint64 hash, bool create) const;
+
+    QFile m_file;
+    uchar *m_map = nullptr;
+    mutable QMutex m_mutex;
+};
+
+#endif // LOGGROWTH_H
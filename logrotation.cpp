@@ -0,0 +1,443 @@
+#include "logrotation.h"
+#include "fileutil.h"
+
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QLocale>
+#include <QtCore/QRegularExpression>
+#include <QtCore/QSaveFile>
+#include <QtCore/QStandardPaths>
+
+#include <algorithm>
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+namespace {
+
+struct Rotation
+{
+    int number;
+    QString suffix;
+    QString path;
+    qint64 mtime;
+};
+
+const QRegularExpression &rotatedNamePattern()
+{
+    static const QRegularExpression pattern("(\\.\\d+|-\\d{8})(\\.(gz|xz|zst))?$");
+    return pattern;
+}
+
+// Numbered rotations of path (path.N, path.N.gz, ...), highest number first.
+QVector<Rotation> existingRotations(const QString &path)
+{
+    static const QRegularExpression numbered("^\\.(\\d+)(\\.(gz|xz|zst))?$");
+
+    const QFileInfo info(path);
+    const QString base = info.fileName();
+    QVector<Rotation> rotations;
+
+    const QFileInfoList entries = QDir(info.absolutePath()).entryInfoList(
+        QStringList() << base + ".*", QDir::Files | QDir::System);
+    for (const QFileInfo &entry : entries) {
+        const QRegularExpressionMatch match = numbered.match(entry.fileName().mid(base.size()));
+        if (match.hasMatch()) {
+            rotations.append(Rotation { match.captured(1).toInt(), match.captured(2), entry.filePath(),
+                                        entry.lastModified().toSecsSinceEpoch() });
+        }
+    }
+
+    std::sort(rotations.begin(), rotations.end(), [](const Rotation &a, const Rotation &b) {
+        return a.number > b.number;
+    });
+    return rotations;
+}
+
+// When the current file started collecting: the newest rotation's mtime,
+// else the file's birth time if the filesystem records it.
+qint64 collectingSince(const QString &path, const QVector<Rotation> &rotations)
+{
+    qint64 newest = -1;
+    for (const Rotation &rotation : rotations) {
+        newest = qMax(newest, rotation.mtime);
+    }
+    if (newest >= 0) {
+        return newest;
+    }
+
+    struct statx stx;
+    if (::statx(AT_FDCWD, QFile::encodeName(path).constData(), AT_STATX_DONT_SYNC, STATX_BTIME, &stx) == 0
+        && (stx.stx_mask & STATX_BTIME)) {
+        return qint64(stx.stx_btime.tv_sec);
+    }
+    return -1;
+}
+
+QString methodKey(RotationMethod method)
+{
+    switch (method) {
+    case RotationMethod::Rename:
+        return "rename";
+    case RotationMethod::CopyTruncate:
+        return "copytruncate";
+    case RotationMethod::Auto:
+        break;
+    }
+    return "auto";
+}
+
+bool copyRange(int source, int target, qint64 size)
+{
+    qint64 copied = 0;
+    while (copied < size) {
+        ssize_t n = ::copy_file_range(source, nullptr, target, nullptr, size_t(size - copied), 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EXDEV || errno == ENOSYS || errno == EOPNOTSUPP || errno == EINVAL)) {
+            break;
+        }
+        if (n <= 0) {
+            return n == 0 && copied == size;
+        }
+        copied += n;
+    }
+
+    QByteArray buffer(1024 * 1024, Qt::Uninitialized);
+    while (copied < size) {
+        qint64 n = preadFully(source, buffer.data(), qMin<qint64>(buffer.size(), size - copied), copied);
+        if (n <= 0 || !writeFully(target, buffer.constData(), n)) {
+            return false;
+        }
+        copied += n;
+    }
+    return true;
+}
+
+// Copies the first size bytes to target and truncates the source, so
+// writers keep their descriptor. Lines written between the copy and the
+// truncate are lost, as with logrotate's copytruncate.
+bool copyTruncate(const QString &path, const QString &target, QString *error)
+{
+    UniqueFd source(::open(QFile::encodeName(path).constData(), O_RDWR | O_CLOEXEC | O_NOFOLLOW));
+    struct stat st;
+    if (!source.isValid() || ::fstat(source.get(), &st) != 0) {
+        *error = errnoString(path);
+        return false;
+    }
+
+    UniqueFd output(::open(QFile::encodeName(target).constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600));
+    if (!output.isValid()) {
+        *error = errnoString(target);
+        return false;
+    }
+
+    if (!copyRange(source.get(), output.get(), st.st_size) || !copyFileAttributes(output.get(), st)
+        || ::fsync(output.get()) != 0) {
+        *error = errnoString(target);
+        output.reset();
+        ::unlink(QFile::encodeName(target).constData());
+        return false;
+    }
+
+    if (::ftruncate(source.get(), 0) != 0) {
+        *error = errnoString(path);
+        return false;
+    }
+    return true;
+}
+
+// Moves the log aside and puts an empty file with the same owner and mode
+// in its place.
+bool renameAndCreate(const QString &path, const QString &target, QString *error)
+{
+    const QByteArray sourcePath = QFile::encodeName(path);
+    struct stat st;
+    if (::lstat(sourcePath.constData(), &st) != 0) {
+        *error = errnoString(path);
+        return false;
+    }
+    if (::rename(sourcePath.constData(), QFile::encodeName(target).constData()) != 0) {
+        *error = errnoString(path);
+        return false;
+    }
+
+    UniqueFd created(::open(sourcePath.constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, st.st_mode & 07777));
+    if (!created.isValid() || ::fchown(created.get(), st.st_uid, st.st_gid) != 0
+        || ::fchmod(created.get(), st.st_mode & 07777) != 0) {
+        *error = errnoString(path);
+        return false;
+    }
+    return true;
+}
+
+struct CompressRotationJob
+{
+    typedef CompressionResult result_type;
+
+    CompressionResult operator()(const QPair<QString, CompressionCodec> &file) const
+    {
+        return LogCompressor::compressFile(file.first, file.second);
+    }
+};
+
+} // namespace
+
+QString RotationPolicy::defaultPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation) + "/rotation.json";
+}
+
+RotationPolicy RotationPolicy::load(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return RotationPolicy();
+    }
+    return fromJson(file.readAll());
+}
+
+RotationPolicy RotationPolicy::fromJson(const QByteArray &json)
+{
+    RotationPolicy policy;
+    const QJsonObject root = QJsonDocument::fromJson(json).object();
+    policy.automatic = root.value("automatic").toBool();
+    for (const QJsonValue &value : root.value("rules").toArray()) {
+        const QJsonObject object = value.toObject();
+        RotationRule rule;
+        rule.pattern = object.value("pattern").toString();
+        rule.maxSize = qint64(object.value("maxSize").toDouble(double(rule.maxSize)));
+        rule.maxAgeDays = object.value("maxAgeDays").toInt(rule.maxAgeDays);
+        rule.keep = qMax(1, object.value("keep").toInt(rule.keep));
+        const QString method = object.value("method").toString();
+        rule.method = method == "rename" ? RotationMethod::Rename
+                    : method == "copytruncate" ? RotationMethod::CopyTruncate : RotationMethod::Auto;
+        rule.compress = object.value("compress").toBool(rule.compress);
+        rule.codec = object.value("codec").toString() == "gzip" ? CompressionCodec::Gzip : CompressionCodec::Zstd;
+        if (!rule.pattern.isEmpty()) {
+            policy.rules.append(rule);
+        }
+    }
+    return policy;
+}
+
+QByteArray RotationPolicy::toJson() const
+{
+    QJsonArray ruleArray;
+    for (const RotationRule &rule : rules) {
+        ruleArray.append(QJsonObject {
+            { "pattern", rule.pattern },
+            { "maxSize", double(rule.maxSize) },
+            { "maxAgeDays", rule.maxAgeDays },
+            { "keep", rule.keep },
+            { "method", methodKey(rule.method) },
+            { "compress", rule.compress },
+            { "codec", rule.codec == CompressionCodec::Gzip ? "gzip" : "zstd" },
+        });
+    }
+    const QJsonObject root { { "automatic", automatic }, { "rules", ruleArray } };
+    return QJsonDocument(root).toJson();
+}
+
+bool RotationPolicy::save(const QString &path, QString *error) const
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(toJson()) < 0 || !file.commit()) {
+        if (error) {
+            *error = QString("%1: %2").arg(path, file.errorString());
+        }
+        return false;
+    }
+    return true;
+}
+
+QSet<QPair<quint64, quint64>> LogRotator::openFiles()
+{
+    QSet<QPair<quint64, quint64>> files;
+
+    DIR *proc = ::opendir("/proc");
+    if (!proc) {
+        return files;
+    }
+    while (struct dirent *process = ::readdir(proc)) {
+        if (process->d_name[0] < '0' || process->d_name[0] > '9') {
+            continue;
+        }
+        const QByteArray fdDirectory = QByteArray("/proc/") + process->d_name + "/fd";
+        DIR *fds = ::opendir(fdDirectory.constData());
+        if (!fds) {
+            continue;
+        }
+        const int directoryFd = ::dirfd(fds);
+        while (struct dirent *fd = ::readdir(fds)) {
+            struct stat st;
+            if (fd->d_name[0] != '.' && ::fstatat(directoryFd, fd->d_name, &st, 0) == 0 && S_ISREG(st.st_mode)) {
+                files.insert(qMakePair((quint64(major(st.st_dev)) << 32) | minor(st.st_dev), quint64(st.st_ino)));
+            }
+        }
+        ::closedir(fds);
+    }
+    ::closedir(proc);
+    return files;
+}
+
+QVector<RotationTask> LogRotator::plan(const RotationPolicy &policy, const QVector<LogFileInfo> &logs,
+                                       const QSet<QPair<quint64, quint64>> &openFiles, qint64 now)
+{
+    QVector<RotationTask> tasks;
+
+    for (const LogFileInfo &log : logs) {
+        if (log.compressed || rotatedNamePattern().match(log.path).hasMatch()) {
+            continue;
+        }
+
+        const QByteArray path = QFile::encodeName(log.path);
+        const RotationRule *rule = nullptr;
+        for (const RotationRule &candidate : policy.rules) {
+            if (::fnmatch(QFile::encodeName(candidate.pattern).constData(), path.constData(), FNM_PATHNAME) == 0) {
+                rule = &candidate;
+                break;
+            }
+        }
+        if (!rule || log.size == 0) {
+            continue;
+        }
+
+        const QVector<Rotation> rotations = existingRotations(log.path);
+        QString reason;
+        if (rule->maxSize >= 0 && log.size > rule->maxSize) {
+            reason = QString("%1 > %2").arg(QLocale().formattedDataSize(log.size),
+                                            QLocale().formattedDataSize(rule->maxSize));
+        } else if (rule->maxAgeDays >= 0) {
+            const qint64 since = collectingSince(log.path, rotations);
+            if (since >= 0 && now - since > qint64(rule->maxAgeDays) * 86400) {
+                reason = QString("collecting for %1 days").arg((now - since) / 86400);
+            }
+        }
+        if (reason.isEmpty()) {
+            continue;
+        }
+
+        RotationTask task;
+        task.path = log.path;
+        task.size = log.size;
+        task.reason = reason;
+        task.compress = rule->compress;
+        task.codec = rule->codec;
+        task.target = log.path + ".1";
+        task.method = rule->method;
+        if (task.method == RotationMethod::Auto) {
+            task.method = openFiles.contains(qMakePair(log.device, log.inode)) ? RotationMethod::CopyTruncate
+                                                                                : RotationMethod::Rename;
+        }
+
+        for (const Rotation &rotation : rotations) {
+            if (rotation.number + 1 > rule->keep) {
+                task.deletions << rotation.path;
+            } else {
+                task.renames.append(qMakePair(rotation.path,
+                    QString("%1.%2%3").arg(log.path).arg(rotation.number + 1).arg(rotation.suffix)));
+            }
+        }
+        tasks.append(task);
+    }
+    return tasks;
+}
+
+RotationReport LogRotator::execute(const QVector<RotationTask> &tasks)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    RotationReport report;
+    QVector<QPair<QString, CompressionCodec>> toCompress;
+
+    for (const RotationTask &task : tasks) {
+        bool ok = true;
+        for (const QString &path : task.deletions) {
+            if (::unlink(QFile::encodeName(path).constData()) == 0) {
+                report.deleted++;
+            } else if (errno != ENOENT) {
+                report.errors << errnoString(path);
+            }
+        }
+        for (const auto &rename : task.renames) {
+            if (::rename(QFile::encodeName(rename.first).constData(), QFile::encodeName(rename.second).constData()) != 0) {
+                report.errors << errnoString(rename.first);
+                ok = false;
+                break;
+            }
+        }
+        if (!ok) {
+            continue;
+        }
+
+        QString error;
+        ok = task.method == RotationMethod::CopyTruncate ? copyTruncate(task.path, task.target, &error)
+                                                          : renameAndCreate(task.path, task.target, &error);
+        if (!ok) {
+            report.errors << error;
+            continue;
+        }
+        report.rotated++;
+        report.bytesRotated += task.size;
+        if (task.compress) {
+            toCompress.append(qMakePair(task.target, task.codec));
+        }
+    }
+
+    // One job per file; each also splits its file into parallel blocks.
+    const QVector<CompressionResult> results =
+        QtConcurrent::blockingMapped<QVector<CompressionResult>>(toCompress, CompressRotationJob());
+    for (const CompressionResult &result : results) {
+        if (result.ok()) {
+            report.compressed++;
+        } else {
+            report.errors << result.error;
+        }
+    }
+
+    report.elapsedMs = timer.elapsed();
+    return report;
+}
+
+QString LogRotator::describe(const RotationTask &task)
+{
+    QStringList lines;
+    lines << QString("%1 (%2): %3 to %4%5").arg(task.path, task.reason, methodName(task.method),
+                                                 QFileInfo(task.target).fileName(),
+                                                 task.compress ? (task.codec == CompressionCodec::Gzip ? ".gz" : ".zst")
+                                                               : "");
+    for (const QString &path : task.deletions) {
+        lines << QString("    delete %1").arg(QFileInfo(path).fileName());
+    }
+    for (const auto &rename : task.renames) {
+        lines << QString("    %1 -> %2").arg(QFileInfo(rename.first).fileName(), QFileInfo(rename.second).fileName());
+    }
+    return lines.join("\n");
+}
+
+QString LogRotator::methodName(RotationMethod method)
+{
+    switch (method) {
+    case RotationMethod::Rename:
+        return "Rename";
+    case RotationMethod::CopyTruncate:
+        return "Copytruncate";
+    case RotationMethod::Auto:
+        break;
+    }
+    return "Auto";
+}
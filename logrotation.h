@@ -0,0 +1,99 @@
+#ifndef LOGROTATION_H
+#define LOGROTATION_H
+
+#include "logcompressor.h"
+#include "logscanner.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QMetaType>
+#include <QtCore/QPair>
+#include <QtCore/QSet>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+enum class RotationMethod
+{
+    // Copytruncate when some process has the file open, rename otherwise.
+    Auto,
+    Rename,
+    CopyTruncate
+};
+
+struct RotationRule
+{
+    // fnmatch(3) pattern against the full path, e.g. /var/log/nginx/*.log.
+    QString pattern;
+    // Rotate when larger than this; negative disables the check.
+    qint64 maxSize = 100 * 1024 * 1024;
+    // Rotate when the last rotation (or the file's birth) is older than
+    // this many days; negative disables the check.
+    int maxAgeDays = 7;
+    // Numbered rotations (.1 ... .keep) to retain.
+    int keep = 4;
+    RotationMethod method = RotationMethod::Auto;
+    bool compress = true;
+    CompressionCodec codec = CompressionCodec::Zstd;
+};
+
+struct RotationPolicy
+{
+    bool automatic = false;
+    QVector<RotationRule> rules;
+
+    static QString defaultPath();
+    static RotationPolicy load(const QString &path = defaultPath());
+    bool save(const QString &path = defaultPath(), QString *error = nullptr) const;
+
+    // The file format, also how a policy is handed to the privileged helper.
+    static RotationPolicy fromJson(const QByteArray &json);
+    QByteArray toJson() const;
+};
+
+struct RotationTask
+{
+    QString path;
+    qint64 size = 0;
+    QString reason;
+    RotationMethod method = RotationMethod::Rename;
+    bool compress = false;
+    CompressionCodec codec = CompressionCodec::Zstd;
+    // Older rotations beyond the retention count, then shifts of the rest
+    // (highest number first) so .1 is free for the current file.
+    QStringList deletions;
+    QVector<QPair<QString, QString>> renames;
+    QString target;
+};
+
+struct RotationReport
+{
+    int rotated = 0;
+    int compressed = 0;
+    int deleted = 0;
+    qint64 bytesRotated = 0;
+    qint64 elapsedMs = 0;
+    QStringList errors;
+};
+
+Q_DECLARE_METATYPE(RotationReport)
+
+class LogRotator
+{
+public:
+    // Regular files some process holds open, keyed like LogFileInfo's
+    // (device, inode), from one pass over /proc/*/fd.
+    static QSet<QPair<quint64, quint64>> openFiles();
+
+    // Pure: decides what to do for each log the first matching rule covers.
+    static QVector<RotationTask> plan(const RotationPolicy &policy, const QVector<LogFileInfo> &logs,
+                                      const QSet<QPair<quint64, quint64>> &openFiles, qint64 now);
+
+    // Renames and truncations run in order on the calling thread; the new
+    // .1 files are then compressed in parallel on the global pool.
+    static RotationReport execute(const QVector<RotationTask> &tasks);
+
+    static QString describe(const RotationTask &task);
+    static QString methodName(RotationMethod method);
+};
+
+#endif // LOGROTATION_H
@@ -0,0 +1,195 @@
+#include "logscanner.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+#include <QtCore/QThread>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <dirent.h>
+#include <fcntl.h>
+#include <mutex>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct ScanQueue
+{
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::deque<QByteArray> directories;
+    int active = 0;
+    QVector<LogFileInfo> results;
+};
+
+void scanDirectory(const QByteArray &directory, QVector<LogFileInfo> &found, std::vector<QByteArray> &subdirectories)
+{
+    int fd = ::open(directory.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    DIR *dir = ::fdopendir(fd);
+    if (!dir) {
+        ::close(fd);
+        return;
+    }
+
+    while (struct dirent *entry = ::readdir(dir)) {
+        const char *name = entry->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+            continue;
+        }
+
+        unsigned char type = entry->d_type;
+        if (type == DT_DIR) {
+            subdirectories.push_back(directory + '/' + name);
+            continue;
+        }
+        if (type != DT_REG && type != DT_UNKNOWN) {
+            continue;
+        }
+
+        bool compressed = false;
+        bool isLog = LogScanner::isLogFileName(name, &compressed);
+        if (!isLog && type == DT_REG) {
+            continue;
+        }
+
+        struct statx stx;
+        if (::statx(fd, name, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC,
+                    STATX_TYPE | STATX_SIZE | STATX_BLOCKS | STATX_MTIME | STATX_INO, &stx) != 0) {
+            continue;
+        }
+
+        if (S_ISDIR(stx.stx_mode)) {
+            subdirectories.push_back(directory + '/' + name);
+        } else if (isLog && S_ISREG(stx.stx_mode)) {
+            LogFileInfo info;
+            info.path = QFile::decodeName(directory + '/' + name);
+            info.size = qint64(stx.stx_size);
+            info.allocated = qint64(stx.stx_blocks) * 512;
+            info.mtime = qint64(stx.stx_mtime.tv_sec);
+            info.device = (quint64(stx.stx_dev_major) << 32) | stx.stx_dev_minor;
+            info.inode = stx.stx_ino;
+            info.compressed = compressed;
+            found.append(info);
+        }
+    }
+
+    ::closedir(dir);
+}
+
+void worker(ScanQueue &queue)
+{
+    QVector<LogFileInfo> found;
+    std::vector<QByteArray> subdirectories;
+
+    std::unique_lock<std::mutex> lock(queue.mutex);
+    for (;;) {
+        queue.wakeup.wait(lock, [&queue]() {
+            return !queue.directories.empty() || queue.active == 0;
+        });
+        if (queue.directories.empty()) {
+            break;
+        }
+
+        QByteArray directory = std::move(queue.directories.front());
+        queue.directories.pop_front();
+        queue.active++;
+        lock.unlock();
+
+        scanDirectory(directory, found, subdirectories);
+
+        lock.lock();
+        for (QByteArray &subdirectory : subdirectories) {
+            queue.directories.push_back(std::move(subdirectory));
+        }
+        subdirectories.clear();
+        queue.active--;
+        queue.wakeup.notify_all();
+    }
+
+    queue.results += found;
+}
+
+} // namespace
+
+bool LogScanner::isLogFileName(const char *name, bool *compressed)
+{
+    const char *log = nullptr;
+    for (const char *p = strstr(name, ".log"); p; p = strstr(p + 1, ".log")) {
+        char next = p[4];
+        if (next == '\0' || next == '.' || next == '-') {
+            log = p;
+        }
+    }
+    if (!log) {
+        return false;
+    }
+
+    const char *rest = log + 4;
+    size_t length = strlen(rest);
+    bool isCompressed = false;
+
+    static const char *const suffixes[] = { ".gz", ".xz", ".zst" };
+    for (const char *suffix : suffixes) {
+        size_t suffixLength = strlen(suffix);
+        if (length >= suffixLength && memcmp(rest + length - suffixLength, suffix, suffixLength) == 0) {
+            length -= suffixLength;
+            isCompressed = true;
+            break;
+        }
+    }
+
+    // Whatever sits between ".log" and the codec must be a rotation number
+    // (".1") or a dateext stamp ("-20240101").
+    if (length > 0) {
+        if ((rest[0] != '.' && rest[0] != '-') || length == 1) {
+            return false;
+        }
+        for (size_t i = 1; i < length; ++i) {
+            if (rest[i] < '0' || rest[i] > '9') {
+                return false;
+            }
+        }
+    }
+
+    if (compressed) {
+        *compressed = isCompressed;
+    }
+    return true;
+}
+
+QVector<LogFileInfo> LogScanner::scan(const QString &root, int threads)
+{
+    if (threads <= 0) {
+        threads = qBound(1, QThread::idealThreadCount(), 8);
+    }
+
+    ScanQueue queue;
+    QByteArray rootPath = QFile::encodeName(root);
+    while (rootPath.size() > 1 && rootPath.endsWith('/')) {
+        rootPath.chop(1);
+    }
+    queue.directories.push_back(rootPath);
+
+    std::vector<std::thread> workers;
+    workers.reserve(size_t(threads - 1));
+    for (int i = 1; i < threads; ++i) {
+        workers.emplace_back(worker, std::ref(queue));
+    }
+    worker(queue);
+    for (std::thread &thread : workers) {
+        thread.join();
+    }
+
+    std::sort(queue.results.begin(), queue.results.end(), [](const LogFileInfo &a, const LogFileInfo &b) {
+        return a.path < b.path;
+    });
+    return queue.results;
+}
@@ -0,0 +1,39 @@
+#ifndef LOGSCANNER_H
+#define LOGSCANNER_H
+
+#include "fileutil.h"
+
+#include <QtCore/QMetaType>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+struct LogFileInfo
+{
+    QString path;
+    qint64 size = 0;
+    qint64 allocated = 0;
+    qint64 mtime = 0;
+    quint64 device = 0;
+    quint64 inode = 0;
+    bool compressed = false;
+};
+
+Q_DECLARE_METATYPE(QVector<LogFileInfo>)
+
+class LogScanner
+{
+public:
+    static QString defaultRoot()
+    {
+        return systemRoot() + "/var/log";
+    }
+
+    // Walks the tree on a small pool of threads, statx()ing only entries whose
+    // names look like logs or log rotations.
+    static QVector<LogFileInfo> scan(const QString &root = defaultRoot(), int threads = 0);
+
+    // foo.log, foo.log.1, foo.log-20240101 and their .gz/.xz/.zst forms.
+    static bool isLogFileName(const char *name, bool *compressed = nullptr);
+};
+
+#endif // LOGSCANNER_H
@@ -25,9 +25,106 @@
 #include <QtCore/QFile>
 #include <QtCore/QTextStream>
 #include <QtCore/QDateTime>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFutureWatcher>
+#include <QtCore/QLocale>
+#include <QtCore/QProcessEnvironment>
+#include <QtWidgets/QProgressBar>
+#include <QtWidgets/QDateTimeEdit>
+#include <QtWidgets/QDialog>
+#include <QtWidgets/QFileDialog>
+#include <QtWidgets/QFormLayout>
+#include <QtWidgets/QListView>
+#include <QtCore/QAbstractListModel>
+#include <QtCore/QAbstractTableModel>
+#include <QtCore/QRegularExpression>
+#include <QtCore/QSortFilterProxyModel>
+#include <QtWidgets/QTableView>
+#include <QtCore/QMap>
+#include <QtCore/QTimer>
+#include <QtGui/QFontDatabase>
+#include <QtWidgets/QPlainTextEdit>
+#include <climits>
+#include <fnmatch.h>
+#include <functional>
+#include <sys/statvfs.h>
+#include <numeric>
 #include <unistd.h>
 #include <QTemporaryFile>
 
+#include "batchmode.h"
+#include "bootanalysis.h"
+#include "cacheverifier.h"
+#include "cgroupsampler.h"
+#include "dedup.h"
+#include "filemetadata.h"
+#include "fileutil.h"
+#include "journalfiles.h"
+#include "journalvolume.h"
+#include "lineindex.h"
+#include "logarchive.h"
+#include "logcompressor.h"
+#include "loggrowth.h"
+#include "logrotation.h"
+#include "logscanner.h"
+#include "pacmandb.h"
+#include "pacmanprogress.h"
+#include "privilegedhelper.h"
+#include "resultcache.h"
+#include "systemdunits.h"
+#include "taskscheduler.h"
+
+class SizeTableItem : public QTableWidgetItem
+{
+public:
+    explicit SizeTableItem(qint64 bytes) : QTableWidgetItem(QLocale().formattedDataSize(bytes))
+    {
+        setData(Qt::UserRole, bytes);
+    }
+
+    bool operator<(const QTableWidgetItem &other) const override
+    {
+        return data(Qt::UserRole).toLongLong() < other.data(Qt::UserRole).toLongLong();
+    }
+};
+
+class CountTableItem : public QTableWidgetItem
+{
+public:
+    explicit CountTableItem(quint64 count) : QTableWidgetItem(QLocale().toString(count))
+    {
+        setData(Qt::UserRole, count);
+    }
+
+    bool operator<(const QTableWidgetItem &other) const override
+    {
+        return data(Qt::UserRole).toULongLong() < other.data(Qt::UserRole).toULongLong();
+    }
+};
+
+class DurationTableItem : public QTableWidgetItem
+{
+public:
+    explicit DurationTableItem(qint64 usec) : QTableWidgetItem(format(usec))
+    {
+        setData(Qt::UserRole, usec);
+    }
+
+    static QString format(qint64 usec)
+    {
+        if (usec >= 1000000) {
+            return QString("%1 s").arg(usec / 1e6, 0, 'f', 3);
+        }
+        return QString("%1 ms").arg(usec / 1000);
+    }
+
+    bool operator<(const QTableWidgetItem &other) const override
+    {
+        return data(Qt::UserRole).toLongLong() < other.data(Qt::UserRole).toLongLong();
+    }
+};
+
 class CacheManagementWidget : public QWidget
 {
     Q_OBJECT
@@ -56,44 +153,243 @@ public:
         m_clearButton = new QPushButton("Clear Cache", this);
         connect(m_clearButton, &QPushButton::clicked, this, &CacheManagementWidget::clearCache);
 
+        m_verifyButton = new QPushButton("Verify Cache", this);
+        connect(m_verifyButton, &QPushButton::clicked, this, &CacheManagementWidget::verifyCache);
+        
+        m_decompressCheckBox = new QCheckBox("Test-decompress packages", this);
+
         cacheButtonLayout->addWidget(m_refreshButton);
         cacheButtonLayout->addWidget(m_clearButton);
+        cacheButtonLayout->addWidget(m_verifyButton);
+        cacheButtonLayout->addWidget(m_decompressCheckBox);
         
         mainLayout->addLayout(cacheButtonLayout);
-        mainLayout->addStretch();
+        
+        m_summaryLabel = new QLabel(this);
+        mainLayout->addWidget(m_summaryLabel);
+        
+        m_packagesTable = new QTableWidget(0, 5, this);
+        m_packagesTable->setHorizontalHeaderLabels(QStringList() << "Package File" << "Version" << "Size" << "Status" << "Integrity");
+        m_packagesTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+        m_packagesTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+        m_packagesTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+        m_packagesTable->horizontalHeader()->setSectionResizeMode(1, QHeaderView::ResizeToContents);
+        m_packagesTable->horizontalHeader()->setSectionResizeMode(2, QHeaderView::ResizeToContents);
+        m_packagesTable->horizontalHeader()->setSectionResizeMode(3, QHeaderView::ResizeToContents);
+        m_packagesTable->horizontalHeader()->setSectionResizeMode(4, QHeaderView::ResizeToContents);
+        m_packagesTable->setMinimumHeight(200);
+        mainLayout->addWidget(m_packagesTable);
 
         m_statusLabel = new QLabel("Ready", this);
         mainLayout->addWidget(m_statusLabel);
-
-        refreshCacheSize();
+        
+        m_listingWatcher = new QFutureWatcher<QVector<CachedPackage>>(this);
+        connect(m_listingWatcher, &QFutureWatcher<QVector<CachedPackage>>::finished,
+                this, &CacheManagementWidget::onCacheListingReady);
+        
+        m_verifyWatcher = new QFutureWatcher<VerifyResult>(this);
+        connect(m_verifyWatcher, &QFutureWatcher<VerifyResult>::resultReadyAt,
+                this, &CacheManagementWidget::onPackageVerified);
+        connect(m_verifyWatcher, &QFutureWatcher<VerifyResult>::finished,
+                this, &CacheManagementWidget::onVerificationFinished);
     }
 
 public slots:
     void refreshCacheSize()
     {
-        m_statusLabel->setText("Calculating cache size...");
+        m_sizeValueLabel->setText("Calculating...");
+        FileMetadataCache::instance().invalidate(PacmanCache::defaultPath());
+        refreshCacheListing();
+    }
+
+    void refreshCacheListing()
+    {
+        if (m_listingWatcher->isRunning()) {
+            return;
+        }
+        
+        m_summaryLabel->setText("Classifying cached packages...");
+        m_listingTimer.start();
+        m_listingWatcher->setFuture(TaskScheduler::instance().run(TaskPriority::Normal, "cache-listing", []() {
+            QVector<CachedPackage> cached = PacmanCache::list();
+            PacmanCache::classify(cached, PacmanLocalDb::read(), PacmanSyncDb::readAll());
+            ResultCache::store("cache-listing", cached);
+            return cached;
+        }));
+    }
+
+    void onCacheListingReady()
+    {
+        m_cachedPackages = m_listingWatcher->result();
+        
+        qint64 cacheBytes = 0;
+        for (const FileMetadata &entry : FileMetadataCache::instance().entriesUnder(PacmanCache::defaultPath())) {
+            cacheBytes += entry.allocated;
+        }
+        m_sizeValueLabel->setText(QLocale().formattedDataSize(cacheBytes));
+        showPackages(m_cachedPackages, QString("[%1 ms]").arg(m_listingTimer.elapsed()));
+    }
+
+    // The previous run's listing, shown while the real one is computed. It
+    // is not kept in m_cachedPackages, so nothing acts on it.
+    void showStoredListing()
+    {
+        QVector<CachedPackage> cached;
+        qint64 storedSecs = 0;
+        if (!ResultCache::load("cache-listing", &cached, &storedSecs)) {
+            return;
+        }
+        qint64 cacheBytes = 0;
+        for (const CachedPackage &package : cached) {
+            cacheBytes += package.size;
+        }
+        const QString stored = QDateTime::fromSecsSinceEpoch(storedSecs).toString("yyyy-MM-dd HH:mm");
+        m_sizeValueLabel->setText(QString("%1 (as of %2, refreshing...)").arg(QLocale().formattedDataSize(cacheBytes), stored));
+        showPackages(cached, QString("[as of %1]").arg(stored));
+    }
+
+    void showPackages(const QVector<CachedPackage> &cached, const QString &timing)
+    {
+        m_packagesTable->setSortingEnabled(false);
+        m_packagesTable->clearContents();
+        m_integrityItems.clear();
+        m_packagesTable->setRowCount(cached.size());
+        
+        int counts[3] = { 0, 0, 0 };
+        qint64 sizes[3] = { 0, 0, 0 };
+        
+        for (int row = 0; row < cached.size(); row++) {
+            const CachedPackage &package = cached[row];
+            counts[package.status]++;
+            sizes[package.status] += package.size;
+            
+            QTableWidgetItem *fileItem = new QTableWidgetItem(package.fileName);
+            QTableWidgetItem *versionItem = new QTableWidgetItem(package.version);
+            QTableWidgetItem *sizeItem = new SizeTableItem(package.size);
+            QTableWidgetItem *statusItem = new QTableWidgetItem(PacmanCache::statusName(package.status));
+            
+            fileItem->setData(Qt::UserRole, package.name);
+            
+            if (package.status == CachedPackage::Dead) {
+                statusItem->setBackground(QColor(255, 200, 200));
+            } else if (package.status == CachedPackage::Installed) {
+                statusItem->setBackground(QColor(200, 255, 200));
+            }
+            
+            m_packagesTable->setItem(row, 0, fileItem);
+            m_packagesTable->setItem(row, 1, versionItem);
+            m_packagesTable->setItem(row, 2, sizeItem);
+            m_packagesTable->setItem(row, 3, statusItem);
+            
+            QTableWidgetItem *integrityItem = new QTableWidgetItem(package.sha256.isEmpty() ? "-" : "Not verified");
+            m_packagesTable->setItem(row, 4, integrityItem);
+            m_integrityItems.insert(PacmanCache::defaultPath() + "/" + package.fileName, integrityItem);
+        }
+        
+        m_packagesTable->setSortingEnabled(true);
+        
+        m_summaryLabel->setText(QString("Installed: %1 (%2)   In repository: %3 (%4)   Dead: %5 (%6)   %7")
+            .arg(counts[CachedPackage::Installed]).arg(QLocale().formattedDataSize(sizes[CachedPackage::Installed]))
+            .arg(counts[CachedPackage::InRepo]).arg(QLocale().formattedDataSize(sizes[CachedPackage::InRepo]))
+            .arg(counts[CachedPackage::Dead]).arg(QLocale().formattedDataSize(sizes[CachedPackage::Dead]))
+            .arg(timing));
+    }
+
+    void verifyCache()
+    {
+        if (m_verifyWatcher->isRunning()) {
+            m_verifyWatcher->cancel();
+            m_statusLabel->setText("Cancelling verification...");
+            return;
+        }
+        
+        if (m_cachedPackages.isEmpty()) {
+            m_statusLabel->setText("No cached packages to verify");
+            return;
+        }
+        
+        // Largest files first so the pool does not end on one long straggler.
+        QVector<CachedPackage> packages = m_cachedPackages;
+        std::sort(packages.begin(), packages.end(), [](const CachedPackage &a, const CachedPackage &b) {
+            return a.size > b.size;
+        });
+        
+        QVector<VerifyJob> jobs;
+        jobs.reserve(packages.size());
+        m_verifyTotalBytes = 0;
+        for (const CachedPackage &package : packages) {
+            VerifyJob job;
+            job.path = PacmanCache::defaultPath() + "/" + package.fileName;
+            job.expectedSha256 = package.sha256;
+            job.expectedSize = package.expectedSize;
+            job.testDecompress = m_decompressCheckBox->isChecked();
+            jobs.append(job);
+            m_verifyTotalBytes += package.size;
+        }
+        
+        for (QTableWidgetItem *item : qAsConst(m_integrityItems)) {
+            item->setText("Pending");
+            item->setBackground(QBrush());
+        }
+        
+        m_verifyFailures = 0;
+        m_verifiedBytes = 0;
+        m_verifyTimer.start();
+        m_verifyButton->setText("Cancel Verification");
         m_refreshButton->setEnabled(false);
         m_clearButton->setEnabled(false);
+        m_statusLabel->setText(QString("Verifying %1 cached packages...").arg(jobs.size()));
+        
+        m_verifyWatcher->setFuture(QtConcurrent::mapped(jobs, PackageVerifier::verify));
+    }
 
-        QProcess *process = new QProcess(this);
-        connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            [=](int exitCode, QProcess::ExitStatus exitStatus) {
-                m_refreshButton->setEnabled(true);
-                m_clearButton->setEnabled(true);
-                
-                if (exitCode == 0) {
-                    QString output = process->readAllStandardOutput();
-                    m_sizeValueLabel->setText(output.trimmed());
-                    m_statusLabel->setText("Ready");
-                } else {
-                    m_sizeValueLabel->setText("Error");
-                    m_statusLabel->setText("Failed to calculate cache size");
-                }
-                
-                process->deleteLater();
-            });
+    void onPackageVerified(int index)
+    {
+        const VerifyResult result = m_verifyWatcher->resultAt(index);
+        m_verifiedBytes += result.bytes;
+        
+        QTableWidgetItem *item = m_integrityItems.value(result.path);
+        if (item) {
+            item->setText(PackageVerifier::statusName(result.status));
+            item->setToolTip(result.detail);
+            if (result.status == VerifyResult::Ok) {
+                item->setBackground(QColor(200, 255, 200));
+            } else if (result.status != VerifyResult::NoChecksum) {
+                item->setBackground(QColor(255, 200, 200));
+            }
+        }
+        
+        if (result.status != VerifyResult::Ok && result.status != VerifyResult::NoChecksum) {
+            m_verifyFailures++;
+        }
+        
+        double seconds = qMax<qint64>(1, m_verifyTimer.elapsed()) / 1000.0;
+        m_statusLabel->setText(QString("Verified %1 of %2 at %3/s")
+            .arg(QLocale().formattedDataSize(m_verifiedBytes))
+            .arg(QLocale().formattedDataSize(m_verifyTotalBytes))
+            .arg(QLocale().formattedDataSize(qint64(m_verifiedBytes / seconds))));
+    }
 
-        process->start("bash", QStringList() << "-c" << "du -sh /var/cache/pacman/pkg/ | cut -f1");
+    void onVerificationFinished()
+    {
+        m_verifyButton->setText("Verify Cache");
+        m_refreshButton->setEnabled(true);
+        m_clearButton->setEnabled(true);
+        
+        if (m_verifyWatcher->isCanceled()) {
+            m_statusLabel->setText("Verification cancelled");
+            return;
+        }
+        
+        double seconds = qMax<qint64>(1, m_verifyTimer.elapsed()) / 1000.0;
+        if (m_verifyFailures == 0) {
+            m_statusLabel->setText(QString("All cached packages verified (%1 in %2 s)")
+                .arg(QLocale().formattedDataSize(m_verifiedBytes)).arg(seconds, 0, 'f', 1));
+        } else {
+            m_statusLabel->setText(QString("%1 cached packages failed verification").arg(m_verifyFailures));
+            QMessageBox::warning(this, "Cache Verification",
+                QString("%1 cached packages are truncated or corrupt.\nSee the Integrity column for details.").arg(m_verifyFailures));
+        }
     }
 
     void clearCache()
@@ -110,33 +406,63 @@ public slots:
         m_refreshButton->setEnabled(false);
         m_clearButton->setEnabled(false);
         
-        QProcess *process = new QProcess(this);
-        connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            [=](int exitCode, QProcess::ExitStatus exitStatus) {
+        QFutureWatcher<QString> *watcher = new QFutureWatcher<QString>(this);
+        connect(watcher, &QFutureWatcher<QString>::finished, this, [=]() {
                 m_refreshButton->setEnabled(true);
                 m_clearButton->setEnabled(true);
                 
-                if (exitCode == 0) {
+                const QString error = watcher->result();
+                if (error.isEmpty()) {
                     m_statusLabel->setText("Cache cleared successfully");
                     QMessageBox::information(this, "Success", "Pacman cache cleared successfully");
-                    refreshCacheSize();
                 } else {
-                    QString error = process->readAllStandardError();
                     m_statusLabel->setText("Failed to clear cache");
                     QMessageBox::critical(this, "Error", "Failed to clear Pacman cache.\n" + error);
                 }
+                refreshCacheSize();
                 
-                process->deleteLater();
+                watcher->deleteLater();
             });
 
-        process->start("bash", QStringList() << "-c" << "rm -rf /var/cache/pacman/pkg/*");
+        watcher->setFuture(TaskScheduler::instance().run(TaskPriority::Interactive, "cache-clear", []() {
+            QString error;
+            PrivilegedHelper::instance().clearPackageCache(&error);
+            return error;
+        }));
+    }
+
+protected:
+    void showEvent(QShowEvent *event) override
+    {
+        QWidget::showEvent(event);
+        if (m_populated) {
+            return;
+        }
+        m_populated = true;
+        showStoredListing();
+        // Queued, so the window paints before the listing is started.
+        QTimer::singleShot(0, this, &CacheManagementWidget::refreshCacheSize);
     }
 
 private:
+    bool m_populated = false;
     QLabel *m_sizeValueLabel;
     QLabel *m_statusLabel;
+    QLabel *m_summaryLabel;
     QPushButton *m_refreshButton;
     QPushButton *m_clearButton;
+    QPushButton *m_verifyButton;
+    QCheckBox *m_decompressCheckBox;
+    QTableWidget *m_packagesTable;
+    QFutureWatcher<QVector<CachedPackage>> *m_listingWatcher;
+    QElapsedTimer m_listingTimer;
+    QVector<CachedPackage> m_cachedPackages;
+    QHash<QString, QTableWidgetItem*> m_integrityItems;
+    QFutureWatcher<VerifyResult> *m_verifyWatcher;
+    QElapsedTimer m_verifyTimer;
+    qint64 m_verifyTotalBytes = 0;
+    qint64 m_verifiedBytes = 0;
+    int m_verifyFailures = 0;
 };
 
 class OrphanedPackagesWidget : public QWidget
@@ -177,6 +503,19 @@ public:
         
         mainLayout->addLayout(orphanedButtonLayout);
         
+        m_removalProgressBar = new QProgressBar(this);
+        m_removalProgressBar->setVisible(false);
+        mainLayout->addWidget(m_removalProgressBar);
+        
+        m_bytesFreedLabel = new QLabel(this);
+        m_bytesFreedLabel->setVisible(false);
+        mainLayout->addWidget(m_bytesFreedLabel);
+        
+        m_progressModel = new RemovalProgressModel(this);
+        connect(m_progressModel, &RemovalProgressModel::packageAdded, this, &OrphanedPackagesWidget::onRemovalPackageAdded);
+        connect(m_progressModel, &RemovalProgressModel::packageStateChanged, this, &OrphanedPackagesWidget::onRemovalPackageStateChanged);
+        connect(m_progressModel, &RemovalProgressModel::bytesFreedChanged, this, &OrphanedPackagesWidget::onBytesFreedChanged);
+        
         mainLayout->addStretch();
 
         m_statusLabel = new QLabel("Ready", this);
@@ -201,16 +540,17 @@ public slots:
         m_listOrphansButton->setEnabled(false);
         m_removeOrphansButton->setEnabled(false);
         m_orphanedPackagesList->clear();
+        m_removalItems.clear();
         m_selectAllCheckBox->setChecked(false);
         m_selectAllCheckBox->setEnabled(false);
 
-        QProcess *process = new QProcess(this);
-        connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            [=](int exitCode, QProcess::ExitStatus exitStatus) {
+        QFutureWatcher<ProcessResult> *watcher = new QFutureWatcher<ProcessResult>(this);
+        connect(watcher, &QFutureWatcher<ProcessResult>::finished, this, [=]() {
+                const ProcessResult result = watcher->result();
                 m_listOrphansButton->setEnabled(true);
                 
-                if (exitCode == 0) {
-                    QString output = process->readAllStandardOutput();
+                if (result.ok()) {
+                    QString output = QString::fromLocal8Bit(result.standardOutput);
                     QStringList packages = output.split('\n', Qt::SkipEmptyParts);
                     
                     if (packages.isEmpty() || (packages.size() == 1 && packages[0].contains("No orphaned packages found"))) {
@@ -236,7 +576,7 @@ public slots:
                         updateRemoveButtonState();
                     }
                 } else {
-                    QString error = process->readAllStandardError();
+                    QString error = result.error.isEmpty() ? QString::fromLocal8Bit(result.standardError) : result.error;
                     QListWidgetItem* item = new QListWidgetItem("Error listing orphaned packages: " + error);
                     item->setFlags(item->flags() & ~Qt::ItemIsUserCheckable);
                     m_orphanedPackagesList->addItem(item);
@@ -246,10 +586,11 @@ public slots:
                     m_selectAllCheckBox->setEnabled(false);
                 }
                 
-                process->deleteLater();
+                watcher->deleteLater();
             });
 
-        process->start("bash", QStringList() << "-c" << "pacman -Qdt 2>/dev/null || echo 'No orphaned packages found'");
+        watcher->setFuture(TaskScheduler::instance().runProcess(TaskPriority::Interactive, "pacman-orphans", "bash",
+            QStringList() << "-c" << "pacman -Qdt 2>/dev/null || echo 'No orphaned packages found'"));
     }
     
     void updateRemoveButtonState()
@@ -295,29 +636,111 @@ public slots:
         m_removeOrphansButton->setEnabled(false);
         m_selectAllCheckBox->setEnabled(false);
 
-        QProcess *process = new QProcess(this);
-        connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            [=](int exitCode, QProcess::ExitStatus exitStatus) {
+        m_removalItems.clear();
+        for (int i = 0; i < m_orphanedPackagesList->count(); i++) {
+            QListWidgetItem* item = m_orphanedPackagesList->item(i);
+            m_removalItems.insert(item->text().section(' ', 0, 0), item);
+        }
+
+        m_progressModel->start(packagesToRemove);
+        m_removalProgressBar->setRange(0, packagesToRemove.size());
+        m_removalProgressBar->setValue(0);
+        m_removalProgressBar->setVisible(true);
+        m_bytesFreedLabel->setText(QString("Freed: 0 B of %1").arg(QLocale().formattedDataSize(m_progressModel->totalBytes())));
+        m_bytesFreedLabel->setVisible(true);
+
+        QFutureWatcher<QString> *watcher = new QFutureWatcher<QString>(this);
+        connect(watcher, &QFutureWatcher<QString>::finished, this, [=]() {
+                // Output chunks were queued before this, so the model has seen them all.
+                const QString error = watcher->result();
+                bool success = error.isEmpty();
+                m_progressModel->finish(success);
+                
                 m_listOrphansButton->setEnabled(true);
                 m_selectAllCheckBox->setEnabled(true);
+                m_removalProgressBar->setVisible(false);
                 
-                if (exitCode == 0) {
-                    m_statusLabel->setText("Selected packages removed successfully");
-                    QMessageBox::information(this, "Success", "Selected orphaned packages removed successfully");
+                QString freed = QLocale().formattedDataSize(m_progressModel->bytesFreed());
+                if (success) {
+                    m_statusLabel->setText(QString("Selected packages removed successfully, %1 freed").arg(freed));
+                    QMessageBox::information(this, "Success",
+                        QString("Selected orphaned packages removed successfully.\n%1 freed.").arg(freed));
                     listOrphanedPackages();
                 } else {
-                    QString error = process->readAllStandardError();
                     m_statusLabel->setText("Failed to remove selected packages");
                     QMessageBox::critical(this, "Error", "Failed to remove orphaned packages.\n" + error);
                     updateRemoveButtonState();
                 }
                 
-                process->deleteLater();
+                watcher->deleteLater();
             });
 
-        QString packagesArg = packagesToRemove.join(" ");
+        watcher->setFuture(TaskScheduler::instance().run(TaskPriority::Interactive, "orphan-removal", [this, packagesToRemove]() {
+            QString error;
+            const bool ok = PrivilegedHelper::instance().removePackages(packagesToRemove, [this](const QByteArray &chunk) {
+                QMetaObject::invokeMethod(this, [this, chunk]() {
+                    m_progressModel->feed(chunk);
+                }, Qt::QueuedConnection);
+            }, &error);
+            if (!ok && error.isEmpty()) {
+                error = "pacman exited with an error";
+            }
+            return error;
+        }));
+    }
+
+    void onRemovalPackageAdded(int index)
+    {
+        const RemovalProgressModel::Entry &entry = m_progressModel->entry(index);
+        if (m_removalItems.contains(entry.name)) {
+            return;
+        }
+        
+        QListWidgetItem* item = new QListWidgetItem(QString("%1 %2").arg(entry.name, entry.version).trimmed());
+        item->setFlags(item->flags() & ~Qt::ItemIsUserCheckable);
+        m_orphanedPackagesList->addItem(item);
+        m_removalItems.insert(entry.name, item);
+        
+        if (m_removalProgressBar->isVisible()) {
+            m_removalProgressBar->setMaximum(m_progressModel->count());
+        }
+    }
+
+    void onRemovalPackageStateChanged(int index)
+    {
+        const RemovalProgressModel::Entry &entry = m_progressModel->entry(index);
+        QListWidgetItem* item = m_removalItems.value(entry.name);
+        if (!item) {
+            return;
+        }
         
-        process->start("bash", QStringList() << "-c" << QString("pacman -Rns %1 --noconfirm").arg(packagesArg));
+        QString label = QString("%1 %2").arg(entry.name, entry.version).trimmed();
+        switch (entry.state) {
+        case RemovalProgressModel::PackageState::Pending:
+            break;
+        case RemovalProgressModel::PackageState::Removing:
+            label += " - removing...";
+            m_statusLabel->setText(QString("Removing %1...").arg(entry.name));
+            m_orphanedPackagesList->scrollToItem(item);
+            break;
+        case RemovalProgressModel::PackageState::Removed:
+            label += QString(" - removed (%1)").arg(QLocale().formattedDataSize(entry.installedSize));
+            item->setForeground(QColor(0, 128, 0));
+            break;
+        case RemovalProgressModel::PackageState::Failed:
+            label += " - failed";
+            item->setForeground(QColor(192, 0, 0));
+            break;
+        }
+        item->setText(label);
+        m_removalProgressBar->setValue(m_progressModel->removedCount());
+    }
+
+    void onBytesFreedChanged(qint64 bytes)
+    {
+        m_bytesFreedLabel->setText(QString("Freed: %1 of %2")
+            .arg(QLocale().formattedDataSize(bytes))
+            .arg(QLocale().formattedDataSize(m_progressModel->totalBytes())));
     }
 
 private:
@@ -326,191 +749,1300 @@ private:
     QPushButton *m_removeOrphansButton;
     QListWidget *m_orphanedPackagesList;
     QCheckBox *m_selectAllCheckBox;
+    QProgressBar *m_removalProgressBar;
+    QLabel *m_bytesFreedLabel;
+    RemovalProgressModel *m_progressModel;
+    QHash<QString, QListWidgetItem*> m_removalItems;
 };
 
-class SystemLogsWidget : public QWidget
+// An archive's members as listed by the helper.
+struct ArchiveListing
+{
+    QVector<ArchiveMember> members;
+    int blockCount = 0;
+    QString error;
+};
+
+class LogArchiveDialog : public QDialog
 {
     Q_OBJECT
 
 public:
-    SystemLogsWidget(QWidget *parent = nullptr) : QWidget(parent)
+    LogArchiveDialog(const QString &archivePath, QWidget *parent = nullptr) : QDialog(parent), m_path(archivePath)
     {
+        setWindowTitle(QString("Query %1").arg(QFileInfo(archivePath).fileName()));
+        resize(900, 600);
+
         QVBoxLayout *mainLayout = new QVBoxLayout(this);
+        QFormLayout *formLayout = new QFormLayout();
 
-        QLabel *infoLabel = new QLabel("This tab helps you manage system logs.\nYou can view, compress, or remove old log files to save disk space.", this);
-        mainLayout->addWidget(infoLabel);
-        
-        m_logsTable = new QTableWidget(0, 3, this);
-        m_logsTable->setHorizontalHeaderLabels(QStringList() << "Log File" << "Size" << "Last Modified");
-        m_logsTable->setSelectionBehavior(QAbstractItemView::SelectRows);
-        m_logsTable->setSelectionMode(QAbstractItemView::MultiSelection);
-        m_logsTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
-        m_logsTable->setMinimumHeight(200);
-        mainLayout->addWidget(m_logsTable);
-        
-        QGroupBox *actionsGroupBox = new QGroupBox("Log Management Actions", this);
-        QVBoxLayout *actionsLayout = new QVBoxLayout(actionsGroupBox);
-        
-        QHBoxLayout *ageLayout = new QHBoxLayout();
-        QLabel *ageLabel = new QLabel("Process logs older than:", this);
-        m_ageSpinBox = new QSpinBox(this);
-        m_ageSpinBox->setMinimum(1);
-        m_ageSpinBox->setMaximum(365);
-        m_ageSpinBox->setValue(30);
-        m_ageUnitCombo = new QComboBox(this);
-        m_ageUnitCombo->addItems(QStringList() << "Days" << "Weeks" << "Months");
-        ageLayout->addWidget(ageLabel);
-        ageLayout->addWidget(m_ageSpinBox);
-        ageLayout->addWidget(m_ageUnitCombo);
-        ageLayout->addStretch();
-        actionsLayout->addLayout(ageLayout);
-        
-        QButtonGroup *actionGroup = new QButtonGroup(this);
-        
-        m_compressLogsRadio = new QRadioButton("Compress selected logs", this);
-        m_removeLogsRadio = new QRadioButton("Remove selected logs", this);
-        m_compressLogsRadio->setChecked(true);
-        
-        actionGroup->addButton(m_compressLogsRadio);
-        actionGroup->addButton(m_removeLogsRadio);
-        
-        actionsLayout->addWidget(m_compressLogsRadio);
-        actionsLayout->addWidget(m_removeLogsRadio);
-        
-        mainLayout->addWidget(actionsGroupBox);
-        
-        QHBoxLayout *buttonLayout = new QHBoxLayout();
-        
-        m_refreshLogsButton = new QPushButton("Refresh Logs List", this);
-        connect(m_refreshLogsButton, &QPushButton::clicked, this, &SystemLogsWidget::refreshLogsList);
-        
-        m_selectOldLogsButton = new QPushButton("Select Old Logs", this);
-        connect(m_selectOldLogsButton, &QPushButton::clicked, this, &SystemLogsWidget::selectOldLogs);
-        
-        m_processLogsButton = new QPushButton("Process Selected Logs", this);
-        connect(m_processLogsButton, &QPushButton::clicked, this, &SystemLogsWidget::processLogs);
-        m_processLogsButton->setEnabled(false);
-        
-        buttonLayout->addWidget(m_refreshLogsButton);
-        buttonLayout->addWidget(m_selectOldLogsButton);
-        buttonLayout->addWidget(m_processLogsButton);
-        
-        mainLayout->addLayout(buttonLayout);
-        
-        m_statusLabel = new QLabel("Ready", this);
+        m_memberCombo = new QComboBox(this);
+        m_fromEdit = new QDateTimeEdit(QDateTime::currentDateTime().addDays(-1), this);
+        m_toEdit = new QDateTimeEdit(QDateTime::currentDateTime(), this);
+        m_fromEdit->setDisplayFormat("yyyy-MM-dd HH:mm:ss");
+        m_toEdit->setDisplayFormat("yyyy-MM-dd HH:mm:ss");
+        m_fromEdit->setCalendarPopup(true);
+        m_toEdit->setCalendarPopup(true);
+
+        formLayout->addRow("Log file:", m_memberCombo);
+        formLayout->addRow("From:", m_fromEdit);
+        formLayout->addRow("To:", m_toEdit);
+        mainLayout->addLayout(formLayout);
+
+        m_searchButton = new QPushButton("Show Lines", this);
+        connect(m_searchButton, &QPushButton::clicked, this, &LogArchiveDialog::runQuery);
+        mainLayout->addWidget(m_searchButton);
+
+        m_output = new QPlainTextEdit(this);
+        m_output->setReadOnly(true);
+        m_output->setLineWrapMode(QPlainTextEdit::NoWrap);
+        mainLayout->addWidget(m_output);
+
+        m_statusLabel = new QLabel(this);
         mainLayout->addWidget(m_statusLabel);
-        
-        connect(m_logsTable, &QTableWidget::itemSelectionChanged, this, &SystemLogsWidget::updateButtonState);
-        
-        refreshLogsList();
+
+        m_queryWatcher = new QFutureWatcher<ArchiveQueryResult>(this);
+        connect(m_queryWatcher, &QFutureWatcher<ArchiveQueryResult>::finished,
+                this, &LogArchiveDialog::onQueryFinished);
+        m_listingWatcher = new QFutureWatcher<ArchiveListing>(this);
+        connect(m_listingWatcher, &QFutureWatcher<ArchiveListing>::finished,
+                this, &LogArchiveDialog::onListed);
+
+        // Archives the helper wrote under /var/log are root's, as readable
+        // as the logs in them; those are read through the helper.
+        const QFileInfo index(LogArchive::indexPath(archivePath));
+        m_viaHelper = ::geteuid() != 0
+            && !(QFileInfo(archivePath).isReadable() && (!index.exists() || index.isReadable()));
+        if (m_viaHelper) {
+            m_searchButton->setEnabled(false);
+            m_statusLabel->setText("Reading the archive index...");
+            m_listingWatcher->setFuture(TaskScheduler::instance().run(TaskPriority::Interactive, QString(), [archivePath]() {
+                ArchiveListing listing;
+                PrivilegedHelper::instance().listArchive(archivePath, &listing.members, &listing.blockCount,
+                                                         &listing.error);
+                return listing;
+            }));
+            return;
+        }
+
+        QString error;
+        if (!m_archive.open(archivePath, &error)) {
+            m_statusLabel->setText(error);
+            m_searchButton->setEnabled(false);
+            return;
+        }
+        showMembers(m_archive.members(), m_archive.blocks().size());
     }
 
-public slots:
-    void refreshLogsList()
+private slots:
+    void runQuery()
     {
-        m_statusLabel->setText("Refreshing logs list...");
-        m_refreshLogsButton->setEnabled(false);
-        m_selectOldLogsButton->setEnabled(false);
-        m_processLogsButton->setEnabled(false);
-        m_logsTable->clearContents();
-        m_logsTable->setRowCount(0);
+        // Line timestamps are wall-clock values, so compare against the
+        // entered local time read as UTC.
+        const qint64 from = QDateTime(m_fromEdit->date(), m_fromEdit->time(), Qt::UTC).toSecsSinceEpoch();
+        const qint64 to = QDateTime(m_toEdit->date(), m_toEdit->time(), Qt::UTC).toSecsSinceEpoch();
+        const QString member = m_memberCombo->currentData().toString();
 
-        QProcess *process = new QProcess(this);
-        connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            [=](int exitCode, QProcess::ExitStatus exitStatus) {
-                m_refreshLogsButton->setEnabled(true);
-                m_selectOldLogsButton->setEnabled(true);
-                
-                if (exitCode == 0) {
-                    QString output = process->readAllStandardOutput();
-                    QStringList lines = output.split('\n', Qt::SkipEmptyParts);
-                    
-                    m_logsTable->setRowCount(lines.size());
-                    
-                    int row = 0;
-                    for (const QString &line : lines) {
-                        QStringList parts = line.split('|');
-                        if (parts.size() >= 3) {
-                            QTableWidgetItem *fileItem = new QTableWidgetItem(parts[0].trimmed());
-                            QTableWidgetItem *sizeItem = new QTableWidgetItem(parts[1].trimmed());
-                            QTableWidgetItem *dateItem = new QTableWidgetItem(parts[2].trimmed());
-                            
-                            fileItem->setData(Qt::UserRole, parts[0].trimmed());
-                            
-                            m_logsTable->setItem(row, 0, fileItem);
-                            m_logsTable->setItem(row, 1, sizeItem);
-                            m_logsTable->setItem(row, 2, dateItem);
-                            row++;
-                        }
-                    }
-                    
-                    m_statusLabel->setText(QString("Found %1 log files").arg(lines.size()));
-                } else {
-                    m_statusLabel->setText("Failed to get logs list");
-                }
-                
-                updateButtonState();
-                process->deleteLater();
-            });
+        m_searchButton->setEnabled(false);
+        m_statusLabel->setText("Searching...");
+        if (m_viaHelper) {
+            const QString path = m_path;
+            m_queryWatcher->setFuture(TaskScheduler::instance().run(TaskPriority::Interactive, QString(), [path, from, to, member]() {
+                return PrivilegedHelper::instance().queryArchive(path, from, to, member);
+            }));
+            return;
+        }
+        const LogArchive *archive = &m_archive;
+        m_queryWatcher->setFuture(TaskScheduler::instance().run(TaskPriority::Interactive, QString(), [archive, from, to, member]() {
+            return archive->queryTimeRange(from, to, member);
+        }));
+    }
 
-        process->start("bash", QStringList() << "-c" << 
-            "find /var/log -type f -name '*.log' -o -name '*.log.[0-9]*' | "
-            "while read file; do "
-            "  echo \"$file|$(du -h \"$file\" | cut -f1)|$(date -r \"$file\" '+%Y-%m-%d %H:%M')\"; "
-            "done");
+    void onListed()
+    {
+        const ArchiveListing listing = m_listingWatcher->result();
+        if (!listing.error.isEmpty()) {
+            m_statusLabel->setText(listing.error);
+            return;
+        }
+        m_searchButton->setEnabled(true);
+        showMembers(listing.members, listing.blockCount);
     }
-    
-    void selectOldLogs()
+
+    void onQueryFinished()
     {
-        int age = m_ageSpinBox->value();
-        QString unit = m_ageUnitCombo->currentText();
-        
-        int days = age;
-        if (unit == "Weeks") {
-            days = age * 7;
-        } else if (unit == "Months") {
-            days = age * 30;
+        const ArchiveQueryResult result = m_queryWatcher->result();
+        m_searchButton->setEnabled(true);
+
+        if (!result.error.isEmpty()) {
+            m_statusLabel->setText(result.error);
+            return;
         }
+        m_output->setPlainText(QString::fromUtf8(result.text));
+        m_statusLabel->setText(QString("Decompressed %1 of %2 blocks in %3 ms")
+            .arg(result.blocksRead).arg(result.blocksTotal).arg(result.elapsedMs));
+    }
+
+    void reject() override
+    {
+        m_listingWatcher->waitForFinished();
+        m_queryWatcher->waitForFinished();
+        QDialog::reject();
+    }
+
+private:
+    void showMembers(const QVector<ArchiveMember> &members, int blockCount)
+    {
+        m_memberCombo->addItem("All files", QString());
+        for (const ArchiveMember &member : members) {
+            m_memberCombo->addItem(QString("%1 (%2)").arg(member.name, QLocale().formattedDataSize(member.size)),
+                                   member.name);
+        }
+        m_statusLabel->setText(QString("%1 files in %2 blocks").arg(members.size()).arg(blockCount));
+    }
+
+    QString m_path;
+    bool m_viaHelper = false;
+    LogArchive m_archive;
+    QComboBox *m_memberCombo;
+    QDateTimeEdit *m_fromEdit;
+    QDateTimeEdit *m_toEdit;
+    QPushButton *m_searchButton;
+    QPlainTextEdit *m_output;
+    QLabel *m_statusLabel;
+    QFutureWatcher<ArchiveQueryResult> *m_queryWatcher;
+    QFutureWatcher<ArchiveListing> *m_listingWatcher;
+};
+
+class LogLineModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    // Long lines are cut for display; the view only asks for visible rows.
+    static const int MaxDisplayChars = 4096;
+
+    LogLineModel(const LineIndex *index, QObject *parent = nullptr) : QAbstractListModel(parent), m_index(index)
+    {
+    }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override
+    {
+        return parent.isValid() ? 0 : m_rows;
+    }
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override
+    {
+        if (role != Qt::DisplayRole || !index.isValid()) {
+            return QVariant();
+        }
+        return QString::fromUtf8(m_index->line(index.row()).left(MaxDisplayChars));
+    }
+
+    void linesIndexed()
+    {
+        const int rows = int(qMin<qint64>(m_index->lineCount(), INT_MAX));
+        if (rows > m_rows) {
+            beginInsertRows(QModelIndex(), m_rows, rows - 1);
+            m_rows = rows;
+            endInsertRows();
+        }
+    }
+
+private:
+    const LineIndex *m_index;
+    int m_rows = 0;
+};
+
+class LogViewerDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    LogViewerDialog(const QString &path, QWidget *parent = nullptr) : QDialog(parent)
+    {
+        setAttribute(Qt::WA_DeleteOnClose);
+        setWindowTitle(path);
+        resize(1000, 700);
+
+        QVBoxLayout *mainLayout = new QVBoxLayout(this);
+
+        QHBoxLayout *toolLayout = new QHBoxLayout();
+        m_lineSpinBox = new QSpinBox(this);
+        m_lineSpinBox->setRange(1, 1);
+        QPushButton *goButton = new QPushButton("Go", this);
+        connect(goButton, &QPushButton::clicked, this, &LogViewerDialog::goToLine);
+        connect(m_lineSpinBox, &QSpinBox::editingFinished, this, &LogViewerDialog::goToLine);
+
+        m_findEdit = new QLineEdit(this);
+        m_findEdit->setPlaceholderText("Find text...");
+        m_findButton = new QPushButton("Find Next", this);
+        connect(m_findButton, &QPushButton::clicked, this, &LogViewerDialog::findNext);
+        connect(m_findEdit, &QLineEdit::returnPressed, this, &LogViewerDialog::findNext);
+
+        toolLayout->addWidget(new QLabel("Line:", this));
+        toolLayout->addWidget(m_lineSpinBox);
+        toolLayout->addWidget(goButton);
+        toolLayout->addSpacing(20);
+        toolLayout->addWidget(m_findEdit);
+        toolLayout->addWidget(m_findButton);
+        mainLayout->addLayout(toolLayout);
+
+        m_model = new LogLineModel(&m_index, this);
+        m_view = new QListView(this);
+        m_view->setUniformItemSizes(true);
+        m_view->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+        m_view->setModel(m_model);
+        mainLayout->addWidget(m_view);
+
+        m_statusLabel = new QLabel(this);
+        mainLayout->addWidget(m_statusLabel);
+
+        m_indexWatcher = new QFutureWatcher<LineIndexChunk>(this);
+        connect(m_indexWatcher, &QFutureWatcher<LineIndexChunk>::resultReadyAt,
+                this, &LogViewerDialog::onChunkIndexed);
+        connect(m_indexWatcher, &QFutureWatcher<LineIndexChunk>::finished,
+                this, &LogViewerDialog::updateStatus);
+
+        m_searchWatcher = new QFutureWatcher<qint64>(this);
+        connect(m_searchWatcher, &QFutureWatcher<qint64>::finished, this, &LogViewerDialog::onSearchFinished);
+
+        QString error;
+        if (!m_file.open(path, &error)) {
+            m_statusLabel->setText(error);
+            m_findButton->setEnabled(false);
+            return;
+        }
+
+        // Mapping is instant; the index is built in chunks on the thread pool
+        // and rows appear as soon as the first chunk is done.
+        m_index.reset(m_file.data(), m_file.size());
+        QVector<int> chunks(LineIndex::chunkCount(m_file.size()));
+        std::iota(chunks.begin(), chunks.end(), 0);
+        m_indexTimer.start();
+        m_indexWatcher->setFuture(QtConcurrent::mapped(chunks, IndexChunkJob { m_file.data(), m_file.size() }));
+        updateStatus();
+    }
+
+    ~LogViewerDialog() override
+    {
+        // Both jobs read the mapping, which goes away with m_file.
+        m_indexWatcher->cancel();
+        m_indexWatcher->waitForFinished();
+        m_searchWatcher->waitForFinished();
+    }
+
+private slots:
+    void onChunkIndexed(int chunk)
+    {
+        m_pendingChunks.insert(chunk, m_indexWatcher->resultAt(chunk));
+        while (m_pendingChunks.contains(m_nextChunk)) {
+            m_index.append(m_pendingChunks.take(m_nextChunk));
+            ++m_nextChunk;
+        }
+
+        m_model->linesIndexed();
+        m_lineSpinBox->setMaximum(int(qBound<qint64>(1, m_index.lineCount(), INT_MAX)));
+
+        if (m_pendingHit >= 0 && m_index.lineForOffset(m_pendingHit) >= 0) {
+            showLine(m_index.lineForOffset(m_pendingHit));
+            m_pendingHit = -1;
+        }
+        updateStatus();
+    }
+
+    void goToLine()
+    {
+        const qint64 line = m_lineSpinBox->value() - 1;
+        if (line < m_index.lineCount()) {
+            showLine(line);
+        } else {
+            m_statusLabel->setText(QString("Line %1 is not indexed yet").arg(line + 1));
+        }
+    }
+
+    void findNext()
+    {
+        const QByteArray needle = m_findEdit->text().toUtf8();
+        if (needle.isEmpty() || m_searchWatcher->isRunning()) {
+            return;
+        }
+
+        const QModelIndex current = m_view->currentIndex();
+        qint64 from = 0;
+        if (current.isValid()) {
+            from = m_index.lineStart(current.row() + 1);
+            if (from < 0) {
+                // The current line is the last one indexed so far.
+                from = m_index.indexedBytes();
+            }
+        }
+        const char *data = m_file.data();
+        const qint64 size = m_file.size();
+
+        m_findButton->setEnabled(false);
+        m_statusLabel->setText(QString("Searching for \"%1\"...").arg(m_findEdit->text()));
+        m_searchWatcher->setFuture(TaskScheduler::instance().run(TaskPriority::Interactive, QString(), [data, size, from, needle]() {
+            return SubstringSearch::findFirst(data, size, from, needle);
+        }));
+    }
+
+    void onSearchFinished()
+    {
+        m_findButton->setEnabled(true);
+
+        const qint64 hit = m_searchWatcher->result();
+        if (hit < 0) {
+            m_statusLabel->setText(QString("\"%1\" not found below the current line").arg(m_findEdit->text()));
+            return;
+        }
+
+        const qint64 line = m_index.lineForOffset(hit);
+        if (line < 0) {
+            m_pendingHit = hit;
+            m_statusLabel->setText("Match found; waiting for the index to reach it...");
+            return;
+        }
+        showLine(line);
+        updateStatus();
+    }
+
+    void updateStatus()
+    {
+        if (m_file.truncated()) {
+            m_statusLabel->setText("The file was truncated while open; reopen it to see what it holds now");
+        } else if (m_index.isComplete()) {
+            m_statusLabel->setText(QString("%1 lines, %2, indexed in %3 ms")
+                .arg(m_index.lineCount())
+                .arg(QLocale().formattedDataSize(m_file.size()))
+                .arg(m_indexTimer.elapsed()));
+        } else {
+            m_statusLabel->setText(QString("Indexing... %1 of %2, %3 lines so far")
+                .arg(QLocale().formattedDataSize(m_index.indexedBytes()))
+                .arg(QLocale().formattedDataSize(m_file.size()))
+                .arg(m_index.lineCount()));
+        }
+    }
+
+private:
+    void showLine(qint64 line)
+    {
+        const QModelIndex index = m_model->index(int(line));
+        m_view->setCurrentIndex(index);
+        m_view->scrollTo(index, QAbstractItemView::PositionAtCenter);
+        m_lineSpinBox->setValue(int(line + 1));
+    }
+
+    MappedFile m_file;
+    LineIndex m_index;
+    LogLineModel *m_model;
+    QListView *m_view;
+    QSpinBox *m_lineSpinBox;
+    QLineEdit *m_findEdit;
+    QPushButton *m_findButton;
+    QLabel *m_statusLabel;
+    QFutureWatcher<LineIndexChunk> *m_indexWatcher;
+    QFutureWatcher<qint64> *m_searchWatcher;
+    QMap<int, LineIndexChunk> m_pendingChunks;
+    int m_nextChunk = 0;
+    qint64 m_pendingHit = -1;
+    QElapsedTimer m_indexTimer;
+};
+
+class JournalVolumeDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    JournalVolumeDialog(const JournalVolumeReport &report, QWidget *parent = nullptr) : QDialog(parent)
+    {
+        setAttribute(Qt::WA_DeleteOnClose);
+        setWindowTitle("Journal Volume by Unit");
+        resize(900, 600);
+
+        QVBoxLayout *mainLayout = new QVBoxLayout(this);
+        mainLayout->addWidget(new QLabel(QString("%1 entries, %2 of payload in %3 journal files. "
+            "Double-click a unit to show it in the System Services tab.")
+            .arg(report.total.entries)
+            .arg(QLocale().formattedDataSize(qint64(report.total.bytes)))
+            .arg(report.files), this));
+
+        QTableWidget *unitsTable = new QTableWidget(report.units.size(), 6, this);
+        unitsTable->setHorizontalHeaderLabels(QStringList() << "Unit" << "Entries" << "Payload"
+                                              << "Errors (0-3)" << "Warnings (4)" << "Info (5-7)");
+        unitsTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+        unitsTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+        unitsTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+
+        int row = 0;
+        for (auto it = report.units.constBegin(); it != report.units.constEnd(); ++it, ++row) {
+            const LogVolume &volume = it.value();
+            const quint64 errors = volume.priorities[0] + volume.priorities[1] + volume.priorities[2] + volume.priorities[3];
+            const quint64 info = volume.priorities[5] + volume.priorities[6] + volume.priorities[7];
+            QTableWidgetItem *unitItem = new QTableWidgetItem(it.key().isEmpty() ? "(no unit)" : it.key());
+            unitItem->setData(Qt::UserRole, it.key());
+            unitsTable->setItem(row, 0, unitItem);
+            unitsTable->setItem(row, 1, new CountTableItem(volume.entries));
+            unitsTable->setItem(row, 2, new SizeTableItem(qint64(volume.bytes)));
+            unitsTable->setItem(row, 3, new CountTableItem(errors));
+            unitsTable->setItem(row, 4, new CountTableItem(volume.priorities[4]));
+            unitsTable->setItem(row, 5, new CountTableItem(info));
+        }
+        unitsTable->setSortingEnabled(true);
+        unitsTable->sortItems(2, Qt::DescendingOrder);
+        connect(unitsTable, &QTableWidget::itemDoubleClicked, this, [this, unitsTable](QTableWidgetItem *item) {
+            const QString unit = unitsTable->item(item->row(), 0)->data(Qt::UserRole).toString();
+            if (!unit.isEmpty() && unit != "kernel") {
+                emit serviceRequested(unit);
+            }
+        });
+
+        QTableWidget *hoursTable = new QTableWidget(report.hours.size(), 3, this);
+        hoursTable->setHorizontalHeaderLabels(QStringList() << "Hour" << "Entries" << "Payload");
+        hoursTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+        hoursTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+
+        row = 0;
+        for (auto it = report.hours.constBegin(); it != report.hours.constEnd(); ++it, ++row) {
+            hoursTable->setItem(row, 0, new QTableWidgetItem(
+                QDateTime::fromSecsSinceEpoch(it.key()).toString("yyyy-MM-dd HH:00")));
+            hoursTable->setItem(row, 1, new CountTableItem(it->entries));
+            hoursTable->setItem(row, 2, new SizeTableItem(qint64(it->bytes)));
+        }
+        hoursTable->setSortingEnabled(true);
+        hoursTable->sortItems(0, Qt::DescendingOrder);
+
+        QHBoxLayout *tablesLayout = new QHBoxLayout();
+        tablesLayout->addWidget(unitsTable, 3);
+        tablesLayout->addWidget(hoursTable, 2);
+        mainLayout->addLayout(tablesLayout);
+
+        if (!report.errors.isEmpty()) {
+            QLabel *errorLabel = new QLabel(QString("%1 files could not be read completely").arg(report.errors.size()), this);
+            errorLabel->setToolTip(report.errors.join("\n"));
+            mainLayout->addWidget(errorLabel);
+        }
+    }
+
+signals:
+    void serviceRequested(const QString &unit);
+};
+
+class RotationPolicyDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    RotationPolicyDialog(QWidget *parent = nullptr) : QDialog(parent)
+    {
+        setWindowTitle("Log Rotation Policy");
+        resize(950, 600);
+
+        QVBoxLayout *mainLayout = new QVBoxLayout(this);
+        mainLayout->addWidget(new QLabel("The first rule whose pattern matches a log's full path applies. "
+                                         "Auto uses copytruncate for logs some process holds open.", this));
+
+        m_rulesTable = new QTableWidget(0, 6, this);
+        m_rulesTable->setHorizontalHeaderLabels(QStringList() << "Pattern" << "Max Size" << "Max Age"
+                                                << "Keep" << "Method" << "Compress");
+        m_rulesTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+        m_rulesTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+        mainLayout->addWidget(m_rulesTable);
+
+        QHBoxLayout *ruleButtons = new QHBoxLayout();
+        QPushButton *addButton = new QPushButton("Add Rule", this);
+        QPushButton *removeButton = new QPushButton("Remove Rule", this);
+        connect(addButton, &QPushButton::clicked, this, [this]() {
+            RotationRule rule;
+            rule.pattern = LogScanner::defaultRoot() + "/*.log";
+            addRule(rule);
+        });
+        connect(removeButton, &QPushButton::clicked, this, [this]() {
+            m_rulesTable->removeRow(m_rulesTable->currentRow());
+        });
+        m_automaticCheck = new QCheckBox("Rotate automatically every hour", this);
+        ruleButtons->addWidget(addButton);
+        ruleButtons->addWidget(removeButton);
+        ruleButtons->addStretch();
+        ruleButtons->addWidget(m_automaticCheck);
+        mainLayout->addLayout(ruleButtons);
+
+        m_previewText = new QPlainTextEdit(this);
+        m_previewText->setReadOnly(true);
+        m_previewText->setLineWrapMode(QPlainTextEdit::NoWrap);
+        m_previewText->setPlaceholderText("Preview shows what a rotation pass would do without touching any file.");
+        mainLayout->addWidget(m_previewText);
+
+        QHBoxLayout *buttons = new QHBoxLayout();
+        m_previewButton = new QPushButton("Preview", this);
+        m_rotateButton = new QPushButton("Rotate Now", this);
+        QPushButton *saveButton = new QPushButton("Save", this);
+        QPushButton *closeButton = new QPushButton("Close", this);
+        connect(m_previewButton, &QPushButton::clicked, this, &RotationPolicyDialog::preview);
+        connect(m_rotateButton, &QPushButton::clicked, this, &RotationPolicyDialog::rotateNow);
+        connect(saveButton, &QPushButton::clicked, this, &RotationPolicyDialog::save);
+        connect(closeButton, &QPushButton::clicked, this, &QDialog::reject);
+        m_statusLabel = new QLabel(this);
+        buttons->addWidget(m_statusLabel, 1);
+        buttons->addWidget(m_previewButton);
+        buttons->addWidget(m_rotateButton);
+        buttons->addWidget(saveButton);
+        buttons->addWidget(closeButton);
+        mainLayout->addLayout(buttons);
+
+        m_planWatcher = new QFutureWatcher<QVector<RotationTask>>(this);
+        connect(m_planWatcher, &QFutureWatcher<QVector<RotationTask>>::finished,
+                this, &RotationPolicyDialog::onPlanReady);
+        m_rotateWatcher = new QFutureWatcher<RotationReport>(this);
+        connect(m_rotateWatcher, &QFutureWatcher<RotationReport>::finished,
+                this, &RotationPolicyDialog::onRotationFinished);
+
+        const RotationPolicy policy = RotationPolicy::load();
+        m_automaticCheck->setChecked(policy.automatic);
+        for (const RotationRule &rule : policy.rules) {
+            addRule(rule);
+        }
+    }
+
+    RotationPolicy currentPolicy() const
+    {
+        RotationPolicy policy;
+        policy.automatic = m_automaticCheck->isChecked();
+        for (int row = 0; row < m_rulesTable->rowCount(); ++row) {
+            RotationRule rule;
+            rule.pattern = m_rulesTable->item(row, 0)->text().trimmed();
+            if (rule.pattern.isEmpty()) {
+                continue;
+            }
+            const int sizeMiB = static_cast<QSpinBox *>(m_rulesTable->cellWidget(row, 1))->value();
+            const int ageDays = static_cast<QSpinBox *>(m_rulesTable->cellWidget(row, 2))->value();
+            rule.maxSize = sizeMiB > 0 ? qint64(sizeMiB) * 1024 * 1024 : -1;
+            rule.maxAgeDays = ageDays > 0 ? ageDays : -1;
+            rule.keep = static_cast<QSpinBox *>(m_rulesTable->cellWidget(row, 3))->value();
+            rule.method = RotationMethod(static_cast<QComboBox *>(m_rulesTable->cellWidget(row, 4))->currentData().toInt());
+            const int codec = static_cast<QComboBox *>(m_rulesTable->cellWidget(row, 5))->currentData().toInt();
+            rule.compress = codec >= 0;
+            rule.codec = codec >= 0 ? CompressionCodec(codec) : CompressionCodec::Zstd;
+            policy.rules.append(rule);
+        }
+        return policy;
+    }
+
+signals:
+    void logsRotated();
+
+private slots:
+    void preview()
+    {
+        const RotationPolicy policy = currentPolicy();
+        setBusy(true, "Planning...");
+        m_planWatcher->setFuture(TaskScheduler::instance().run(TaskPriority::Interactive, QString(), [policy]() {
+            return LogRotator::plan(policy, LogScanner::scan(), LogRotator::openFiles(),
+                                    QDateTime::currentSecsSinceEpoch());
+        }));
+    }
+
+    void onPlanReady()
+    {
+        const QVector<RotationTask> tasks = m_planWatcher->result();
+        QStringList lines;
+        qint64 bytes = 0;
+        for (const RotationTask &task : tasks) {
+            lines << LogRotator::describe(task);
+            bytes += task.size;
+        }
+        m_previewText->setPlainText(tasks.isEmpty() ? "Nothing to rotate." : lines.join("\n"));
+        setBusy(false, QString("%1 logs (%2) would be rotated")
+            .arg(tasks.size()).arg(QLocale().formattedDataSize(bytes)));
+    }
+
+    void rotateNow()
+    {
+        QMessageBox::StandardButton reply = QMessageBox::question(this, "Rotate Logs",
+            "Rotate every log the current rules select now?", QMessageBox::Yes | QMessageBox::No);
+        if (reply != QMessageBox::Yes) {
+            return;
+        }
+
+        const RotationPolicy policy = currentPolicy();
+        setBusy(true, "Rotating...");
+        m_rotateWatcher->setFuture(TaskScheduler::instance().run(TaskPriority::Interactive, QString(), [policy]() {
+            return PrivilegedHelper::instance().rotateLogs(policy);
+        }));
+    }
+
+    void onRotationFinished()
+    {
+        const RotationReport report = m_rotateWatcher->result();
+        m_previewText->setPlainText(report.errors.join("\n"));
+        setBusy(false, QString("Rotated %1 logs (%2), compressed %3, deleted %4 old rotations in %5 ms")
+            .arg(report.rotated).arg(QLocale().formattedDataSize(report.bytesRotated))
+            .arg(report.compressed).arg(report.deleted).arg(report.elapsedMs));
+        emit logsRotated();
+    }
+
+    void save()
+    {
+        QString error;
+        if (currentPolicy().save(RotationPolicy::defaultPath(), &error)) {
+            m_statusLabel->setText("Saved");
+        } else {
+            QMessageBox::critical(this, "Error", QString("Failed to save the rotation policy.\n%1").arg(error));
+        }
+    }
+
+    void reject() override
+    {
+        m_planWatcher->waitForFinished();
+        m_rotateWatcher->waitForFinished();
+        QDialog::reject();
+    }
+
+private:
+    void addRule(const RotationRule &rule)
+    {
+        const int row = m_rulesTable->rowCount();
+        m_rulesTable->insertRow(row);
+        m_rulesTable->setItem(row, 0, new QTableWidgetItem(rule.pattern));
+
+        QSpinBox *sizeSpin = new QSpinBox(this);
+        sizeSpin->setRange(0, 1024 * 1024);
+        sizeSpin->setSuffix(" MiB");
+        sizeSpin->setSpecialValueText("Off");
+        sizeSpin->setValue(rule.maxSize > 0 ? int(rule.maxSize / (1024 * 1024)) : 0);
+        m_rulesTable->setCellWidget(row, 1, sizeSpin);
+
+        QSpinBox *ageSpin = new QSpinBox(this);
+        ageSpin->setRange(0, 3650);
+        ageSpin->setSuffix(" days");
+        ageSpin->setSpecialValueText("Off");
+        ageSpin->setValue(qMax(0, rule.maxAgeDays));
+        m_rulesTable->setCellWidget(row, 2, ageSpin);
+
+        QSpinBox *keepSpin = new QSpinBox(this);
+        keepSpin->setRange(1, 365);
+        keepSpin->setValue(rule.keep);
+        m_rulesTable->setCellWidget(row, 3, keepSpin);
+
+        QComboBox *methodCombo = new QComboBox(this);
+        for (RotationMethod method : { RotationMethod::Auto, RotationMethod::Rename, RotationMethod::CopyTruncate }) {
+            methodCombo->addItem(LogRotator::methodName(method), int(method));
+        }
+        methodCombo->setCurrentIndex(methodCombo->findData(int(rule.method)));
+        m_rulesTable->setCellWidget(row, 4, methodCombo);
+
+        QComboBox *compressCombo = new QComboBox(this);
+        compressCombo->addItem("None", -1);
+        compressCombo->addItem("gzip", int(CompressionCodec::Gzip));
+        compressCombo->addItem("zstd", int(CompressionCodec::Zstd));
+        compressCombo->setCurrentIndex(compressCombo->findData(rule.compress ? int(rule.codec) : -1));
+        m_rulesTable->setCellWidget(row, 5, compressCombo);
+    }
+
+    void setBusy(bool busy, const QString &status)
+    {
+        m_previewButton->setEnabled(!busy);
+        m_rotateButton->setEnabled(!busy);
+        m_statusLabel->setText(status);
+    }
+
+    QTableWidget *m_rulesTable;
+    QCheckBox *m_automaticCheck;
+    QPlainTextEdit *m_previewText;
+    QPushButton *m_previewButton;
+    QPushButton *m_rotateButton;
+    QLabel *m_statusLabel;
+    QFutureWatcher<QVector<RotationTask>> *m_planWatcher;
+    QFutureWatcher<RotationReport> *m_rotateWatcher;
+};
+
+class SystemLogsWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    SystemLogsWidget(QWidget *parent = nullptr) : QWidget(parent)
+    {
+        QVBoxLayout *mainLayout = new QVBoxLayout(this);
+
+        QLabel *infoLabel = new QLabel("This tab helps you manage system logs.\nYou can view, compress, or remove old log files to save disk space.", this);
+        mainLayout->addWidget(infoLabel);
         
-        m_statusLabel->setText(QString("Selecting logs older than %1 %2...").arg(age).arg(unit.toLower()));
+        m_logsTable = new QTableWidget(0, 5, this);
+        m_logsTable->setHorizontalHeaderLabels(QStringList() << "Log File" << "Size" << "Last Modified"
+                                               << "Growth / Hour" << "Full In");
+        m_logsTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+        m_logsTable->setSelectionMode(QAbstractItemView::MultiSelection);
+        m_logsTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+        m_logsTable->setMinimumHeight(200);
+        mainLayout->addWidget(m_logsTable);
         
-        QProcess *process = new QProcess(this);
-        connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            [=](int exitCode, QProcess::ExitStatus exitStatus) {
-                if (exitCode == 0) {
-                    QString output = process->readAllStandardOutput();
-                    QStringList oldFiles = output.split('\n', Qt::SkipEmptyParts);
-                    
-                    m_logsTable->clearSelection();
-                    
-                    int selectedCount = 0;
-                    for (int row = 0; row < m_logsTable->rowCount(); row++) {
-                        QTableWidgetItem *item = m_logsTable->item(row, 0);
-                        if (item) {
-                            QString filePath = item->data(Qt::UserRole).toString();
-                            if (oldFiles.contains(filePath)) {
-                                m_logsTable->selectRow(row);
-                                selectedCount++;
-                            }
-                        }
+        QGroupBox *actionsGroupBox = new QGroupBox("Log Management Actions", this);
+        QVBoxLayout *actionsLayout = new QVBoxLayout(actionsGroupBox);
+        
+        QHBoxLayout *ageLayout = new QHBoxLayout();
+        QLabel *ageLabel = new QLabel("Process logs older than:", this);
+        m_ageSpinBox = new QSpinBox(this);
+        m_ageSpinBox->setMinimum(1);
+        m_ageSpinBox->setMaximum(365);
+        m_ageSpinBox->setValue(30);
+        m_ageUnitCombo = new QComboBox(this);
+        m_ageUnitCombo->addItems(QStringList() << "Days" << "Weeks" << "Months");
+        ageLayout->addWidget(ageLabel);
+        ageLayout->addWidget(m_ageSpinBox);
+        ageLayout->addWidget(m_ageUnitCombo);
+        ageLayout->addStretch();
+        actionsLayout->addLayout(ageLayout);
+        
+        QButtonGroup *actionGroup = new QButtonGroup(this);
+        
+        m_compressLogsRadio = new QRadioButton("Compress selected logs", this);
+        m_removeLogsRadio = new QRadioButton("Remove selected logs", this);
+        m_archiveLogsRadio = new QRadioButton("Archive selected logs into one seekable zstd file", this);
+        m_compressLogsRadio->setChecked(true);
+        
+        actionGroup->addButton(m_compressLogsRadio);
+        actionGroup->addButton(m_removeLogsRadio);
+        actionGroup->addButton(m_archiveLogsRadio);
+        
+        QHBoxLayout *codecLayout = new QHBoxLayout();
+        QLabel *codecLabel = new QLabel("Compression format:", this);
+        m_codecCombo = new QComboBox(this);
+        m_codecCombo->addItem("gzip (.gz)", int(CompressionCodec::Gzip));
+        m_codecCombo->addItem("zstd (.zst)", int(CompressionCodec::Zstd));
+        codecLayout->addWidget(m_compressLogsRadio);
+        codecLayout->addWidget(codecLabel);
+        codecLayout->addWidget(m_codecCombo);
+        codecLayout->addStretch();
+        connect(m_compressLogsRadio, &QRadioButton::toggled, m_codecCombo, &QComboBox::setEnabled);
+        
+        actionsLayout->addLayout(codecLayout);
+        actionsLayout->addWidget(m_removeLogsRadio);
+        actionsLayout->addWidget(m_archiveLogsRadio);
+        
+        mainLayout->addWidget(actionsGroupBox);
+        
+        QGroupBox *journalGroupBox = new QGroupBox("systemd Journal", this);
+        QVBoxLayout *journalLayout = new QVBoxLayout(journalGroupBox);
+        
+        QHBoxLayout *journalTablesLayout = new QHBoxLayout();
+        m_journalTable = new QTableWidget(0, 6, this);
+        m_journalTable->setHorizontalHeaderLabels(QStringList() << "Journal File" << "Last Boot" << "Size"
+                                                  << "First Entry" << "Last Entry" << "State");
+        m_journalTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+        m_journalTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+        m_journalTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+        m_journalTable->setSortingEnabled(true);
+        
+        m_bootTable = new QTableWidget(0, 4, this);
+        m_bootTable->setHorizontalHeaderLabels(QStringList() << "Boot ID" << "Files" << "Size" << "Last Entry");
+        m_bootTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+        m_bootTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+        m_bootTable->setSortingEnabled(true);
+        
+        journalTablesLayout->addWidget(m_journalTable, 3);
+        journalTablesLayout->addWidget(m_bootTable, 2);
+        journalLayout->addLayout(journalTablesLayout);
+        
+        QHBoxLayout *vacuumLayout = new QHBoxLayout();
+        m_vacuumSizeCheck = new QCheckBox("Keep at most", this);
+        m_vacuumSizeSpin = new QSpinBox(this);
+        m_vacuumSizeSpin->setRange(16, 1024 * 1024);
+        m_vacuumSizeSpin->setValue(512);
+        m_vacuumSizeSpin->setSuffix(" MiB");
+        m_vacuumAgeCheck = new QCheckBox("Remove files older than", this);
+        m_vacuumAgeSpin = new QSpinBox(this);
+        m_vacuumAgeSpin->setRange(1, 3650);
+        m_vacuumAgeSpin->setValue(30);
+        m_vacuumAgeSpin->setSuffix(" days");
+        m_vacuumSizeCheck->setChecked(true);
+        m_vacuumButton = new QPushButton("Vacuum Journal...", this);
+        connect(m_vacuumButton, &QPushButton::clicked, this, &SystemLogsWidget::vacuumJournal);
+        
+        vacuumLayout->addWidget(m_vacuumSizeCheck);
+        vacuumLayout->addWidget(m_vacuumSizeSpin);
+        vacuumLayout->addWidget(m_vacuumAgeCheck);
+        vacuumLayout->addWidget(m_vacuumAgeSpin);
+        vacuumLayout->addStretch();
+        m_volumeButton = new QPushButton("Volume by Unit...", this);
+        connect(m_volumeButton, &QPushButton::clicked, this, &SystemLogsWidget::analyzeJournalVolume);
+        vacuumLayout->addWidget(m_volumeButton);
+        vacuumLayout->addWidget(m_vacuumButton);
+        journalLayout->addLayout(vacuumLayout);
+        
+        m_journalSummaryLabel = new QLabel(this);
+        journalLayout->addWidget(m_journalSummaryLabel);
+        
+        mainLayout->addWidget(journalGroupBox);
+        
+        QHBoxLayout *buttonLayout = new QHBoxLayout();
+        
+        m_refreshLogsButton = new QPushButton("Refresh Logs List", this);
+        connect(m_refreshLogsButton, &QPushButton::clicked, this, &SystemLogsWidget::refreshLogsList);
+        
+        m_selectOldLogsButton = new QPushButton("Select Old Logs", this);
+        connect(m_selectOldLogsButton, &QPushButton::clicked, this, &SystemLogsWidget::selectOldLogs);
+        
+        m_processLogsButton = new QPushButton("Process Selected Logs", this);
+        connect(m_processLogsButton, &QPushButton::clicked, this, &SystemLogsWidget::processLogs);
+        m_processLogsButton->setEnabled(false);
+        
+        m_viewLogButton = new QPushButton("View Log", this);
+        connect(m_viewLogButton, &QPushButton::clicked, this, &SystemLogsWidget::viewSelectedLog);
+        m_viewLogButton->setEnabled(false);
+        connect(m_logsTable, &QTableWidget::itemDoubleClicked, this, &SystemLogsWidget::viewSelectedLog);
+        
+        QPushButton *rotationButton = new QPushButton("Rotation Policy...", this);
+        connect(rotationButton, &QPushButton::clicked, this, &SystemLogsWidget::editRotationPolicy);
+        
+        QPushButton *queryArchiveButton = new QPushButton("Query Archive...", this);
+        connect(queryArchiveButton, &QPushButton::clicked, this, &SystemLogsWidget::queryArchive);
+        
+        buttonLayout->addWidget(m_refreshLogsButton);
+        buttonLayout->addWidget(m_selectOldLogsButton);
+        buttonLayout->addWidget(m_processLogsButton);
+        buttonLayout->addWidget(m_viewLogButton);
+        buttonLayout->addWidget(rotationButton);
+        buttonLayout->addWidget(queryArchiveButton);
+        
+        mainLayout->addLayout(buttonLayout);
+        
+        m_statusLabel = new QLabel("Ready", this);
+        mainLayout->addWidget(m_statusLabel);
+        
+        connect(m_logsTable, &QTableWidget::itemSelectionChanged, this, &SystemLogsWidget::updateButtonState);
+        
+        m_scanWatcher = new QFutureWatcher<QVector<LogFileInfo>>(this);
+        connect(m_scanWatcher, &QFutureWatcher<QVector<LogFileInfo>>::finished,
+                this, &SystemLogsWidget::onLogsScanned);
+        
+        m_compressWatcher = new QFutureWatcher<CompressionResult>(this);
+        connect(m_compressWatcher, &QFutureWatcher<CompressionResult>::resultReadyAt,
+                this, &SystemLogsWidget::onLogCompressed);
+        connect(m_compressWatcher, &QFutureWatcher<CompressionResult>::finished,
+                this, &SystemLogsWidget::onLogCompressionFinished);
+        
+        m_journalWatcher = new QFutureWatcher<QVector<JournalFileInfo>>(this);
+        connect(m_journalWatcher, &QFutureWatcher<QVector<JournalFileInfo>>::finished,
+                this, &SystemLogsWidget::onJournalScanned);
+        
+        m_volumeWatcher = new QFutureWatcher<JournalVolumeReport>(this);
+        connect(m_volumeWatcher, &QFutureWatcher<JournalVolumeReport>::progressValueChanged, this, [this](int value) {
+            m_journalSummaryLabel->setText(QString("Reading journal files... %1 of %2")
+                .arg(value).arg(m_volumeWatcher->progressMaximum()));
+        });
+        connect(m_volumeWatcher, &QFutureWatcher<JournalVolumeReport>::finished,
+                this, &SystemLogsWidget::onJournalVolumeReady);
+        
+        m_archiveWatcher = new QFutureWatcher<ArchiveReport>(this);
+        connect(m_archiveWatcher, &QFutureWatcher<ArchiveReport>::finished,
+                this, &SystemLogsWidget::onLogsArchived);
+        
+        QString growthError;
+        if (!m_growthTracker.open(LogGrowthTracker::defaultPath(), &growthError)) {
+            m_logsTable->horizontalHeaderItem(3)->setToolTip(growthError);
+        }
+        m_growthWatcher = new QFutureWatcher<void>(this);
+        connect(m_growthWatcher, &QFutureWatcher<void>::finished, this, &SystemLogsWidget::updateGrowthColumns);
+        
+        m_growthTimer = new QTimer(this);
+        m_growthTimer->setInterval(60 * 1000);
+        connect(m_growthTimer, &QTimer::timeout, this, &SystemLogsWidget::sampleLogSizes);
+        m_growthTimer->start();
+        
+        m_rotationWatcher = new QFutureWatcher<RotationReport>(this);
+        connect(m_rotationWatcher, &QFutureWatcher<RotationReport>::finished,
+                this, &SystemLogsWidget::onScheduledRotationFinished);
+        
+        m_rotationTimer = new QTimer(this);
+        m_rotationTimer->setInterval(60 * 60 * 1000);
+        connect(m_rotationTimer, &QTimer::timeout, this, &SystemLogsWidget::runScheduledRotation);
+        m_rotationTimer->start();
+    }
+
+    ~SystemLogsWidget() override
+    {
+        // The sampler writes through m_growthTracker.
+        m_growthWatcher->waitForFinished();
+        m_rotationWatcher->waitForFinished();
+    }
+
+signals:
+    void serviceRequested(const QString &unit);
+    void logVolumesChanged(const QHash<QString, quint64> &bytesPerUnit);
+
+public slots:
+    void refreshLogsList()
+    {
+        if (m_scanWatcher->isRunning()) {
+            return;
+        }
+        
+        m_statusLabel->setText("Refreshing logs list...");
+        m_refreshLogsButton->setEnabled(false);
+        m_selectOldLogsButton->setEnabled(false);
+        m_processLogsButton->setEnabled(false);
+
+        m_scanTimer.start();
+        FileMetadataCache::instance().invalidate(LogScanner::defaultRoot());
+        m_scanWatcher->setFuture(TaskScheduler::instance().run(TaskPriority::Normal, "log-scan", []() {
+            const QVector<LogFileInfo> logs = LogScanner::scan();
+            FileMetadataCache::instance().insert(logs);
+            ResultCache::store("log-scan", logs);
+            return logs;
+        }));
+        refreshJournal();
+    }
+
+    void sampleLogSizes()
+    {
+        if (!m_growthTracker.isOpen() || m_growthWatcher->isRunning() || m_growthPaths.isEmpty()) {
+            return;
+        }
+        LogGrowthTracker *tracker = &m_growthTracker;
+        const QStringList paths = m_growthPaths;
+        m_growthWatcher->setFuture(TaskScheduler::instance().run(TaskPriority::Background, "log-growth", [tracker, paths]() {
+            tracker->record(paths, QDateTime::currentSecsSinceEpoch());
+        }));
+    }
+
+    void updateGrowthColumns()
+    {
+        // Free space is looked up once per filesystem, not per log.
+        QHash<quint64, qint64> freeBytes;
+        auto available = [&freeBytes](quint64 device, const QString &path) {
+            auto it = freeBytes.constFind(device);
+            if (it != freeBytes.constEnd()) {
+                return it.value();
+            }
+            struct statvfs st;
+            qint64 bytes = ::statvfs(QFile::encodeName(QFileInfo(path).absolutePath()).constData(), &st) == 0
+                ? qint64(st.f_bavail) * qint64(st.f_frsize) : -1;
+            freeBytes.insert(device, bytes);
+            return bytes;
+        };
+        
+        const bool sorting = m_logsTable->isSortingEnabled();
+        m_logsTable->setSortingEnabled(false);
+        for (int row = 0; row < m_logsTable->rowCount(); row++) {
+            QTableWidgetItem *fileItem = m_logsTable->item(row, 0);
+            if (!fileItem) {
+                continue;
+            }
+            const QString path = fileItem->data(Qt::UserRole).toString();
+            const GrowthEstimate growth = m_growthTracker.estimate(path);
+            
+            QTableWidgetItem *rateItem = new QTableWidgetItem("-");
+            QTableWidgetItem *fullItem = new QTableWidgetItem("-");
+            rateItem->setData(Qt::UserRole, 0.0);
+            if (growth.isValid()) {
+                rateItem->setText(QString("%1/h").arg(QLocale().formattedDataSize(qint64(growth.bytesPerHour))));
+                rateItem->setData(Qt::UserRole, growth.bytesPerHour);
+                rateItem->setToolTip(QString("Fitted over %1 samples spanning %2 h")
+                    .arg(growth.samples).arg(growth.spanSecs / 3600.0, 0, 'f', 1));
+                
+                const qint64 free = available(m_growthDevices.value(path), path);
+                if (growth.bytesPerHour > 0 && free >= 0) {
+                    const double hours = free / growth.bytesPerHour;
+                    fullItem->setText(hours < 48 ? QString("%1 h").arg(hours, 0, 'f', 1)
+                                                 : QString("%1 days").arg(hours / 24, 0, 'f', 0));
+                    fullItem->setToolTip("If this log alone keeps growing at its current rate");
+                    if (hours < 24 * 7) {
+                        fullItem->setBackground(QColor(255, 200, 200));
                     }
-                    
-                    m_statusLabel->setText(QString("Selected %1 log files older than %2 %3")
-                        .arg(selectedCount).arg(age).arg(unit.toLower()));
-                } else {
-                    m_statusLabel->setText("Failed to select old logs");
                 }
+            }
+            m_logsTable->setItem(row, 3, rateItem);
+            m_logsTable->setItem(row, 4, fullItem);
+        }
+        m_logsTable->setSortingEnabled(sorting);
+    }
+
+    void refreshJournal()
+    {
+        if (m_journalWatcher->isRunning()) {
+            return;
+        }
+        m_vacuumButton->setEnabled(false);
+        m_journalSummaryLabel->setText("Reading journal headers...");
+        m_journalWatcher->setFuture(TaskScheduler::instance().run(TaskPriority::Normal, "journal-scan", []() {
+            return JournalFiles::scan();
+        }));
+    }
+
+    void onJournalScanned()
+    {
+        m_journalFiles = m_journalWatcher->result();
+        
+        struct BootUsage
+        {
+            int files = 0;
+            qint64 bytes = 0;
+            quint64 lastEntry = 0;
+        };
+        QHash<QString, BootUsage> boots;
+        qint64 totalBytes = 0;
+        qint64 archivedBytes = 0;
+        
+        auto formatRealtime = [](quint64 usec) {
+            return usec == 0 ? QString("-")
+                             : QDateTime::fromMSecsSinceEpoch(qint64(usec / 1000)).toString("yyyy-MM-dd HH:mm");
+        };
+        
+        m_journalTable->setSortingEnabled(false);
+        m_journalTable->setRowCount(m_journalFiles.size());
+        for (int row = 0; row < m_journalFiles.size(); row++) {
+            const JournalFileInfo &file = m_journalFiles[row];
+            QTableWidgetItem *headItem = new QTableWidgetItem(formatRealtime(file.headRealtime));
+            QTableWidgetItem *tailItem = new QTableWidgetItem(formatRealtime(file.tailRealtime));
+            headItem->setData(Qt::UserRole, file.headRealtime);
+            tailItem->setData(Qt::UserRole, file.tailRealtime);
+            
+            m_journalTable->setItem(row, 0, new QTableWidgetItem(QFileInfo(file.path).fileName()));
+            m_journalTable->setItem(row, 1, new QTableWidgetItem(file.bootId.left(12)));
+            m_journalTable->setItem(row, 2, new SizeTableItem(file.diskUsage));
+            m_journalTable->setItem(row, 3, headItem);
+            m_journalTable->setItem(row, 4, tailItem);
+            m_journalTable->setItem(row, 5, new QTableWidgetItem(
+                file.error.isEmpty() ? JournalFiles::stateName(file.state) : file.error));
+            m_journalTable->item(row, 0)->setToolTip(file.path);
+            
+            totalBytes += file.diskUsage;
+            if (file.archived) {
+                archivedBytes += file.diskUsage;
+            }
+            if (!file.bootId.isEmpty()) {
+                BootUsage &boot = boots[file.bootId];
+                boot.files++;
+                boot.bytes += file.diskUsage;
+                boot.lastEntry = qMax(boot.lastEntry, file.tailRealtime);
+            }
+        }
+        m_journalTable->setSortingEnabled(true);
+        
+        m_bootTable->setSortingEnabled(false);
+        m_bootTable->setRowCount(boots.size());
+        int row = 0;
+        for (auto it = boots.constBegin(); it != boots.constEnd(); ++it, ++row) {
+            QTableWidgetItem *lastItem = new QTableWidgetItem(formatRealtime(it->lastEntry));
+            lastItem->setData(Qt::UserRole, it->lastEntry);
+            m_bootTable->setItem(row, 0, new QTableWidgetItem(it.key()));
+            m_bootTable->setItem(row, 1, new QTableWidgetItem(QString::number(it->files)));
+            m_bootTable->setItem(row, 2, new SizeTableItem(it->bytes));
+            m_bootTable->setItem(row, 3, lastItem);
+        }
+        m_bootTable->setSortingEnabled(true);
+        m_bootTable->sortItems(3, Qt::DescendingOrder);
+        
+        // A file is counted under the boot of its last entry.
+        m_journalSummaryLabel->setText(QString("Journal uses %1 in %2 files across %3 boots; %4 is in archived files")
+            .arg(QLocale().formattedDataSize(totalBytes))
+            .arg(m_journalFiles.size())
+            .arg(boots.size())
+            .arg(QLocale().formattedDataSize(archivedBytes)));
+        m_vacuumButton->setEnabled(archivedBytes > 0);
+        m_volumeButton->setEnabled(!m_journalFiles.isEmpty());
+    }
+
+    void analyzeJournalVolume()
+    {
+        if (m_volumeWatcher->isRunning()) {
+            return;
+        }
+        QStringList paths;
+        for (const JournalFileInfo &file : qAsConst(m_journalFiles)) {
+            paths << file.path;
+        }
+        
+        m_volumeButton->setEnabled(false);
+        m_volumeTimer.start();
+        // Ordered with the rest of the background work; the map inside
+        // still spreads the files over the pool.
+        m_volumeWatcher->setFuture(TaskScheduler::instance().run(TaskPriority::Background, "journal-volume", [paths]() {
+            return QtConcurrent::blockingMappedReduced<JournalVolumeReport>(paths, JournalVolumeAnalyzer::analyzeFile,
+                                                                            JournalVolumeAnalyzer::merge);
+        }));
+    }
+
+    void onJournalVolumeReady()
+    {
+        m_volumeButton->setEnabled(true);
+        const JournalVolumeReport report = m_volumeWatcher->result();
+        m_journalSummaryLabel->setText(QString("Attributed %1 journal entries to %2 units in %3 ms")
+            .arg(report.total.entries).arg(report.units.size()).arg(m_volumeTimer.elapsed()));
+        
+        QHash<QString, quint64> bytesPerUnit;
+        for (auto it = report.units.constBegin(); it != report.units.constEnd(); ++it) {
+            bytesPerUnit.insert(it.key(), it->bytes);
+        }
+        emit logVolumesChanged(bytesPerUnit);
+        
+        JournalVolumeDialog *dialog = new JournalVolumeDialog(report, this);
+        connect(dialog, &JournalVolumeDialog::serviceRequested, this, &SystemLogsWidget::serviceRequested);
+        dialog->show();
+    }
+
+    void vacuumJournal()
+    {
+        const qint64 maxBytes = m_vacuumSizeCheck->isChecked() ? qint64(m_vacuumSizeSpin->value()) * 1024 * 1024 : -1;
+        const qint64 maxAge = m_vacuumAgeCheck->isChecked() ? qint64(m_vacuumAgeSpin->value()) * 86400 : -1;
+        const QVector<JournalFileInfo> plan = JournalFiles::planVacuum(
+            m_journalFiles, maxBytes, maxAge, QDateTime::currentSecsSinceEpoch());
+        
+        if (plan.isEmpty()) {
+            QMessageBox::information(this, "Vacuum Journal", "No archived journal files match these limits.");
+            return;
+        }
+        
+        qint64 bytes = 0;
+        QStringList details;
+        for (const JournalFileInfo &file : plan) {
+            bytes += file.diskUsage;
+            details << QString("%1 (%2)").arg(file.path, QLocale().formattedDataSize(file.diskUsage));
+        }
+        
+        QMessageBox box(QMessageBox::Question, "Vacuum Journal",
+            QString("Delete %1 archived journal files and free %2?")
+                .arg(plan.size()).arg(QLocale().formattedDataSize(bytes)),
+            QMessageBox::Yes | QMessageBox::No, this);
+        box.setDetailedText(details.join("\n"));
+        if (box.exec() != QMessageBox::Yes) {
+            return;
+        }
+        
+        QStringList paths;
+        for (const JournalFileInfo &file : plan) {
+            paths << file.path;
+        }
+        m_statusLabel->setText("Vacuuming the journal...");
+        m_vacuumButton->setEnabled(false);
+        
+        QFutureWatcher<QPair<QStringList, qint64>> *watcher = new QFutureWatcher<QPair<QStringList, qint64>>(this);
+        connect(watcher, &QFutureWatcher<QPair<QStringList, qint64>>::finished, this, [=]() {
+                m_vacuumButton->setEnabled(true);
+                
+                const QStringList errors = watcher->result().first;
+                const QString summary = QString("Freed %1 from the journal")
+                    .arg(QLocale().formattedDataSize(watcher->result().second));
+                m_statusLabel->setText(summary);
+                if (!errors.isEmpty()) {
+                    QMessageBox errorBox(QMessageBox::Warning, "Vacuum Journal",
+                        QString("%1\n\n%2 files could not be removed.").arg(summary).arg(errors.size()), QMessageBox::Ok, this);
+                    errorBox.setDetailedText(errors.join("\n"));
+                    errorBox.exec();
+                }
+                refreshJournal();
                 
-                updateButtonState();
-                process->deleteLater();
+                watcher->deleteLater();
             });
         
-        process->start("bash", QStringList() << "-c" << 
-            QString("find /var/log -type f -mtime +%1 -name '*.log' -o -name '*.log.[0-9]*'").arg(days));
+        watcher->setFuture(TaskScheduler::instance().run(TaskPriority::Interactive, QString(), [paths]() {
+            qint64 freed = 0;
+            const QStringList errors = PrivilegedHelper::instance().vacuumJournal(paths, &freed);
+            return qMakePair(errors, freed);
+        }));
+    }
+
+    void onLogsScanned()
+    {
+        const QVector<LogFileInfo> logs = m_scanWatcher->result();
+        
+        m_refreshLogsButton->setEnabled(true);
+        m_selectOldLogsButton->setEnabled(true);
+        m_showingStored = false;
+        showLogs(logs);
+        
+        m_growthPaths.clear();
+        m_growthDevices.clear();
+        for (const LogFileInfo &log : logs) {
+            if (!log.compressed) {
+                m_growthPaths << log.path;
+                m_growthDevices.insert(log.path, log.device);
+            }
+        }
+        sampleLogSizes();
+        
+        m_statusLabel->setText(QString("Found %1 log files in %2 ms").arg(logs.size()).arg(m_scanTimer.elapsed()));
+        updateButtonState();
+    }
+    
+    // The previous run's scan, shown until the new one lands. Its paths may
+    // be gone by now, so the select, process and view buttons stay disabled
+    // until then, whatever is selected.
+    void showStoredLogs()
+    {
+        QVector<LogFileInfo> logs;
+        qint64 storedSecs = 0;
+        if (ResultCache::load("log-scan", &logs, &storedSecs)) {
+            m_showingStored = true;
+            showLogs(logs);
+            m_statusLabel->setText(QString("Showing %1 log files as of %2, refreshing...")
+                .arg(logs.size()).arg(QDateTime::fromSecsSinceEpoch(storedSecs).toString("yyyy-MM-dd HH:mm")));
+        }
+    }
+
+    void showLogs(const QVector<LogFileInfo> &logs)
+    {
+        m_logsTable->setUpdatesEnabled(false);
+        m_logsTable->clearContents();
+        m_logsTable->setRowCount(logs.size());
+        
+        for (int row = 0; row < logs.size(); row++) {
+            const LogFileInfo &log = logs[row];
+            QTableWidgetItem *fileItem = new QTableWidgetItem(log.path);
+            QTableWidgetItem *sizeItem = new SizeTableItem(log.size);
+            QTableWidgetItem *dateItem = new QTableWidgetItem(
+                QDateTime::fromSecsSinceEpoch(log.mtime).toString("yyyy-MM-dd HH:mm"));
+            
+            fileItem->setData(Qt::UserRole, log.path);
+            dateItem->setData(Qt::UserRole, log.mtime);
+            
+            m_logsTable->setItem(row, 0, fileItem);
+            m_logsTable->setItem(row, 1, sizeItem);
+            m_logsTable->setItem(row, 2, dateItem);
+        }
+        
+        m_logsTable->setUpdatesEnabled(true);
+    }
+    
+    void selectOldLogs()
+    {
+        int age = m_ageSpinBox->value();
+        QString unit = m_ageUnitCombo->currentText();
+        
+        int days = age;
+        if (unit == "Weeks") {
+            days = age * 7;
+        } else if (unit == "Months") {
+            days = age * 30;
+        }
+        
+        // The scan that filled the table also filled the metadata cache, so
+        // this is one hash lookup per row rather than another walk of /var/log.
+        const qint64 cutoff = QDateTime::currentSecsSinceEpoch() - qint64(days) * 24 * 3600;
+        const FileMetadataCache &metadata = FileMetadataCache::instance();
+        
+        m_logsTable->clearSelection();
+        int selectedCount = 0;
+        for (int row = 0; row < m_logsTable->rowCount(); row++) {
+            QTableWidgetItem *item = m_logsTable->item(row, 0);
+            FileMetadata entry;
+            if (item && metadata.find(item->data(Qt::UserRole).toString(), &entry) && entry.mtime < cutoff) {
+                m_logsTable->selectRow(row);
+                selectedCount++;
+            }
+        }
+        
+        m_statusLabel->setText(QString("Selected %1 log files older than %2 %3")
+            .arg(selectedCount).arg(age).arg(unit.toLower()));
+        updateButtonState();
     }
     
     void processLogs()
     {
+        if (m_showingStored) {
+            return;
+        }
         QList<QTableWidgetItem*> selectedItems = m_logsTable->selectedItems();
         QStringList selectedFiles;
         
@@ -532,7 +2064,8 @@ public slots:
         }
         
         bool compress = m_compressLogsRadio->isChecked();
-        QString operation = compress ? "compress" : "remove";
+        bool archive = m_archiveLogsRadio->isChecked();
+        QString operation = compress ? "compress" : archive ? "archive" : "remove";
         
         QMessageBox::StandardButton reply = QMessageBox::question(this, 
             QString("Confirm Log %1").arg(operation.at(0).toUpper() + operation.mid(1)),
@@ -548,58 +2081,670 @@ public slots:
         m_selectOldLogsButton->setEnabled(false);
         m_processLogsButton->setEnabled(false);
         
-        QProcess *process = new QProcess(this);
-        connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            [=](int exitCode, QProcess::ExitStatus exitStatus) {
+        if (compress) {
+            compressLogs(selectedFiles);
+            return;
+        }
+        if (archive) {
+            archiveLogs(selectedFiles);
+            return;
+        }
+        
+        QFutureWatcher<QStringList> *watcher = new QFutureWatcher<QStringList>(this);
+        connect(watcher, &QFutureWatcher<QStringList>::finished, this, [=]() {
                 m_refreshLogsButton->setEnabled(true);
                 m_selectOldLogsButton->setEnabled(true);
                 
-                if (exitCode == 0) {
+                const QStringList errors = watcher->result();
+                if (errors.isEmpty()) {
                     QString actionVerb = compress ? "compressed" : "removed";
                     m_statusLabel->setText(QString("Successfully %1 selected log files").arg(actionVerb));
                     QMessageBox::information(this, "Success", 
                         QString("Successfully %1 %2 log files").arg(actionVerb).arg(selectedFiles.size()));
                     refreshLogsList();
                 } else {
-                    QString error = process->readAllStandardError();
                     m_statusLabel->setText(QString("Failed to %1 log files").arg(operation));
                     QMessageBox::critical(this, "Error", 
-                        QString("Failed to %1 log files.\n%2").arg(operation).arg(error));
-                    updateButtonState();
+                        QString("Failed to %1 log files.\n%2").arg(operation).arg(errors.join("\n")));
+                    refreshLogsList();
                 }
                 
-                process->deleteLater();
+                watcher->deleteLater();
             });
         
-        QString script;
-        if (compress) {
-            script = "for file in " + selectedFiles.join(" ") + "; do\n"
-                     "  if [[ \"$file\" != *.gz ]]; then\n"
-                     "    gzip -f \"$file\"\n"
-                     "  fi\n"
-                     "done";
+        watcher->setFuture(TaskScheduler::instance().run(TaskPriority::Interactive, QString(), [selectedFiles]() {
+            return PrivilegedHelper::instance().removeFiles(selectedFiles);
+        }));
+    }
+
+    void compressLogs(const QStringList &files)
+    {
+        QStringList pending;
+        for (const QString &file : files) {
+            if (!file.endsWith(".gz") && !file.endsWith(".xz") && !file.endsWith(".zst")) {
+                pending << file;
+            }
+        }
+        
+        m_compressionResults.clear();
+        m_compressionTimer.start();
+        
+        PrivilegedCompressJob job;
+        job.codec = CompressionCodec(m_codecCombo->currentData().toInt());
+        m_compressWatcher->setFuture(QtConcurrent::mapped(pending, job));
+    }
+
+    void onLogCompressed(int index)
+    {
+        const CompressionResult result = m_compressWatcher->resultAt(index);
+        m_compressionResults.append(result);
+        
+        if (result.ok()) {
+            m_statusLabel->setText(QString("Compressed %1: %2 -> %3 at %4 MB/s")
+                .arg(QFileInfo(result.sourcePath).fileName())
+                .arg(QLocale().formattedDataSize(result.inputBytes))
+                .arg(QLocale().formattedDataSize(result.outputBytes))
+                .arg(result.megabytesPerSecond(), 0, 'f', 1));
+        }
+    }
+
+    void onLogCompressionFinished()
+    {
+        m_refreshLogsButton->setEnabled(true);
+        m_selectOldLogsButton->setEnabled(true);
+        
+        qint64 inputBytes = 0;
+        qint64 outputBytes = 0;
+        QStringList errors;
+        QStringList rates;
+        for (const CompressionResult &result : qAsConst(m_compressionResults)) {
+            if (!result.ok()) {
+                errors << result.error;
+                continue;
+            }
+            inputBytes += result.inputBytes;
+            outputBytes += result.outputBytes;
+            rates << QString("%1: %2 MB/s").arg(QFileInfo(result.sourcePath).fileName())
+                .arg(result.megabytesPerSecond(), 0, 'f', 1);
+        }
+        
+        double seconds = qMax<qint64>(1, m_compressionTimer.elapsed()) / 1000.0;
+        QString summary = QString("Compressed %1 log files: %2 -> %3 in %4 s (%5 MB/s overall)")
+            .arg(m_compressionResults.size() - errors.size())
+            .arg(QLocale().formattedDataSize(inputBytes))
+            .arg(QLocale().formattedDataSize(outputBytes))
+            .arg(seconds, 0, 'f', 1)
+            .arg(inputBytes / (1024.0 * 1024.0) / seconds, 0, 'f', 1);
+        m_statusLabel->setText(summary);
+        
+        if (errors.isEmpty()) {
+            QMessageBox box(QMessageBox::Information, "Success", summary, QMessageBox::Ok, this);
+            box.setDetailedText(rates.join("\n"));
+            box.exec();
         } else {
-            script = "rm -f " + selectedFiles.join(" ");
+            QMessageBox box(QMessageBox::Critical, "Error",
+                QString("%1\n\nFailed to compress %2 log files.").arg(summary).arg(errors.size()), QMessageBox::Ok, this);
+            box.setDetailedText(errors.join("\n"));
+            box.exec();
+        }
+        
+        refreshLogsList();
+    }
+    
+    void archiveLogs(const QStringList &selectedFiles)
+    {
+        // xz rotations can't be read back in-process; leave them alone.
+        QStringList files;
+        for (const QString &file : selectedFiles) {
+            if (!file.endsWith(".xz")) {
+                files << file;
+            }
+        }
+        files.sort();
+        // Not a log name, so later scans and rotations leave the archive be.
+        m_archivePath = LogScanner::defaultRoot() + "/logs-"
+            + QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss") + ".archive.zst";
+        m_archivedFiles = files;
+        m_compressionTimer.start();
+        
+        const QString archivePath = m_archivePath;
+        m_archiveWatcher->setFuture(TaskScheduler::instance().run(TaskPriority::Interactive, QString(), [archivePath, files]() {
+            ArchiveReport report = PrivilegedHelper::instance().createArchive(archivePath, files, 9);
+            if (!report.ok && report.error.isEmpty()) {
+                report.error = QString("Failed to write %1").arg(archivePath);
+            }
+            return report;
+        }));
+    }
+
+    void onLogsArchived()
+    {
+        m_refreshLogsButton->setEnabled(true);
+        m_selectOldLogsButton->setEnabled(true);
+        
+        const ArchiveReport report = m_archiveWatcher->result();
+        if (!report.ok) {
+            m_statusLabel->setText("Failed to archive log files");
+            QMessageBox::critical(this, "Error", QString("Failed to archive log files.\n%1").arg(report.error));
+            updateButtonState();
+            return;
+        }
+        
+        // The helper removed the originals that were unchanged since it read them.
+        const QStringList &errors = report.removeErrors;
+        const qint64 outputBytes = QFileInfo(m_archivePath).size();
+        QString summary = QString("Archived %1 log files into %2: %3 -> %4 in %5 s")
+            .arg(m_archivedFiles.size())
+            .arg(m_archivePath)
+            .arg(QLocale().formattedDataSize(report.bytesRemoved))
+            .arg(QLocale().formattedDataSize(outputBytes))
+            .arg(m_compressionTimer.elapsed() / 1000.0, 0, 'f', 1);
+        m_statusLabel->setText(summary);
+        
+        if (errors.isEmpty()) {
+            QMessageBox::information(this, "Success", summary);
+        } else {
+            QMessageBox box(QMessageBox::Warning, "Warning",
+                QString("%1\n\nKept %2 original files.").arg(summary).arg(errors.size()), QMessageBox::Ok, this);
+            box.setDetailedText(errors.join("\n"));
+            box.exec();
+        }
+        
+        refreshLogsList();
+    }
+
+    void queryArchive()
+    {
+        QString path = QFileDialog::getOpenFileName(this, "Open Log Archive", LogScanner::defaultRoot(),
+                                                    "Log archives (*.zst)");
+        if (path.isEmpty()) {
+            return;
+        }
+        
+        LogArchiveDialog dialog(path, this);
+        dialog.exec();
+    }
+
+    void editRotationPolicy()
+    {
+        RotationPolicyDialog dialog(this);
+        connect(&dialog, &RotationPolicyDialog::logsRotated, this, &SystemLogsWidget::refreshLogsList);
+        dialog.exec();
+    }
+
+    void runScheduledRotation()
+    {
+        if (m_rotationWatcher->isRunning()) {
+            return;
+        }
+        const RotationPolicy policy = RotationPolicy::load();
+        if (!policy.automatic || policy.rules.isEmpty()) {
+            return;
+        }
+        // A background pass never raises a polkit prompt; it only runs while
+        // an earlier operation has the helper up, or as root.
+        m_rotationWatcher->setFuture(TaskScheduler::instance().run(TaskPriority::Background, "scheduled-rotation", [policy]() {
+            if (!PrivilegedHelper::instance().isRunning()) {
+                qInfo("Scheduled log rotation skipped: the privileged helper is not running");
+                return RotationReport();
+            }
+            return PrivilegedHelper::instance().rotateLogs(policy);
+        }));
+    }
+
+    void onScheduledRotationFinished()
+    {
+        const RotationReport report = m_rotationWatcher->result();
+        if (report.rotated == 0 && report.errors.isEmpty()) {
+            return;
+        }
+        m_statusLabel->setText(QString("Scheduled rotation: %1 logs rotated, %2 old rotations deleted%3")
+            .arg(report.rotated).arg(report.deleted)
+            .arg(report.errors.isEmpty() ? QString() : QString(", %1 errors").arg(report.errors.size())));
+        m_statusLabel->setToolTip(report.errors.join("\n"));
+        refreshLogsList();
+    }
+
+    void viewSelectedLog()
+    {
+        QTableWidgetItem *item = m_logsTable->currentItem();
+        if (!item || m_showingStored) {
+            return;
+        }
+        const QString path = m_logsTable->item(item->row(), 0)->data(Qt::UserRole).toString();
+        if (path.endsWith(".gz") || path.endsWith(".xz") || path.endsWith(".zst")) {
+            QMessageBox::information(this, "View Log", "Compressed log rotations can't be viewed directly.");
+            return;
         }
         
-        process->start("pkexec", QStringList() << "bash" << "-c" << script);
+        LogViewerDialog *viewer = new LogViewerDialog(path, this);
+        viewer->show();
     }
-    
+
     void updateButtonState()
     {
-        m_processLogsButton->setEnabled(m_logsTable->selectedItems().size() > 0);
+        m_processLogsButton->setEnabled(!m_showingStored && m_logsTable->selectedItems().size() > 0);
+        m_viewLogButton->setEnabled(!m_showingStored && m_logsTable->currentItem() != nullptr);
+    }
+
+protected:
+    void showEvent(QShowEvent *event) override
+    {
+        QWidget::showEvent(event);
+        if (m_populated) {
+            return;
+        }
+        m_populated = true;
+        refreshLogsList();
+        showStoredLogs();
     }
 
 private:
+    bool m_populated = false;
+    bool m_showingStored = false;
     QTableWidget *m_logsTable;
     QLabel *m_statusLabel;
     QPushButton *m_refreshLogsButton;
     QPushButton *m_selectOldLogsButton;
     QPushButton *m_processLogsButton;
+    QPushButton *m_viewLogButton;
     QRadioButton *m_compressLogsRadio;
     QRadioButton *m_removeLogsRadio;
+    QRadioButton *m_archiveLogsRadio;
     QSpinBox *m_ageSpinBox;
     QComboBox *m_ageUnitCombo;
+    QComboBox *m_codecCombo;
+    QFutureWatcher<QVector<LogFileInfo>> *m_scanWatcher;
+    QElapsedTimer m_scanTimer;
+    QFutureWatcher<CompressionResult> *m_compressWatcher;
+    QVector<CompressionResult> m_compressionResults;
+    QElapsedTimer m_compressionTimer;
+    QTableWidget *m_journalTable;
+    QTableWidget *m_bootTable;
+    QCheckBox *m_vacuumSizeCheck;
+    QSpinBox *m_vacuumSizeSpin;
+    QCheckBox *m_vacuumAgeCheck;
+    QSpinBox *m_vacuumAgeSpin;
+    QPushButton *m_vacuumButton;
+    QLabel *m_journalSummaryLabel;
+    QFutureWatcher<QVector<JournalFileInfo>> *m_journalWatcher;
+    QVector<JournalFileInfo> m_journalFiles;
+    QPushButton *m_volumeButton;
+    QFutureWatcher<JournalVolumeReport> *m_volumeWatcher;
+    QElapsedTimer m_volumeTimer;
+    LogGrowthTracker m_growthTracker;
+    QFutureWatcher<void> *m_growthWatcher;
+    QTimer *m_growthTimer;
+    QStringList m_growthPaths;
+    QHash<QString, quint64> m_growthDevices;
+    QFutureWatcher<RotationReport> *m_rotationWatcher;
+    QTimer *m_rotationTimer;
+    QFutureWatcher<ArchiveReport> *m_archiveWatcher;
+    QString m_archivePath;
+    QStringList m_archivedFiles;
+};
+
+class BootAnalysisDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    BootAnalysisDialog(const BootAnalysis &analysis, QWidget *parent = nullptr) : QDialog(parent)
+    {
+        setAttribute(Qt::WA_DeleteOnClose);
+        setWindowTitle("Boot Impact");
+        resize(900, 600);
+
+        QVBoxLayout *mainLayout = new QVBoxLayout(this);
+        const qint64 userspaceUsec = analysis.finish > analysis.userspaceStart
+            ? qint64(analysis.finish - analysis.userspaceStart) : 0;
+        QString summary = QString("Userspace finished booting after %1; %2 units loaded (analyzed in %3 ms). "
+                                  "Double-click a unit to show it in the services list.")
+            .arg(userspaceUsec > 0 ? DurationTableItem::format(userspaceUsec) : QString("an unknown time"))
+            .arg(analysis.units.size())
+            .arg(analysis.elapsedMs);
+        if (!analysis.error.isEmpty()) {
+            summary += "\n" + analysis.error;
+        }
+        mainLayout->addWidget(new QLabel(summary, this));
+
+        // The chain as systemd-analyze critical-chain prints it: when each
+        // unit became active, and how long its own activation took.
+        QSet<int> onChain;
+        QTableWidget *chainTable = new QTableWidget(analysis.criticalChain.size(), 3, this);
+        chainTable->setHorizontalHeaderLabels(QStringList() << QString("Critical chain of %1").arg(analysis.target)
+                                              << "Active at" << "Activation");
+        chainTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+        chainTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+        chainTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+        for (int row = 0; row < analysis.criticalChain.size(); ++row) {
+            const BootUnitTiming &unit = analysis.units[analysis.criticalChain[row]];
+            onChain.insert(analysis.criticalChain[row]);
+            const qint64 at = unit.activated > analysis.userspaceStart ? qint64(unit.activated - analysis.userspaceStart) : 0;
+            chainTable->setItem(row, 0, new QTableWidgetItem(QString(row, ' ') + unit.name));
+            chainTable->item(row, 0)->setData(Qt::UserRole, unit.name);
+            chainTable->setItem(row, 1, new DurationTableItem(at));
+            chainTable->setItem(row, 2, new DurationTableItem(unit.activationUsec()));
+        }
+
+        QTableWidget *rankingTable = new QTableWidget(analysis.ranking.size(), 3, this);
+        rankingTable->setHorizontalHeaderLabels(QStringList() << "Unit" << "Activation" << "On Critical Chain");
+        rankingTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+        rankingTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+        rankingTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+        for (int row = 0; row < analysis.ranking.size(); ++row) {
+            const int index = analysis.ranking[row];
+            const BootUnitTiming &unit = analysis.units[index];
+            QTableWidgetItem *nameItem = new QTableWidgetItem(unit.name);
+            nameItem->setData(Qt::UserRole, unit.name);
+            QTableWidgetItem *chainItem = new QTableWidgetItem(onChain.contains(index) ? "yes" : "");
+            if (onChain.contains(index)) {
+                nameItem->setBackground(QColor(255, 230, 180));
+            }
+            rankingTable->setItem(row, 0, nameItem);
+            rankingTable->setItem(row, 1, new DurationTableItem(unit.activationUsec()));
+            rankingTable->setItem(row, 2, chainItem);
+        }
+        rankingTable->setSortingEnabled(true);
+
+        for (QTableWidget *table : { chainTable, rankingTable }) {
+            connect(table, &QTableWidget::itemDoubleClicked, this, [this, table](QTableWidgetItem *item) {
+                const QString unit = table->item(item->row(), 0)->data(Qt::UserRole).toString();
+                if (unit.endsWith(".service")) {
+                    emit serviceRequested(unit);
+                }
+            });
+        }
+
+        QHBoxLayout *tablesLayout = new QHBoxLayout();
+        tablesLayout->addWidget(chainTable, 1);
+        tablesLayout->addWidget(rankingTable, 1);
+        mainLayout->addLayout(tablesLayout);
+    }
+
+signals:
+    void serviceRequested(const QString &unit);
+};
+
+class ServiceTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column
+    {
+        NameColumn,
+        DescriptionColumn,
+        StatusColumn,
+        StartupColumn,
+        LogVolumeColumn,
+        CpuColumn,
+        MemoryColumn,
+        IoColumn,
+        ColumnCount
+    };
+
+    // Numbers sort as numbers; everything else by its display text.
+    static const int SortRole = Qt::UserRole;
+
+    ServiceTableModel(QObject *parent = nullptr) : QAbstractTableModel(parent)
+    {
+    }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override
+    {
+        return parent.isValid() ? 0 : m_services.size();
+    }
+
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override
+    {
+        return parent.isValid() ? 0 : ColumnCount;
+    }
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override
+    {
+        static const char *const titles[ColumnCount] = { "Service Name", "Description", "Status", "Startup", "Log Volume",
+                                                         "CPU", "Memory", "I/O" };
+        if (orientation != Qt::Horizontal || role != Qt::DisplayRole || section < 0 || section >= ColumnCount) {
+            return QVariant();
+        }
+        return QString(titles[section]);
+    }
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override
+    {
+        if (!index.isValid() || index.row() >= m_services.size()) {
+            return QVariant();
+        }
+        const ServiceUnit &service = m_services[index.row()];
+
+        switch (index.column()) {
+        case NameColumn:
+            if (role == Qt::DisplayRole || role == SortRole) {
+                return service.name;
+            }
+            break;
+        case DescriptionColumn:
+            if (role == Qt::DisplayRole || role == SortRole) {
+                return service.description.isEmpty() ? QString("No description available") : service.description;
+            }
+            break;
+        case StatusColumn:
+            if (role == Qt::DisplayRole || role == SortRole) {
+                return service.activeState;
+            } else if (role == Qt::ToolTipRole) {
+                return service.subState;
+            } else if (role == Qt::BackgroundRole) {
+                if (service.activeState == "active") {
+                    return QColor(200, 255, 200);
+                } else if (service.activeState == "inactive" || service.activeState == "failed") {
+                    return QColor(255, 200, 200);
+                }
+            }
+            break;
+        case StartupColumn:
+            if (role == Qt::DisplayRole || role == SortRole) {
+                return service.unitFileState.isEmpty() ? QString("-") : service.unitFileState;
+            } else if (role == Qt::BackgroundRole) {
+                if (service.unitFileState.startsWith("enabled")) {
+                    return QColor(200, 255, 200);
+                } else if (service.unitFileState == "disabled") {
+                    return QColor(255, 200, 200);
+                }
+            }
+            break;
+        case LogVolumeColumn: {
+            auto it = m_logVolumes.constFind(service.name);
+            if (role == SortRole) {
+                return it == m_logVolumes.constEnd() ? quint64(0) : it.value();
+            } else if (role == Qt::DisplayRole) {
+                if (it == m_logVolumes.constEnd()) {
+                    return m_logVolumes.isEmpty() ? QString() : QString("-");
+                }
+                return QLocale().formattedDataSize(qint64(it.value()));
+            }
+            break;
+        }
+        case CpuColumn:
+        case MemoryColumn:
+        case IoColumn:
+            return usageData(service.name, index.column(), role);
+        }
+        return QVariant();
+    }
+
+    void setServices(const QVector<ServiceUnit> &services)
+    {
+        beginResetModel();
+        m_services = services;
+        rebuildIndex();
+        endResetModel();
+    }
+
+    // Patches one row in place from a PropertiesChanged payload.
+    void updateService(int row, const QVariantMap &properties)
+    {
+        if (m_services[row].applyProperties(properties)) {
+            emit dataChanged(index(row, 0), index(row, ColumnCount - 1));
+        }
+    }
+
+    void addService(const ServiceUnit &service)
+    {
+        const int existing = rowOf(service.name);
+        if (existing >= 0) {
+            m_pathRows.remove(m_services[existing].objectPath);
+            m_services[existing] = service;
+            m_pathRows.insert(service.objectPath, existing);
+            emit dataChanged(index(existing, 0), index(existing, ColumnCount - 1));
+            return;
+        }
+        const int row = m_services.size();
+        beginInsertRows(QModelIndex(), row, row);
+        m_services.append(service);
+        m_rows.insert(service.name, row);
+        m_pathRows.insert(service.objectPath, row);
+        endInsertRows();
+    }
+
+    void removeService(const QString &name)
+    {
+        const int row = rowOf(name);
+        if (row < 0) {
+            return;
+        }
+        beginRemoveRows(QModelIndex(), row, row);
+        m_services.remove(row);
+        rebuildIndex();
+        endRemoveRows();
+    }
+
+    void setLogVolumes(const QHash<QString, quint64> &bytesPerUnit)
+    {
+        m_logVolumes = bytesPerUnit;
+        if (!m_services.isEmpty()) {
+            emit dataChanged(index(0, LogVolumeColumn), index(m_services.size() - 1, LogVolumeColumn));
+        }
+    }
+
+    void setUsage(const ServiceUsageMap &usage)
+    {
+        m_usage = usage;
+        if (!m_services.isEmpty()) {
+            emit dataChanged(index(0, CpuColumn), index(m_services.size() - 1, IoColumn));
+        }
+    }
+
+    const ServiceUnit &service(int row) const
+    {
+        return m_services[row];
+    }
+
+    int rowOf(const QString &name) const
+    {
+        return m_rows.value(name, -1);
+    }
+
+    int rowForPath(const QString &objectPath) const
+    {
+        return m_pathRows.value(objectPath, -1);
+    }
+
+private:
+    QVariant usageData(const QString &name, int column, int role) const
+    {
+        if (role != Qt::DisplayRole && role != SortRole && role != Qt::TextAlignmentRole) {
+            return QVariant();
+        }
+        if (role == Qt::TextAlignmentRole) {
+            return int(Qt::AlignRight | Qt::AlignVCenter);
+        }
+        auto it = m_usage.constFind(name);
+        const ServiceUsage usage = it == m_usage.constEnd() ? ServiceUsage() : it.value();
+        const double value = column == CpuColumn ? usage.cpuPercent
+            : column == MemoryColumn ? double(usage.memoryBytes) : usage.ioBytesPerSecond;
+        if (role == SortRole) {
+            return value;
+        }
+        if (value < 0) {
+            return QString();
+        }
+        if (column == CpuColumn) {
+            return QString("%1 %").arg(value, 0, 'f', 1);
+        } else if (column == MemoryColumn) {
+            return QLocale().formattedDataSize(qint64(value));
+        }
+        return QLocale().formattedDataSize(qint64(value)) + "/s";
+    }
+
+    void rebuildIndex()
+    {
+        m_rows.clear();
+        m_pathRows.clear();
+        m_rows.reserve(m_services.size());
+        m_pathRows.reserve(m_services.size());
+        for (int row = 0; row < m_services.size(); ++row) {
+            m_rows.insert(m_services[row].name, row);
+            m_pathRows.insert(m_services[row].objectPath, row);
+        }
+    }
+
+    QVector<ServiceUnit> m_services;
+    QHash<QString, int> m_rows;
+    QHash<QString, int> m_pathRows;
+    QHash<QString, quint64> m_logVolumes;
+    ServiceUsageMap m_usage;
+};
+
+// Filters on the cached records only, so typing in the search box never
+// touches systemd.
+class ServiceFilterProxy : public QSortFilterProxyModel
+{
+    Q_OBJECT
+
+public:
+    ServiceFilterProxy(QObject *parent = nullptr) : QSortFilterProxyModel(parent)
+    {
+        setSortRole(ServiceTableModel::SortRole);
+        setSortCaseSensitivity(Qt::CaseInsensitive);
+    }
+
+    // Returns false, and matches nothing, for an invalid regular expression.
+    bool setPattern(const QString &pattern, bool regex)
+    {
+        m_pattern = pattern;
+        m_useRegex = regex && !pattern.isEmpty();
+        m_regex = QRegularExpression(pattern, QRegularExpression::CaseInsensitiveOption);
+        invalidateFilter();
+        return !m_useRegex || m_regex.isValid();
+    }
+
+    // An empty state shows every unit.
+    void setActiveState(const QString &state)
+    {
+        m_activeState = state;
+        invalidateFilter();
+    }
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override
+    {
+        Q_UNUSED(sourceParent);
+        const ServiceUnit &service = static_cast<const ServiceTableModel *>(sourceModel())->service(sourceRow);
+        if (!m_activeState.isEmpty() && service.activeState != m_activeState) {
+            return false;
+        }
+        if (m_useRegex) {
+            return m_regex.isValid() && m_regex.match(service.name).hasMatch();
+        }
+        return service.name.contains(m_pattern, Qt::CaseInsensitive);
+    }
+
+private:
+    QString m_pattern;
+    bool m_useRegex = false;
+    QRegularExpression m_regex;
+    QString m_activeState;
 };
 
 class SystemServicesWidget : public QWidget
@@ -620,22 +2765,51 @@ public:
         m_searchEdit->setPlaceholderText("Enter service name to filter...");
         connect(m_searchEdit, &QLineEdit::textChanged, this, &SystemServicesWidget::filterServices);
         
+        m_regexCheckBox = new QCheckBox("Regex", this);
+        connect(m_regexCheckBox, &QCheckBox::toggled, this, [this]() {
+            filterServices(m_searchEdit->text());
+        });
+        
+        m_stateCombo = new QComboBox(this);
+        m_stateCombo->addItem("All states", QString());
+        for (const char *state : { "active", "inactive", "failed", "activating", "deactivating" }) {
+            m_stateCombo->addItem(state, QString(state));
+        }
+        connect(m_stateCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this]() {
+            m_proxyModel->setActiveState(m_stateCombo->currentData().toString());
+        });
+        
         searchLayout->addWidget(searchLabel);
         searchLayout->addWidget(m_searchEdit);
+        searchLayout->addWidget(m_regexCheckBox);
+        searchLayout->addWidget(m_stateCombo);
         mainLayout->addLayout(searchLayout);
         
-        m_servicesTable = new QTableWidget(0, 4, this);
-        m_servicesTable->setHorizontalHeaderLabels(QStringList() << "Service Name" << "Description" << "Status" << "Startup");
-        m_servicesTable->setSelectionBehavior(QAbstractItemView::SelectRows);
-        m_servicesTable->setSelectionMode(QAbstractItemView::SingleSelection);
-        m_servicesTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
-        m_servicesTable->horizontalHeader()->setSectionResizeMode(1, QHeaderView::Stretch);
-        m_servicesTable->horizontalHeader()->setSectionResizeMode(2, QHeaderView::ResizeToContents);
-        m_servicesTable->horizontalHeader()->setSectionResizeMode(3, QHeaderView::ResizeToContents);
-        m_servicesTable->setMinimumHeight(300);
-        mainLayout->addWidget(m_servicesTable);
-        
-        connect(m_servicesTable, &QTableWidget::itemSelectionChanged, this, &SystemServicesWidget::updateButtonStates);
+        m_servicesModel = new ServiceTableModel(this);
+        m_proxyModel = new ServiceFilterProxy(this);
+        m_proxyModel->setSourceModel(m_servicesModel);
+        
+        m_servicesView = new QTableView(this);
+        m_servicesView->setModel(m_proxyModel);
+        m_servicesView->setSortingEnabled(true);
+        m_servicesView->sortByColumn(ServiceTableModel::NameColumn, Qt::AscendingOrder);
+        m_servicesView->setSelectionBehavior(QAbstractItemView::SelectRows);
+        m_servicesView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+        m_servicesView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+        m_servicesView->verticalHeader()->hide();
+        m_servicesView->horizontalHeader()->setSectionResizeMode(ServiceTableModel::NameColumn, QHeaderView::ResizeToContents);
+        m_servicesView->horizontalHeader()->setSectionResizeMode(ServiceTableModel::DescriptionColumn, QHeaderView::Stretch);
+        m_servicesView->horizontalHeader()->setSectionResizeMode(ServiceTableModel::StatusColumn, QHeaderView::ResizeToContents);
+        m_servicesView->horizontalHeader()->setSectionResizeMode(ServiceTableModel::StartupColumn, QHeaderView::ResizeToContents);
+        m_servicesView->horizontalHeader()->setSectionResizeMode(ServiceTableModel::LogVolumeColumn, QHeaderView::ResizeToContents);
+        m_servicesView->horizontalHeader()->setSectionResizeMode(ServiceTableModel::CpuColumn, QHeaderView::ResizeToContents);
+        m_servicesView->horizontalHeader()->setSectionResizeMode(ServiceTableModel::MemoryColumn, QHeaderView::ResizeToContents);
+        m_servicesView->horizontalHeader()->setSectionResizeMode(ServiceTableModel::IoColumn, QHeaderView::ResizeToContents);
+        m_servicesView->setMinimumHeight(300);
+        mainLayout->addWidget(m_servicesView);
+        
+        connect(m_servicesView->selectionModel(), &QItemSelectionModel::selectionChanged,
+                this, &SystemServicesWidget::updateButtonStates);
         
         QHBoxLayout *actionLayout = new QHBoxLayout();
         
@@ -664,372 +2838,458 @@ public:
         actionLayout->addWidget(m_enableButton);
         actionLayout->addWidget(m_disableButton);
         
+        m_bootButton = new QPushButton("Boot Impact...", this);
+        connect(m_bootButton, &QPushButton::clicked, this, &SystemServicesWidget::analyzeBoot);
+        actionLayout->addWidget(m_bootButton);
+        
         mainLayout->addLayout(actionLayout);
         
         m_statusLabel = new QLabel("Ready", this);
         mainLayout->addWidget(m_statusLabel);
         
-        refreshServicesList();
+        m_listingWatcher = new QFutureWatcher<ServiceListing>(this);
+        connect(m_listingWatcher, &QFutureWatcher<ServiceListing>::finished,
+                this, &SystemServicesWidget::onServicesListed);
+        
+        m_newUnitsWatcher = new QFutureWatcher<QVector<ServiceUnit>>(this);
+        connect(m_newUnitsWatcher, &QFutureWatcher<QVector<ServiceUnit>>::finished,
+                this, &SystemServicesWidget::onNewUnitsLoaded);
+        
+        // Signals arriving within one frame are applied together.
+        m_flushTimer = new QTimer(this);
+        m_flushTimer->setSingleShot(true);
+        m_flushTimer->setInterval(16);
+        connect(m_flushTimer, &QTimer::timeout, this, &SystemServicesWidget::flushUnitChanges);
+        
+        m_unitFilesTimer = new QTimer(this);
+        m_unitFilesTimer->setSingleShot(true);
+        m_unitFilesTimer->setInterval(500);
+        connect(m_unitFilesTimer, &QTimer::timeout, this, &SystemServicesWidget::refreshServicesList);
+        
+        m_unitWatcher = new SystemdUnitWatcher(QDBusConnection::systemBus(), SystemdManager::defaultService(), this);
+        connect(m_unitWatcher, &SystemdUnitWatcher::unitPropertiesChanged, this, &SystemServicesWidget::queuePropertiesChange);
+        connect(m_unitWatcher, &SystemdUnitWatcher::unitNew, this, &SystemServicesWidget::queueNewUnit);
+        connect(m_unitWatcher, &SystemdUnitWatcher::unitRemoved, this, &SystemServicesWidget::queueRemovedUnit);
+        connect(m_unitWatcher, &SystemdUnitWatcher::unitFilesChanged, m_unitFilesTimer, QOverload<>::of(&QTimer::start));
+        QString watchError;
+        if (!m_unitWatcher->start(&watchError)) {
+            m_refreshButton->setToolTip(QString("Live updates unavailable: %1").arg(watchError));
+        }
+        
+        m_bootWatcher = new QFutureWatcher<BootAnalysis>(this);
+        connect(m_bootWatcher, &QFutureWatcher<BootAnalysis>::finished, this, &SystemServicesWidget::onBootAnalyzed);
+        
+        m_usageWatcher = new QFutureWatcher<ServiceUsageMap>(this);
+        connect(m_usageWatcher, &QFutureWatcher<ServiceUsageMap>::finished, this, [this]() {
+            m_servicesModel->setUsage(m_usageWatcher->result());
+        });
+        
+        // Sampled once a second, only while the tab is on screen.
+        m_usageTimer = new QTimer(this);
+        m_usageTimer->setInterval(1000);
+        connect(m_usageTimer, &QTimer::timeout, this, &SystemServicesWidget::sampleUsage);
+    }
+
+    ~SystemServicesWidget() override
+    {
+        // The sampler runs on the pool against m_cgroupSampler.
+        m_usageWatcher->waitForFinished();
     }
 
 public slots:
+    void sampleUsage()
+    {
+        if (m_usageWatcher->isRunning()) {
+            return;
+        }
+        CgroupSampler *sampler = &m_cgroupSampler;
+        m_usageWatcher->setFuture(TaskScheduler::instance().run(TaskPriority::Background, "cgroup-usage", [sampler]() {
+            return sampler->sample();
+        }));
+    }
+    
+
     void refreshServicesList()
     {
+        if (m_listingWatcher->isRunning()) {
+            return;
+        }
+        
         m_statusLabel->setText("Fetching services list...");
         m_refreshButton->setEnabled(false);
         m_startButton->setEnabled(false);
         m_stopButton->setEnabled(false);
         m_enableButton->setEnabled(false);
         m_disableButton->setEnabled(false);
-        m_searchEdit->setEnabled(false);
         
-        m_servicesTable->clearContents();
-        m_servicesTable->setRowCount(0);
-        m_allServices.clear();
-
-        QProcess *process = new QProcess(this);
-        connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            [=](int exitCode, QProcess::ExitStatus exitStatus) {
-                if (exitCode == 0) {
-                    QString output = process->readAllStandardOutput();
-                    QStringList lines = output.split('\n', Qt::SkipEmptyParts);
-                    
-                    m_allServices = lines;
-                    
-                    displayFilteredServices(m_allServices);
-                    
-                    m_statusLabel->setText(QString("Found %1 services").arg(m_allServices.size()));
-                } else {
-                    m_statusLabel->setText("Failed to get services list");
-                }
-                
-                m_refreshButton->setEnabled(true);
-                m_searchEdit->setEnabled(true);
-                process->deleteLater();
-            });
-
-        process->start("bash", QStringList() << "-c" << 
-            "systemctl list-units --type=service --all --no-legend | awk '{print $1}'");
+        m_listingWatcher->setFuture(TaskScheduler::instance().run(TaskPriority::Normal, "service-listing", []() {
+            const ServiceListing listing = SystemdManager().listServices();
+            if (listing.error.isEmpty()) {
+                ResultCache::store("service-listing", listing.units);
+            }
+            return listing;
+        }));
     }
     
-    void filterServices(const QString &filter)
+    // The previous run's units, shown until systemd answers. Live signals
+    // that arrive meanwhile apply to them as usual.
+    void showStoredServices()
+    {
+        QVector<ServiceUnit> units;
+        qint64 storedSecs = 0;
+        if (ResultCache::load("service-listing", &units, &storedSecs)) {
+            m_servicesModel->setServices(units);
+            m_statusLabel->setText(QString("Showing %1 services as of %2, refreshing...")
+                .arg(units.size()).arg(QDateTime::fromSecsSinceEpoch(storedSecs).toString("yyyy-MM-dd HH:mm")));
+        }
+    }
+    
+    void onServicesListed()
     {
-        if (m_allServices.isEmpty()) {
+        const ServiceListing listing = m_listingWatcher->result();
+        m_refreshButton->setEnabled(true);
+        
+        if (listing.units.isEmpty() && !listing.error.isEmpty()) {
+            m_statusLabel->setText(QString("Failed to get services list: %1").arg(listing.error));
             return;
         }
         
-        QStringList filteredServices;
-        for (const QString &service : m_allServices) {
-            if (service.contains(filter, Qt::CaseInsensitive)) {
-                filteredServices << service;
-            }
+        const QString selected = selectedServiceName();
+        m_servicesModel->setServices(listing.units);
+        // Changes signalled while the listing ran may be newer than what it
+        // read; replay them onto it.
+        if (!m_pendingProperties.isEmpty() || !m_pendingRemoved.isEmpty() || !m_pendingNew.isEmpty()) {
+            m_flushTimer->start();
         }
+        if (!selected.isEmpty()) {
+            selectService(selected);
+        }
+        updateButtonStates();
         
-        displayFilteredServices(filteredServices);
+        QString status = QString("Found %1 services in %2 ms").arg(listing.units.size()).arg(listing.elapsedMs);
+        if (!listing.error.isEmpty()) {
+            status += QString(" (%1)").arg(listing.error);
+        }
+        m_statusLabel->setText(status);
     }
     
-    void displayFilteredServices(const QStringList &services)
+    void queuePropertiesChange(const QString &objectPath, const QVariantMap &properties)
     {
-        m_servicesTable->clearContents();
-        m_servicesTable->setRowCount(services.size());
-        
-        for (int i = 0; i < services.size(); ++i) {
-            const QString &serviceName = services[i];
-            
-            fetchServiceDetails(i, serviceName);
+        QVariantMap &pending = m_pendingProperties[objectPath];
+        for (auto it = properties.constBegin(); it != properties.constEnd(); ++it) {
+            pending.insert(it.key(), it.value());
         }
+        m_flushTimer->start();
     }
     
-    void fetchServiceDetails(int row, const QString &serviceName)
-    {
-        QTableWidgetItem *nameItem = new QTableWidgetItem(serviceName);
-        m_servicesTable->setItem(row, 0, nameItem);
-        
-        QProcess *descProcess = new QProcess(this);
-        connect(descProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            [=](int exitCode, QProcess::ExitStatus exitStatus) {
-                QString description = "No description available";
-                if (exitCode == 0) {
-                    description = descProcess->readAllStandardOutput().trimmed();
-                    if (description.isEmpty()) {
-                        description = "No description available";
-                    }
-                }
-                QTableWidgetItem *descItem = new QTableWidgetItem(description);
-                m_servicesTable->setItem(row, 1, descItem);
-                descProcess->deleteLater();
-            });
-        
-        descProcess->start("bash", QStringList() << "-c" << 
-            QString("systemctl show %1 -p Description | sed 's/Description=//'").arg(serviceName));
-        
-        QProcess *activeProcess = new QProcess(this);
-        connect(activeProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            [=](int exitCode, QProcess::ExitStatus exitStatus) {
-                QString status = "Unknown";
-                if (exitCode == 0) {
-                    status = activeProcess->readAllStandardOutput().trimmed();
-                }
-                QTableWidgetItem *statusItem = new QTableWidgetItem(status);
-                
-                if (status.contains("active", Qt::CaseInsensitive)) {
-                    statusItem->setBackground(QColor(200, 255, 200));
-                } else if (status.contains("inactive", Qt::CaseInsensitive)) {
-                    statusItem->setBackground(QColor(255, 200, 200));
-                }
-                
-                m_servicesTable->setItem(row, 2, statusItem);
-                activeProcess->deleteLater();
-            });
-        
-        activeProcess->start("bash", QStringList() << "-c" << 
-            QString("systemctl is-active %1").arg(serviceName));
+    void queueNewUnit(const QString &name, const QString &objectPath)
+    {
+        Q_UNUSED(name);
+        m_pendingNew.insert(objectPath);
+        m_flushTimer->start();
+    }
+    
+    void queueRemovedUnit(const QString &name, const QString &objectPath)
+    {
+        m_pendingNew.remove(objectPath);
+        m_pendingProperties.remove(objectPath);
+        m_pendingRemoved.insert(name);
+        m_flushTimer->start();
+    }
+    
+    void flushUnitChanges()
+    {
+        // Queued changes are replayed onto the listing once it arrives.
+        if (m_listingWatcher->isRunning()) {
+            return;
+        }
         
-        QProcess *enabledProcess = new QProcess(this);
-        connect(enabledProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            [=](int exitCode, QProcess::ExitStatus exitStatus) {
-                QString enabled = "Unknown";
-                if (exitCode == 0) {
-                    enabled = enabledProcess->readAllStandardOutput().trimmed();
-                }
-                QTableWidgetItem *enabledItem = new QTableWidgetItem(enabled);
-                
-                if (enabled.contains("enabled", Qt::CaseInsensitive)) {
-                    enabledItem->setBackground(QColor(200, 255, 200));
-                } else if (enabled.contains("disabled", Qt::CaseInsensitive)) {
-                    enabledItem->setBackground(QColor(255, 200, 200));
+        for (const QString &name : qAsConst(m_pendingRemoved)) {
+            m_servicesModel->removeService(name);
+        }
+        m_pendingRemoved.clear();
+        
+        for (auto it = m_pendingProperties.constBegin(); it != m_pendingProperties.constEnd(); ++it) {
+            const int row = m_servicesModel->rowForPath(it.key());
+            if (row >= 0) {
+                m_servicesModel->updateService(row, it.value());
+            } else {
+                m_pendingNew.insert(it.key());
+            }
+        }
+        m_pendingProperties.clear();
+        
+        if (!m_pendingNew.isEmpty() && !m_newUnitsWatcher->isRunning()) {
+            const QStringList paths = m_pendingNew.values();
+            m_pendingNew.clear();
+            m_newUnitsWatcher->setFuture(TaskScheduler::instance().run(TaskPriority::Normal, QString(), [paths]() {
+                SystemdManager manager;
+                QVector<ServiceUnit> units;
+                for (const QString &path : paths) {
+                    ServiceUnit unit;
+                    if (manager.unitProperties(path, &unit) && unit.name.endsWith(".service")) {
+                        units.append(unit);
+                    }
                 }
-                
-                m_servicesTable->setItem(row, 3, enabledItem);
-                enabledProcess->deleteLater();
-            });
+                return units;
+            }));
+        }
+    }
+    
+    void onNewUnitsLoaded()
+    {
+        for (const ServiceUnit &unit : m_newUnitsWatcher->result()) {
+            m_servicesModel->addService(unit);
+        }
+        if (!m_pendingNew.isEmpty()) {
+            m_flushTimer->start();
+        }
+    }
+    
+    void analyzeBoot()
+    {
+        if (m_bootWatcher->isRunning()) {
+            return;
+        }
+        m_bootButton->setEnabled(false);
+        m_statusLabel->setText("Analyzing boot...");
+        m_bootWatcher->setFuture(TaskScheduler::instance().run(TaskPriority::Interactive, "boot-analysis", []() {
+            return BootAnalyzer().analyze();
+        }));
+    }
+    
+    void onBootAnalyzed()
+    {
+        const BootAnalysis analysis = m_bootWatcher->result();
+        m_bootButton->setEnabled(true);
+        if (analysis.units.isEmpty()) {
+            m_statusLabel->setText(QString("Boot analysis failed: %1").arg(analysis.error));
+            return;
+        }
+        m_statusLabel->setText(QString("Boot analyzed in %1 ms").arg(analysis.elapsedMs));
         
-        enabledProcess->start("bash", QStringList() << "-c" << 
-            QString("systemctl is-enabled %1").arg(serviceName));
+        BootAnalysisDialog *dialog = new BootAnalysisDialog(analysis, this);
+        connect(dialog, &BootAnalysisDialog::serviceRequested, this, &SystemServicesWidget::showService);
+        dialog->show();
+    }
+    
+    void filterServices(const QString &filter)
+    {
+        const bool valid = m_proxyModel->setPattern(filter, m_regexCheckBox->isChecked());
+        m_searchEdit->setStyleSheet(valid ? QString() : QString("color: red"));
+        m_searchEdit->setToolTip(valid ? QString() : QString("Invalid regular expression"));
+    }
+    
+    void setLogVolumes(const QHash<QString, quint64> &bytesPerUnit)
+    {
+        m_servicesModel->setLogVolumes(bytesPerUnit);
+    }
+
+    void showService(const QString &unit)
+    {
+        m_searchEdit->setText(unit);
+        selectService(unit);
+    }
+
+    void updateButtonStates()
+    {
+        bool hasSelection = m_servicesView->selectionModel()->hasSelection();
+        m_startButton->setEnabled(hasSelection);
+        m_stopButton->setEnabled(hasSelection);
+        m_enableButton->setEnabled(hasSelection);
+        m_disableButton->setEnabled(hasSelection);
+    }
+    
+    void startService()
+    {
+        runServiceBatch(ServiceBatch::Start);
+    }
+    
+    void stopService()
+    {
+        runServiceBatch(ServiceBatch::Stop);
+    }
+    
+    void enableService()
+    {
+        runServiceBatch(ServiceBatch::Enable);
     }
     
-    void updateButtonStates()
+    void disableService()
     {
-        bool hasSelection = !m_servicesTable->selectedItems().isEmpty();
-        m_startButton->setEnabled(hasSelection);
-        m_stopButton->setEnabled(hasSelection);
-        m_enableButton->setEnabled(hasSelection);
-        m_disableButton->setEnabled(hasSelection);
+        runServiceBatch(ServiceBatch::Disable);
     }
     
-    void startService()
+    void onServiceJobFinished(const ServiceJobResult &result)
     {
-        QList<QTableWidgetItem*> items = m_servicesTable->selectedItems();
-        if (items.isEmpty()) {
-            return;
-        }
-        
-        int row = items.first()->row();
-        QTableWidgetItem* nameItem = m_servicesTable->item(row, 0);
-        if (!nameItem) {
-            return;
-        }
-        
-        QString serviceName = nameItem->text();
-        
-        QMessageBox::StandardButton reply = QMessageBox::question(this, 
-            "Confirm Service Start", 
-            QString("Are you sure you want to start the service '%1'?\nThis requires administrator privileges.").arg(serviceName),
-            QMessageBox::Yes | QMessageBox::No);
-            
-        if (reply == QMessageBox::No) {
-            return;
+        Q_UNUSED(result);
+        int failed = 0;
+        for (const ServiceJobResult &done : m_batch->results()) {
+            failed += done.ok ? 0 : 1;
         }
-        
-        m_statusLabel->setText(QString("Starting service %1...").arg(serviceName));
-        setButtonsEnabled(false);
-        
-        QProcess *process = new QProcess(this);
-        connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            [=](int exitCode, QProcess::ExitStatus exitStatus) {
-                setButtonsEnabled(true);
-                
-                if (exitCode == 0) {
-                    m_statusLabel->setText(QString("Service %1 started successfully").arg(serviceName));
-                    fetchServiceDetails(row, serviceName);
-                } else {
-                    QString error = process->readAllStandardError();
-                    m_statusLabel->setText(QString("Failed to start service %1").arg(serviceName));
-                    QMessageBox::critical(this, "Error", 
-                        QString("Failed to start service.\n%1").arg(error));
-                }
-                
-                process->deleteLater();
-            });
-        
-        process->start("pkexec", QStringList() << "systemctl" << "start" << serviceName);
+        m_statusLabel->setText(QString("%1: %2 of %3 services done, %4 failed")
+            .arg(ServiceBatch::operationName(m_batch->operation()))
+            .arg(m_batch->results().size())
+            .arg(m_batch->unitCount())
+            .arg(failed));
     }
     
-    void stopService()
+    void onServiceBatchFinished()
     {
-        QList<QTableWidgetItem*> items = m_servicesTable->selectedItems();
-        if (items.isEmpty()) {
-            return;
+        ServiceBatch *batch = m_batch;
+        m_batch = nullptr;
+        setButtonsEnabled(true);
+        
+        QStringList failures;
+        for (const ServiceJobResult &result : batch->results()) {
+            if (!result.ok) {
+                failures << QString("%1: %2").arg(result.unit, result.message);
+            }
         }
-        
-        int row = items.first()->row();
-        QTableWidgetItem* nameItem = m_servicesTable->item(row, 0);
-        if (!nameItem) {
-            return;
+        const QString operation = ServiceBatch::operationName(batch->operation());
+        if (failures.isEmpty()) {
+            m_statusLabel->setText(QString("%1 %2 service(s): done").arg(operation).arg(batch->unitCount()));
+        } else {
+            m_statusLabel->setText(QString("%1 %2 service(s): %3 failed")
+                .arg(operation).arg(batch->unitCount()).arg(failures.size()));
+            QMessageBox::critical(this, "Error",
+                QString("Failed to %1 %2 service(s).\n%3").arg(operation).arg(failures.size()).arg(failures.join("\n")));
         }
         
-        QString serviceName = nameItem->text();
-        
-        QMessageBox::StandardButton reply = QMessageBox::question(this, 
-            "Confirm Service Stop", 
-            QString("Are you sure you want to stop the service '%1'?\nThis requires administrator privileges.").arg(serviceName),
-            QMessageBox::Yes | QMessageBox::No);
-            
-        if (reply == QMessageBox::No) {
-            return;
+        // Start/stop show up through PropertiesChanged; unit file states only
+        // through a relist, which the watcher triggers unless it is down.
+        if (batch->operation() == ServiceBatch::Enable || batch->operation() == ServiceBatch::Disable) {
+            m_unitFilesTimer->start();
         }
-        
-        m_statusLabel->setText(QString("Stopping service %1...").arg(serviceName));
-        setButtonsEnabled(false);
-        
-        QProcess *process = new QProcess(this);
-        connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            [=](int exitCode, QProcess::ExitStatus exitStatus) {
-                setButtonsEnabled(true);
-                
-                if (exitCode == 0) {
-                    m_statusLabel->setText(QString("Service %1 stopped successfully").arg(serviceName));
-                    fetchServiceDetails(row, serviceName);
-                } else {
-                    QString error = process->readAllStandardError();
-                    m_statusLabel->setText(QString("Failed to stop service %1").arg(serviceName));
-                    QMessageBox::critical(this, "Error", 
-                        QString("Failed to stop service.\n%1").arg(error));
-                }
-                
-                process->deleteLater();
-            });
-        
-        process->start("pkexec", QStringList() << "systemctl" << "stop" << serviceName);
+        batch->deleteLater();
     }
-    
-    void enableService()
+
+protected:
+    void showEvent(QShowEvent *event) override
     {
-        QList<QTableWidgetItem*> items = m_servicesTable->selectedItems();
-        if (items.isEmpty()) {
-            return;
+        QWidget::showEvent(event);
+        if (!m_populated) {
+            m_populated = true;
+            refreshServicesList();
+            showStoredServices();
         }
-        
-        int row = items.first()->row();
-        QTableWidgetItem* nameItem = m_servicesTable->item(row, 0);
-        if (!nameItem) {
+        sampleUsage();
+        m_usageTimer->start();
+    }
+
+    void hideEvent(QHideEvent *event) override
+    {
+        QWidget::hideEvent(event);
+        m_usageTimer->stop();
+    }
+
+private:
+    void runServiceBatch(ServiceBatch::Operation operation)
+    {
+        const QStringList units = selectedServiceNames();
+        if (units.isEmpty() || m_batch) {
             return;
         }
         
-        QString serviceName = nameItem->text();
-        
-        QMessageBox::StandardButton reply = QMessageBox::question(this, 
-            "Confirm Service Enable", 
-            QString("Are you sure you want to enable the service '%1' at startup?\nThis requires administrator privileges.").arg(serviceName),
+        const QString operationName = ServiceBatch::operationName(operation);
+        const QString what = units.size() == 1 ? QString("the service '%1'").arg(units.first())
+                                               : QString("%1 services").arg(units.size());
+        QMessageBox::StandardButton reply = QMessageBox::question(this,
+            "Confirm Service Change",
+            QString("Are you sure you want to %1 %2?\nThis requires administrator privileges.").arg(operationName, what),
             QMessageBox::Yes | QMessageBox::No);
             
         if (reply == QMessageBox::No) {
             return;
         }
         
-        m_statusLabel->setText(QString("Enabling service %1...").arg(serviceName));
+        m_statusLabel->setText(QString("%1: %2 service(s)...").arg(operationName).arg(units.size()));
         setButtonsEnabled(false);
         
-        QProcess *process = new QProcess(this);
-        connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            [=](int exitCode, QProcess::ExitStatus exitStatus) {
-                setButtonsEnabled(true);
-                
-                if (exitCode == 0) {
-                    m_statusLabel->setText(QString("Service %1 enabled successfully").arg(serviceName));
-                    fetchServiceDetails(row, serviceName);
-                } else {
-                    QString error = process->readAllStandardError();
-                    m_statusLabel->setText(QString("Failed to enable service %1").arg(serviceName));
-                    QMessageBox::critical(this, "Error", 
-                        QString("Failed to enable service.\n%1").arg(error));
-                }
-                
-                process->deleteLater();
-            });
-        
-        process->start("pkexec", QStringList() << "systemctl" << "enable" << serviceName);
+        m_batch = new ServiceBatch(operation, units, QDBusConnection::systemBus(), SystemdManager::defaultService(), this);
+        connect(m_batch, &ServiceBatch::unitFinished, this, &SystemServicesWidget::onServiceJobFinished);
+        connect(m_batch, &ServiceBatch::finished, this, &SystemServicesWidget::onServiceBatchFinished);
+        m_batch->start();
     }
-    
-    void disableService()
+
+    QStringList selectedServiceNames() const
     {
-        QList<QTableWidgetItem*> items = m_servicesTable->selectedItems();
-        if (items.isEmpty()) {
-            return;
+        QStringList names;
+        for (const QModelIndex &row : m_servicesView->selectionModel()->selectedRows()) {
+            names << m_servicesModel->service(m_proxyModel->mapToSource(row).row()).name;
         }
-        
-        int row = items.first()->row();
-        QTableWidgetItem* nameItem = m_servicesTable->item(row, 0);
-        if (!nameItem) {
-            return;
+        return names;
+    }
+
+    QString selectedServiceName() const
+    {
+        const QModelIndexList rows = m_servicesView->selectionModel()->selectedRows();
+        if (rows.isEmpty()) {
+            return QString();
         }
-        
-        QString serviceName = nameItem->text();
-        
-        QMessageBox::StandardButton reply = QMessageBox::question(this, 
-            "Confirm Service Disable", 
-            QString("Are you sure you want to disable the service '%1' at startup?\nThis requires administrator privileges.").arg(serviceName),
-            QMessageBox::Yes | QMessageBox::No);
-            
-        if (reply == QMessageBox::No) {
+        return m_servicesModel->service(m_proxyModel->mapToSource(rows.first()).row()).name;
+    }
+
+    void selectService(const QString &unit)
+    {
+        const int sourceRow = m_servicesModel->rowOf(unit);
+        if (sourceRow < 0) {
             return;
         }
-        
-        m_statusLabel->setText(QString("Disabling service %1...").arg(serviceName));
-        setButtonsEnabled(false);
-        
-        QProcess *process = new QProcess(this);
-        connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            [=](int exitCode, QProcess::ExitStatus exitStatus) {
-                setButtonsEnabled(true);
-                
-                if (exitCode == 0) {
-                    m_statusLabel->setText(QString("Service %1 disabled successfully").arg(serviceName));
-                    fetchServiceDetails(row, serviceName);
-                } else {
-                    QString error = process->readAllStandardError();
-                    m_statusLabel->setText(QString("Failed to disable service %1").arg(serviceName));
-                    QMessageBox::critical(this, "Error", 
-                        QString("Failed to disable service.\n%1").arg(error));
-                }
-                
-                process->deleteLater();
-            });
-        
-        process->start("pkexec", QStringList() << "systemctl" << "disable" << serviceName);
+        const QModelIndex index = m_proxyModel->mapFromSource(m_servicesModel->index(sourceRow, 0));
+        if (index.isValid()) {
+            m_servicesView->selectRow(index.row());
+            m_servicesView->scrollTo(index);
+        }
     }
 
-private:
     void setButtonsEnabled(bool enabled)
     {
+        const bool hasSelection = m_servicesView->selectionModel()->hasSelection();
         m_refreshButton->setEnabled(enabled);
-        m_startButton->setEnabled(enabled && !m_servicesTable->selectedItems().isEmpty());
-        m_stopButton->setEnabled(enabled && !m_servicesTable->selectedItems().isEmpty());
-        m_enableButton->setEnabled(enabled && !m_servicesTable->selectedItems().isEmpty());
-        m_disableButton->setEnabled(enabled && !m_servicesTable->selectedItems().isEmpty());
+        m_startButton->setEnabled(enabled && hasSelection);
+        m_stopButton->setEnabled(enabled && hasSelection);
+        m_enableButton->setEnabled(enabled && hasSelection);
+        m_disableButton->setEnabled(enabled && hasSelection);
         m_searchEdit->setEnabled(enabled);
     }
 
 private:
-    QTableWidget *m_servicesTable;
+    bool m_populated = false;
+    QTableView *m_servicesView;
+    ServiceTableModel *m_servicesModel;
+    ServiceFilterProxy *m_proxyModel;
     QLabel *m_statusLabel;
     QPushButton *m_refreshButton;
     QPushButton *m_startButton;
     QPushButton *m_stopButton;
     QPushButton *m_enableButton;
     QPushButton *m_disableButton;
+    QPushButton *m_bootButton;
+    ServiceBatch *m_batch = nullptr;
+    QFutureWatcher<BootAnalysis> *m_bootWatcher;
     QLineEdit *m_searchEdit;
-    QStringList m_allServices;
+    QCheckBox *m_regexCheckBox;
+    QComboBox *m_stateCombo;
+    QFutureWatcher<ServiceListing> *m_listingWatcher;
+    QFutureWatcher<QVector<ServiceUnit>> *m_newUnitsWatcher;
+    SystemdUnitWatcher *m_unitWatcher;
+    QTimer *m_flushTimer;
+    QTimer *m_unitFilesTimer;
+    QHash<QString, QVariantMap> m_pendingProperties;
+    QSet<QString> m_pendingNew;
+    QSet<QString> m_pendingRemoved;
+    CgroupSampler m_cgroupSampler;
+    QFutureWatcher<ServiceUsageMap> *m_usageWatcher;
+    QTimer *m_usageTimer;
+};
+
+// One Disk Usage query's matches, tagged with the request that asked for
+// them.
+struct DiskQueryResult
+{
+    quint64 sequence = 0;
+    QVector<FileMetadata> entries;
 };
 
 class DiskUsageAnalyzerWidget : public QWidget
@@ -1186,10 +3446,30 @@ public:
         
         mainLayout->addLayout(paginationLayout);
         
+        QHBoxLayout *dedupLayout = new QHBoxLayout();
+        
+        m_dedupButton = new QPushButton("Deduplicate Selected", this);
+        connect(m_dedupButton, &QPushButton::clicked, this, &DiskUsageAnalyzerWidget::deduplicateSelected);
+        
+        m_hardlinkCheckBox = new QCheckBox("Fall back to hardlinks", this);
+        m_hardlinkCheckBox->setToolTip("Hardlinked copies share later modifications. Only used where reflinks are not supported.");
+        
+        dedupLayout->addWidget(m_dedupButton);
+        dedupLayout->addWidget(m_hardlinkCheckBox);
+        dedupLayout->addStretch();
+        
+        mainLayout->addLayout(dedupLayout);
+        
+        m_dedupWatcher = new QFutureWatcher<DedupReport>(this);
+        connect(m_dedupWatcher, &QFutureWatcher<DedupReport>::finished,
+                this, &DiskUsageAnalyzerWidget::onDeduplicationFinished);
+        
+        m_queryWatcher = new QFutureWatcher<DiskQueryResult>(this);
+        connect(m_queryWatcher, &QFutureWatcher<DiskQueryResult>::finished,
+                this, &DiskUsageAnalyzerWidget::onQueryFinished);
+        
         m_statusLabel = new QLabel("Ready", this);
         mainLayout->addWidget(m_statusLabel);
-        
-        refreshPartitions();
     }
 
 public slots:
@@ -1199,13 +3479,13 @@ public slots:
         m_refreshPartitionsButton->setEnabled(false);
         m_partitionsCombo->clear();
         
-        QProcess *process = new QProcess(this);
-        connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            [=](int exitCode, QProcess::ExitStatus exitStatus) {
+        QFutureWatcher<ProcessResult> *watcher = new QFutureWatcher<ProcessResult>(this);
+        connect(watcher, &QFutureWatcher<ProcessResult>::finished, this, [=]() {
+                const ProcessResult result = watcher->result();
                 m_refreshPartitionsButton->setEnabled(true);
                 
-                if (exitCode == 0) {
-                    QString output = process->readAllStandardOutput();
+                if (result.ok()) {
+                    QString output = QString::fromLocal8Bit(result.standardOutput);
                     QStringList lines = output.split('\n', Qt::SkipEmptyParts);
                     
                     for (const QString &line : lines) {
@@ -1232,10 +3512,10 @@ public slots:
                     m_statusLabel->setText("Failed to get partitions list");
                 }
                 
-                process->deleteLater();
+                watcher->deleteLater();
             });
         
-        process->start("df", QStringList() << "-h");
+        watcher->setFuture(TaskScheduler::instance().runProcess(TaskPriority::Normal, "df", "df", QStringList() << "-h"));
     }
 
     void updatePartitionInfo(int index)
@@ -1247,11 +3527,11 @@ public slots:
         QString mountpoint = m_partitionsCombo->itemData(index).toString();
         m_statusLabel->setText(QString("Getting info for %1...").arg(mountpoint));
         
-        QProcess *process = new QProcess(this);
-        connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            [=](int exitCode, QProcess::ExitStatus exitStatus) {
-                if (exitCode == 0) {
-                    QString output = process->readAllStandardOutput();
+        QFutureWatcher<ProcessResult> *watcher = new QFutureWatcher<ProcessResult>(this);
+        connect(watcher, &QFutureWatcher<ProcessResult>::finished, this, [=]() {
+                const ProcessResult result = watcher->result();
+                if (result.ok()) {
+                    QString output = QString::fromLocal8Bit(result.standardOutput);
                     QStringList lines = output.split('\n', Qt::SkipEmptyParts);
                     
                     if (lines.size() > 1) {
@@ -1273,42 +3553,21 @@ public slots:
                     m_statusLabel->setText("Failed to get partition info");
                 }
                 
-                process->deleteLater();
+                watcher->deleteLater();
             });
         
-        process->start("df", QStringList() << "-h" << mountpoint);
+        watcher->setFuture(TaskScheduler::instance().runProcess(TaskPriority::Normal, "df-" + mountpoint, "df",
+                                                                QStringList() << "-h" << mountpoint));
     }
     
     void browseDirectory()
     {
         m_statusLabel->setText("Opening file browser for directory selection...");
-        
-        QString user = qgetenv("SUDO_USER");
-        if (user.isEmpty()) {
-            user = qgetenv("USER");
-        }
-        
-        if (user.isEmpty()) {
-            m_statusLabel->setText("Failed to determine user");
+        if (!QProcess::startDetached("xdg-open", QStringList() << QDir::homePath())) {
+            m_statusLabel->setText("Failed to open file browser");
             return;
         }
-        
-        QString homeDir = "/home/" + user;
-        
-        QProcess *process = new QProcess(this);
-        QStringList env = QProcess::systemEnvironment();
-        env << "DISPLAY=" + qgetenv("DISPLAY");
-        
-        process->setEnvironment(env);
-        
-        process->start("bash", QStringList() 
-            << "-c" 
-            << QString("su %1 -c 'xdg-open %2' || echo 'Failed to open file browser'").arg(user).arg(homeDir));
-        
-        process->waitForFinished(5000);
-        
         m_statusLabel->setText("Please select a directory in the opened file browser, then enter it manually in the Directory field.");
-        process->deleteLater();
     }
     
     void browseFindDirectory()
@@ -1320,30 +3579,10 @@ public slots:
         }
         
         m_statusLabel->setText(QString("Opening %1 in file browser...").arg(directory));
-        
-        QString user = qgetenv("SUDO_USER");
-        if (user.isEmpty()) {
-            user = qgetenv("USER");
-        }
-        
-        if (user.isEmpty()) {
-            m_statusLabel->setText("Failed to determine user");
+        if (!QProcess::startDetached("xdg-open", QStringList() << directory)) {
+            m_statusLabel->setText("Failed to open directory");
             return;
         }
-        
-        QProcess *process = new QProcess(this);
-        QStringList env = QProcess::systemEnvironment();
-        env << "DISPLAY=" + qgetenv("DISPLAY");
-        
-        process->setEnvironment(env);
-        
-        process->start("bash", QStringList() 
-            << "-c" 
-            << QString("su %1 -c 'xdg-open %2' || echo 'Failed to open directory'").arg(user).arg(directory));
-        
-        process->waitForFinished(5000);
-        
-        process->deleteLater();
         m_statusLabel->setText("File browser requested");
     }
     
@@ -1356,47 +3595,10 @@ public slots:
         }
         
         m_statusLabel->setText(QString("Analyzing directory %1...").arg(directory));
-        m_resultsTable->clearContents();
-        m_resultsTable->setRowCount(0);
-        
-        m_allResults.clear();
-        m_currentPage = 0;
-        m_prevPageButton->setEnabled(false);
-        m_nextPageButton->setEnabled(false);
-        m_paginationLabel->setText("Page 1 of 1");
-        
-        QProcess *process = new QProcess(this);
-        connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            [=](int exitCode, QProcess::ExitStatus exitStatus) {
-                if (exitCode == 0) {
-                    QString output = process->readAllStandardOutput();
-                    m_allResults = output.split('\n', Qt::SkipEmptyParts);
-                    
-                    int totalResults = m_allResults.size();
-                    int totalPages = (totalResults + RESULTS_PER_PAGE - 1) / RESULTS_PER_PAGE;
-                    
-                    displayResultsPage(0);
-                    
-                    if (totalResults > RESULTS_PER_PAGE) {
-                        m_statusLabel->setText(QString("Analysis complete. Found %1 results. Showing page 1 of %2.")
-                            .arg(totalResults)
-                            .arg(totalPages));
-                    } else {
-                        m_statusLabel->setText(QString("Analysis complete. Found %1 results.")
-                            .arg(totalResults));
-                    }
-                } else {
-                    m_statusLabel->setText("Failed to analyze directory");
-                }
-                
-                process->deleteLater();
-            });
-        
-        process->start("bash", QStringList() << "-c" << 
-            QString("find \"%1\" -type f -not -path \"*/\\.*\" | sort -k2 | "
-                   "while read file; do "
-                   "  echo \"$(basename \"$file\")|$(du -h \"$file\" | cut -f1)|$file\"; "
-                   "done | sort -hr -k2").arg(directory));
+        const int skip = QDir::cleanPath(directory).size();
+        runQuery(directory, true, [skip](const FileMetadata &entry) {
+            return entry.path.indexOf("/.", skip) < 0;
+        }, "Analysis complete. Found %1 results.");
     }
     
     void onTableItemDoubleClicked(int row, int column)
@@ -1406,8 +3608,7 @@ public slots:
             QString filePath = pathItem->text();
             QString dirPath = QFileInfo(filePath).absolutePath();
             
-            QProcess *process = new QProcess(this);
-            process->start("xdg-open", QStringList() << dirPath);
+            QProcess::startDetached("xdg-open", QStringList() << dirPath);
             
             m_statusLabel->setText(QString("Opening location: %1").arg(dirPath));
         }
@@ -1429,57 +3630,11 @@ public slots:
         }
         
         m_statusLabel->setText(QString("Filtering files in %1 with pattern %2...").arg(directory).arg(filter));
-        m_resultsTable->clearContents();
-        m_resultsTable->setRowCount(0);
-        
-        m_allResults.clear();
-        m_currentPage = 0;
-        m_prevPageButton->setEnabled(false);
-        m_nextPageButton->setEnabled(false);
-        m_paginationLabel->setText("Page 1 of 1");
-        
-        QProcess *process = new QProcess(this);
-        connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            [=](int exitCode, QProcess::ExitStatus exitStatus) {
-                if (exitCode == 0) {
-                    QString output = process->readAllStandardOutput();
-                    m_allResults = output.split('\n', Qt::SkipEmptyParts);
-                    
-                    int totalResults = m_allResults.size();
-                    int totalPages = (totalResults + RESULTS_PER_PAGE - 1) / RESULTS_PER_PAGE;
-                    
-                    displayResultsPage(0);
-                    
-                    if (totalResults > RESULTS_PER_PAGE) {
-                        m_statusLabel->setText(QString("Filter applied. Found %1 results. Showing page 1 of %2.")
-                            .arg(totalResults)
-                            .arg(totalPages));
-                    } else {
-                        m_statusLabel->setText(QString("Filter applied. Found %1 results.")
-                            .arg(totalResults));
-                    }
-                } else {
-                    m_statusLabel->setText("Failed to apply filter");
-                }
-                
-                process->deleteLater();
-            });
-        
-        QString findCommand;
-        if (filter.startsWith("*.")) {
-            QString ext = filter.mid(1);
-            findCommand = QString("find \"%1\" -type f -name \"%2\" | "
-                                  "while read file; do "
-                                  "  echo \"$(basename \"$file\")|$(du -h \"$file\" | cut -f1)|$file\"; "
-                                  "done | sort -hr -k2").arg(directory).arg(filter);
-        } else {
-            findCommand = QString("find \"%1\" -type f -name \"*%2*\" | "
-                                  "while read file; do "
-                                  "  echo \"$(basename \"$file\")|$(du -h \"$file\" | cut -f1)|$file\"; "
-                                  "done | sort -hr -k2").arg(directory).arg(filter);
-        }
-        
-        process->start("bash", QStringList() << "-c" << findCommand);
+        const QByteArray pattern = QFile::encodeName(filter.startsWith("*.") ? filter : "*" + filter + "*");
+        runQuery(directory, false, [pattern](const FileMetadata &entry) {
+            const QByteArray name = QFile::encodeName(entry.path.mid(entry.path.lastIndexOf('/') + 1));
+            return ::fnmatch(pattern.constData(), name.constData(), 0) == 0;
+        }, "Filter applied. Found %1 results.");
     }
     
     void findLargeFiles()
@@ -1501,6 +3656,21 @@ public slots:
         }
         
         m_statusLabel->setText(QString("Finding files larger than %1 %2 in %3...").arg(sizeThreshold).arg(unit).arg(directory));
+        runQuery(directory, false, [thresholdBytes](const FileMetadata &entry) {
+            return entry.size > thresholdBytes;
+        }, "Found %1 large files.");
+    }
+
+    // Filter and size queries reuse the last walk of the directory (or of a
+    // parent) from the shared metadata cache; only Analyze forces a new one.
+    void runQuery(const QString &directory, bool rescan,
+                  const std::function<bool(const FileMetadata &)> &accept, const QString &summary)
+    {
+        // The newest query wins: the old one is cancelled, and should its
+        // result still arrive, onQueryFinished() drops it by sequence.
+        TaskScheduler::instance().cancel("disk-query");
+        const quint64 sequence = ++m_querySequence;
+        
         m_resultsTable->clearContents();
         m_resultsTable->setRowCount(0);
         
@@ -1509,40 +3679,54 @@ public slots:
         m_prevPageButton->setEnabled(false);
         m_nextPageButton->setEnabled(false);
         m_paginationLabel->setText("Page 1 of 1");
+        m_querySummary = summary;
         
-        QProcess *process = new QProcess(this);
-        connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            [=](int exitCode, QProcess::ExitStatus exitStatus) {
-                if (exitCode == 0) {
-                    QString output = process->readAllStandardOutput();
-                    m_allResults = output.split('\n', Qt::SkipEmptyParts);
-                    
-                    int totalResults = m_allResults.size();
-                    int totalPages = (totalResults + RESULTS_PER_PAGE - 1) / RESULTS_PER_PAGE;
-                    
-                    displayResultsPage(0);
-                    
-                    if (totalResults > RESULTS_PER_PAGE) {
-                        m_statusLabel->setText(QString("Found %1 large files. Showing page 1 of %2.")
-                            .arg(totalResults)
-                            .arg(totalPages));
-                    } else {
-                        m_statusLabel->setText(QString("Found %1 large files.")
-                            .arg(totalResults));
-                    }
-                } else {
-                    m_statusLabel->setText("Failed to find large files");
+        if (rescan) {
+            FileMetadataCache::instance().invalidate(directory);
+        }
+        m_queryWatcher->setFuture(TaskScheduler::instance().run(TaskPriority::Interactive, "disk-query",
+                                                                [directory, accept, sequence](const CancellationToken &token) {
+            FileMetadataCache &metadata = FileMetadataCache::instance();
+            if (!metadata.hasTree(directory)) {
+                metadata.scanTree(directory);
+            }
+            DiskQueryResult result;
+            result.sequence = sequence;
+            if (token.isCancelled()) {
+                return result;
+            }
+            QVector<FileMetadata> &results = result.entries;
+            for (const FileMetadata &entry : metadata.entriesUnder(directory)) {
+                if (accept(entry)) {
+                    results.append(entry);
                 }
-                
-                process->deleteLater();
+            }
+            std::sort(results.begin(), results.end(), [](const FileMetadata &a, const FileMetadata &b) {
+                return a.allocated > b.allocated;
             });
+            return result;
+        }));
+    }
+
+    void onQueryFinished()
+    {
+        // A cancelled query that never ran has no result.
+        const QFuture<DiskQueryResult> future = m_queryWatcher->future();
+        if (future.resultCount() == 0 || future.result().sequence != m_querySequence) {
+            return;
+        }
+        m_allResults = future.result().entries;
+        
+        int totalResults = m_allResults.size();
+        int totalPages = (totalResults + RESULTS_PER_PAGE - 1) / RESULTS_PER_PAGE;
         
-        QString findCommand = QString("find \"%1\" -type f -size +%2c | "
-                                     "while read file; do "
-                                     "  echo \"$(basename \"$file\")|$(du -h \"$file\" | cut -f1)|$file\"; "
-                                     "done | sort -hr -k2").arg(directory).arg(thresholdBytes);
+        displayResultsPage(0);
         
-        process->start("bash", QStringList() << "-c" << findCommand);
+        QString message = m_querySummary.arg(totalResults);
+        if (totalResults > RESULTS_PER_PAGE) {
+            message += QString(" Showing page 1 of %1.").arg(totalPages);
+        }
+        m_statusLabel->setText(message);
     }
 
     void displayResultsPage(int page)
@@ -1565,19 +3749,83 @@ public slots:
 
         int row = 0;
         for (int i = startIdx; i < endIdx; i++) {
-            const QString &line = m_allResults[i];
-            QStringList parts = line.split('|');
-            if (parts.size() >= 3) {
-                QTableWidgetItem *nameItem = new QTableWidgetItem(parts[0].trimmed());
-                QTableWidgetItem *sizeItem = new QTableWidgetItem(parts[1].trimmed());
-                QTableWidgetItem *pathItem = new QTableWidgetItem(parts[2].trimmed());
-                
-                m_resultsTable->setItem(row, 0, nameItem);
-                m_resultsTable->setItem(row, 1, sizeItem);
-                m_resultsTable->setItem(row, 2, pathItem);
-                row++;
+            const FileMetadata &entry = m_allResults[i];
+            QTableWidgetItem *nameItem = new QTableWidgetItem(entry.path.mid(entry.path.lastIndexOf('/') + 1));
+            QTableWidgetItem *sizeItem = new SizeTableItem(entry.allocated);
+            QTableWidgetItem *pathItem = new QTableWidgetItem(entry.path);
+            
+            m_resultsTable->setItem(row, 0, nameItem);
+            m_resultsTable->setItem(row, 1, sizeItem);
+            m_resultsTable->setItem(row, 2, pathItem);
+            row++;
+        }
+    }
+
+    void deduplicateSelected()
+    {
+        QSet<int> selectedRows;
+        for (QTableWidgetItem *item : m_resultsTable->selectedItems()) {
+            selectedRows.insert(item->row());
+        }
+        
+        QStringList paths;
+        for (int row : selectedRows) {
+            QTableWidgetItem *pathItem = m_resultsTable->item(row, 2);
+            if (pathItem) {
+                paths << pathItem->text();
             }
         }
+        
+        if (paths.size() < 2) {
+            m_statusLabel->setText("Select at least two files in the results table to deduplicate");
+            return;
+        }
+        
+        bool allowHardlinks = m_hardlinkCheckBox->isChecked();
+        QMessageBox::StandardButton reply = QMessageBox::question(this,
+            "Confirm Deduplication",
+            QString("Replace identical copies among %1 selected files with %2?\nFile contents are compared byte by byte first.")
+                .arg(paths.size())
+                .arg(allowHardlinks ? "reflinks, or hardlinks where reflinks are unsupported" : "reflinks"),
+            QMessageBox::Yes | QMessageBox::No);
+            
+        if (reply == QMessageBox::No) {
+            return;
+        }
+        
+        DedupOptions options;
+        options.allowHardlinks = allowHardlinks;
+        
+        m_dedupButton->setEnabled(false);
+        m_statusLabel->setText(QString("Deduplicating %1 files...").arg(paths.size()));
+        m_dedupWatcher->setFuture(TaskScheduler::instance().run(TaskPriority::Interactive, QString(), [paths, options]() {
+            const DedupReport report = PrivilegedHelper::instance().deduplicate(paths, options);
+            FileMetadataCache::instance().invalidate(paths);
+            return report;
+        }));
+    }
+
+    void onDeduplicationFinished()
+    {
+        const DedupReport report = m_dedupWatcher->result();
+        m_dedupButton->setEnabled(true);
+        
+        QString summary = QString("Replaced %1 duplicates (%2 reflinked, %3 hardlinked): %4 deduplicated, %5 actually freed")
+            .arg(report.duplicates)
+            .arg(report.reflinked)
+            .arg(report.hardlinked)
+            .arg(QLocale().formattedDataSize(report.bytesDeduplicated))
+            .arg(QLocale().formattedDataSize(report.bytesFreed));
+        m_statusLabel->setText(summary);
+        
+        if (!report.errors.isEmpty()) {
+            QMessageBox::warning(this, "Deduplication",
+                summary + QString("\n\n%1 files could not be processed:\n%2")
+                    .arg(report.errors.size())
+                    .arg(report.errors.mid(0, 20).join("\n")));
+        } else {
+            QMessageBox::information(this, "Deduplication", summary);
+        }
     }
 
     void updatePaginationControls(int totalPages)
@@ -1590,7 +3838,18 @@ public slots:
             .arg(totalPages));
     }
 
+protected:
+    void showEvent(QShowEvent *event) override
+    {
+        QWidget::showEvent(event);
+        if (!m_populated) {
+            m_populated = true;
+            QTimer::singleShot(0, this, &DiskUsageAnalyzerWidget::refreshPartitions);
+        }
+    }
+
 private:
+    bool m_populated = false;
     QComboBox *m_partitionsCombo;
     QPushButton *m_refreshPartitionsButton;
     QLabel *m_sizeValueLabel;
@@ -1605,12 +3864,18 @@ private:
     QTableWidget *m_resultsTable;
     QLabel *m_statusLabel;
     
-    QStringList m_allResults;
+    QVector<FileMetadata> m_allResults;
+    QFutureWatcher<DiskQueryResult> *m_queryWatcher;
+    quint64 m_querySequence = 0;
+    QString m_querySummary;
     int m_currentPage = 0;
     static const int RESULTS_PER_PAGE = 200;
     QPushButton *m_prevPageButton;
     QPushButton *m_nextPageButton;
     QLabel *m_paginationLabel;
+    QPushButton *m_dedupButton;
+    QCheckBox *m_hardlinkCheckBox;
+    QFutureWatcher<DedupReport> *m_dedupWatcher;
 };
 
 class PacmanCacheCleaner : public QMainWindow
@@ -1618,78 +3883,153 @@ class PacmanCacheCleaner : public QMainWindow
     Q_OBJECT
 
 public:
+    enum Tab
+    {
+        CacheTab,
+        OrphanedTab,
+        LogsTab,
+        ServicesTab,
+        DiskUsageTab
+    };
+
     PacmanCacheCleaner(QWidget *parent = nullptr) : QMainWindow(parent)
     {
-        setWindowTitle("Pacman Cache Cleaner (Administrator)");
+        setWindowTitle("Pacman Cache Cleaner");
         setMinimumSize(750, 550);
 
         m_tabWidget = new QTabWidget(this);
         setCentralWidget(m_tabWidget);
         
-        m_cacheTab = new CacheManagementWidget(this);
-        m_orphanedTab = new OrphanedPackagesWidget(this);
-        m_logsTab = new SystemLogsWidget(this);
-        m_servicesTab = new SystemServicesWidget(this);
-        m_diskUsageTab = new DiskUsageAnalyzerWidget(this);
-        
-        m_tabWidget->addTab(m_cacheTab, "Cache Management");
-        m_tabWidget->addTab(m_orphanedTab, "Orphaned Packages");
-        m_tabWidget->addTab(m_logsTab, "System Logs");
-        m_tabWidget->addTab(m_servicesTab, "System Services");
-        m_tabWidget->addTab(m_diskUsageTab, "Disk Usage");
+        // Every page starts empty; a tab's widget is built the first time
+        // it is shown, and only starts its own work from there.
+        const QStringList titles = QStringList() << "Cache Management" << "Orphaned Packages" << "System Logs"
+                                                 << "System Services" << "Disk Usage";
+        for (const QString &title : titles) {
+            QWidget *page = new QWidget(this);
+            QVBoxLayout *layout = new QVBoxLayout(page);
+            layout->setContentsMargins(0, 0, 0, 0);
+            m_tabWidget->addTab(page, title);
+        }
         
         m_statusLabel = new QLabel("Ready", this);
         statusBar()->addWidget(m_statusLabel);
         
         connect(m_tabWidget, &QTabWidget::currentChanged, this, &PacmanCacheCleaner::onTabChanged);
+        ensureTab(m_tabWidget->currentIndex());
+        
+        // Scheduled rotation lives in the logs tab; build it (without
+        // scanning) once the window is up if the policy asks for it.
+        QTimer::singleShot(0, this, [this]() {
+            if (RotationPolicy::load().automatic) {
+                ensureTab(LogsTab);
+            }
+        });
     }
     
 private slots:
     void onTabChanged(int index)
     {
-        if (index == 1) {
+        ensureTab(index);
+        if (index == OrphanedTab) {
             m_orphanedTab->listOrphanedPackages();
         }
     }
 
 private:
+    void ensureTab(int index)
+    {
+        QWidget *page = m_tabWidget->widget(index);
+        if (!page || !page->layout()->isEmpty()) {
+            return;
+        }
+        
+        QWidget *tab = nullptr;
+        switch (index) {
+        case CacheTab:
+            tab = m_cacheTab = new CacheManagementWidget(page);
+            break;
+        case OrphanedTab:
+            tab = m_orphanedTab = new OrphanedPackagesWidget(page);
+            break;
+        case LogsTab:
+            tab = m_logsTab = new SystemLogsWidget(page);
+            // Kept here as well, for a services tab built later.
+            connect(m_logsTab, &SystemLogsWidget::logVolumesChanged, this, [this](const QHash<QString, quint64> &volumes) {
+                m_logVolumes = volumes;
+                if (m_servicesTab) {
+                    m_servicesTab->setLogVolumes(volumes);
+                }
+            });
+            connect(m_logsTab, &SystemLogsWidget::serviceRequested, this, [this](const QString &unit) {
+                m_tabWidget->setCurrentIndex(ServicesTab);
+                m_servicesTab->showService(unit);
+            });
+            break;
+        case ServicesTab:
+            tab = m_servicesTab = new SystemServicesWidget(page);
+            if (!m_logVolumes.isEmpty()) {
+                m_servicesTab->setLogVolumes(m_logVolumes);
+            }
+            break;
+        case DiskUsageTab:
+            tab = m_diskUsageTab = new DiskUsageAnalyzerWidget(page);
+            break;
+        default:
+            return;
+        }
+        page->layout()->addWidget(tab);
+    }
+
     QTabWidget *m_tabWidget;
-    CacheManagementWidget *m_cacheTab;
-    OrphanedPackagesWidget *m_orphanedTab;
-    SystemLogsWidget *m_logsTab;
-    SystemServicesWidget *m_servicesTab;
-    DiskUsageAnalyzerWidget *m_diskUsageTab;
+    CacheManagementWidget *m_cacheTab = nullptr;
+    OrphanedPackagesWidget *m_orphanedTab = nullptr;
+    SystemLogsWidget *m_logsTab = nullptr;
+    SystemServicesWidget *m_servicesTab = nullptr;
+    DiskUsageAnalyzerWidget *m_diskUsageTab = nullptr;
+    QHash<QString, quint64> m_logVolumes;
     QLabel *m_statusLabel;
 };
 
 #include "main.moc"
 
-bool isRoot()
+#ifdef PACMANCACHECLEANER_NO_MAIN
+
+// The end-to-end harness (tests/e2e) builds this file without main() and
+// drives the real window through this.
+QMainWindow *createMainWindow()
 {
-    return getuid() == 0;
+    return new PacmanCacheCleaner;
 }
 
+#else
+
 int main(int argc, char *argv[])
 {
+    if (argc > 1 && qstrcmp(argv[1], "--helper") == 0) {
+        // The allowlist is defined by the real system paths, whatever the
+        // caller's environment says.
+        qunsetenv("PACMAN_CACHE_CLEANER_SYSROOT");
+        QCoreApplication app(argc, argv);
+        // pkexec records who asked; sudo does the same in SUDO_UID.
+        bool ok = false;
+        uid_t client = qEnvironmentVariable("PKEXEC_UID").toUInt(&ok);
+        if (!ok) {
+            client = qEnvironmentVariable("SUDO_UID").toUInt(&ok);
+        }
+        return PrivilegedHelperServer::run(ok ? client : 0);
+    }
+    if (argc > 1 && BatchMode::isCommand(argv[1])) {
+        return BatchMode::run(argc, argv);
+    }
+    
     QApplication app(argc, argv);
     app.setApplicationName("Pacman Cache Cleaner");
     app.setApplicationDisplayName("Pacman Cache Cleaner");
     
-    if (!isRoot()) {
-        QMessageBox::information(nullptr, "Administrator Privileges Required",
-            "This application requires administrator privileges to function properly.\n"
-            "The application will now restart with elevated privileges.");
-        
-        QString execPath = QCoreApplication::applicationFilePath();
-        
-        QProcess process;
-        process.startDetached("pkexec", QStringList() << execPath);
-        
-        return 0;
-    }
-    
     PacmanCacheCleaner mainWindow;
     mainWindow.show();
     
     return app.exec();
-}
\ No newline at end of file
+}
+
+#endif // PACMANCACHECLEANER_NO_MAIN
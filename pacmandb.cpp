@@ -0,0 +1,222 @@
+#include "pacmandb.h"
+#include "compressedstream.h"
+#include "filemetadata.h"
+#include "tarstream.h"
+
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+
+#include <algorithm>
+
+namespace {
+
+QVector<SyncPackage> readSyncDbFile(const QString &dbFile)
+{
+    QVector<SyncPackage> packages;
+    PacmanSyncDb::readFile(dbFile, &packages);
+    return packages;
+}
+
+QString packageKey(const QString &name, const QString &version)
+{
+    return name + QLatin1Char(' ') + version;
+}
+
+} // namespace
+
+QHash<QString, InstalledPackage> PacmanLocalDb::read(const QString &path)
+{
+    QHash<QString, InstalledPackage> packages;
+
+    QDir dir(path);
+    const QStringList entries = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Unsorted);
+    packages.reserve(entries.size());
+
+    for (const QString &entry : entries) {
+        QFile desc(dir.filePath(entry) + "/desc");
+        if (!desc.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+        const QByteArray data = desc.readAll();
+
+        InstalledPackage package;
+        forEachDescField(data.constData(), data.size(), [&](const QByteArray &key, const QByteArray &value) {
+            if (key == "NAME") {
+                package.name = QString::fromUtf8(value);
+            } else if (key == "VERSION") {
+                package.version = QString::fromUtf8(value);
+            } else if (key == "SIZE") {
+                package.installedSize = value.toLongLong();
+            }
+        });
+
+        if (!package.name.isEmpty()) {
+            packages.insert(package.name, package);
+        }
+    }
+
+    return packages;
+}
+
+bool PacmanSyncDb::readFile(const QString &dbFile, QVector<SyncPackage> *packages, QString *error)
+{
+    const QString repo = QFileInfo(dbFile).completeBaseName();
+
+    TarStreamParser parser(
+        [](const QByteArray &name) {
+            return name.endsWith("/desc");
+        },
+        [&](const QByteArray &, const QByteArray &data) {
+            SyncPackage package;
+            package.repo = repo;
+            forEachDescField(data.constData(), data.size(), [&](const QByteArray &key, const QByteArray &value) {
+                if (key == "NAME") {
+                    package.name = QString::fromUtf8(value);
+                } else if (key == "VERSION") {
+                    package.version = QString::fromUtf8(value);
+                } else if (key == "FILENAME") {
+                    package.fileName = QString::fromUtf8(value);
+                } else if (key == "SHA256SUM") {
+                    package.sha256 = QByteArray::fromHex(value);
+                } else if (key == "CSIZE") {
+                    package.compressedSize = value.toLongLong();
+                }
+            });
+            if (!package.name.isEmpty()) {
+                packages->append(package);
+            }
+        });
+
+    bool malformed = false;
+    bool ok = CompressedStreamReader::readFile(dbFile, [&](const char *data, qint64 size) {
+        if (!parser.feed(data, size)) {
+            malformed = true;
+            return false;
+        }
+        return !parser.isFinished();
+    }, error);
+
+    if (malformed) {
+        if (error) {
+            *error = QString("%1 is not a valid pacman database").arg(dbFile);
+        }
+        return false;
+    }
+    return ok;
+}
+
+QVector<SyncPackage> PacmanSyncDb::readAll(const QString &path)
+{
+    QStringList dbFiles;
+    const QFileInfoList entries = QDir(path).entryInfoList(QStringList() << "*.db", QDir::Files);
+    for (const QFileInfo &entry : entries) {
+        dbFiles << entry.absoluteFilePath();
+    }
+
+    const QList<QVector<SyncPackage>> perDb = QtConcurrent::blockingMapped<QList<QVector<SyncPackage>>>(dbFiles, readSyncDbFile);
+
+    QVector<SyncPackage> packages;
+    for (const QVector<SyncPackage> &db : perDb) {
+        packages += db;
+    }
+    return packages;
+}
+
+bool PacmanCache::parseFileName(const QString &fileName, QString *name, QString *version)
+{
+    int suffix = fileName.indexOf(".pkg.tar");
+    if (suffix <= 0) {
+        return false;
+    }
+
+    const QString stem = fileName.left(suffix);
+    int archDash = stem.lastIndexOf('-');
+    int relDash = archDash > 0 ? stem.lastIndexOf('-', archDash - 1) : -1;
+    int verDash = relDash > 0 ? stem.lastIndexOf('-', relDash - 1) : -1;
+    if (verDash <= 0) {
+        return false;
+    }
+
+    *name = stem.left(verDash);
+    *version = stem.mid(verDash + 1, archDash - verDash - 1);
+    return true;
+}
+
+QVector<CachedPackage> PacmanCache::list(const QString &path)
+{
+    FileMetadataCache &metadata = FileMetadataCache::instance();
+    if (!metadata.hasTree(path)) {
+        metadata.scanTree(path);
+    }
+
+    const QString directory = QDir::cleanPath(path) + '/';
+    QVector<CachedPackage> cached;
+    for (const FileMetadata &entry : metadata.entriesUnder(path)) {
+        const QString fileName = entry.path.mid(directory.size());
+        if (fileName.contains('/') || !fileName.contains(".pkg.tar")
+            || fileName.endsWith(".sig") || fileName.endsWith(".part")) {
+            continue;
+        }
+
+        CachedPackage package;
+        if (!parseFileName(fileName, &package.name, &package.version)) {
+            continue;
+        }
+        package.fileName = fileName;
+        package.size = entry.size;
+        cached.append(package);
+    }
+
+    std::sort(cached.begin(), cached.end(), [](const CachedPackage &a, const CachedPackage &b) {
+        return a.fileName < b.fileName;
+    });
+    return cached;
+}
+
+void PacmanCache::classify(QVector<CachedPackage> &cached,
+                           const QHash<QString, InstalledPackage> &installed,
+                           const QVector<SyncPackage> &available)
+{
+    QHash<QString, const SyncPackage *> byKey;
+    QHash<QString, const SyncPackage *> byFileName;
+    byKey.reserve(available.size());
+    byFileName.reserve(available.size());
+    for (const SyncPackage &package : available) {
+        byKey.insert(packageKey(package.name, package.version), &package);
+        byFileName.insert(package.fileName, &package);
+    }
+
+    for (CachedPackage &package : cached) {
+        const SyncPackage *sync = byFileName.value(package.fileName);
+        if (sync) {
+            package.sha256 = sync->sha256;
+            package.expectedSize = sync->compressedSize > 0 ? sync->compressedSize : -1;
+        } else {
+            sync = byKey.value(packageKey(package.name, package.version));
+        }
+
+        auto it = installed.constFind(package.name);
+        if (it != installed.constEnd() && it->version == package.version) {
+            package.status = CachedPackage::Installed;
+        } else if (sync) {
+            package.status = CachedPackage::InRepo;
+        } else {
+            package.status = CachedPackage::Dead;
+        }
+    }
+}
+
+QString PacmanCache::statusName(CachedPackage::Status status)
+{
+    switch (status) {
+    case CachedPackage::Installed:
+        return "Installed";
+    case CachedPackage::InRepo:
+        return "In repository";
+    case CachedPackage::Dead:
+        break;
+    }
+    return "Dead";
+}
@@ -0,0 +1,127 @@
+#ifndef PACMANDB_H
+#define PACMANDB_H
+
+#include "fileutil.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+struct InstalledPackage
+{
+    QString name;
+    QString version;
+    qint64 installedSize = 0;
+};
+
+class PacmanLocalDb
+{
+public:
+    static QString defaultPath()
+    {
+        return systemRoot() + "/var/lib/pacman/local";
+    }
+
+    // Reads every <pkg>/desc entry of the local database, keyed by package name.
+    static QHash<QString, InstalledPackage> read(const QString &path = defaultPath());
+};
+
+struct SyncPackage
+{
+    QString repo;
+    QString name;
+    QString version;
+    QString fileName;
+    QByteArray sha256;
+    qint64 compressedSize = 0;
+};
+
+class PacmanSyncDb
+{
+public:
+    static QString defaultPath()
+    {
+        return systemRoot() + "/var/lib/pacman/sync";
+    }
+
+    // Streams one <repo>.db (tar, optionally gzip or zstd compressed) without
+    // extracting it to disk.
+    static bool readFile(const QString &dbFile, QVector<SyncPackage> *packages, QString *error = nullptr);
+
+    // Parses every *.db in the directory, one database per worker thread.
+    static QVector<SyncPackage> readAll(const QString &path = defaultPath());
+};
+
+struct CachedPackage
+{
+    enum Status
+    {
+        Installed,
+        InRepo,
+        Dead
+    };
+
+    QString fileName;
+    QString name;
+    QString version;
+    qint64 size = 0;
+    Status status = Dead;
+    QByteArray sha256;
+    qint64 expectedSize = -1;
+};
+
+class PacmanCache
+{
+public:
+    static QString defaultPath()
+    {
+        return systemRoot() + "/var/cache/pacman/pkg";
+    }
+
+    // Splits name-pkgver-pkgrel-arch.pkg.tar.* into name and pkgver-pkgrel.
+    static bool parseFileName(const QString &fileName, QString *name, QString *version);
+
+    // Package files directly in path, from the shared metadata cache (walking
+    // the directory first if it is not cached).
+    static QVector<CachedPackage> list(const QString &path = defaultPath());
+    static void classify(QVector<CachedPackage> &cached,
+                         const QHash<QString, InstalledPackage> &installed,
+                         const QVector<SyncPackage> &available);
+    static QString statusName(CachedPackage::Status status);
+};
+
+// Calls callback(key, value) for each %KEY% block of a pacman desc file.
+// Multi-line values are passed unsplit.
+template <typename Callback>
+void forEachDescField(const char *data, qint64 size, Callback callback)
+{
+    const char *p = data;
+    const char *end = data + size;
+
+    while (p < end) {
+        const char *lineEnd = p;
+        while (lineEnd < end && *lineEnd != '\n') {
+            ++lineEnd;
+        }
+
+        if (lineEnd - p > 2 && *p == '%' && lineEnd[-1] == '%') {
+            QByteArray key = QByteArray::fromRawData(p + 1, int(lineEnd - p - 2));
+            const char *valueStart = lineEnd < end ? lineEnd + 1 : end;
+            const char *valueEnd = valueStart;
+            while (valueEnd < end && !(*valueEnd == '\n' && (valueEnd == valueStart || valueEnd[-1] == '\n'))) {
+                ++valueEnd;
+            }
+            const char *trimmedEnd = valueEnd;
+            while (trimmedEnd > valueStart && trimmedEnd[-1] == '\n') {
+                --trimmedEnd;
+            }
+            callback(key, QByteArray::fromRawData(valueStart, int(trimmedEnd - valueStart)));
+            p = valueEnd;
+        } else {
+            p = lineEnd + 1;
+        }
+    }
+}
+
+#endif // PACMANDB_H
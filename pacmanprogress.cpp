@@ -0,0 +1,146 @@
+#include "pacmanprogress.h"
+
+RemovalProgressModel::RemovalProgressModel(QObject *parent) : QObject(parent)
+{
+}
+
+void RemovalProgressModel::start(const QStringList &packageNames)
+{
+    m_installed = PacmanLocalDb::read();
+    m_entries.clear();
+    m_indexByName.clear();
+    m_splitter.clear();
+    m_current = -1;
+    m_removedCount = 0;
+    m_bytesFreed = 0;
+
+    for (const QString &name : packageNames) {
+        addPackage(name);
+    }
+}
+
+qint64 RemovalProgressModel::totalBytes() const
+{
+    qint64 total = 0;
+    for (const Entry &entry : m_entries) {
+        total += entry.installedSize;
+    }
+    return total;
+}
+
+void RemovalProgressModel::feed(const QByteArray &chunk)
+{
+    m_splitter.append(chunk);
+    m_splitter.consume([this](const QByteArray &line) {
+        parseLine(line);
+    });
+}
+
+void RemovalProgressModel::finish(bool success)
+{
+    m_splitter.flush([this](const QByteArray &line) {
+        parseLine(line);
+    });
+
+    for (int i = 0; i < m_entries.size(); ++i) {
+        PackageState state = m_entries[i].state;
+        if (state == PackageState::Removing || state == PackageState::Pending) {
+            setState(i, success ? PackageState::Removed : PackageState::Failed);
+        }
+    }
+    m_current = -1;
+}
+
+void RemovalProgressModel::parseLine(const QByteArray &line)
+{
+    // Without a tty pacman prints one "(  3/200) removing name" line per package.
+    QByteArray text = line.trimmed();
+    int current = 0;
+    int total = 0;
+
+    if (text.startsWith('(')) {
+        int close = text.indexOf(')');
+        int slash = text.indexOf('/');
+        if (close < 0 || slash < 0 || slash > close) {
+            return;
+        }
+        current = text.mid(1, slash - 1).trimmed().toInt();
+        total = text.mid(slash + 1, close - slash - 1).trimmed().toInt();
+        text = text.mid(close + 1).trimmed();
+    }
+
+    static const QByteArray removingPrefix("removing ");
+    if (!text.startsWith(removingPrefix)) {
+        return;
+    }
+
+    QByteArray name = text.mid(removingPrefix.size());
+    int space = name.indexOf(' ');
+    if (space >= 0) {
+        name.truncate(space);
+    }
+    if (name.endsWith("...")) {
+        name.chop(3);
+    }
+    if (name.isEmpty()) {
+        return;
+    }
+
+    beginRemoving(QString::fromUtf8(name));
+    if (total > 0) {
+        emit transactionProgress(current, total);
+    }
+}
+
+void RemovalProgressModel::beginRemoving(const QString &name)
+{
+    if (m_current >= 0) {
+        setState(m_current, PackageState::Removed);
+    }
+
+    int index = m_indexByName.value(name, -1);
+    if (index < 0) {
+        // Recursive dependencies pulled in by -s are not in the selection.
+        index = addPackage(name);
+    }
+
+    m_current = index;
+    setState(index, PackageState::Removing);
+}
+
+void RemovalProgressModel::setState(int index, PackageState state)
+{
+    Entry &entry = m_entries[index];
+    if (entry.state == state) {
+        return;
+    }
+
+    entry.state = state;
+    if (state == PackageState::Removed) {
+        m_removedCount++;
+        m_bytesFreed += entry.installedSize;
+    }
+
+    emit packageStateChanged(index);
+    if (state == PackageState::Removed) {
+        emit bytesFreedChanged(m_bytesFreed);
+    }
+}
+
+int RemovalProgressModel::addPackage(const QString &name)
+{
+    Entry entry;
+    entry.name = name;
+
+    auto it = m_installed.constFind(name);
+    if (it != m_installed.constEnd()) {
+        entry.version = it->version;
+        entry.installedSize = it->installedSize;
+    }
+
+    int index = m_entries.size();
+    m_entries.append(entry);
+    m_indexByName.insert(name, index);
+    emit packageAdded(index);
+    return index;
+}
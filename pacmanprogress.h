@@ -0,0 +1,67 @@
+#ifndef PACMANPROGRESS_H
+#define PACMANPROGRESS_H
+
+#include "linesplitter.h"
+#include "pacmandb.h"
+
+#include <QtCore/QHash>
+#include <QtCore/QObject>
+#include <QtCore/QVector>
+
+// Tracks a running `pacman -R` transaction from its incrementally read output.
+class RemovalProgressModel : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class PackageState
+    {
+        Pending,
+        Removing,
+        Removed,
+        Failed
+    };
+
+    struct Entry
+    {
+        QString name;
+        QString version;
+        qint64 installedSize = 0;
+        PackageState state = PackageState::Pending;
+    };
+
+    explicit RemovalProgressModel(QObject *parent = nullptr);
+
+    void start(const QStringList &packageNames);
+    void feed(const QByteArray &chunk);
+    void finish(bool success);
+
+    int count() const { return m_entries.size(); }
+    const Entry &entry(int index) const { return m_entries[index]; }
+    int indexOf(const QString &name) const { return m_indexByName.value(name, -1); }
+    int removedCount() const { return m_removedCount; }
+    qint64 bytesFreed() const { return m_bytesFreed; }
+    qint64 totalBytes() const;
+
+signals:
+    void packageAdded(int index);
+    void packageStateChanged(int index);
+    void bytesFreedChanged(qint64 bytes);
+    void transactionProgress(int current, int total);
+
+private:
+    void parseLine(const QByteArray &line);
+    void beginRemoving(const QString &name);
+    void setState(int index, PackageState state);
+    int addPackage(const QString &name);
+
+    QHash<QString, InstalledPackage> m_installed;
+    QVector<Entry> m_entries;
+    QHash<QString, int> m_indexByName;
+    LineSplitter m_splitter;
+    int m_current = -1;
+    int m_removedCount = 0;
+    qint64 m_bytesFreed = 0;
+};
+
+#endif // PACMANPROGRESS_H
@@ -0,0 +1,1067 @@
+#include "privilegedhelper.h"
+#include "fileutil.h"
+#include "journalfiles.h"
+#include "logarchive.h"
+#include "logscanner.h"
+#include "pacmandb.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QProcess>
+#include <QtCore/QProcessEnvironment>
+#include <QtCore/QRegularExpression>
+#include <QtCore/QVector>
+#include <QtCore/QtEndian>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+const char RuntimeDirectory[] = "/run/pacman-cache-cleaner";
+const QDataStream::Version StreamVersion = QDataStream::Qt_5_0;
+// Long enough for someone to type a password into the polkit agent.
+const int ConnectTimeoutMs = 120000;
+// How long the helper stays after its last connection closed, so a client
+// that reconnects is not asked to authenticate again.
+const int IdleTimeoutMs = 60000;
+// Requests run concurrently so a long one (removing packages, archiving)
+// does not hold up the rest, but a client cannot make the helper start an
+// unbounded number of root threads.
+const int MaxConnections = 4;
+const int MaxConcurrentRequests = 8;
+const int OutputChunkSize = 1024 * 1024;
+
+class Reader : public QDataStream
+{
+public:
+    explicit Reader(const QByteArray &data) : QDataStream(data)
+    {
+        setVersion(StreamVersion);
+    }
+
+    bool ok() const
+    {
+        return status() == QDataStream::Ok;
+    }
+};
+
+template <typename... Args>
+QByteArray encode(const Args &... args)
+{
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(StreamVersion);
+    (out << ... << args);
+    return data;
+}
+
+QByteArray encodeResult(const CompressionResult &result)
+{
+    return encode(result.sourcePath, result.outputPath, result.inputBytes, result.outputBytes,
+                  result.elapsedMs, result.error);
+}
+
+void decodeResult(const QByteArray &data, CompressionResult *result)
+{
+    Reader in(data);
+    in >> result->sourcePath >> result->outputPath >> result->inputBytes >> result->outputBytes
+       >> result->elapsedMs >> result->error;
+}
+
+QByteArray encodeResult(const RotationReport &report)
+{
+    return encode(qint32(report.rotated), qint32(report.compressed), qint32(report.deleted),
+                  report.bytesRotated, report.elapsedMs, report.errors);
+}
+
+void decodeResult(const QByteArray &data, RotationReport *report)
+{
+    Reader in(data);
+    qint32 rotated = 0;
+    qint32 compressed = 0;
+    qint32 deleted = 0;
+    in >> rotated >> compressed >> deleted >> report->bytesRotated >> report->elapsedMs >> report->errors;
+    report->rotated = rotated;
+    report->compressed = compressed;
+    report->deleted = deleted;
+}
+
+QByteArray encodeResult(const ArchiveReport &report)
+{
+    return encode(report.ok, report.error, qint32(report.removed), report.bytesRemoved, report.removeErrors);
+}
+
+void decodeResult(const QByteArray &data, ArchiveReport *report)
+{
+    Reader in(data);
+    qint32 removed = 0;
+    in >> report->ok >> report->error >> removed >> report->bytesRemoved >> report->removeErrors;
+    report->removed = removed;
+}
+
+QByteArray encodeResult(const DedupReport &report)
+{
+    return encode(qint32(report.candidates), qint32(report.duplicates), qint32(report.reflinked),
+                  qint32(report.hardlinked), report.bytesDeduplicated, report.bytesFreed, report.errors);
+}
+
+void decodeResult(const QByteArray &data, DedupReport *report)
+{
+    Reader in(data);
+    qint32 candidates = 0;
+    qint32 duplicates = 0;
+    qint32 reflinked = 0;
+    qint32 hardlinked = 0;
+    in >> candidates >> duplicates >> reflinked >> hardlinked
+       >> report->bytesDeduplicated >> report->bytesFreed >> report->errors;
+    report->candidates = candidates;
+    report->duplicates = duplicates;
+    report->reflinked = reflinked;
+    report->hardlinked = hardlinked;
+}
+
+QByteArray frame(quint32 id, quint8 type, const QByteArray &arguments)
+{
+    char header[4 + HelperProtocol::HeaderSize];
+    qToLittleEndian<quint32>(HelperProtocol::HeaderSize + quint32(arguments.size()), header);
+    qToLittleEndian<quint32>(id, header + 4);
+    header[8] = char(type);
+
+    QByteArray data;
+    data.reserve(int(sizeof(header)) + arguments.size());
+    data.append(header, int(sizeof(header)));
+    data.append(arguments);
+    return data;
+}
+
+bool readFrame(int fd, quint32 *id, quint8 *type, QByteArray *arguments)
+{
+    char length[4];
+    if (readFully(fd, length, sizeof(length)) != qint64(sizeof(length))) {
+        return false;
+    }
+    const quint32 size = qFromLittleEndian<quint32>(length);
+    if (size < HelperProtocol::HeaderSize || size > HelperProtocol::MaxFrameSize) {
+        return false;
+    }
+    QByteArray body(int(size), Qt::Uninitialized);
+    if (readFully(fd, body.data(), size) != qint64(size)) {
+        return false;
+    }
+    *id = qFromLittleEndian<quint32>(body.constData());
+    *type = quint8(body.at(4));
+    *arguments = body.mid(int(HelperProtocol::HeaderSize));
+    return true;
+}
+
+// send() rather than write(): a peer that went away must not SIGPIPE us.
+bool sendAll(int fd, const QByteArray &data)
+{
+    const char *p = data.constData();
+    qint64 remaining = data.size();
+    while (remaining > 0) {
+        ssize_t n = ::send(fd, p, size_t(remaining), MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += n;
+        remaining -= n;
+    }
+    return true;
+}
+
+bool isUnder(const QString &path, const QString &root)
+{
+    return path.startsWith(root + '/');
+}
+
+// A file the helper may touch: the directory holding it, opened from an
+// allowlisted root without following any symlink, and its name there.
+// Everything after the check goes through directory, so a component
+// swapped for a symlink afterwards cannot redirect it.
+struct CheckedPath
+{
+    UniqueFd directory;
+    QByteArray name;
+    struct stat st;
+};
+
+// path must be a clean absolute path inside one of roots with no symlink
+// below the root. With mustExist it must be a regular file (not a
+// symlink); otherwise it must not exist yet.
+bool checkPath(const QString &path, const QStringList &roots, bool mustExist, CheckedPath *checked, QString *error)
+{
+    QString problem = QString("%1: outside %2").arg(path, roots.join(", "));
+    for (const QString &root : roots) {
+        if (isUnder(path, root)) {
+            checked->directory = openParentBeneath(root, path, &checked->name, &problem);
+            break;
+        }
+    }
+    if (!checked->directory.isValid()) {
+        *error = problem;
+        return false;
+    }
+
+    struct stat *st = &checked->st;
+    const int result = ::fstatat(checked->directory.get(), checked->name.constData(), st, AT_SYMLINK_NOFOLLOW);
+    if (!mustExist) {
+        if (result == 0 || errno != ENOENT) {
+            *error = QString("%1: already exists").arg(path);
+            return false;
+        }
+        return true;
+    }
+    if (result != 0) {
+        *error = errnoString(path);
+        return false;
+    }
+    if (!S_ISREG(st->st_mode)) {
+        *error = QString("%1: not a regular file").arg(path);
+        return false;
+    }
+    return true;
+}
+
+// Unlinks the logs LogArchive::create() archived, skipping any whose inode,
+// size or mtime no longer match what it read; those are left in place.
+QStringList removeArchivedSources(const QVector<ArchiveSource> &sources, const QStringList &roots, int *removed,
+                                  qint64 *bytesRemoved)
+{
+    QStringList errors;
+    for (const ArchiveSource &source : sources) {
+        CheckedPath checked;
+        QString problem;
+        const struct stat &st = checked.st;
+        if (source.size < 0) {
+            errors << QString("%1: changed while it was archived; kept").arg(source.path);
+        } else if (!checkPath(source.path, roots, true, &checked, &problem)) {
+            errors << problem;
+        } else if (quint64(st.st_dev) != source.device || quint64(st.st_ino) != source.inode
+                   || qint64(st.st_size) != source.size
+                   || qint64(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec != source.mtimeNs) {
+            errors << QString("%1: changed since it was archived; kept").arg(source.path);
+        } else if (::unlinkat(checked.directory.get(), checked.name.constData(), 0) != 0) {
+            errors << errnoString(source.path);
+        } else {
+            ++*removed;
+            *bytesRemoved += source.size;
+        }
+    }
+    return errors;
+}
+
+bool removePackages(const QStringList &names, const std::function<void(const QByteArray &)> &output,
+                    QByteArray *reply, QString *error)
+{
+    static const QRegularExpression validName("^[A-Za-z0-9@_+][A-Za-z0-9@._+-]*$");
+    for (const QString &name : names) {
+        if (!validName.match(name).hasMatch()) {
+            *error = QString("Invalid package name: %1").arg(name);
+            return false;
+        }
+    }
+
+    QProcess pacman;
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    environment.insert("LC_ALL", "C");
+    pacman.setProcessEnvironment(environment);
+    pacman.start("pacman", QStringList() << "-Rns" << "--noconfirm" << "--" << names);
+    if (!pacman.waitForStarted(-1)) {
+        *error = pacman.errorString();
+        return false;
+    }
+
+    QByteArray errors;
+    while (pacman.waitForReadyRead(-1)) {
+        const QByteArray chunk = pacman.readAllStandardOutput();
+        if (!chunk.isEmpty()) {
+            output(chunk);
+        }
+        errors += pacman.readAllStandardError();
+    }
+    pacman.waitForFinished(-1);
+    const QByteArray rest = pacman.readAllStandardOutput();
+    if (!rest.isEmpty()) {
+        output(rest);
+    }
+    errors += pacman.readAllStandardError();
+
+    *reply = encode(pacman.exitStatus() == QProcess::NormalExit && pacman.exitCode() == 0, errors);
+    return true;
+}
+
+std::atomic<int> liveConnections(0);
+
+std::mutex requestSlotsMutex;
+std::condition_variable requestSlotFreed;
+int runningRequests = 0;
+
+// Blocks the connection's reader, and so the client, while all slots are
+// taken.
+void acquireRequestSlot()
+{
+    std::unique_lock<std::mutex> lock(requestSlotsMutex);
+    requestSlotFreed.wait(lock, []() { return runningRequests < MaxConcurrentRequests; });
+    ++runningRequests;
+}
+
+void releaseRequestSlot()
+{
+    {
+        std::lock_guard<std::mutex> lock(requestSlotsMutex);
+        --runningRequests;
+    }
+    requestSlotFreed.notify_one();
+}
+
+struct Connection
+{
+    Connection(int socket, uid_t peerUid) : fd(socket), peer(peerUid)
+    {
+        ++liveConnections;
+    }
+
+    ~Connection()
+    {
+        ::close(fd);
+        --liveConnections;
+    }
+
+    void send(quint32 id, quint8 type, const QByteArray &arguments)
+    {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        sendAll(fd, frame(id, type, arguments));
+    }
+
+    int fd;
+    uid_t peer;
+    std::mutex writeMutex;
+};
+
+// Reads requests until the client hangs up; each runs on its own thread,
+// at most MaxConcurrentRequests at a time across all connections, which
+// keeps the connection open until it has replied.
+void serveConnection(std::shared_ptr<Connection> connection)
+{
+    quint32 id = 0;
+    quint8 type = 0;
+    QByteArray arguments;
+    while (readFrame(connection->fd, &id, &type, &arguments)) {
+        acquireRequestSlot();
+        std::thread([connection, id, type, arguments]() {
+            QByteArray reply;
+            QString error;
+            const bool ok = HelperOperations::execute(type, arguments, connection->peer,
+                [&connection, id](const QByteArray &chunk) {
+                    connection->send(id, HelperProtocol::Output, chunk);
+                }, &reply, &error);
+            if (ok) {
+                connection->send(id, HelperProtocol::Reply, reply);
+            } else {
+                connection->send(id, HelperProtocol::Error, encode(error));
+            }
+            releaseRequestSlot();
+        }).detach();
+    }
+}
+
+} // namespace
+
+QString HelperProtocol::socketPath(uid_t client)
+{
+    return QString("%1/helper-%2.sock").arg(RuntimeDirectory).arg(client);
+}
+
+bool HelperOperations::execute(quint8 type, const QByteArray &arguments, uid_t client,
+                               const std::function<void(const QByteArray &)> &output,
+                               QByteArray *reply, QString *error)
+{
+    const QStringList logRoot = QStringList() << LogScanner::defaultRoot();
+    Reader in(arguments);
+
+    switch (type) {
+    case HelperProtocol::RemoveFiles: {
+        QStringList paths;
+        in >> paths;
+        if (!in.ok()) {
+            break;
+        }
+        const QStringList roots = QStringList() << LogScanner::defaultRoot() << PacmanCache::defaultPath();
+        QStringList errors;
+        qint64 freed = 0;
+        for (const QString &path : paths) {
+            CheckedPath checked;
+            QString problem;
+            if (!checkPath(path, roots, true, &checked, &problem)) {
+                errors << problem;
+            } else if (::unlinkat(checked.directory.get(), checked.name.constData(), 0) != 0) {
+                errors << errnoString(path);
+            } else {
+                freed += qint64(checked.st.st_blocks) * 512;
+                // An archive's sidecar is useless without it.
+                const QByteArray index = QFile::encodeName(LogArchive::indexPath(QFile::decodeName(checked.name)));
+                struct stat st;
+                if (path.endsWith(".zst")
+                    && ::fstatat(checked.directory.get(), index.constData(), &st, AT_SYMLINK_NOFOLLOW) == 0
+                    && S_ISREG(st.st_mode)) {
+                    if (::unlinkat(checked.directory.get(), index.constData(), 0) != 0) {
+                        errors << errnoString(LogArchive::indexPath(path));
+                    } else {
+                        freed += qint64(st.st_blocks) * 512;
+                    }
+                }
+            }
+        }
+        *reply = encode(errors, freed);
+        return true;
+    }
+
+    case HelperProtocol::ClearPackageCache: {
+        QStringList errors;
+        const QDir cache(PacmanCache::defaultPath());
+        for (const QFileInfo &entry : cache.entryInfoList(QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot)) {
+            const bool removed = entry.isDir() && !entry.isSymLink()
+                ? QDir(entry.filePath()).removeRecursively()
+                : QFile::remove(entry.filePath());
+            if (!removed) {
+                errors << QString("%1: could not be removed").arg(entry.filePath());
+            }
+        }
+        *reply = encode(errors);
+        return true;
+    }
+
+    case HelperProtocol::RemovePackages: {
+        QStringList names;
+        in >> names;
+        if (!in.ok() || names.isEmpty()) {
+            break;
+        }
+        return removePackages(names, output, reply, error);
+    }
+
+    case HelperProtocol::CompressLog: {
+        QString path;
+        quint8 codec = 0;
+        in >> path >> codec;
+        if (!in.ok() || codec > quint8(CompressionCodec::Zstd)) {
+            break;
+        }
+        CompressionResult result;
+        CheckedPath checked;
+        if (checkPath(path, logRoot, true, &checked, &result.error)) {
+            result = LogCompressor::compressFileAt(checked.directory.get(), path, CompressionCodec(codec));
+        } else {
+            result.sourcePath = path;
+        }
+        *reply = encodeResult(result);
+        return true;
+    }
+
+    case HelperProtocol::CreateArchive: {
+        QString archivePath;
+        QStringList files;
+        qint32 level = 0;
+        in >> archivePath >> files >> level;
+        if (!in.ok()) {
+            break;
+        }
+        CheckedPath checked;
+        ArchiveReport report;
+        QString &problem = report.error;
+        bool ok = checkPath(archivePath, logRoot, false, &checked, &problem)
+               && checkPath(LogArchive::indexPath(archivePath), logRoot, false, &checked, &problem);
+        // Under a log name the next scan would list, rotate or archive it.
+        if (ok && LogScanner::isLogFileName(QFile::encodeName(QFileInfo(archivePath).fileName()).constData())) {
+            ok = false;
+            problem = QString("%1: named like a log file").arg(archivePath);
+        }
+        for (int i = 0; ok && i < files.size(); ++i) {
+            ok = checkPath(files.at(i), logRoot, true, &checked, &problem);
+        }
+        QVector<ArchiveSource> sources;
+        if (ok) {
+            ok = LogArchive::create(archivePath, files, qBound(1, int(level), 19), &problem, &sources);
+        }
+        // Both files stay root's; the client reads them through
+        // ListArchive and QueryArchive.
+        // The archive and its index are durable; only now drop the originals,
+        // and only those still as they were read.
+        if (ok) {
+            report.removeErrors = removeArchivedSources(sources, logRoot, &report.removed, &report.bytesRemoved);
+        }
+        report.ok = ok;
+        *reply = encodeResult(report);
+        return true;
+    }
+
+    case HelperProtocol::RotateLogs: {
+        QByteArray policy;
+        in >> policy;
+        if (!in.ok()) {
+            break;
+        }
+        // The plan only ever covers what LogScanner finds under /var/log.
+        *reply = encodeResult(LogRotator::execute(LogRotator::plan(RotationPolicy::fromJson(policy), LogScanner::scan(),
+                                                                   LogRotator::openFiles(),
+                                                                   QDateTime::currentSecsSinceEpoch())));
+        return true;
+    }
+
+    case HelperProtocol::VacuumJournal: {
+        QStringList paths;
+        in >> paths;
+        if (!in.ok()) {
+            break;
+        }
+        const QStringList roots = QStringList() << JournalFiles::defaultRoot();
+        QStringList errors;
+        qint64 freed = 0;
+        for (const QString &path : paths) {
+            CheckedPath checked;
+            QString problem;
+            // Re-reads the header and skips files that are no longer archived.
+            if (!checkPath(path, roots, true, &checked, &problem)
+                || !JournalFiles::removeAt(checked.directory.get(), path, &freed, &problem)) {
+                errors << problem;
+            }
+        }
+        *reply = encode(errors, freed);
+        return true;
+    }
+
+    case HelperProtocol::Deduplicate: {
+        QStringList paths;
+        bool allowHardlinks = false;
+        in >> paths >> allowHardlinks;
+        if (!in.ok()) {
+            break;
+        }
+        // Sharing extents or hardlinking rewrites the duplicate's directory
+        // entry or inode, so only the client's own files in its own
+        // directories qualify. FileDeduplicator checks again on the opened
+        // files, which a swapped symlink cannot get past.
+        for (const QString &path : paths) {
+            struct stat st;
+            struct stat directory;
+            if (!QDir::isAbsolutePath(path) || ::lstat(QFile::encodeName(path).constData(), &st) != 0
+                || !S_ISREG(st.st_mode)) {
+                *error = QString("%1: not a regular file").arg(path);
+                return false;
+            }
+            if (client != 0
+                && (st.st_uid != client
+                    || ::stat(QFile::encodeName(QFileInfo(path).absolutePath()).constData(), &directory) != 0
+                    || directory.st_uid != client || !(directory.st_mode & S_IWUSR))) {
+                *error = QString("%1: only your own files in directories you own can be deduplicated").arg(path);
+                return false;
+            }
+        }
+        DedupOptions options;
+        options.allowHardlinks = allowHardlinks;
+        if (client != 0) {
+            options.owner = client;
+        }
+        *reply = encodeResult(FileDeduplicator::run(paths, options));
+        return true;
+    }
+
+    case HelperProtocol::ListArchive: {
+        QString archivePath;
+        in >> archivePath;
+        if (!in.ok()) {
+            break;
+        }
+        CheckedPath checked;
+        QString problem;
+        LogArchive archive;
+        const bool ok = checkPath(archivePath, logRoot, true, &checked, &problem) && archive.open(archivePath, &problem);
+        QStringList names;
+        QVector<qint64> sizes;
+        for (const ArchiveMember &member : archive.members()) {
+            names << member.name;
+            sizes << member.size;
+        }
+        *reply = encode(ok, problem, names, sizes, qint32(archive.blocks().size()));
+        return true;
+    }
+
+    case HelperProtocol::QueryArchive: {
+        QString archivePath;
+        qint64 from = 0;
+        qint64 to = 0;
+        QString member;
+        in >> archivePath >> from >> to >> member;
+        if (!in.ok()) {
+            break;
+        }
+        CheckedPath checked;
+        LogArchive archive;
+        ArchiveQueryResult result;
+        if (checkPath(archivePath, logRoot, true, &checked, &result.error)
+            && archive.open(archivePath, &result.error)) {
+            result = archive.queryTimeRange(from, to, member);
+        }
+        // The lines can outgrow a frame, so they go out as Output.
+        for (int offset = 0; offset < result.text.size(); offset += OutputChunkSize) {
+            output(result.text.mid(offset, OutputChunkSize));
+        }
+        *reply = encode(qint32(result.blocksRead), qint32(result.blocksTotal), result.elapsedMs, result.error);
+        return true;
+    }
+
+    default:
+        break;
+    }
+
+    *error = QString("Malformed or unknown request (type %1)").arg(type);
+    return false;
+}
+
+int PrivilegedHelperServer::run(uid_t client)
+{
+    if (::geteuid() != 0) {
+        qWarning("The helper must run as root");
+        return 1;
+    }
+
+    struct stat st;
+    if (::mkdir(RuntimeDirectory, 0755) != 0 && errno != EEXIST) {
+        qWarning("%s", qPrintable(errnoString(RuntimeDirectory)));
+        return 1;
+    }
+    if (::lstat(RuntimeDirectory, &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != 0) {
+        qWarning("%s is not a directory owned by root", RuntimeDirectory);
+        return 1;
+    }
+
+    const QByteArray path = QFile::encodeName(HelperProtocol::socketPath(client));
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (size_t(path.size()) >= sizeof(address.sun_path)) {
+        return 1;
+    }
+    memcpy(address.sun_path, path.constData(), size_t(path.size()));
+
+    UniqueFd listener(::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    ::unlink(path.constData());
+    const mode_t mask = ::umask(0077);
+    const bool bound = listener.isValid()
+        && ::bind(listener.get(), reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) == 0;
+    ::umask(mask);
+    if (!bound || ::chown(path.constData(), client, 0) != 0 || ::listen(listener.get(), 16) != 0) {
+        qWarning("%s", qPrintable(errnoString(QFile::decodeName(path))));
+        return 1;
+    }
+
+    // Until the first connection the client that launched us is still
+    // waiting for it, for at most ConnectTimeoutMs; the idle timeout only
+    // runs once the last connection has closed.
+    QElapsedTimer idle;
+    idle.start();
+    bool served = false;
+    for (;;) {
+        struct pollfd pending = { listener.get(), POLLIN, 0 };
+        if (::poll(&pending, 1, 1000) > 0) {
+            int fd = ::accept4(listener.get(), nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0) {
+                continue;
+            }
+            struct ucred peer;
+            socklen_t length = sizeof(peer);
+            if (::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &peer, &length) != 0
+                || (peer.uid != client && peer.uid != 0) || liveConnections >= MaxConnections) {
+                ::close(fd);
+                continue;
+            }
+            served = true;
+            std::thread(serveConnection, std::make_shared<Connection>(fd, peer.uid)).detach();
+            continue;
+        }
+        if (served && liveConnections > 0) {
+            idle.restart();
+        } else if (idle.elapsed() > (served ? IdleTimeoutMs : ConnectTimeoutMs)) {
+            break;
+        }
+    }
+
+    ::unlink(path.constData());
+    return 0;
+}
+
+PrivilegedHelper &PrivilegedHelper::instance()
+{
+    static PrivilegedHelper helper;
+    return helper;
+}
+
+PrivilegedHelper::PrivilegedHelper()
+{
+}
+
+PrivilegedHelper::~PrivilegedHelper()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_fd >= 0) {
+            ::shutdown(m_fd, SHUT_RDWR);
+        }
+    }
+    if (m_reader.joinable()) {
+        m_reader.join();
+    }
+}
+
+bool PrivilegedHelper::launcherRunning() const
+{
+    // pkexec, then the helper it becomes; root-owned, so EPERM means alive.
+    return m_launcher > 0 && (::kill(m_launcher, 0) == 0 || errno == EPERM);
+}
+
+void PrivilegedHelper::launch()
+{
+    qint64 pid = 0;
+    if (QProcess::startDetached("pkexec", QStringList() << QCoreApplication::applicationFilePath() << "--helper",
+                                QString(), &pid)) {
+        m_launcher = pid_t(pid);
+    }
+}
+
+bool PrivilegedHelper::isRunning()
+{
+    QString error;
+    return ::geteuid() == 0 || connection(&error, false) >= 0;
+}
+
+int PrivilegedHelper::connection(QString *error, bool launchIfNeeded)
+{
+    std::lock_guard<std::mutex> connectLock(m_connectMutex);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_fd >= 0) {
+            return m_fd;
+        }
+    }
+    // The previous connection's reader has closed its socket and is exiting.
+    if (m_reader.joinable()) {
+        m_reader.join();
+    }
+
+    const QByteArray path = QFile::encodeName(HelperProtocol::socketPath(::getuid()));
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path.constData(), qMin(size_t(path.size()), sizeof(address.sun_path) - 1));
+
+    QElapsedTimer timer;
+    timer.start();
+    bool launched = false;
+    while (timer.elapsed() < ConnectTimeoutMs) {
+        UniqueFd fd(::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+        if (fd.isValid() && ::connect(fd.get(), reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) == 0) {
+            struct ucred peer;
+            socklen_t length = sizeof(peer);
+            if (::getsockopt(fd.get(), SOL_SOCKET, SO_PEERCRED, &peer, &length) != 0 || peer.uid != 0) {
+                *error = QString("%1 is not served by root").arg(QFile::decodeName(path));
+                return -1;
+            }
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_fd = fd.release();
+            m_reader = std::thread(&PrivilegedHelper::readReplies, this, m_fd);
+            return m_fd;
+        }
+
+        if (!launchIfNeeded) {
+            *error = "The privileged helper is not running";
+            return -1;
+        }
+        if (!launcherRunning()) {
+            if (launched) {
+                *error = "The privileged helper did not start (authentication failed or was cancelled)";
+                return -1;
+            }
+            launch();
+            launched = true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    *error = "Timed out waiting for the privileged helper";
+    return -1;
+}
+
+void PrivilegedHelper::readReplies(int fd)
+{
+    quint32 id = 0;
+    quint8 type = 0;
+    QByteArray arguments;
+    while (readFrame(fd, &id, &type, &arguments)) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        Pending *pending = m_pending.value(id);
+        if (!pending) {
+            continue;
+        }
+        if (type == HelperProtocol::Output) {
+            // The caller stays blocked until its Reply, so pending outlives this.
+            lock.unlock();
+            if (pending->output) {
+                pending->output(arguments);
+            }
+            continue;
+        }
+        pending->ok = type == HelperProtocol::Reply;
+        if (pending->ok) {
+            pending->reply = arguments;
+        } else {
+            Reader in(arguments);
+            in >> pending->error;
+        }
+        pending->done = true;
+        m_pending.remove(id);
+        m_replied.notify_all();
+    }
+
+    std::lock_guard<std::mutex> writeLock(m_writeMutex);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ::close(fd);
+    m_fd = -1;
+    for (Pending *pending : qAsConst(m_pending)) {
+        pending->done = true;
+        pending->error = "The privileged helper exited";
+    }
+    m_pending.clear();
+    m_replied.notify_all();
+}
+
+bool PrivilegedHelper::call(quint8 type, const QByteArray &arguments, QByteArray *reply, QString *error,
+                            const std::function<void(const QByteArray &)> &output)
+{
+    if (::geteuid() == 0) {
+        std::function<void(const QByteArray &)> sink = output;
+        if (!sink) {
+            sink = [](const QByteArray &) {};
+        }
+        return HelperOperations::execute(type, arguments, 0, sink, reply, error);
+    }
+    if (quint32(arguments.size()) > HelperProtocol::MaxFrameSize - HelperProtocol::HeaderSize) {
+        *error = "Request too large for the privileged helper";
+        return false;
+    }
+    if (connection(error) < 0) {
+        return false;
+    }
+
+    Pending pending;
+    pending.output = output;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    const quint32 id = m_nextId++;
+    m_pending.insert(id, &pending);
+    lock.unlock();
+
+    {
+        std::lock_guard<std::mutex> writeLock(m_writeMutex);
+        std::lock_guard<std::mutex> stateLock(m_mutex);
+        // The reader closes the socket under both locks, so m_fd is either
+        // this connection or -1, never a reused descriptor.
+        if (m_fd < 0 || !sendAll(m_fd, frame(id, type, arguments))) {
+            m_pending.remove(id);
+            pending.done = true;
+            pending.error = "Lost the connection to the privileged helper";
+        }
+    }
+
+    lock.lock();
+    m_replied.wait(lock, [&pending]() {
+        return pending.done;
+    });
+    if (pending.ok) {
+        *reply = pending.reply;
+    } else {
+        *error = pending.error;
+    }
+    return pending.ok;
+}
+
+QStringList PrivilegedHelper::removeFiles(const QStringList &paths, qint64 *bytesFreed)
+{
+    QByteArray reply;
+    QString error;
+    if (!call(HelperProtocol::RemoveFiles, encode(paths), &reply, &error)) {
+        return QStringList() << error;
+    }
+    QStringList errors;
+    qint64 freed = 0;
+    Reader in(reply);
+    in >> errors >> freed;
+    if (bytesFreed) {
+        *bytesFreed += freed;
+    }
+    return errors;
+}
+
+bool PrivilegedHelper::clearPackageCache(QString *error)
+{
+    QByteArray reply;
+    QString failure;
+    QStringList errors;
+    if (call(HelperProtocol::ClearPackageCache, QByteArray(), &reply, &failure)) {
+        Reader in(reply);
+        in >> errors;
+    } else {
+        errors << failure;
+    }
+    if (!errors.isEmpty() && error) {
+        *error = errors.join("\n");
+    }
+    return errors.isEmpty();
+}
+
+bool PrivilegedHelper::removePackages(const QStringList &names, const std::function<void(const QByteArray &)> &output,
+                                      QString *error)
+{
+    QByteArray reply;
+    QString failure;
+    if (!call(HelperProtocol::RemovePackages, encode(names), &reply, &failure, output)) {
+        if (error) {
+            *error = failure;
+        }
+        return false;
+    }
+    bool ok = false;
+    QByteArray errors;
+    Reader in(reply);
+    in >> ok >> errors;
+    if (!ok && error) {
+        *error = QString::fromLocal8Bit(errors);
+    }
+    return ok;
+}
+
+CompressionResult PrivilegedHelper::compressLog(const QString &path, CompressionCodec codec)
+{
+    CompressionResult result;
+    QByteArray reply;
+    if (call(HelperProtocol::CompressLog, encode(path, quint8(codec)), &reply, &result.error)) {
+        decodeResult(reply, &result);
+    } else {
+        result.sourcePath = path;
+    }
+    return result;
+}
+
+ArchiveReport PrivilegedHelper::createArchive(const QString &archivePath, const QStringList &files, int level)
+{
+    ArchiveReport report;
+    QByteArray reply;
+    if (call(HelperProtocol::CreateArchive, encode(archivePath, files, qint32(level)), &reply, &report.error)) {
+        decodeResult(reply, &report);
+    }
+    return report;
+}
+
+bool PrivilegedHelper::listArchive(const QString &archivePath, QVector<ArchiveMember> *members, int *blockCount,
+                                   QString *error)
+{
+    QByteArray reply;
+    QString failure;
+    bool ok = false;
+    if (call(HelperProtocol::ListArchive, encode(archivePath), &reply, &failure)) {
+        Reader in(reply);
+        QStringList names;
+        QVector<qint64> sizes;
+        qint32 blocks = 0;
+        in >> ok >> failure >> names >> sizes >> blocks;
+        for (int i = 0; i < names.size() && i < sizes.size(); ++i) {
+            ArchiveMember member;
+            member.name = names.at(i);
+            member.size = sizes.at(i);
+            members->append(member);
+        }
+        *blockCount = blocks;
+    }
+    if (!ok && error) {
+        *error = failure;
+    }
+    return ok;
+}
+
+ArchiveQueryResult PrivilegedHelper::queryArchive(const QString &archivePath, qint64 from, qint64 to,
+                                                  const QString &member)
+{
+    ArchiveQueryResult result;
+    QByteArray reply;
+    // Output arrives in order on the reader thread, before the reply.
+    if (call(HelperProtocol::QueryArchive, encode(archivePath, from, to, member), &reply, &result.error,
+             [&result](const QByteArray &chunk) { result.text += chunk; })) {
+        Reader in(reply);
+        qint32 blocksRead = 0;
+        qint32 blocksTotal = 0;
+        in >> blocksRead >> blocksTotal >> result.elapsedMs >> result.error;
+        result.blocksRead = blocksRead;
+        result.blocksTotal = blocksTotal;
+    }
+    return result;
+}
+
+RotationReport PrivilegedHelper::rotateLogs(const RotationPolicy &policy)
+{
+    RotationReport report;
+    QByteArray reply;
+    QString error;
+    if (call(HelperProtocol::RotateLogs, encode(policy.toJson()), &reply, &error)) {
+        decodeResult(reply, &report);
+    } else {
+        report.errors << error;
+    }
+    return report;
+}
+
+QStringList PrivilegedHelper::vacuumJournal(const QStringList &paths, qint64 *bytesFreed)
+{
+    QByteArray reply;
+    QString error;
+    if (!call(HelperProtocol::VacuumJournal, encode(paths), &reply, &error)) {
+        return QStringList() << error;
+    }
+    QStringList errors;
+    qint64 freed = 0;
+    Reader in(reply);
+    in >> errors >> freed;
+    if (bytesFreed) {
+        *bytesFreed += freed;
+    }
+    return errors;
+}
+
+DedupReport PrivilegedHelper::deduplicate(const QStringList &paths, const DedupOptions &options)
+{
+    DedupReport report;
+    QByteArray reply;
+    QString error;
+    if (call(HelperProtocol::Deduplicate, encode(paths, options.allowHardlinks), &reply, &error)) {
+        decodeResult(reply, &report);
+    } else {
+        report.errors << error;
+    }
+    return report;
+}
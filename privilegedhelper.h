@@ -0,0 +1,148 @@
+#ifndef PRIVILEGEDHELPER_H
+#define PRIVILEGEDHELPER_H
+
+#include "dedup.h"
+#include "logarchive.h"
+#include "logcompressor.h"
+#include "logrotation.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <sys/types.h>
+#include <thread>
+
+// Frames in both directions: a 4-byte little-endian length of the rest, a
+// 4-byte request id, a 1-byte type, then the arguments as a QDataStream
+// (raw bytes for Output). Every request is answered by any number of Output
+// frames followed by exactly one Reply or Error frame with the same id;
+// requests on one connection run concurrently, so replies may come back out
+// of order.
+namespace HelperProtocol {
+
+enum Type : quint8
+{
+    // The allowlist: nothing else is accepted.
+    RemoveFiles = 1,
+    ClearPackageCache,
+    RemovePackages,
+    CompressLog,
+    CreateArchive,
+    RotateLogs,
+    VacuumJournal,
+    Deduplicate,
+    ListArchive,
+    QueryArchive,
+
+    Output = 0x80,
+    Reply,
+    Error
+};
+
+const quint32 HeaderSize = 5;
+const quint32 MaxFrameSize = 16 * 1024 * 1024;
+
+// Owned by root, created by the helper, chowned to the one user it serves.
+QString socketPath(uid_t client);
+
+} // namespace HelperProtocol
+
+// Checks and runs one request on behalf of client. Used by the helper
+// process, and in process when the GUI itself runs as root.
+class HelperOperations
+{
+public:
+    static bool execute(quint8 type, const QByteArray &arguments, uid_t client,
+                        const std::function<void(const QByteArray &)> &output,
+                        QByteArray *reply, QString *error);
+};
+
+// The privileged side, `PacmanCacheCleaner --helper` started through
+// pkexec. Serves client (and root) until a minute after the last connection
+// closes, or exits if nobody connects within two minutes.
+class PrivilegedHelperServer
+{
+public:
+    static int run(uid_t client);
+};
+
+// The GUI side. Calls block the calling thread until the helper replies, so
+// they belong on worker threads; calls from several threads share the one
+// connection and run in parallel in the helper.
+class PrivilegedHelper
+{
+public:
+    static PrivilegedHelper &instance();
+
+    ~PrivilegedHelper();
+
+    // The first call launches the helper through pkexec and waits for it,
+    // so the polkit prompt comes with the operation that needs it.
+    // isRunning() only connects to a helper that is already up, and never
+    // prompts; always true as root.
+    bool isRunning();
+
+    QStringList removeFiles(const QStringList &paths, qint64 *bytesFreed = nullptr);
+    bool clearPackageCache(QString *error = nullptr);
+    // output receives pacman's stdout as it is produced, on an internal thread.
+    bool removePackages(const QStringList &names, const std::function<void(const QByteArray &)> &output,
+                        QString *error = nullptr);
+    CompressionResult compressLog(const QString &path, CompressionCodec codec);
+    ArchiveReport createArchive(const QString &archivePath, const QStringList &files, int level);
+    // Archives under /var/log stay root's; these read them for the client.
+    bool listArchive(const QString &archivePath, QVector<ArchiveMember> *members, int *blockCount,
+                     QString *error = nullptr);
+    ArchiveQueryResult queryArchive(const QString &archivePath, qint64 from, qint64 to, const QString &member);
+    RotationReport rotateLogs(const RotationPolicy &policy);
+    QStringList vacuumJournal(const QStringList &paths, qint64 *bytesFreed = nullptr);
+    DedupReport deduplicate(const QStringList &paths, const DedupOptions &options);
+
+private:
+    struct Pending
+    {
+        bool done = false;
+        bool ok = false;
+        QByteArray reply;
+        QString error;
+        std::function<void(const QByteArray &)> output;
+    };
+
+    PrivilegedHelper();
+
+    bool launcherRunning() const;
+    void launch();
+    bool call(quint8 type, const QByteArray &arguments, QByteArray *reply, QString *error,
+              const std::function<void(const QByteArray &)> &output = nullptr);
+    int connection(QString *error, bool launchIfNeeded = true);
+    void readReplies(int fd);
+
+    std::mutex m_connectMutex;
+    std::mutex m_writeMutex;
+    std::mutex m_mutex;
+    std::condition_variable m_replied;
+    int m_fd = -1;
+    pid_t m_launcher = 0;
+    quint32 m_nextId = 1;
+    QHash<quint32, Pending *> m_pending;
+    std::thread m_reader;
+};
+
+// Functor form of compressLog for QtConcurrent::mapped, like CompressFileJob.
+struct PrivilegedCompressJob
+{
+    typedef CompressionResult result_type;
+
+    CompressionCodec codec;
+
+    CompressionResult operator()(const QString &path) const
+    {
+        return PrivilegedHelper::instance().compressLog(path, codec);
+    }
+};
+
+#endif // PRIVILEGEDHELPER_H
@@ -0,0 +1,99 @@
+#include "resultcache.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QSaveFile>
+#include <QtCore/QStandardPaths>
+#include <QtCore/QtEndian>
+
+#include <cstring>
+
+namespace {
+
+const char Magic[4] = { 'P', 'C', 'R', 'C' };
+const int HeaderSize = 4 + 4 + 8;
+
+} // namespace
+
+QString ResultCache::defaultDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+}
+
+QString ResultCache::path(const QString &name)
+{
+    return defaultDirectory() + "/" + name + ".cache";
+}
+
+bool ResultCache::read(const QString &name, QByteArray *data, qint64 *storedSecs)
+{
+    QFile file(path(name));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const QByteArray contents = file.readAll();
+    if (contents.size() < HeaderSize || memcmp(contents.constData(), Magic, sizeof(Magic)) != 0
+        || qFromLittleEndian<quint32>(contents.constData() + 4) != FormatVersion) {
+        return false;
+    }
+    if (storedSecs) {
+        *storedSecs = qFromLittleEndian<qint64>(contents.constData() + 8);
+    }
+    *data = contents.mid(HeaderSize);
+    return true;
+}
+
+void ResultCache::write(const QString &name, const QByteArray &data)
+{
+    // Best effort: a cache that cannot be written only costs the next start
+    // its head start.
+    QDir().mkpath(defaultDirectory());
+    QByteArray header(HeaderSize, Qt::Uninitialized);
+    memcpy(header.data(), Magic, sizeof(Magic));
+    qToLittleEndian<quint32>(FormatVersion, header.data() + 4);
+    qToLittleEndian<qint64>(QDateTime::currentSecsSinceEpoch(), header.data() + 8);
+
+    QSaveFile file(path(name));
+    if (file.open(QIODevice::WriteOnly) && file.write(header) == header.size() && file.write(data) == data.size()) {
+        file.commit();
+    }
+}
+
+QDataStream &operator<<(QDataStream &out, const CachedPackage &package)
+{
+    return out << package.fileName << package.name << package.version << package.size << qint32(package.status)
+               << package.sha256 << package.expectedSize;
+}
+
+QDataStream &operator>>(QDataStream &in, CachedPackage &package)
+{
+    qint32 status = 0;
+    in >> package.fileName >> package.name >> package.version >> package.size >> status >> package.sha256
+       >> package.expectedSize;
+    package.status = status >= CachedPackage::Installed && status <= CachedPackage::Dead
+        ? CachedPackage::Status(status) : CachedPackage::Dead;
+    return in;
+}
+
+QDataStream &operator<<(QDataStream &out, const LogFileInfo &log)
+{
+    return out << log.path << log.size << log.allocated << log.mtime << log.device << log.inode << log.compressed;
+}
+
+QDataStream &operator>>(QDataStream &in, LogFileInfo &log)
+{
+    return in >> log.path >> log.size >> log.allocated >> log.mtime >> log.device >> log.inode >> log.compressed;
+}
+
+QDataStream &operator<<(QDataStream &out, const ServiceUnit &unit)
+{
+    return out << unit.name << unit.description << unit.loadState << unit.activeState << unit.subState
+               << unit.unitFileState << unit.objectPath;
+}
+
+QDataStream &operator>>(QDataStream &in, ServiceUnit &unit)
+{
+    return in >> unit.name >> unit.description >> unit.loadState >> unit.activeState >> unit.subState
+              >> unit.unitFileState >> unit.objectPath;
+}
@@ -0,0 +1,69 @@
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include "logscanner.h"
+#include "pacmandb.h"
+#include "systemdunits.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QDataStream>
+#include <QtCore/QIODevice>
+#include <QtCore/QString>
+
+// The last result of each slow listing, kept under the user's cache
+// directory so a tab can show it the moment it opens and refresh behind it.
+// An entry is a small header (magic, format version, time stored) and a
+// QDataStream of the value; one that is missing, from another format
+// version or truncated simply reads as absent.
+class ResultCache
+{
+public:
+    // Bump whenever a streamed struct changes shape.
+    static const quint32 FormatVersion = 1;
+
+    static QString defaultDirectory();
+
+    // Thread-safe; meant to be called from the worker that produced value.
+    template <typename T>
+    static void store(const QString &name, const T &value)
+    {
+        QByteArray data;
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_5_0);
+        out << value;
+        write(name, data);
+    }
+
+    // storedSecs receives when the entry was written, in seconds since the epoch.
+    template <typename T>
+    static bool load(const QString &name, T *value, qint64 *storedSecs = nullptr)
+    {
+        QByteArray data;
+        if (!read(name, &data, storedSecs)) {
+            return false;
+        }
+        QDataStream in(data);
+        in.setVersion(QDataStream::Qt_5_0);
+        T loaded;
+        in >> loaded;
+        if (in.status() != QDataStream::Ok) {
+            return false;
+        }
+        *value = loaded;
+        return true;
+    }
+
+private:
+    static QString path(const QString &name);
+    static bool read(const QString &name, QByteArray *data, qint64 *storedSecs);
+    static void write(const QString &name, const QByteArray &data);
+};
+
+QDataStream &operator<<(QDataStream &out, const CachedPackage &package);
+QDataStream &operator>>(QDataStream &in, CachedPackage &package);
+QDataStream &operator<<(QDataStream &out, const LogFileInfo &log);
+QDataStream &operator>>(QDataStream &in, LogFileInfo &log);
+QDataStream &operator<<(QDataStream &out, const ServiceUnit &unit);
+QDataStream &operator>>(QDataStream &in, ServiceUnit &unit);
+
+#endif // RESULTCACHE_H
@@ -0,0 +1,424 @@
+#include "systemdunits.h"
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QTimer>
+#include <QtDBus/QDBusArgument>
+#include <QtDBus/QDBusError>
+#include <QtDBus/QDBusMessage>
+#include <QtDBus/QDBusMetaType>
+#include <QtDBus/QDBusObjectPath>
+#include <QtDBus/QDBusPendingCall>
+#include <QtDBus/QDBusPendingReply>
+
+#include <algorithm>
+
+namespace {
+
+const char ManagerPath[] = "/org/freedesktop/systemd1";
+const char ManagerInterface[] = "org.freedesktop.systemd1.Manager";
+const char UnitInterface[] = "org.freedesktop.systemd1.Unit";
+const char PropertiesInterface[] = "org.freedesktop.DBus.Properties";
+
+// ListUnits: a(ssssssouso) = name, description, load state, active state,
+// sub state, followed unit, object path, job id, job type, job path.
+QVector<ServiceUnit> readUnits(const QDBusArgument &argument)
+{
+    QVector<ServiceUnit> units;
+    argument.beginArray();
+    while (!argument.atEnd()) {
+        ServiceUnit unit;
+        QString following;
+        QDBusObjectPath path;
+        uint jobId = 0;
+        QString jobType;
+        QDBusObjectPath jobPath;
+
+        argument.beginStructure();
+        argument >> unit.name >> unit.description >> unit.loadState >> unit.activeState >> unit.subState
+                 >> following >> path >> jobId >> jobType >> jobPath;
+        argument.endStructure();
+
+        if (unit.name.endsWith(".service")) {
+            unit.objectPath = path.path();
+            units.append(unit);
+        }
+    }
+    argument.endArray();
+    return units;
+}
+
+// ListUnitFiles: a(ss) = unit file path, state; keyed by file name.
+QHash<QString, QString> readUnitFiles(const QDBusArgument &argument)
+{
+    QHash<QString, QString> states;
+    argument.beginArray();
+    while (!argument.atEnd()) {
+        QString path;
+        QString state;
+        argument.beginStructure();
+        argument >> path >> state;
+        argument.endStructure();
+        states.insert(path.mid(path.lastIndexOf('/') + 1), state);
+    }
+    argument.endArray();
+    return states;
+}
+
+// getty@tty1.service has no file of its own; its state is the template's.
+QString templateName(const QString &unit)
+{
+    const int at = unit.indexOf('@');
+    const int dot = unit.lastIndexOf('.');
+    if (at < 0 || dot < at) {
+        return QString();
+    }
+    return unit.left(at + 1) + unit.mid(dot);
+}
+
+} // namespace
+
+bool ServiceUnit::applyProperties(const QVariantMap &properties)
+{
+    bool changed = false;
+    auto apply = [&properties, &changed](const char *key, QString &field) {
+        auto it = properties.constFind(key);
+        if (it != properties.constEnd() && it->toString() != field) {
+            field = it->toString();
+            changed = true;
+        }
+    };
+    apply("Description", description);
+    apply("LoadState", loadState);
+    apply("ActiveState", activeState);
+    apply("SubState", subState);
+    apply("UnitFileState", unitFileState);
+    return changed;
+}
+
+SystemdManager::SystemdManager(const QDBusConnection &bus, const QString &service)
+    : m_bus(bus), m_service(service)
+{
+}
+
+ServiceListing SystemdManager::listServices() const
+{
+    ServiceListing listing;
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!m_bus.isConnected()) {
+        listing.error = QString("D-Bus connection unavailable: %1").arg(m_bus.lastError().message());
+        return listing;
+    }
+
+    const QDBusMessage listUnits = QDBusMessage::createMethodCall(m_service, ManagerPath, ManagerInterface, "ListUnits");
+    const QDBusMessage listUnitFiles = QDBusMessage::createMethodCall(m_service, ManagerPath, ManagerInterface, "ListUnitFiles");
+    QDBusPendingCall unitsCall = m_bus.asyncCall(listUnits);
+    QDBusPendingCall filesCall = m_bus.asyncCall(listUnitFiles);
+    unitsCall.waitForFinished();
+    filesCall.waitForFinished();
+
+    if (unitsCall.isError()) {
+        listing.error = QString("ListUnits: %1").arg(unitsCall.error().message());
+        return listing;
+    }
+    const QList<QVariant> unitsReply = unitsCall.reply().arguments();
+    if (unitsReply.isEmpty() || !unitsReply.first().canConvert<QDBusArgument>()) {
+        listing.error = "ListUnits: unexpected reply";
+        return listing;
+    }
+    listing.units = readUnits(unitsReply.first().value<QDBusArgument>());
+
+    // Without unit file states the list is still useful; leave them empty.
+    QHash<QString, QString> fileStates;
+    if (filesCall.isError()) {
+        listing.error = QString("ListUnitFiles: %1").arg(filesCall.error().message());
+    } else {
+        const QList<QVariant> filesReply = filesCall.reply().arguments();
+        if (!filesReply.isEmpty() && filesReply.first().canConvert<QDBusArgument>()) {
+            fileStates = readUnitFiles(filesReply.first().value<QDBusArgument>());
+        }
+    }
+
+    for (ServiceUnit &unit : listing.units) {
+        auto it = fileStates.constFind(unit.name);
+        if (it == fileStates.constEnd()) {
+            it = fileStates.constFind(templateName(unit.name));
+        }
+        if (it != fileStates.constEnd()) {
+            unit.unitFileState = it.value();
+        }
+    }
+
+    std::sort(listing.units.begin(), listing.units.end(), [](const ServiceUnit &a, const ServiceUnit &b) {
+        return a.name < b.name;
+    });
+    listing.elapsedMs = timer.elapsed();
+    return listing;
+}
+
+bool SystemdManager::unitProperties(const QString &objectPath, ServiceUnit *unit, QString *error) const
+{
+    QDBusMessage call = QDBusMessage::createMethodCall(m_service, objectPath, PropertiesInterface, "GetAll");
+    call << QString(UnitInterface);
+    const QDBusMessage reply = m_bus.call(call);
+    if (reply.type() != QDBusMessage::ReplyMessage || reply.arguments().isEmpty()) {
+        if (error) {
+            *error = reply.errorMessage();
+        }
+        return false;
+    }
+
+    const QVariantMap properties = qdbus_cast<QVariantMap>(reply.arguments().first());
+    unit->name = properties.value("Id").toString();
+    unit->objectPath = objectPath;
+    unit->applyProperties(properties);
+    return true;
+}
+
+SystemdUnitWatcher::SystemdUnitWatcher(const QDBusConnection &bus, const QString &service, QObject *parent)
+    : QObject(parent), m_bus(bus), m_service(service)
+{
+}
+
+bool SystemdUnitWatcher::start(QString *error)
+{
+    // systemd only broadcasts unit signals while someone is subscribed.
+    const QDBusMessage reply = m_bus.call(
+        QDBusMessage::createMethodCall(m_service, ManagerPath, ManagerInterface, "Subscribe"));
+    if (reply.type() == QDBusMessage::ErrorMessage) {
+        if (error) {
+            *error = reply.errorMessage();
+        }
+        return false;
+    }
+
+    bool ok = m_bus.connect(m_service, ManagerPath, ManagerInterface, "UnitNew",
+                            this, SLOT(onUnitNew(QString, QDBusObjectPath)));
+    ok = m_bus.connect(m_service, ManagerPath, ManagerInterface, "UnitRemoved",
+                       this, SLOT(onUnitRemoved(QString, QDBusObjectPath))) && ok;
+    ok = m_bus.connect(m_service, ManagerPath, ManagerInterface, "UnitFilesChanged",
+                       this, SLOT(onUnitFilesChanged())) && ok;
+    // An empty path matches every unit object.
+    ok = m_bus.connect(m_service, QString(), PropertiesInterface, "PropertiesChanged",
+                       this, SLOT(onPropertiesChanged(QDBusMessage))) && ok;
+    if (!ok && error) {
+        *error = m_bus.lastError().message();
+    }
+    return ok;
+}
+
+void SystemdUnitWatcher::onUnitNew(const QString &name, const QDBusObjectPath &path)
+{
+    if (name.endsWith(".service")) {
+        emit unitNew(name, path.path());
+    }
+}
+
+void SystemdUnitWatcher::onUnitRemoved(const QString &name, const QDBusObjectPath &path)
+{
+    if (name.endsWith(".service")) {
+        emit unitRemoved(name, path.path());
+    }
+}
+
+void SystemdUnitWatcher::onUnitFilesChanged()
+{
+    emit unitFilesChanged();
+}
+
+void SystemdUnitWatcher::onPropertiesChanged(const QDBusMessage &message)
+{
+    const QList<QVariant> arguments = message.arguments();
+    // Unit object paths encode the unit name: .../unit/cups_2eservice.
+    if (arguments.size() < 2 || arguments.first().toString() != UnitInterface
+        || !message.path().endsWith("_2eservice")) {
+        return;
+    }
+    emit unitPropertiesChanged(message.path(), qdbus_cast<QVariantMap>(arguments.at(1)));
+}
+
+ServiceBatch::ServiceBatch(Operation operation, const QStringList &units, const QDBusConnection &bus,
+                           const QString &service, QObject *parent)
+    : QObject(parent), m_operation(operation), m_units(units), m_bus(bus), m_service(service)
+{
+    // One result per unit decides when the batch is done.
+    m_units.removeDuplicates();
+}
+
+QString ServiceBatch::operationName(Operation operation)
+{
+    switch (operation) {
+    case Start:
+        return "start";
+    case Stop:
+        return "stop";
+    case Enable:
+        return "enable";
+    case Disable:
+        return "disable";
+    }
+    return QString();
+}
+
+QDBusMessage ServiceBatch::managerCall(const QString &method) const
+{
+    QDBusMessage call = QDBusMessage::createMethodCall(m_service, ManagerPath, ManagerInterface, method);
+    // Lets polkit ask once when the GUI is not running as root; the agent's
+    // auth_admin_keep then covers the rest of the batch.
+    call.setInteractiveAuthorizationAllowed(true);
+    return call;
+}
+
+void ServiceBatch::start()
+{
+    if (m_units.isEmpty()) {
+        emit finished();
+        return;
+    }
+
+    if (m_operation == Enable || m_operation == Disable) {
+        QDBusMessage call = managerCall(m_operation == Enable ? "EnableUnitFiles" : "DisableUnitFiles");
+        // files, runtime[, force]
+        call << m_units << false;
+        if (m_operation == Enable) {
+            call << false;
+        }
+        QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(m_bus.asyncCall(call), this);
+        connect(watcher, &QDBusPendingCallWatcher::finished, this, &ServiceBatch::onUnitFilesChanged);
+        return;
+    }
+
+    // Without JobRemoved no job would ever be seen to finish.
+    if (!m_bus.connect(m_service, ManagerPath, ManagerInterface, "JobRemoved",
+                       this, SLOT(onJobRemoved(uint, QDBusObjectPath, QString, QString)))) {
+        const QDBusError error = m_bus.lastError();
+        failRemaining(QString("Cannot watch systemd jobs: %1")
+                          .arg(error.isValid() ? error.message() : QString("not connected to the bus")));
+        return;
+    }
+    // JobRemoved is only broadcast to subscribed clients. systemd handles
+    // our calls in order, so the jobs below are queued after it.
+    QDBusPendingCallWatcher *subscribe = new QDBusPendingCallWatcher(
+        m_bus.asyncCall(QDBusMessage::createMethodCall(m_service, ManagerPath, ManagerInterface, "Subscribe")), this);
+    connect(subscribe, &QDBusPendingCallWatcher::finished, this, &ServiceBatch::onSubscribed);
+
+    const QString method = m_operation == Start ? "StartUnit" : "StopUnit";
+    for (const QString &unit : qAsConst(m_units)) {
+        QDBusMessage call = managerCall(method);
+        call << unit << QString("replace");
+        QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(m_bus.asyncCall(call), this);
+        m_queued.insert(watcher, unit);
+        connect(watcher, &QDBusPendingCallWatcher::finished, this, &ServiceBatch::onJobQueued);
+    }
+}
+
+void ServiceBatch::onSubscribed(QDBusPendingCallWatcher *watcher)
+{
+    watcher->deleteLater();
+    const QDBusPendingCall call = *watcher;
+    if (call.isError()) {
+        failRemaining(QString("Cannot watch systemd jobs: %1").arg(call.error().message()));
+    }
+}
+
+void ServiceBatch::onJobQueued(QDBusPendingCallWatcher *watcher)
+{
+    const QString unit = m_queued.take(watcher);
+    watcher->deleteLater();
+
+    QDBusPendingReply<QDBusObjectPath> reply = *watcher;
+    if (reply.isError()) {
+        finishUnit(unit, false, reply.error().message());
+        return;
+    }
+    const QString job = reply.value().path();
+    auto early = m_removedEarly.find(job);
+    if (early != m_removedEarly.end()) {
+        const QString result = early.value();
+        m_removedEarly.erase(early);
+        finishUnit(unit, result == "done", result);
+    } else {
+        m_jobs.insert(job, unit);
+        QTimer::singleShot(JobTimeoutMs, this, [this, job]() {
+            const QString unit = m_jobs.take(job);
+            if (!unit.isEmpty()) {
+                finishUnit(unit, false, QString("no result after %1 s").arg(JobTimeoutMs / 1000));
+            }
+        });
+    }
+}
+
+void ServiceBatch::onJobRemoved(uint id, const QDBusObjectPath &job, const QString &unit, const QString &result)
+{
+    Q_UNUSED(id);
+    auto it = m_jobs.find(job.path());
+    if (it != m_jobs.end()) {
+        const QString ownUnit = it.value();
+        m_jobs.erase(it);
+        finishUnit(ownUnit, result == "done", result);
+    } else if (!m_queued.isEmpty() && m_units.contains(unit)) {
+        m_removedEarly.insert(job.path(), result);
+    }
+}
+
+void ServiceBatch::onUnitFilesChanged(QDBusPendingCallWatcher *watcher)
+{
+    watcher->deleteLater();
+    const QDBusPendingCall call = *watcher;
+    if (call.isError()) {
+        const QString message = call.error().message();
+        for (const QString &unit : qAsConst(m_units)) {
+            finishUnit(unit, false, message);
+        }
+        return;
+    }
+
+    // One reload for the whole batch, as systemctl does after enable/disable.
+    QDBusPendingCallWatcher *reload = new QDBusPendingCallWatcher(m_bus.asyncCall(managerCall("Reload")), this);
+    connect(reload, &QDBusPendingCallWatcher::finished, this, &ServiceBatch::onReloaded);
+}
+
+void ServiceBatch::onReloaded(QDBusPendingCallWatcher *watcher)
+{
+    watcher->deleteLater();
+    const QDBusPendingCall call = *watcher;
+    const QString message = call.isError()
+        ? QString("%1d, but reload failed: %2").arg(operationName(m_operation), call.error().message())
+        : QString("%1d").arg(operationName(m_operation));
+    for (const QString &unit : qAsConst(m_units)) {
+        finishUnit(unit, true, message);
+    }
+}
+
+void ServiceBatch::finishUnit(const QString &unit, bool ok, const QString &message)
+{
+    // A unit failed by failRemaining() or a timeout may still see its reply.
+    if (m_finished.contains(unit)) {
+        return;
+    }
+    m_finished.insert(unit);
+
+    ServiceJobResult result;
+    result.unit = unit;
+    result.ok = ok;
+    result.message = message;
+    m_results.append(result);
+    emit unitFinished(result);
+
+    if (m_results.size() == m_units.size()) {
+        m_bus.disconnect(m_service, ManagerPath, ManagerInterface, "JobRemoved",
+                         this, SLOT(onJobRemoved(uint, QDBusObjectPath, QString, QString)));
+        emit finished();
+    }
+}
+
+void ServiceBatch::failRemaining(const QString &message)
+{
+    m_jobs.clear();
+    m_removedEarly.clear();
+    for (const QString &unit : qAsConst(m_units)) {
+        finishUnit(unit, false, message);
+    }
+}
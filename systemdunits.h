@@ -0,0 +1,188 @@
+#ifndef SYSTEMDUNITS_H
+#define SYSTEMDUNITS_H
+
+#include <QtCore/QHash>
+#include <QtCore/QMetaType>
+#include <QtCore/QObject>
+#include <QtCore/QSet>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVariantMap>
+#include <QtCore/QVector>
+#include <QtDBus/QDBusConnection>
+#include <QtDBus/QDBusMessage>
+#include <QtDBus/QDBusObjectPath>
+#include <QtDBus/QDBusPendingCallWatcher>
+
+struct ServiceUnit
+{
+    QString name;
+    QString description;
+    QString loadState;
+    QString activeState;
+    QString subState;
+    // From the unit file list: enabled, disabled, static, masked, ...;
+    // empty for units without a unit file (transient or generated).
+    QString unitFileState;
+    QString objectPath;
+
+    // Copies the org.freedesktop.systemd1.Unit properties it knows about;
+    // returns whether anything shown in the list changed.
+    bool applyProperties(const QVariantMap &properties);
+};
+
+struct ServiceListing
+{
+    QVector<ServiceUnit> units;
+    qint64 elapsedMs = 0;
+    QString error;
+};
+
+Q_DECLARE_METATYPE(ServiceListing)
+
+// Talks to the systemd manager over D-Bus. The bus and service name are
+// parameters so the listing can run against a mock manager on a private bus.
+class SystemdManager
+{
+public:
+    static QString defaultService()
+    {
+        return "org.freedesktop.systemd1";
+    }
+
+    explicit SystemdManager(const QDBusConnection &bus = QDBusConnection::systemBus(),
+                            const QString &service = defaultService());
+
+    // Every loaded service unit (list-units --all --type=service), merged
+    // with its unit file state. ListUnits and ListUnitFiles are sent
+    // together, so a refresh costs one round trip however many units exist.
+    ServiceListing listServices() const;
+
+    // One unit's Unit interface properties (GetAll), for units that appear
+    // after the listing.
+    bool unitProperties(const QString &objectPath, ServiceUnit *unit, QString *error = nullptr) const;
+
+private:
+    QDBusConnection m_bus;
+    QString m_service;
+};
+
+// Relays the manager's UnitNew, UnitRemoved and UnitFilesChanged signals and
+// PropertiesChanged on unit objects, after asking systemd to send them
+// (Manager.Subscribe). Only .service units are reported.
+class SystemdUnitWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SystemdUnitWatcher(const QDBusConnection &bus = QDBusConnection::systemBus(),
+                                const QString &service = SystemdManager::defaultService(),
+                                QObject *parent = nullptr);
+
+    bool start(QString *error = nullptr);
+
+signals:
+    void unitNew(const QString &name, const QString &objectPath);
+    void unitRemoved(const QString &name, const QString &objectPath);
+    void unitPropertiesChanged(const QString &objectPath, const QVariantMap &properties);
+    // Something was enabled, disabled or masked; unit file states are stale.
+    void unitFilesChanged();
+
+private slots:
+    void onUnitNew(const QString &name, const QDBusObjectPath &path);
+    void onUnitRemoved(const QString &name, const QDBusObjectPath &path);
+    void onUnitFilesChanged();
+    void onPropertiesChanged(const QDBusMessage &message);
+
+private:
+    QDBusConnection m_bus;
+    QString m_service;
+};
+
+struct ServiceJobResult
+{
+    QString unit;
+    bool ok = false;
+    // systemd's job result (done, failed, dependency, ...) or the D-Bus error.
+    QString message;
+};
+
+Q_DECLARE_METATYPE(ServiceJobResult)
+
+// Applies one operation to many units at once. Start and stop queue one job
+// per unit without waiting for each other and report each job as its
+// JobRemoved signal arrives; enable and disable are one EnableUnitFiles or
+// DisableUnitFiles call for all units followed by a single Reload. Lives on
+// the thread that owns the bus connection and never blocks it.
+class ServiceBatch : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Operation
+    {
+        Start,
+        Stop,
+        Enable,
+        Disable
+    };
+
+    // How long a queued start or stop job may run before its unit is
+    // reported as failed; systemd's own default start timeout is 90 s.
+    static const int JobTimeoutMs = 120 * 1000;
+
+    ServiceBatch(Operation operation, const QStringList &units,
+                 const QDBusConnection &bus = QDBusConnection::systemBus(),
+                 const QString &service = SystemdManager::defaultService(),
+                 QObject *parent = nullptr);
+
+    static QString operationName(Operation operation);
+
+    void start();
+
+    Operation operation() const
+    {
+        return m_operation;
+    }
+
+    int unitCount() const
+    {
+        return m_units.size();
+    }
+
+    const QVector<ServiceJobResult> &results() const
+    {
+        return m_results;
+    }
+
+signals:
+    void unitFinished(const ServiceJobResult &result);
+    void finished();
+
+private slots:
+    void onJobQueued(QDBusPendingCallWatcher *watcher);
+    void onJobRemoved(uint id, const QDBusObjectPath &job, const QString &unit, const QString &result);
+    void onSubscribed(QDBusPendingCallWatcher *watcher);
+    void onUnitFilesChanged(QDBusPendingCallWatcher *watcher);
+    void onReloaded(QDBusPendingCallWatcher *watcher);
+
+private:
+    QDBusMessage managerCall(const QString &method) const;
+    void finishUnit(const QString &unit, bool ok, const QString &message);
+    // Fails every unit that has no result yet.
+    void failRemaining(const QString &message);
+
+    Operation m_operation;
+    QStringList m_units;
+    QDBusConnection m_bus;
+    QString m_service;
+    QHash<QDBusPendingCallWatcher *, QString> m_queued;
+    // Job object path -> unit, for jobs still running.
+    QHash<QString, QString> m_jobs;
+    // JobRemoved can overtake the StartUnit reply it belongs to.
+    QHash<QString, QString> m_removedEarly;
+    QVector<ServiceJobResult> m_results;
+    QSet<QString> m_finished;
+};
+
+#endif // SYSTEMDUNITS_H
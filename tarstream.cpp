@@ -0,0 +1,202 @@
+#include "tarstream.h"
+
+#include <cstring>
+
+namespace {
+
+qint64 parseNumber(const char *field, int length)
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(field);
+
+    // GNU base-256 encoding for sizes that do not fit in octal.
+    if (bytes[0] & 0x80) {
+        qint64 value = bytes[0] & 0x7f;
+        for (int i = 1; i < length; ++i) {
+            value = (value << 8) | bytes[i];
+        }
+        return value;
+    }
+
+    qint64 value = 0;
+    int i = 0;
+    while (i < length && (field[i] == ' ' || field[i] == '\0')) {
+        ++i;
+    }
+    for (; i < length && field[i] >= '0' && field[i] <= '7'; ++i) {
+        value = value * 8 + (field[i] - '0');
+    }
+    return value;
+}
+
+QByteArray fieldString(const char *field, int length)
+{
+    return QByteArray(field, int(qstrnlen(field, uint(length))));
+}
+
+bool isZeroBlock(const char *block)
+{
+    for (int i = 0; i < 512; ++i) {
+        if (block[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QByteArray paxPath(const QByteArray &records)
+{
+    int pos = 0;
+    while (pos < records.size()) {
+        int space = records.indexOf(' ', pos);
+        if (space < 0) {
+            break;
+        }
+        int length = records.mid(pos, space - pos).toInt();
+        if (length <= 0 || pos + length > records.size()) {
+            break;
+        }
+        QByteArray record = records.mid(space + 1, pos + length - space - 2);
+        if (record.startsWith("path=")) {
+            return record.mid(5);
+        }
+        pos += length;
+    }
+    return QByteArray();
+}
+
+} // namespace
+
+TarStreamParser::TarStreamParser(EntryFilter filter, EntryHandler handler)
+    : m_filter(std::move(filter)), m_handler(std::move(handler))
+{
+}
+
+bool TarStreamParser::feed(const char *data, qint64 size)
+{
+    while (size > 0 && m_state != State::Finished) {
+        switch (m_state) {
+        case State::Header: {
+            qint64 take = qMin<qint64>(512 - m_headerFill, size);
+            memcpy(m_header + m_headerFill, data, size_t(take));
+            m_headerFill += int(take);
+            data += take;
+            size -= take;
+            if (m_headerFill == 512) {
+                m_headerFill = 0;
+                if (!beginEntry()) {
+                    return false;
+                }
+            }
+            break;
+        }
+        case State::Data: {
+            qint64 take = qMin(m_remaining, size);
+            if (m_kind != EntryKind::Skipped) {
+                m_content.append(data, int(take));
+            }
+            m_remaining -= take;
+            data += take;
+            size -= take;
+            if (m_remaining == 0) {
+                finishEntry();
+            }
+            break;
+        }
+        case State::Padding: {
+            qint64 take = qMin(m_padding, size);
+            m_padding -= take;
+            data += take;
+            size -= take;
+            if (m_padding == 0) {
+                m_state = State::Header;
+            }
+            break;
+        }
+        case State::Finished:
+            break;
+        }
+    }
+    return true;
+}
+
+bool TarStreamParser::beginEntry()
+{
+    if (isZeroBlock(m_header)) {
+        m_state = State::Finished;
+        return true;
+    }
+
+    unsigned int checksum = 0;
+    for (int i = 0; i < 512; ++i) {
+        checksum += (i >= 148 && i < 156) ? ' ' : static_cast<unsigned char>(m_header[i]);
+    }
+    if (qint64(checksum) != parseNumber(m_header + 148, 8)) {
+        return false;
+    }
+
+    qint64 size = parseNumber(m_header + 124, 12);
+    char type = m_header[156];
+
+    if (!m_longName.isEmpty()) {
+        m_name = m_longName;
+    } else {
+        m_name = fieldString(m_header, 100);
+        if (memcmp(m_header + 257, "ustar", 5) == 0 && m_header[345] != '\0') {
+            m_name = fieldString(m_header + 345, 155) + '/' + m_name;
+        }
+    }
+
+    switch (type) {
+    case 'L':
+        m_kind = EntryKind::LongName;
+        break;
+    case 'x':
+        m_kind = EntryKind::PaxHeader;
+        break;
+    case '0':
+    case '\0':
+        m_kind = m_filter(m_name) ? EntryKind::Regular : EntryKind::Skipped;
+        break;
+    default:
+        m_kind = EntryKind::Skipped;
+        break;
+    }
+
+    if (m_kind != EntryKind::LongName && m_kind != EntryKind::PaxHeader) {
+        m_longName.clear();
+    }
+
+    m_content.clear();
+    if (m_kind != EntryKind::Skipped) {
+        m_content.reserve(int(size));
+    }
+    m_remaining = size;
+    m_padding = (512 - size % 512) % 512;
+
+    if (size == 0) {
+        finishEntry();
+    } else {
+        m_state = State::Data;
+    }
+    return true;
+}
+
+void TarStreamParser::finishEntry()
+{
+    switch (m_kind) {
+    case EntryKind::LongName:
+        m_longName = QByteArray(m_content.constData(), int(qstrnlen(m_content.constData(), uint(m_content.size()))));
+        break;
+    case EntryKind::PaxHeader:
+        m_longName = paxPath(m_content);
+        break;
+    case EntryKind::Regular:
+        m_handler(m_name, m_content);
+        break;
+    case EntryKind::Skipped:
+        break;
+    }
+
+    m_content.clear();
+    m_state = m_padding > 0 ? State::Padding : State::Header;
+}
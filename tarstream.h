@@ -0,0 +1,53 @@
+#ifndef TARSTREAM_H
+#define TARSTREAM_H
+
+#include <QtCore/QByteArray>
+#include <functional>
+
+// Incremental ustar/pax parser fed with decompressed chunks. Only entries
+// accepted by the filter are buffered and passed to the handler.
+class TarStreamParser
+{
+public:
+    using EntryFilter = std::function<bool(const QByteArray &name)>;
+    using EntryHandler = std::function<void(const QByteArray &name, const QByteArray &data)>;
+
+    TarStreamParser(EntryFilter filter, EntryHandler handler);
+
+    bool feed(const char *data, qint64 size);
+    bool isFinished() const { return m_state == State::Finished; }
+
+private:
+    enum class State
+    {
+        Header,
+        Data,
+        Padding,
+        Finished
+    };
+
+    enum class EntryKind
+    {
+        Skipped,
+        Regular,
+        LongName,
+        PaxHeader
+    };
+
+    bool beginEntry();
+    void finishEntry();
+
+    EntryFilter m_filter;
+    EntryHandler m_handler;
+    State m_state = State::Header;
+    EntryKind m_kind = EntryKind::Skipped;
+    char m_header[512];
+    int m_headerFill = 0;
+    qint64 m_remaining = 0;
+    qint64 m_padding = 0;
+    QByteArray m_name;
+    QByteArray m_longName;
+    QByteArray m_content;
+};
+
+#endif // TARSTREAM_H
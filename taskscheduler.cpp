@@ -0,0 +1,144 @@
+#include "taskscheduler.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QProcess>
+
+TaskScheduler &TaskScheduler::instance()
+{
+    // Processes are owned by, and report to, the GUI thread whichever thread
+    // asks first. Never destroyed, so no QProcess outlives the application.
+    static TaskScheduler *scheduler = []() {
+        TaskScheduler *created = new TaskScheduler;
+        if (QCoreApplication *application = QCoreApplication::instance()) {
+            created->moveToThread(application->thread());
+        }
+        return created;
+    }();
+    return *scheduler;
+}
+
+void TaskScheduler::finished(const QString &key, void *identity)
+{
+    if (key.isEmpty()) {
+        return;
+    }
+    QMutexLocker locker(&m_mutex);
+    // A cancelled task's key may already belong to a newer one.
+    auto it = m_inFlight.find(key);
+    if (it != m_inFlight.end() && it->interface.get() == identity) {
+        m_inFlight.erase(it);
+    }
+}
+
+void TaskScheduler::cancel(const QString &key)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_inFlight.find(key);
+        if (it != m_inFlight.end()) {
+            it->token.cancel();
+            m_inFlight.erase(it);
+            return;
+        }
+    }
+
+    for (int i = 0; i < m_processQueue.size(); ++i) {
+        if (m_processQueue.at(i).key == key) {
+            QFutureInterface<ProcessResult> interface = m_processQueue.at(i).interface;
+            m_processQueue.remove(i);
+            m_processesInFlight.remove(key);
+            interface.reportCanceled();
+            interface.reportFinished();
+            return;
+        }
+    }
+    if (QProcess *process = m_runningProcesses.value(key)) {
+        process->kill();
+    }
+}
+
+QFuture<ProcessResult> TaskScheduler::runProcess(TaskPriority priority, const QString &key, const QString &program,
+                                                 const QStringList &arguments)
+{
+    if (!key.isEmpty()) {
+        auto it = m_processesInFlight.constFind(key);
+        if (it != m_processesInFlight.constEnd()) {
+            return it->future();
+        }
+    }
+
+    QueuedProcess queued;
+    queued.priority = int(priority);
+    queued.sequence = m_nextSequence++;
+    queued.key = key;
+    queued.program = program;
+    queued.arguments = arguments;
+    queued.interface.reportStarted();
+    if (!key.isEmpty()) {
+        m_processesInFlight.insert(key, queued.interface);
+    }
+    m_processQueue.append(queued);
+
+    const QFuture<ProcessResult> future = queued.interface.future();
+    startProcesses();
+    return future;
+}
+
+void TaskScheduler::startProcesses()
+{
+    while (m_processCount < MaxProcesses && !m_processQueue.isEmpty()) {
+        // Highest priority first, then in the order they were asked for.
+        int next = 0;
+        for (int i = 1; i < m_processQueue.size(); ++i) {
+            const QueuedProcess &candidate = m_processQueue.at(i);
+            const QueuedProcess &best = m_processQueue.at(next);
+            if (candidate.priority > best.priority
+                || (candidate.priority == best.priority && candidate.sequence < best.sequence)) {
+                next = i;
+            }
+        }
+        const QueuedProcess queued = m_processQueue.takeAt(next);
+
+        QProcess *process = new QProcess(this);
+        ++m_processCount;
+        if (!queued.key.isEmpty()) {
+            m_runningProcesses.insert(queued.key, process);
+        }
+
+        const QString key = queued.key;
+        const QFutureInterface<ProcessResult> interface = queued.interface;
+        connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+            [this, process, key, interface](int exitCode, QProcess::ExitStatus exitStatus) {
+                ProcessResult result;
+                result.exitCode = exitCode;
+                result.crashed = exitStatus == QProcess::CrashExit;
+                result.standardOutput = process->readAllStandardOutput();
+                result.standardError = process->readAllStandardError();
+                finishProcess(process, key, interface, result);
+            });
+        connect(process, &QProcess::errorOccurred, this, [this, process, key, interface](QProcess::ProcessError error) {
+            // Anything but a failed start is followed by finished().
+            if (error == QProcess::FailedToStart) {
+                ProcessResult result;
+                result.error = process->errorString();
+                finishProcess(process, key, interface, result);
+            }
+        });
+        process->start(queued.program, queued.arguments);
+    }
+}
+
+void TaskScheduler::finishProcess(QProcess *process, const QString &key, QFutureInterface<ProcessResult> interface,
+                                  const ProcessResult &result)
+{
+    if (!key.isEmpty() && m_runningProcesses.value(key) == process) {
+        m_runningProcesses.remove(key);
+        m_processesInFlight.remove(key);
+    }
+    --m_processCount;
+    process->deleteLater();
+
+    interface.reportResult(result);
+    interface.reportFinished();
+    startProcesses();
+}
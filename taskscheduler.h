@@ -0,0 +1,203 @@
+#ifndef TASKSCHEDULER_H
+#define TASKSCHEDULER_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QFuture>
+#include <QtCore/QFutureInterface>
+#include <QtCore/QHash>
+#include <QtCore/QMetaType>
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+#include <QtCore/QRunnable>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QThreadPool>
+#include <QtCore/QVector>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <type_traits>
+
+class QProcess;
+
+// Queued work runs highest priority first; QtConcurrent's own jobs (mapped
+// verification, indexing, compression) share the pool at Normal.
+enum class TaskPriority
+{
+    Background = -10,
+    Normal = 0,
+    Interactive = 10
+};
+
+// Shared between a task and whoever may cancel it. Long tasks poll it
+// between stages; a task cancelled before it starts never runs.
+class CancellationToken
+{
+public:
+    CancellationToken() : m_cancelled(std::make_shared<std::atomic<bool>>(false)) {}
+
+    bool isCancelled() const
+    {
+        return m_cancelled->load(std::memory_order_relaxed);
+    }
+
+    void cancel()
+    {
+        m_cancelled->store(true, std::memory_order_relaxed);
+    }
+
+private:
+    std::shared_ptr<std::atomic<bool>> m_cancelled;
+};
+
+struct ProcessResult
+{
+    int exitCode = -1;
+    bool crashed = false;
+    QByteArray standardOutput;
+    QByteArray standardError;
+    // Set when the program could not be started.
+    QString error;
+
+    bool ok() const { return error.isEmpty() && !crashed && exitCode == 0; }
+};
+
+Q_DECLARE_METATYPE(ProcessResult)
+
+// Runs one scheduled function and publishes its result.
+template <typename T>
+class ScheduledTask : public QRunnable
+{
+public:
+    ScheduledTask(std::function<T(const CancellationToken &)> function, std::shared_ptr<QFutureInterface<T>> interface,
+                  CancellationToken token, std::function<void()> done)
+        : m_function(std::move(function)), m_interface(std::move(interface)), m_token(token), m_done(std::move(done))
+    {
+    }
+
+    void run() override
+    {
+        if (!m_token.isCancelled()) {
+            if constexpr (std::is_void<T>::value) {
+                m_function(m_token);
+            } else {
+                const T result = m_function(m_token);
+                m_interface->reportResult(result);
+            }
+        }
+        m_done();
+        m_interface->reportFinished();
+    }
+
+private:
+    std::function<T(const CancellationToken &)> m_function;
+    std::shared_ptr<QFutureInterface<T>> m_interface;
+    CancellationToken m_token;
+    std::function<void()> m_done;
+};
+
+// One place for the application's asynchronous work: functions on the
+// global thread pool and external programs on a small bounded process pool,
+// both ordered by priority. A non-empty key names the request: while a task
+// with that key is queued or running, asking again returns the same future
+// instead of doing the work twice. A key must always produce the same
+// result type.
+//
+// Cancelling a task or process that has not started finishes its future
+// without a result, so only cancel work whose watcher has already moved on
+// to a newer future. A running task sees its token set; a running process
+// is killed.
+class TaskScheduler : public QObject
+{
+public:
+    static TaskScheduler &instance();
+
+    static const int MaxProcesses = 4;
+
+    // function may take a const CancellationToken & to notice cancellation.
+    template <typename Function>
+    auto run(TaskPriority priority, const QString &key, Function function)
+    {
+        using Result = typename std::conditional_t<std::is_invocable_v<Function, const CancellationToken &>,
+                                                   std::invoke_result<Function, const CancellationToken &>,
+                                                   std::invoke_result<Function>>::type;
+        std::function<Result(const CancellationToken &)> body;
+        if constexpr (std::is_invocable_v<Function, const CancellationToken &>) {
+            body = function;
+        } else {
+            body = [function](const CancellationToken &) {
+                return function();
+            };
+        }
+        return start<Result>(priority, key, body);
+    }
+
+    // Must be called from the GUI thread, which owns the QProcess objects.
+    QFuture<ProcessResult> runProcess(TaskPriority priority, const QString &key, const QString &program,
+                                      const QStringList &arguments);
+
+    void cancel(const QString &key);
+
+private:
+    struct InFlight
+    {
+        std::shared_ptr<void> interface;
+        CancellationToken token;
+    };
+
+    struct QueuedProcess
+    {
+        int priority = 0;
+        quint64 sequence = 0;
+        QString key;
+        QString program;
+        QStringList arguments;
+        QFutureInterface<ProcessResult> interface;
+    };
+
+    TaskScheduler() = default;
+
+    template <typename T>
+    QFuture<T> start(TaskPriority priority, const QString &key, std::function<T(const CancellationToken &)> function)
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!key.isEmpty()) {
+            auto it = m_inFlight.constFind(key);
+            if (it != m_inFlight.constEnd()) {
+                return std::static_pointer_cast<QFutureInterface<T>>(it->interface)->future();
+            }
+        }
+
+        auto interface = std::make_shared<QFutureInterface<T>>();
+        interface->reportStarted();
+        CancellationToken token;
+        if (!key.isEmpty()) {
+            m_inFlight.insert(key, InFlight { interface, token });
+        }
+        locker.unlock();
+
+        void *identity = interface.get();
+        QThreadPool::globalInstance()->start(new ScheduledTask<T>(function, interface, token, [this, key, identity]() {
+            finished(key, identity);
+        }), int(priority));
+        return interface->future();
+    }
+
+    void finished(const QString &key, void *identity);
+    void startProcesses();
+    void finishProcess(QProcess *process, const QString &key, QFutureInterface<ProcessResult> interface,
+                       const ProcessResult &result);
+
+    QMutex m_mutex;
+    QHash<QString, InFlight> m_inFlight;
+
+    // GUI thread only.
+    QVector<QueuedProcess> m_processQueue;
+    QHash<QString, QFutureInterface<ProcessResult>> m_processesInFlight;
+    QHash<QString, QProcess *> m_runningProcesses;
+    int m_processCount = 0;
+    quint64 m_nextSequence = 0;
+};
+
+#endif // TASKSCHEDULER_H
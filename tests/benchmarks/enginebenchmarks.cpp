@@ -0,0 +1,204 @@
+#include "filemetadata.h"
+#include "fixtures.h"
+#include "lineindex.h"
+#include "logcompressor.h"
+#include "logscanner.h"
+#include "pacmandb.h"
+
+#include <QtCore/QElapsedTimer>
+#include <QtTest/QtTest>
+
+#include <algorithm>
+
+// Engine throughput on generated fixtures. Run with -o results.xml,xml (or
+// -csv) to get numbers that can be compared across commits; the largest
+// dataset is capped by PCC_MAX_ENTRIES, see fixtures.h.
+class EngineBenchmarks : public QObject
+{
+    Q_OBJECT
+
+private:
+    // 1k to 10M, skipping what the configured cap rules out.
+    static void addSizes(const char *column, int smallest = 1000)
+    {
+        QTest::addColumn<int>(column);
+        for (int size = smallest; size <= 10000000 && size <= Fixtures::maxEntries(); size *= 10) {
+            QTest::addRow("%d", size) << size;
+        }
+    }
+
+    // Best of a few runs, reported as bytes per second rather than time.
+    template <typename Function>
+    static void measureThroughput(qint64 bytes, Function function)
+    {
+        qint64 best = -1;
+        for (int run = 0; run < 3; ++run) {
+            QElapsedTimer timer;
+            timer.start();
+            function();
+            const qint64 elapsed = timer.nsecsElapsed();
+            best = best < 0 ? elapsed : qMin(best, elapsed);
+        }
+        QTest::setBenchmarkResult(qreal(bytes) * 1e9 / qMax<qint64>(1, best), QTest::BytesPerSecond);
+    }
+
+private slots:
+    void walkTree_data()
+    {
+        addSizes("entries");
+    }
+
+    void walkTree()
+    {
+        QFETCH(int, entries);
+        const QString root = Fixtures::fileTree(entries);
+        FileMetadataCache &metadata = FileMetadataCache::instance();
+        QBENCHMARK {
+            metadata.invalidate(root);
+            metadata.scanTree(root);
+        }
+        QVERIFY(metadata.entriesUnder(root).size() >= entries);
+    }
+
+    // What the Disk Usage tab does with a cached walk: collect and rank.
+    void sortResults_data()
+    {
+        addSizes("entries");
+    }
+
+    void sortResults()
+    {
+        QFETCH(int, entries);
+        const QString root = Fixtures::fileTree(entries);
+        FileMetadataCache &metadata = FileMetadataCache::instance();
+        if (!metadata.hasTree(root)) {
+            metadata.scanTree(root);
+        }
+        QBENCHMARK {
+            QVector<FileMetadata> results = metadata.entriesUnder(root);
+            std::sort(results.begin(), results.end(), [](const FileMetadata &a, const FileMetadata &b) {
+                return a.allocated > b.allocated;
+            });
+        }
+    }
+
+    void scanLogs_data()
+    {
+        addSizes("files");
+    }
+
+    void scanLogs()
+    {
+        QFETCH(int, files);
+        const QString root = Fixtures::logTree(files);
+        QVector<LogFileInfo> logs;
+        QBENCHMARK {
+            logs = LogScanner::scan(root);
+        }
+        // Four of every five names are logs.
+        QCOMPARE(logs.size(), files - files / 5);
+    }
+
+    void parseLocalDb_data()
+    {
+        addSizes("packages");
+    }
+
+    void parseLocalDb()
+    {
+        QFETCH(int, packages);
+        const QString path = Fixtures::localDb(packages);
+        QHash<QString, InstalledPackage> installed;
+        QBENCHMARK {
+            installed = PacmanLocalDb::read(path);
+        }
+        QCOMPARE(installed.size(), packages);
+    }
+
+    void parseSyncDb_data()
+    {
+        addSizes("packages");
+    }
+
+    void parseSyncDb()
+    {
+        QFETCH(int, packages);
+        const QString path = Fixtures::syncDb(packages) + "/core.db";
+        QVector<SyncPackage> available;
+        QBENCHMARK {
+            available.clear();
+            QString error;
+            QVERIFY2(PacmanSyncDb::readFile(path, &available, &error), qPrintable(error));
+        }
+        QCOMPARE(available.size(), packages);
+    }
+
+    void classifyCache_data()
+    {
+        addSizes("packages");
+    }
+
+    void classifyCache()
+    {
+        QFETCH(int, packages);
+        const QVector<CachedPackage> cached = PacmanCache::list(Fixtures::packageCache(packages));
+        const QHash<QString, InstalledPackage> installed = PacmanLocalDb::read(Fixtures::localDb(packages));
+        QVector<SyncPackage> available;
+        QVERIFY(PacmanSyncDb::readFile(Fixtures::syncDb(packages) + "/core.db", &available));
+        QCOMPARE(cached.size(), packages * 3);
+
+        QBENCHMARK {
+            QVector<CachedPackage> classified = cached;
+            PacmanCache::classify(classified, installed, available);
+        }
+    }
+
+    void compressBlock_data()
+    {
+        QTest::addColumn<int>("codec");
+        QTest::addColumn<int>("level");
+        QTest::newRow("gzip-1") << int(CompressionCodec::Gzip) << 1;
+        QTest::newRow("gzip-6") << int(CompressionCodec::Gzip) << 6;
+        QTest::newRow("zstd-1") << int(CompressionCodec::Zstd) << 1;
+        QTest::newRow("zstd-3") << int(CompressionCodec::Zstd) << 3;
+        QTest::newRow("zstd-9") << int(CompressionCodec::Zstd) << 9;
+    }
+
+    // One LogCompressor block, the unit the compression pool hands out.
+    void compressBlock()
+    {
+        QFETCH(int, codec);
+        QFETCH(int, level);
+        CompressionPolicy policy;
+        policy.codec = CompressionCodec(codec);
+        policy.level = level;
+        const QByteArray text = Fixtures::logText(16 * 1024 * 1024);
+        measureThroughput(text.size(), [&]() {
+            QString error;
+            QVERIFY2(!LogCompressor::compressBlock(text.constData(), text.size(), policy, &error).isEmpty(),
+                     qPrintable(error));
+        });
+    }
+
+    void indexLines()
+    {
+        const QByteArray text = Fixtures::logText(LineIndex::ChunkSize);
+        measureThroughput(text.size(), [&]() {
+            QVERIFY(LineIndex::indexChunk(text.constData(), text.size(), 0).lineCount > 0);
+        });
+    }
+
+    void searchLog()
+    {
+        const QByteArray text = Fixtures::logText(64 * 1024 * 1024);
+        // Absent, so every byte is examined.
+        const QByteArray needle("segfault at 0000000000000000");
+        measureThroughput(text.size(), [&]() {
+            QCOMPARE(SubstringSearch::findFirst(text.constData(), text.size(), 0, needle), qint64(-1));
+        });
+    }
+};
+
+QTEST_GUILESS_MAIN(EngineBenchmarks)
+
+#include "enginebenchmarks.moc"
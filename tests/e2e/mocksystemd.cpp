@@ -0,0 +1,190 @@
+#include <QtCore/QCoreApplication>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QVariantMap>
+#include <QtDBus/QDBusArgument>
+#include <QtDBus/QDBusConnection>
+#include <QtDBus/QDBusError>
+#include <QtDBus/QDBusMessage>
+#include <QtDBus/QDBusMetaType>
+#include <QtDBus/QDBusObjectPath>
+#include <QtDBus/QDBusVirtualObject>
+
+#include <cstdio>
+
+// Stands in for systemd's manager on whatever bus DBUS_SYSTEM_BUS_ADDRESS
+// names, so TabLatency can open the Services tab against a private
+// dbus-daemon. It owns org.freedesktop.systemd1 and answers ListUnits,
+// ListUnitFiles, Subscribe and the units' Properties.GetAll from a fixed
+// set of units, as many as its argument asks for, one in five of them
+// sockets the tab must skip. Prints "ready" once the name is taken.
+
+namespace {
+
+const char ServiceName[] = "org.freedesktop.systemd1";
+const char ManagerPath[] = "/org/freedesktop/systemd1";
+const char ManagerInterface[] = "org.freedesktop.systemd1.Manager";
+const char UnitInterface[] = "org.freedesktop.systemd1.Unit";
+const char PropertiesInterface[] = "org.freedesktop.DBus.Properties";
+
+struct MockUnit
+{
+    QString name;
+    QString description;
+    QString objectPath;
+    QString unitFileState;
+};
+
+// One ListUnitFiles entry: unit file path and state.
+struct MockUnitFile
+{
+    QString path;
+    QString state;
+};
+
+} // namespace
+
+Q_DECLARE_METATYPE(MockUnit)
+Q_DECLARE_METATYPE(MockUnitFile)
+
+// ListUnits: a(ssssssouso), see readUnits() in systemdunits.cpp.
+QDBusArgument &operator<<(QDBusArgument &argument, const MockUnit &unit)
+{
+    argument.beginStructure();
+    argument << unit.name << unit.description << QString("loaded") << QString("active") << QString("running")
+             << QString() << QDBusObjectPath(unit.objectPath) << uint(0) << QString() << QDBusObjectPath("/");
+    argument.endStructure();
+    return argument;
+}
+
+const QDBusArgument &operator>>(const QDBusArgument &argument, MockUnit &unit)
+{
+    QString loadState, activeState, subState, following, jobType;
+    QDBusObjectPath path, jobPath;
+    uint jobId = 0;
+    argument.beginStructure();
+    argument >> unit.name >> unit.description >> loadState >> activeState >> subState >> following >> path >> jobId
+             >> jobType >> jobPath;
+    argument.endStructure();
+    unit.objectPath = path.path();
+    return argument;
+}
+
+QDBusArgument &operator<<(QDBusArgument &argument, const MockUnitFile &file)
+{
+    argument.beginStructure();
+    argument << file.path << file.state;
+    argument.endStructure();
+    return argument;
+}
+
+const QDBusArgument &operator>>(const QDBusArgument &argument, MockUnitFile &file)
+{
+    argument.beginStructure();
+    argument >> file.path >> file.state;
+    argument.endStructure();
+    return argument;
+}
+
+namespace {
+
+// systemd's bus path escaping: every byte outside [A-Za-z0-9] as _xx.
+QString unitPath(const QString &name)
+{
+    QString escaped;
+    for (const char c : name.toUtf8()) {
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) {
+            escaped += QLatin1Char(c);
+        } else {
+            escaped += QString("_%1").arg(uint(uchar(c)), 2, 16, QLatin1Char('0'));
+        }
+    }
+    return QString("%1/unit/%2").arg(ManagerPath, escaped);
+}
+
+class MockManager : public QDBusVirtualObject
+{
+public:
+    explicit MockManager(int count)
+    {
+        for (int i = 0; i < count; ++i) {
+            MockUnit unit;
+            unit.name = QString("mock-%1.%2").arg(i, 5, 10, QLatin1Char('0')).arg(i % 5 == 4 ? "socket" : "service");
+            unit.description = QString("Mock unit %1").arg(i);
+            unit.objectPath = unitPath(unit.name);
+            unit.unitFileState = i % 2 ? "disabled" : "enabled";
+            m_byPath.insert(unit.objectPath, m_units.size());
+            m_units.append(unit);
+            m_files.append({ "/usr/lib/systemd/system/" + unit.name, unit.unitFileState });
+        }
+    }
+
+    QString introspect(const QString &path) const override
+    {
+        Q_UNUSED(path);
+        return QString();
+    }
+
+    bool handleMessage(const QDBusMessage &message, const QDBusConnection &connection) override
+    {
+        QDBusMessage reply;
+        const QString member = message.member();
+        if (message.path() == ManagerPath && message.interface() == ManagerInterface) {
+            if (member == "ListUnits") {
+                reply = message.createReply(QVariant::fromValue(m_units));
+            } else if (member == "ListUnitFiles") {
+                reply = message.createReply(QVariant::fromValue(m_files));
+            } else if (member == "Subscribe" || member == "Unsubscribe") {
+                reply = message.createReply();
+            }
+        } else if (message.interface() == PropertiesInterface && member == "GetAll") {
+            auto it = m_byPath.constFind(message.path());
+            if (it != m_byPath.constEnd()
+                && message.arguments().value(0).toString() == QLatin1String(UnitInterface)) {
+                const MockUnit &unit = m_units.at(it.value());
+                QVariantMap properties;
+                properties.insert("Id", unit.name);
+                properties.insert("Description", unit.description);
+                properties.insert("LoadState", "loaded");
+                properties.insert("ActiveState", "active");
+                properties.insert("SubState", "running");
+                properties.insert("UnitFileState", unit.unitFileState);
+                reply = message.createReply(QVariant(properties));
+            }
+        }
+        if (reply.type() != QDBusMessage::ReplyMessage) {
+            reply = message.createErrorReply(QDBusError::UnknownMethod,
+                                             QString("%1.%2 is not mocked").arg(message.interface(), member));
+        }
+        QDBusConnection(connection).send(reply);
+        return true;
+    }
+
+private:
+    QList<MockUnit> m_units;
+    QList<MockUnitFile> m_files;
+    QHash<QString, int> m_byPath;
+};
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    qDBusRegisterMetaType<MockUnit>();
+    qDBusRegisterMetaType<QList<MockUnit>>();
+    qDBusRegisterMetaType<MockUnitFile>();
+    qDBusRegisterMetaType<QList<MockUnitFile>>();
+
+    const int count = app.arguments().value(1).toInt();
+    MockManager manager(count);
+    QDBusConnection bus = QDBusConnection::systemBus();
+    if (!bus.registerVirtualObject(ManagerPath, &manager, QDBusConnection::SubPath)
+        || !bus.registerService(ServiceName)) {
+        fprintf(stderr, "mocksystemd: %s\n", qPrintable(bus.lastError().message()));
+        return 1;
+    }
+    printf("ready\n");
+    fflush(stdout);
+    return app.exec();
+}
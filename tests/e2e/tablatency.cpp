@@ -0,0 +1,395 @@
+#include "filemetadata.h"
+#include "fixtures.h"
+#include "resultcache.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QProcess>
+#include <QtCore/QRegularExpression>
+#include <QtCore/QStandardPaths>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QTimer>
+#include <QtTest/QtTest>
+#include <QtWidgets/QApplication>
+#include <QtWidgets/QComboBox>
+#include <QtWidgets/QLabel>
+#include <QtWidgets/QLineEdit>
+#include <QtWidgets/QListWidget>
+#include <QtWidgets/QMainWindow>
+#include <QtWidgets/QTabWidget>
+#include <QtWidgets/QTableView>
+
+#include <functional>
+#include <memory>
+
+// Defined by main.cpp when it is built with PACMANCACHECLEANER_NO_MAIN.
+QMainWindow *createMainWindow();
+
+// Opens each tab of the real window, offscreen, against a fixture system
+// root and the stand-in tools in standins/, and checks how long it takes
+// until the tab shows something and until its refresh has finished. Every
+// row runs in a new window:
+//   cold     no stored results and nothing in the shared metadata cache,
+//            as on the first start (the kernel's page cache stays warm)
+//   warm     the results stored by the cold row are shown first
+//   refresh  the tab's refresh slot, invoked once the tab is settled; only
+//            the total time is reported, against its own budget
+// The Services tab reads MockSystemd on a private dbus-daemon that stands in
+// for the system bus. Dataset sizes and budgets come from the environment,
+// see README.md.
+class TabLatency : public QObject
+{
+    Q_OBJECT
+
+private:
+    // The tab indexes of PacmanCacheCleaner::Tab.
+    enum Tab
+    {
+        CacheTab,
+        OrphanedTab,
+        LogsTab,
+        ServicesTab,
+        DiskUsageTab
+    };
+
+    struct Probe
+    {
+        Tab tab;
+        const char *refreshSlot;
+        std::function<bool(QWidget *)> firstResult;
+        std::function<bool(QWidget *)> done;
+    };
+
+    static int setting(const char *name, int fallback)
+    {
+        bool ok = false;
+        const int configured = qEnvironmentVariableIntValue(name, &ok);
+        return ok && configured > 0 ? configured : fallback;
+    }
+
+    static bool anyLabel(QWidget *tab, const QRegularExpression &pattern)
+    {
+        for (QLabel *label : tab->findChildren<QLabel *>()) {
+            if (pattern.match(label->text()).hasMatch()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static int tableRows(QWidget *tab)
+    {
+        int rows = 0;
+        for (QTableView *table : tab->findChildren<QTableView *>()) {
+            if (table->model()) {
+                rows = qMax(rows, table->model()->rowCount());
+            }
+        }
+        return rows;
+    }
+
+    // The first line process prints, or an empty one if it prints none
+    // within timeoutMs.
+    static QByteArray firstLine(QProcess &process, int timeoutMs)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        while (!process.canReadLine() && timer.elapsed() < timeoutMs) {
+            if (!process.waitForReadyRead(int(qMax<qint64>(1, timeoutMs - timer.elapsed())))) {
+                break;
+            }
+        }
+        return process.canReadLine() ? process.readLine().trimmed() : QByteArray();
+    }
+
+    // Starts a dbus-daemon on a socket under m_home, points
+    // DBUS_SYSTEM_BUS_ADDRESS at it and puts MockSystemd on it, so nothing
+    // reaches the real system bus.
+    bool startMockSystemd(QString *error)
+    {
+        const QString daemon = QStandardPaths::findExecutable("dbus-daemon");
+        if (daemon.isEmpty()) {
+            *error = "dbus-daemon not found on PATH";
+            return false;
+        }
+        m_bus.start(daemon, { "--session", "--nofork", "--nopidfile", "--print-address",
+                              "--address=unix:path=" + m_home.filePath("system_bus_socket") });
+        const QByteArray address = firstLine(m_bus, 10000);
+        if (address.isEmpty()) {
+            *error = "dbus-daemon did not start: " + QString::fromLocal8Bit(m_bus.readAllStandardError());
+            return false;
+        }
+        // Read once, by the first QDBusConnection::systemBus().
+        qputenv("DBUS_SYSTEM_BUS_ADDRESS", address);
+
+        m_systemd.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        m_systemd.start(PCC_MOCK_SYSTEMD, { QString::number(m_services) });
+        if (firstLine(m_systemd, 10000) != "ready") {
+            *error = "MockSystemd did not take org.freedesktop.systemd1";
+            return false;
+        }
+        return true;
+    }
+
+    static QComboBox *partitionsCombo(QWidget *tab)
+    {
+        for (QComboBox *combo : tab->findChildren<QComboBox *>()) {
+            if (combo->count() > 0 && combo->itemText(0).startsWith("/dev/")) {
+                return combo;
+            }
+        }
+        return nullptr;
+    }
+
+    static QLineEdit *directoryEdit(QWidget *tab)
+    {
+        for (QLineEdit *edit : tab->findChildren<QLineEdit *>()) {
+            if (edit->text().startsWith('/')) {
+                return edit;
+            }
+        }
+        return nullptr;
+    }
+
+    static void addRows()
+    {
+        QTest::addColumn<QString>("mode");
+        QTest::newRow("cold") << QString("cold");
+        QTest::newRow("warm") << QString("warm");
+        QTest::newRow("refresh") << QString("refresh");
+    }
+
+    // Spins the event loop until probe.done holds or the total budget runs
+    // out; firstResultMs, if given, is when probe.firstResult first held.
+    bool waitFor(const Probe &probe, QWidget *tab, const QElapsedTimer &timer, qint64 *firstResultMs,
+                 qint64 *totalMs)
+    {
+        if (firstResultMs) {
+            *firstResultMs = -1;
+        }
+        // Every change a probe looks for arrives as an event; the tick only
+        // bounds how long the loop sleeps past the budget.
+        QTimer tick;
+        tick.start(50);
+        while (timer.elapsed() < m_totalBudgetMs) {
+            if (firstResultMs && *firstResultMs < 0 && probe.firstResult(tab)) {
+                *firstResultMs = timer.elapsed();
+            }
+            if (probe.done(tab)) {
+                *totalMs = timer.elapsed();
+                if (firstResultMs && *firstResultMs < 0) {
+                    *firstResultMs = *totalMs;
+                }
+                return true;
+            }
+            QCoreApplication::processEvents(QEventLoop::AllEvents | QEventLoop::WaitForMoreEvents);
+        }
+        return false;
+    }
+
+    void measure(const Probe &probe)
+    {
+        QFETCH(QString, mode);
+        if (mode == "cold") {
+            QDir(ResultCache::defaultDirectory()).removeRecursively();
+            // Earlier rows and tabs walked the same root in this process.
+            FileMetadataCache::instance().invalidate(m_root);
+        }
+
+        std::unique_ptr<QMainWindow> window(createMainWindow());
+        QTabWidget *tabs = window->findChild<QTabWidget *>();
+        QVERIFY(tabs);
+
+        // Switching before show() keeps the Cache Management tab, built by
+        // the constructor, from starting its own scan alongside.
+        QElapsedTimer timer;
+        timer.start();
+        tabs->setCurrentIndex(probe.tab);
+        window->show();
+        QWidget *tab = tabs->currentWidget()->findChild<QWidget *>(QString(), Qt::FindDirectChildrenOnly);
+        QVERIFY(tab);
+
+        qint64 firstResultMs = -1;
+        qint64 totalMs = -1;
+        QVERIFY2(waitFor(probe, tab, timer, &firstResultMs, &totalMs),
+                 qPrintable(QString("not done within %1 ms").arg(m_totalBudgetMs)));
+
+        if (mode == "refresh") {
+            if (QLineEdit *edit = directoryEdit(tab)) {
+                edit->clear();
+            }
+            timer.restart();
+            QVERIFY(QMetaObject::invokeMethod(tab, probe.refreshSlot));
+            QVERIFY2(waitFor(probe, tab, timer, nullptr, &totalMs),
+                     qPrintable(QString("refresh not done within %1 ms").arg(m_totalBudgetMs)));
+            qInfo("%s: total %lld ms", probe.refreshSlot, totalMs);
+            QVERIFY2(totalMs <= m_refreshBudgetMs,
+                     qPrintable(QString("refresh took %1 ms, budget %2 ms").arg(totalMs).arg(m_refreshBudgetMs)));
+        } else {
+            qInfo("%s: first result %lld ms, total %lld ms", qPrintable(tabs->tabText(probe.tab)), firstResultMs,
+                  totalMs);
+            QVERIFY2(firstResultMs <= m_firstResultBudgetMs,
+                     qPrintable(QString("first result after %1 ms, budget %2 ms")
+                                    .arg(firstResultMs).arg(m_firstResultBudgetMs)));
+        }
+    }
+
+private slots:
+    void initTestCase()
+    {
+        QVERIFY(m_home.isValid());
+        m_packages = Fixtures::maxEntries();
+        m_logs = Fixtures::maxEntries();
+        m_orphans = setting("PCC_FAKE_ORPHANS", qMax(1, m_packages / 10));
+        m_services = Fixtures::maxEntries();
+        m_firstResultBudgetMs = setting("PCC_E2E_FIRST_RESULT_MS", 2000);
+        m_refreshBudgetMs = setting("PCC_E2E_REFRESH_MS", 10000);
+        m_totalBudgetMs = setting("PCC_E2E_TOTAL_MS", 30000);
+
+        QElapsedTimer timer;
+        timer.start();
+        m_root = Fixtures::sysroot(m_packages, m_logs);
+        qInfo("sysroot %s (%d packages, %d log files) ready in %lld ms", qPrintable(m_root), m_packages, m_logs,
+              timer.elapsed());
+
+        // Set before anything calls systemRoot(), which reads it once.
+        qputenv("PACMAN_CACHE_CLEANER_SYSROOT", QFile::encodeName(m_root));
+        qputenv("PATH", QFile::encodeName(PCC_STANDINS_DIR) + ":" + qgetenv("PATH"));
+        qputenv("PCC_FAKE_ORPHANS", QByteArray::number(m_orphans));
+        qputenv("PCC_STANDIN_LOG", QFile::encodeName(m_home.filePath("standins.log")));
+        for (const char *variable : { "XDG_CACHE_HOME", "XDG_CONFIG_HOME", "XDG_DATA_HOME" }) {
+            const QString path = m_home.filePath(QString::fromLatin1(variable).toLower());
+            QDir().mkpath(path);
+            qputenv(variable, QFile::encodeName(path));
+        }
+
+        if (!startMockSystemd(&m_mockSystemdError)) {
+            qWarning("Services tab skipped: %s", qPrintable(m_mockSystemdError));
+        }
+    }
+
+    void cacheTab_data()
+    {
+        addRows();
+    }
+
+    void cacheTab()
+    {
+        // Three cached files per package, see Fixtures::packageCache().
+        const int files = m_packages * 3;
+        measure({ CacheTab, "refreshCacheSize",
+                  [](QWidget *tab) { return tableRows(tab) > 0; },
+                  [files](QWidget *tab) {
+                      return tableRows(tab) == files && anyLabel(tab, QRegularExpression("\\[\\d+ ms\\]$"));
+                  } });
+    }
+
+    void orphanedTab_data()
+    {
+        addRows();
+    }
+
+    void orphanedTab()
+    {
+        const QRegularExpression found(QString("^Found %1 orphaned packages$").arg(m_orphans));
+        measure({ OrphanedTab, "listOrphanedPackages",
+                  [](QWidget *tab) {
+                      QListWidget *list = tab->findChild<QListWidget *>();
+                      return list && list->count() > 0 && list->item(0)->text().startsWith("orphan");
+                  },
+                  [found](QWidget *tab) { return anyLabel(tab, found); } });
+    }
+
+    void logsTab_data()
+    {
+        addRows();
+    }
+
+    void logsTab()
+    {
+        // One of every five fixture files is not a log.
+        const QRegularExpression found(QString("^Found %1 log files in \\d+ ms$").arg(m_logs - m_logs / 5));
+        measure({ LogsTab, "refreshLogsList",
+                  [](QWidget *tab) { return tableRows(tab) > 0; },
+                  [found](QWidget *tab) { return anyLabel(tab, found); } });
+    }
+
+    void diskUsageTab_data()
+    {
+        addRows();
+    }
+
+    void diskUsageTab()
+    {
+        measure({ DiskUsageTab, "refreshPartitions",
+                  [](QWidget *tab) { return partitionsCombo(tab) != nullptr; },
+                  [](QWidget *tab) {
+                      QComboBox *combo = partitionsCombo(tab);
+                      QLineEdit *edit = directoryEdit(tab);
+                      return combo && edit && edit->text() == combo->currentData().toString();
+                  } });
+    }
+
+    void servicesTab_data()
+    {
+        addRows();
+    }
+
+    void servicesTab()
+    {
+        if (!m_mockSystemdError.isEmpty()) {
+            QSKIP(qPrintable(m_mockSystemdError));
+        }
+        // One of every five mock units is a socket.
+        const QRegularExpression found(QString("^Found %1 services in \\d+ ms$").arg(m_services - m_services / 5));
+        measure({ ServicesTab, "refreshServicesList",
+                  [](QWidget *tab) { return tableRows(tab) > 0; },
+                  [found](QWidget *tab) { return anyLabel(tab, found); } });
+    }
+
+    void cleanupTestCase()
+    {
+        for (QProcess *process : { &m_systemd, &m_bus }) {
+            process->terminate();
+            process->waitForFinished();
+        }
+
+        QFile log(m_home.filePath("standins.log"));
+        if (!log.open(QIODevice::ReadOnly)) {
+            return;
+        }
+        for (const QByteArray &line : log.readAll().split('\n')) {
+            QVERIFY2(!line.startsWith("systemctl ") && !line.startsWith("du "),
+                     qPrintable("unexpected call: " + QString::fromLocal8Bit(line)));
+        }
+    }
+
+private:
+    QTemporaryDir m_home;
+    QString m_root;
+    int m_packages = 0;
+    int m_logs = 0;
+    int m_orphans = 0;
+    int m_services = 0;
+    int m_firstResultBudgetMs = 0;
+    int m_refreshBudgetMs = 0;
+    int m_totalBudgetMs = 0;
+    QProcess m_bus;
+    QProcess m_systemd;
+    QString m_mockSystemdError;
+};
+
+int main(int argc, char *argv[])
+{
+    // Unless the caller picked a platform, no display is needed.
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    app.setApplicationName("Pacman Cache Cleaner");
+    TabLatency test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tablatency.moc"
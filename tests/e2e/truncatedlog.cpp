@@ -0,0 +1,62 @@
+#include "fileutil.h"
+#include "lineindex.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QTemporaryDir>
+#include <QtTest/QtTest>
+
+// A log viewer maps the whole file and indexes it; logrotate's copytruncate
+// can then cut the file down under the mapping. Every read past the new end
+// must come back as zeros or an empty line, not SIGBUS.
+class TruncatedLog : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void readPastNewEnd()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QString path = dir.filePath("truncated.log");
+
+        // Several pages and more than one checkpoint interval of lines.
+        const int lines = 100000;
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        for (int i = 0; i < lines; ++i) {
+            file.write(QString("2024-01-02T15:04:05 line %1\n").arg(i).toUtf8());
+        }
+        file.close();
+
+        MappedFile mapping;
+        QVERIFY(mapping.open(path));
+        LineIndex index;
+        index.reset(mapping.data(), mapping.size());
+        for (int chunk = 0; chunk < LineIndex::chunkCount(mapping.size()); ++chunk) {
+            index.append(LineIndex::indexChunk(mapping.data(), mapping.size(), chunk));
+        }
+        QCOMPARE(index.lineCount(), qint64(lines));
+        QCOMPARE(index.line(0), QByteArray("2024-01-02T15:04:05 line 0"));
+
+        QVERIFY(file.resize(100));
+        QVERIFY(!mapping.truncated());
+
+        // Lines reached by skipping from a checkpoint, the checkpoint lines
+        // themselves, and the last line.
+        for (qint64 line : { qint64(lines / 2 + 1), qint64(LineIndex::CheckpointInterval * 100), qint64(lines - 1) }) {
+            const qint64 start = index.lineStart(line);
+            QVERIFY(start < mapping.size());
+            const QByteArray text = index.line(line);
+            QVERIFY(!text.contains("line"));
+        }
+        QVERIFY(mapping.truncated());
+
+        // The part that is left reads as before.
+        QCOMPARE(index.line(0), QByteArray("2024-01-02T15:04:05 line 0"));
+        QCOMPARE(SubstringSearch::findFirst(mapping.data(), mapping.size(), 100, "line 9999"), qint64(-1));
+    }
+};
+
+QTEST_GUILESS_MAIN(TruncatedLog)
+
+#include "truncatedlog.moc"
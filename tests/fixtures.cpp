@@ -0,0 +1,318 @@
+#include "fixtures.h"
+#include "fileutil.h"
+#include "logcompressor.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+const char CompleteMarker[] = ".complete";
+
+const char *const Services[] = { "nginx", "postgresql", "sshd", "cups", "httpd", "mysql", "samba", "audit" };
+const char *const Messages[] = {
+    "Started Session of user alice.",
+    "Accepted publickey for deploy from 10.0.3.17 port 52144 ssh2",
+    "GET /api/v1/status HTTP/1.1 200 512 \"-\" \"curl/8.5.0\"",
+    "checkpoint complete: wrote 1874 buffers (11.4%); 0 WAL file(s) added",
+    "connection reset by peer while reading response header from upstream",
+    "pam_unix(sudo:session): session opened for user root(uid=0) by alice(uid=1000)",
+};
+
+// Generation is skipped when the marker exists; a half-written fixture
+// from an interrupted run has none, so it is wiped and written again.
+bool prepare(const QString &path)
+{
+    if (QFileInfo::exists(path + "/" + CompleteMarker)) {
+        return false;
+    }
+    QDir(path).removeRecursively();
+    QDir().mkpath(path);
+    return true;
+}
+
+void markComplete(const QString &path)
+{
+    QFile marker(path + "/" + CompleteMarker);
+    marker.open(QIODevice::WriteOnly);
+}
+
+// Warns and returns false on failure, so a generator can stop before the
+// fixture is marked complete.
+bool writeFile(const QString &path, const QByteArray &contents, qint64 size = -1)
+{
+    UniqueFd fd(::open(QFile::encodeName(path).constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+    if (!fd.isValid()
+        || (!contents.isEmpty() && !writeFully(fd.get(), contents.constData(), contents.size()))
+        || (size > contents.size() && ::ftruncate(fd.get(), size) != 0)) {
+        qWarning("%s", qPrintable(errnoString(path)));
+        return false;
+    }
+    return true;
+}
+
+QString packageName(int index)
+{
+    return QString("pkg%1").arg(index, 6, 10, QChar('0'));
+}
+
+QByteArray desc(const QString &name, const QString &version, const QString &fileName)
+{
+    QByteArray data;
+    if (!fileName.isEmpty()) {
+        data += "%FILENAME%\n" + fileName.toUtf8() + "\n\n";
+    }
+    data += "%NAME%\n" + name.toUtf8() + "\n\n";
+    data += "%VERSION%\n" + version.toUtf8() + "\n\n";
+    data += "%DESC%\nSynthetic package for benchmarks\n\n";
+    data += "%CSIZE%\n" + QByteArray::number(1024 * 1024) + "\n\n";
+    data += "%SIZE%\n" + QByteArray::number(4 * 1024 * 1024) + "\n\n";
+    data += "%SHA256SUM%\n" + QByteArray(64, 'a') + "\n\n";
+    data += "%DEPENDS%\nglibc\nzlib\n\n";
+    return data;
+}
+
+// One ustar member; the parser only needs name, size, type and checksum.
+void appendTarEntry(QByteArray *tar, const QByteArray &name, const QByteArray &data)
+{
+    char header[512];
+    memset(header, 0, sizeof(header));
+    memcpy(header, name.constData(), size_t(qMin(name.size(), 99)));
+    memcpy(header + 100, "0000644", 7);
+    memcpy(header + 108, "0000000", 7);
+    memcpy(header + 116, "0000000", 7);
+    snprintf(header + 124, 12, "%011llo", static_cast<unsigned long long>(data.size()));
+    memcpy(header + 136, "00000000000", 11);
+    header[156] = '0';
+    memcpy(header + 257, "ustar", 6);
+    memcpy(header + 263, "00", 2);
+
+    memset(header + 148, ' ', 8);
+    unsigned int checksum = 0;
+    for (unsigned char byte : header) {
+        checksum += byte;
+    }
+    snprintf(header + 148, 8, "%06o", checksum);
+    header[155] = ' ';
+
+    tar->append(header, sizeof(header));
+    tar->append(data);
+    tar->append(QByteArray((512 - data.size() % 512) % 512, '\0'));
+}
+
+bool generateLogTree(const QString &path, int files)
+{
+    const int services = int(sizeof(Services) / sizeof(Services[0]));
+    const QByteArray text = Fixtures::logText(4096);
+    for (int i = 0; i < files; ++i) {
+        const QString directory = QString("%1/%2%3").arg(path, Services[i % services]).arg(i / (services * 50));
+        if (i % (services * 50) < services) {
+            QDir().mkpath(directory);
+        }
+        QString name;
+        switch (i % 5) {
+        case 0:
+            name = QString("access%1.log").arg(i);
+            break;
+        case 1:
+            name = QString("access%1.log.1").arg(i);
+            break;
+        case 2:
+            name = QString("access%1.log.2.gz").arg(i);
+            break;
+        case 3:
+            name = QString("error%1.log-20240101.zst").arg(i);
+            break;
+        default:
+            // Not a log name; the scanner must skip it cheaply.
+            name = QString("state%1.pid").arg(i);
+            break;
+        }
+        if (!writeFile(directory + "/" + name, text, 4096 + (i % 64) * 1024)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool generateLocalDb(const QString &path, int packages)
+{
+    for (int i = 0; i < packages; ++i) {
+        const QString name = packageName(i);
+        const QString directory = QString("%1/%2-1.0-1").arg(path, name);
+        QDir().mkpath(directory);
+        if (!writeFile(directory + "/desc", desc(name, "1.0-1", QString()))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool generateSyncDb(const QString &path, int packages)
+{
+    QByteArray tar;
+    for (int i = 0; i < packages; ++i) {
+        // Half installed and current, then alternately an upgrade of an
+        // installed package and a package that was never installed.
+        const bool upgrade = i >= packages / 2 && i % 2 == 1;
+        const QString name = packageName(i < packages / 2 || upgrade ? i : packages + i);
+        const QString version = upgrade ? "1.1-1" : "1.0-1";
+        const QString fileName = QString("%1-%2-x86_64.pkg.tar.zst").arg(name, version);
+        appendTarEntry(&tar, QString("%1-%2/desc").arg(name, version).toUtf8(), desc(name, version, fileName));
+    }
+    tar.append(QByteArray(1024, '\0'));
+
+    CompressionPolicy policy;
+    policy.codec = CompressionCodec::Gzip;
+    QDir().mkpath(path);
+    return writeFile(path + "/core.db", LogCompressor::compressBlock(tar.constData(), tar.size(), policy));
+}
+
+bool generatePackageCache(const QString &path, int packages)
+{
+    QDir().mkpath(path);
+    for (int i = 0; i < packages; ++i) {
+        const QString name = packageName(i);
+        for (const char *version : { "1.0-1", "1.1-1", "0.9-1" }) {
+            if (!writeFile(QString("%1/%2-%3-x86_64.pkg.tar.zst").arg(path, name, version), QByteArray(),
+                           1024 * 1024 + i)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+namespace Fixtures {
+
+QString root()
+{
+    const QString configured = qEnvironmentVariable("PCC_FIXTURE_DIR");
+    return configured.isEmpty() ? QDir::tempPath() + "/pcc-fixtures" : configured;
+}
+
+int maxEntries()
+{
+    bool ok = false;
+    const int configured = qEnvironmentVariableIntValue("PCC_MAX_ENTRIES", &ok);
+    return ok && configured > 0 ? configured : 100000;
+}
+
+QString fileTree(int entries)
+{
+    const QString path = QString("%1/tree-%2").arg(root()).arg(entries);
+    if (!prepare(path)) {
+        return path;
+    }
+    const int perDirectory = 100;
+    const int directories = (entries + perDirectory - 1) / perDirectory;
+    const int fanOut = qMax(1, int(std::ceil(std::sqrt(double(directories)))));
+    for (int d = 0; d < directories; ++d) {
+        const QString directory = QString("%1/d%2/d%3").arg(path).arg(d / fanOut).arg(d % fanOut);
+        QDir().mkpath(directory);
+        for (int f = d * perDirectory; f < qMin(entries, (d + 1) * perDirectory); ++f) {
+            // Spread over four orders of magnitude so sorting has work to do.
+            const qint64 size = qint64((f * 2654435761u) % 10000) * (1 + f % 97);
+            if (!writeFile(QString("%1/f%2.dat").arg(directory).arg(f), QByteArray(), size)) {
+                return path;
+            }
+        }
+    }
+    markComplete(path);
+    return path;
+}
+
+QString logTree(int files)
+{
+    const QString path = QString("%1/log-%2").arg(root()).arg(files);
+    if (!prepare(path)) {
+        return path;
+    }
+    if (generateLogTree(path, files)) {
+        markComplete(path);
+    }
+    return path;
+}
+
+QString localDb(int packages)
+{
+    const QString path = QString("%1/local-%2").arg(root()).arg(packages);
+    if (!prepare(path)) {
+        return path;
+    }
+    if (generateLocalDb(path, packages)) {
+        markComplete(path);
+    }
+    return path;
+}
+
+QString syncDb(int packages)
+{
+    const QString path = QString("%1/sync-%2").arg(root()).arg(packages);
+    if (!prepare(path)) {
+        return path;
+    }
+    if (generateSyncDb(path, packages)) {
+        markComplete(path);
+    }
+    return path;
+}
+
+QString packageCache(int packages)
+{
+    const QString path = QString("%1/cache-%2").arg(root()).arg(packages);
+    if (!prepare(path)) {
+        return path;
+    }
+    if (generatePackageCache(path, packages)) {
+        markComplete(path);
+    }
+    return path;
+}
+
+QString sysroot(int packages, int logs)
+{
+    const QString path = QString("%1/sysroot-%2-%3").arg(root()).arg(packages).arg(logs);
+    if (!prepare(path)) {
+        return path;
+    }
+    if (generatePackageCache(path + "/var/cache/pacman/pkg", packages)
+        && generateLocalDb(path + "/var/lib/pacman/local", packages)
+        && generateSyncDb(path + "/var/lib/pacman/sync", packages)
+        && generateLogTree(path + "/var/log", logs)) {
+        markComplete(path);
+    }
+    return path;
+}
+
+QByteArray logText(qint64 bytes)
+{
+    const int services = int(sizeof(Services) / sizeof(Services[0]));
+    const int messages = int(sizeof(Messages) / sizeof(Messages[0]));
+    QByteArray text;
+    text.reserve(int(bytes) + 256);
+    for (int line = 0; text.size() < bytes; ++line) {
+        text += QString("Jan %1 %2:%3:%4 host %5[%6]: %7\n")
+            .arg(1 + line / 86400 % 28, 2)
+            .arg(line / 3600 % 24, 2, 10, QChar('0'))
+            .arg(line / 60 % 60, 2, 10, QChar('0'))
+            .arg(line % 60, 2, 10, QChar('0'))
+            .arg(Services[line % services])
+            .arg(1000 + line % 30000)
+            .arg(Messages[(line * 7) % messages])
+            .toLatin1();
+    }
+    text.truncate(int(bytes));
+    return text;
+}
+
+} // namespace Fixtures
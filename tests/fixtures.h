@@ -0,0 +1,52 @@
+#ifndef FIXTURES_H
+#define FIXTURES_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
+
+// Synthetic stand-ins for the directories the engines read. Each fixture is
+// generated once per size under root() and reused for as long as it exists,
+// since writing a million-entry tree costs far more than walking it.
+// A fixture that could not be written completely is reported with a
+// warning and left unmarked, so the next run generates it again.
+namespace Fixtures {
+
+// $PCC_FIXTURE_DIR, or pcc-fixtures under the system temporary directory.
+QString root();
+
+// The largest dataset a run may generate: $PCC_MAX_ENTRIES, default 100000.
+int maxEntries();
+
+// entries regular files, 100 per directory under two levels of
+// directories; sizes are set with ftruncate, so the tree costs inodes only.
+QString fileTree(int entries);
+
+// A /var/log lookalike: files logs spread over per-service directories,
+// with numbered and compressed rotations and some non-log files the
+// scanner must skip.
+QString logTree(int files);
+
+// A pacman local database (<name>-<version>/desc) of packages entries.
+QString localDb(int packages);
+
+// A sync database directory holding core.db, a gzip-compressed tar of
+// packages <name>-<version>/desc entries: half of localDb's packages at
+// their installed version, then alternately an upgrade of an installed
+// package and a package that was never installed.
+QString syncDb(int packages);
+
+// A package cache with three files per localDb package: the installed
+// 1.0-1, a 1.1-1 the sync db lists for some of them, and a 0.9-1 nothing
+// refers to.
+QString packageCache(int packages);
+
+// All of the above laid out as a system root (var/cache/pacman/pkg,
+// var/lib/pacman/{local,sync}, var/log) for PACMAN_CACHE_CLEANER_SYSROOT.
+QString sysroot(int packages, int logs);
+
+// Plausible syslog lines, deterministic for a given size.
+QByteArray logText(qint64 bytes);
+
+} // namespace Fixtures
+
+#endif // FIXTURES_H